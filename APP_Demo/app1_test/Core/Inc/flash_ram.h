@@ -0,0 +1,108 @@
+/**
+  ******************************************************************************
+  * @file           : flash_ram.h
+  * @brief          : ITCM 常驻的 Flash 编程/擦除驱动
+  * @description    : 写 App 自己所在 Bank (active trailer) 用。操作期间该 Bank
+  *                   的读访问 (取指、读常量、取向量) 会被阻塞到操作结束，
+  *                   因此编程/擦除/等待代码运行在 ITCM，操作期间按
+  *                   FLASH_RAM_BASEPRI 屏蔽处理函数在 Flash 中的中断
+  * @note           : 地址均为逻辑地址；写另一个 Bank 用 flash_port.h 即可
+  ******************************************************************************
+  */
+
+#ifndef __FLASH_RAM_H
+#define __FLASH_RAM_H
+
+#include <stdint.h>
+
+/*============================================================================
+ * 说明
+ *============================================================================*/
+/*
+ * FLASH_RAM_FUNC 标记的函数放在 .itcm_text 段，由 app1_test.sct 的 ER_ITCM
+ * 执行区链接到 ITCM (0x00000000)，启动时由 __main 从 Flash 复制过去。
+ *
+ * 操作期间 (写入 START/最后一个字之后到 QW 清零) 只执行 ITCM 中的代码：
+ *   - 等待回调 cb 在轮询循环中反复调用，必须同样用 FLASH_RAM_FUNC 标记，
+ *     且不能调用 Flash 中的函数 (HAL、printf、memcpy 等)
+ *   - FlashRam_Init() 把向量表复制到 RAM，取向量不再访问 Flash；
+ *     要在操作期间响应的中断，其处理函数也要用 FLASH_RAM_FUNC 标记
+ *   - 处理函数仍在 Flash 中的中断会在取指时停住，直到操作结束；
+ *     FLASH_RAM_BASEPRI 决定操作期间屏蔽哪些中断，避免它们占住 CPU
+ *
+ * 本工程默认 BASEPRI 阈值为 1：
+ *   - SysTick 与 TIM2 (控制周期) 优先级为 0，处理函数在 ITCM (stm32h7xx_it.c)，
+ *     擦除/编程期间照常运行，HAL_GetTick 不滞后
+ *   - USART1/DMA1 优先级为 1，处理函数在 Flash 中，操作期间被推迟；
+ *     USART1 由 DMA 循环接收，空闲线/DMA 中断在操作结束后补发
+ * 新增优先级为 0 的中断时，其处理函数及其调用的函数都必须放在 ITCM。
+ *
+ * 源数据必须在 RAM 中。不做整片 D-Cache 清理：CPU 逐字写入 Flash，
+ * 数据不经 DMA；完成后只丢弃写入/擦除范围的 Cache 行。
+ */
+
+/*============================================================================
+ * 配置
+ *============================================================================*/
+
+/* 操作期间屏蔽全部可屏蔽中断 (PRIMASK) */
+#define FLASH_RAM_MASK_ALL    0xFFu
+
+/* 操作期间的中断屏蔽：1~15=BASEPRI 阈值 (默认 1)，优先级数值 >= 该值的中断
+ * 被推迟到操作结束，高于它的中断照常响应 (处理函数须在 ITCM)；
+ * 0=不屏蔽 (所有处理函数都须在 ITCM)；FLASH_RAM_MASK_ALL=全部屏蔽 (PRIMASK) */
+#ifndef FLASH_RAM_BASEPRI
+#define FLASH_RAM_BASEPRI     1u
+#endif
+
+/* 单次等待的超时 (扇区擦除典型 2s) */
+#ifndef FLASH_RAM_TIMEOUT_MS
+#define FLASH_RAM_TIMEOUT_MS  4000u
+#endif
+
+#define FLASH_RAM_FUNC        __attribute__((section(".itcm_text"), noinline))
+
+/*============================================================================
+ * 数据类型定义
+ *============================================================================*/
+
+/**
+ * @brief  等待期间的回调 (线程上下文，在轮询循环中反复调用)
+ * @param  arg: 调用 FlashRam_xxx 时传入的参数
+ * @note   必须用 FLASH_RAM_FUNC 标记，只能访问 RAM 与外设寄存器
+ */
+typedef void (*flash_ram_poll_cb_t)(void* arg);
+
+/*============================================================================
+ * 函数声明
+ *============================================================================*/
+
+/**
+ * @brief  把当前向量表复制到 RAM 并切换 VTOR (只需调用一次，在使能中断前后均可)
+ * @note   之后 NVIC_SetVector 修改的是 RAM 中的副本
+ */
+void FlashRam_Init(void);
+
+/**
+ * @brief  编程连续的 flash word
+ * @param  addr: 目标地址 (32B 对齐)
+ * @param  data: 源数据 (RAM 中，不要求对齐)
+ * @param  len: 数据长度 (32 的整数倍)
+ * @param  cb: 等待回调 (可为 NULL)
+ * @param  arg: 回调参数
+ * @retval 0=成功, -1=参数错误, -2=编程失败或超时
+ * @note   目标必须已擦除；返回前丢弃写入范围的旧 Cache 行
+ */
+int FlashRam_Program(uint32_t addr, const void* data, uint32_t len,
+                     flash_ram_poll_cb_t cb, void* arg);
+
+/**
+ * @brief  擦除地址所在的扇区
+ * @param  addr: 扇区内任意地址
+ * @param  cb: 等待回调 (可为 NULL)
+ * @param  arg: 回调参数
+ * @retval 0=成功, -1=失败或超时
+ */
+int FlashRam_EraseSector(uint32_t addr, flash_ram_poll_cb_t cb, void* arg);
+
+#endif /* __FLASH_RAM_H */
@@ -14,6 +14,7 @@ extern "C" {
 #endif
 
 #include <stdint.h>
+#include "flash_ram.h"
 
 
 
@@ -25,6 +26,11 @@ extern "C" {
 #define TR_MAGIC          0x544C5252u   /* 'TLRR' trailer magic */
 #define TRAILER_SIZE      0x00020000u   /* 128KB trailer 扇区大小 */
 
+/* 已用记录数达到此值后 App_TrailerCompact 整理 trailer (共 4096 条) */
+#ifndef TRAILER_COMPACT_HWM
+#define TRAILER_COMPACT_HWM   3072u
+#endif
+
 #define IMG_HDR_MAGIC  (0xA5A55A5Au)
 #define IMG_HDR_VER    (1u)
 
@@ -51,7 +57,8 @@ typedef struct __attribute__((packed)) {
   uint32_t state;       /* 状态：TR_STATE_xxx */
   uint32_t attempt;     /* 尝试次数 1..N */
   uint32_t img_crc32;   /* 绑定的镜像 CRC32，防止写错槽 */
-  uint32_t addr;        /* 绑定的镜像地址 */
+  uint32_t addr;        /* 本记录自身的地址 (写入位置，逻辑地址)，所有写入方一致：
+                         * 追加为 base + 序号 * 32，整理/恢复后重写的记录在第 0 条，即 base */
   uint32_t rsv[2];      /* 保留，padding to 32B */
 } tr_rec_t;
 
@@ -87,6 +94,19 @@ typedef struct __attribute__((packed, aligned(4))) {
  */
 int App_ConfirmSelf(void);
 
+/**
+ * @brief  空闲时调用：trailer 已用记录数达到 TRAILER_COMPACT_HWM 后整理为一条记录
+ * @param  cb: 擦除/编程等待期间的回调 (FLASH_RAM_FUNC，可为 NULL)
+ * @param  arg: 回调参数
+ * @retval 1=已整理, 0=未达到高水位, -1=失败
+ * @note   擦除 128KB 扇区需要 1~2s，期间只有 ITCM 中的中断处理函数和 cb 在运行，
+ *         应在没有升级进行时调用 (如主循环中串口空闲时)。
+ *         顺序：最后一条状态记录写入 RTC 备份寄存器
+ *         → 擦除 → 在扇区起始处重写该记录 → 清除快照；中途掉电时 Bootloader
+ *         按快照恢复，Bootloader 之后的写入总有空位，不需要在启动时擦除
+ */
+int App_TrailerCompact(flash_ram_poll_cb_t cb, void* arg);
+
 /**
  * @brief  检查当前镜像是否处于 PENDING 状态
  * @retval 1=PENDING, 0=非 PENDING 或无记录
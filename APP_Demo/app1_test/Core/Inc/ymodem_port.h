@@ -49,6 +49,12 @@ void YmodemPort_UpdateRxHead(void* rb);
  */
 void YmodemPort_InvalidateCache(void* buf, uint32_t size);
 
+/**
+ * @brief  空闲等待 (Ymodem_Receive 在无数据时调用)
+ * @note   可执行 WFI 休眠、喂狗等；必须能被串口接收中断或系统滴答唤醒
+ */
+void YmodemPort_Idle(void);
+
 /*============================================================================
  * 日志输出 - 可选实现
  *============================================================================*/
@@ -0,0 +1,287 @@
+/**
+  ******************************************************************************
+  * @file           : flash_ram.c
+  * @brief          : ITCM 常驻的 Flash 编程/擦除驱动实现
+  * @description    : 直接操作 FLASH 寄存器 (HAL 代码在 Flash 中)。启动操作前的
+  *                   参数检查、解锁、超时换算和操作后的上锁、Cache 维护、统计
+  *                   在 Flash 中执行；从启动到 QW 清零的部分放在 ITCM
+  ******************************************************************************
+  */
+
+#include "flash_ram.h"
+#include "flash_port.h"
+#include "stm32h7xx_hal.h"
+
+/*============================================================================
+ * 内部常量
+ *============================================================================*/
+
+/* 16 个系统异常 + 150 个外设中断 (STM32H743: WWDG_IRQn..WAKEUP_PIN_IRQn) */
+#define VECTOR_COUNT          (16u + 150u)
+
+/* 编程/擦除错误标志 (SR1/SR2 位置相同，CCRx 的清除位与之对应) */
+#define SR_ERRORS             (FLASH_SR_WRPERR | FLASH_SR_PGSERR | FLASH_SR_STRBERR | \
+                               FLASH_SR_INCERR | FLASH_SR_OPERR)
+
+/*============================================================================
+ * 数据类型定义
+ *============================================================================*/
+
+/* 一个 Bank 的控制寄存器组 */
+typedef struct {
+    volatile uint32_t* keyr;
+    volatile uint32_t* cr;
+    volatile uint32_t* sr;
+    volatile uint32_t* ccr;
+} bank_regs_t;
+
+/*============================================================================
+ * 静态变量
+ *============================================================================*/
+
+/* RAM 中的向量表 (VTOR 要求按表大小向上取 2 的幂对齐) */
+static uint32_t s_vectors[VECTOR_COUNT] __attribute__((aligned(1024)));
+
+/*============================================================================
+ * 内部函数 (Flash 中执行，操作开始前/结束后调用)
+ *============================================================================*/
+
+/**
+ * @brief  地址所在 Bank 的寄存器组 (与 HAL 一致按逻辑地址选择)
+ */
+static void bank_regs(uint32_t addr, bank_regs_t* b)
+{
+    if (addr >= FLASH_BANK2_BASE) {
+        b->keyr = &FLASH->KEYR2;
+        b->cr   = &FLASH->CR2;
+        b->sr   = &FLASH->SR2;
+        b->ccr  = &FLASH->CCR2;
+    } else {
+        b->keyr = &FLASH->KEYR1;
+        b->cr   = &FLASH->CR1;
+        b->sr   = &FLASH->SR1;
+        b->ccr  = &FLASH->CCR1;
+    }
+}
+
+/**
+ * @brief  解锁并清除上次遗留的标志
+ * @retval 0=成功, -1=该 Bank 仍有操作在进行 (如后台擦除)
+ */
+static int bank_begin(const bank_regs_t* b)
+{
+    if (*b->sr & FLASH_SR_QW) {
+        return -1;
+    }
+    if (*b->cr & FLASH_CR_LOCK) {
+        *b->keyr = FLASH_KEY1;
+        *b->keyr = FLASH_KEY2;
+    }
+    *b->ccr = SR_ERRORS | FLASH_CCR_CLR_EOP;
+    return 0;
+}
+
+/**
+ * @brief  操作开始前按 FLASH_RAM_BASEPRI 屏蔽中断
+ * @retval 之前的屏蔽状态 (交给 irq_restore)
+ */
+static uint32_t irq_mask(void)
+{
+    uint32_t saved;
+
+#if FLASH_RAM_BASEPRI == FLASH_RAM_MASK_ALL
+    saved = __get_PRIMASK();
+    __disable_irq();
+#else
+    saved = __get_BASEPRI();
+    if (FLASH_RAM_BASEPRI) {
+        /* 只提高屏蔽级别，调用者已设置的更严格的 BASEPRI 保持不变 */
+        __set_BASEPRI_MAX(FLASH_RAM_BASEPRI << (8u - __NVIC_PRIO_BITS));
+    }
+#endif
+    return saved;
+}
+
+/**
+ * @brief  操作结束后恢复 irq_mask 之前的屏蔽状态
+ */
+static void irq_restore(uint32_t saved)
+{
+#if FLASH_RAM_BASEPRI == FLASH_RAM_MASK_ALL
+    __set_PRIMASK(saved);
+#else
+    __set_BASEPRI(saved);
+#endif
+}
+
+/**
+ * @brief  超时对应的周期数 (除法在操作开始前做，避免 ITCM 代码调用库函数)
+ */
+static uint32_t timeout_cycles(void)
+{
+    return (SystemCoreClock / 1000u) * FLASH_RAM_TIMEOUT_MS;
+}
+
+/*============================================================================
+ * ITCM 函数 (操作期间执行，不能调用 Flash 中的任何代码)
+ *============================================================================*/
+
+/**
+ * @brief  等待 QW 清零，期间反复调用回调
+ * @retval 0=成功, -1=错误或超时
+ */
+FLASH_RAM_FUNC static int wait_done(const bank_regs_t* b, uint32_t limit,
+                                    flash_ram_poll_cb_t cb, void* arg)
+{
+    uint32_t t0 = DWT->CYCCNT;
+
+    while (*b->sr & FLASH_SR_QW) {
+        if (cb) {
+            cb(arg);
+        }
+        if (DWT->CYCCNT - t0 > limit) {
+            return -1;
+        }
+    }
+    return (*b->sr & SR_ERRORS) ? -1 : 0;
+}
+
+/**
+ * @brief  逐个 flash word 编程并等待
+ */
+FLASH_RAM_FUNC static int program_words(const bank_regs_t* b, uint32_t addr,
+                                        const uint8_t* src, uint32_t len, uint32_t limit,
+                                        flash_ram_poll_cb_t cb, void* arg)
+{
+    int aligned = (((uint32_t)src & 3u) == 0);
+    int status = 0;
+
+    *b->cr |= FLASH_CR_PG;
+
+    for (uint32_t off = 0; off < len && status == 0; off += FLASH_PORT_WORD_SIZE) {
+        volatile uint32_t* dst = (volatile uint32_t*)(addr + off);
+
+        __ISB();
+        __DSB();
+        /* 逐字 volatile 访问，编译器不会把循环换成 Flash 中的 memcpy */
+        for (uint32_t i = 0; i < FLASH_PORT_WORD_SIZE / 4u; i++) {
+            uint32_t w;
+            if (aligned) {
+                w = ((const volatile uint32_t*)(src + off))[i];
+            } else {
+                const volatile uint8_t* s8 = src + off + i * 4u;
+                w = (uint32_t)s8[0] | ((uint32_t)s8[1] << 8) |
+                    ((uint32_t)s8[2] << 16) | ((uint32_t)s8[3] << 24);
+            }
+            dst[i] = w;                     /* 第 8 个字写入后开始编程 */
+        }
+        __ISB();
+        __DSB();
+
+        status = wait_done(b, limit, cb, arg);
+    }
+
+    *b->cr &= ~FLASH_CR_PG;
+    return status;
+}
+
+/**
+ * @brief  启动扇区擦除并等待
+ */
+FLASH_RAM_FUNC static int erase_sector(const bank_regs_t* b, uint32_t sector, uint32_t limit,
+                                       flash_ram_poll_cb_t cb, void* arg)
+{
+    int status;
+
+    *b->cr &= ~(FLASH_CR_PSIZE | FLASH_CR_SNB);
+    *b->cr |= FLASH_CR_SER | FLASH_VOLTAGE_RANGE_3 | (sector << FLASH_CR_SNB_Pos) | FLASH_CR_START;
+
+    status = wait_done(b, limit, cb, arg);
+
+    *b->cr &= ~(FLASH_CR_SER | FLASH_CR_SNB);
+    return status;
+}
+
+/*============================================================================
+ * 公共函数实现
+ *============================================================================*/
+
+void FlashRam_Init(void)
+{
+    const uint32_t* src = (const uint32_t*)SCB->VTOR;
+
+    if (src == s_vectors) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < VECTOR_COUNT; i++) {
+        s_vectors[i] = src[i];
+    }
+    __DSB();
+    SCB->VTOR = (uint32_t)s_vectors;
+    __DSB();
+    __ISB();
+}
+
+int FlashRam_Program(uint32_t addr, const void* data, uint32_t len,
+                     flash_ram_poll_cb_t cb, void* arg)
+{
+    bank_regs_t b;
+    uint32_t irq;
+    int status;
+
+    if (!data || (addr % FLASH_PORT_WORD_SIZE) != 0 || (len % FLASH_PORT_WORD_SIZE) != 0) {
+        return -1;
+    }
+
+    bank_regs(addr, &b);
+    uint32_t t0 = FlashPort_StatsNow();     /* 同时确保 DWT 已启用 (超时计时) */
+    uint32_t limit = timeout_cycles();
+
+    irq = irq_mask();
+
+    status = bank_begin(&b);
+    if (status == 0) {
+        status = program_words(&b, addr, (const uint8_t*)data, len, limit, cb, arg);
+        *b.cr |= FLASH_CR_LOCK;
+    }
+
+    irq_restore(irq);
+
+    /* Flash 为 Write-Through，只需丢弃写入范围内的旧 Cache 行 */
+    if (len > 0) {
+        FlashPort_InvalidateCache(addr, len);
+    }
+
+    FlashPort_StatsRecord(FLASH_OP_PROGRAM, addr, len, FlashPort_StatsNow() - t0, status == 0);
+    return (status == 0) ? 0 : -2;
+}
+
+int FlashRam_EraseSector(uint32_t addr, flash_ram_poll_cb_t cb, void* arg)
+{
+    uint32_t bank_base = (addr >= FLASH_BANK2_BASE) ? FLASH_BANK2_BASE : FLASH_BANK1_BASE;
+    uint32_t sector = (addr - bank_base) / FLASH_PORT_SECTOR_SIZE;
+    bank_regs_t b;
+    uint32_t irq;
+    int status;
+
+    bank_regs(addr, &b);
+    uint32_t t0 = FlashPort_StatsNow();
+    uint32_t limit = timeout_cycles();
+
+    irq = irq_mask();
+
+    status = bank_begin(&b);
+    if (status == 0) {
+        status = erase_sector(&b, sector, limit, cb, arg);
+        *b.cr |= FLASH_CR_LOCK;
+    }
+
+    irq_restore(irq);
+
+    FlashPort_StatsRecord(FLASH_OP_ERASE, addr, FLASH_PORT_SECTOR_SIZE,
+                          FlashPort_StatsNow() - t0, status == 0);
+    FlashPort_InvalidateCache(addr & ~(FLASH_PORT_SECTOR_SIZE - 1u), FLASH_PORT_SECTOR_SIZE);
+
+    return (status == 0) ? 0 : -1;
+}
@@ -7,6 +7,7 @@
   */
 
 #include "iap_write.h"
+#include "flash_port.h"
 #include "stm32h7xx_hal.h"
 #include <string.h>
 #include <stdio.h>
@@ -21,6 +22,9 @@
 #define TRAILER_SIZE          0x00020000u   /* Trailer 占用 128KB (最后一个扇区) */
 #define APP_SLOT_SIZE         (SLOT_TOTAL_SIZE - TRAILER_SIZE)  /* App 可用 768KB */
 
+/* 编程期间禁用中断，前后整片清理 D-Cache */
+#define IAP_PROG_FLAGS        (FLASH_PORT_IRQ_OFF | FLASH_PORT_CACHE_ALL)
+
 /* 逻辑地址 */
 #define LOGICAL_SLOT_INACTIVE_BASE  (FLASH_BANK2_BASE + BOOTLOADER_SIZE)  /* 0x08120000 */
 
@@ -30,103 +34,51 @@
 /* 包含 Trailer 的总扇区数 (896KB / 128KB = 7 个扇区) */
 #define SLOT_SECTOR_COUNT     7u
 
-/*============================================================================
- * 静态缓冲区 (32B 对齐，用于 Flash 写入)
- *============================================================================*/
-
-static uint8_t s_flash_write_buf[32] __attribute__((aligned(32)));
+/* 非活动 Slot 的 trailer 扇区 */
+#define LOGICAL_TRAILER_INACTIVE_BASE  (LOGICAL_SLOT_INACTIVE_BASE + APP_SLOT_SIZE)  /* 0x081E0000 */
 
 /*============================================================================
  * 内部函数
  *============================================================================*/
 
 /**
- * @brief  获取地址对应的 Flash Bank 编号
+ * @brief  检查 flash word 是否为擦除状态 (全 0xFF)
  */
-static uint32_t get_flash_bank(uint32_t addr)
+static int word_is_erased(uint32_t addr)
 {
-    return (addr >= FLASH_BANK2_BASE) ? FLASH_BANK_2 : FLASH_BANK_1;
+    const uint32_t* p = (const uint32_t*)addr;
+    for (uint32_t i = 0; i < IAP_FLASH_WORD_SIZE / 4u; i++) {
+        if (p[i] != 0xFFFFFFFFu) return 0;
+    }
+    return 1;
 }
 
 /**
- * @brief  获取地址对应的 Flash Sector 编号 (0-7)
- * @note   STM32H7 每个 Bank 有 8 个 128KB 扇区
+ * @brief  在非活动 Slot 的 trailer 写入会话开始标记
+ * @note   Bootloader 的启动校验记录之后出现其他记录即作废，写入与原镜像头
+ *         相同的镜像时也不会沿用旧的校验结果。trailer 已满时擦除 (其中的
+ *         记录属于即将被覆盖的旧镜像)
+ * @retval 0=成功, -1=失败
  */
-static uint32_t get_flash_sector(uint32_t addr)
+static int session_mark(uint32_t size)
 {
-    uint32_t bank_base = (addr >= FLASH_BANK2_BASE) ? FLASH_BANK2_BASE : FLASH_BANK1_BASE;
-    uint32_t offset = addr - bank_base;
-    return offset / IAP_SECTOR_SIZE;
-}
+    static uint8_t mark[IAP_FLASH_WORD_SIZE] __attribute__((aligned(32)));
+    uint32_t magic = IAP_SESSION_MAGIC;
 
-/**
- * @brief  擦除单个 Flash 扇区
- * @param  addr: 扇区内任意地址
- * @retval HAL_OK=成功
- */
-static HAL_StatusTypeDef erase_sector_at(uint32_t addr)
-{
-    FLASH_EraseInitTypeDef erase_cfg = {0};
-    uint32_t sector_error = 0;
-    HAL_StatusTypeDef status;
-    
-    erase_cfg.TypeErase    = FLASH_TYPEERASE_SECTORS;
-    erase_cfg.Banks        = get_flash_bank(addr);
-    erase_cfg.Sector       = get_flash_sector(addr);
-    erase_cfg.NbSectors    = 1;
-    erase_cfg.VoltageRange = FLASH_VOLTAGE_RANGE_3;  /* 2.7V - 3.6V */
-    
-    /* 禁用中断，清理 D-Cache */
-    __disable_irq();
-    SCB_CleanDCache();
-    
-    HAL_FLASH_Unlock();
-    
-    status = HAL_FLASHEx_Erase(&erase_cfg, &sector_error);
-    
-    HAL_FLASH_Lock();
-    
-    /* 清理并使 D-Cache 无效，恢复中断 */
-    SCB_CleanInvalidateDCache();
-    __enable_irq();
-    
-    if (status != HAL_OK) {
-        printf("[IAP] Erase failed: bank=%lu, sector=%lu, error=0x%08lX\r\n",
-               (unsigned long)erase_cfg.Banks, (unsigned long)erase_cfg.Sector,
-               (unsigned long)sector_error);
-    }
-    
-    return status;
-}
+    memset(mark, 0xFF, sizeof(mark));
+    memcpy(&mark[0], &magic, 4);
+    memcpy(&mark[4], &size, 4);
 
-/**
- * @brief  写入 32B flash word
- * @param  addr: 目标地址 (必须 32B 对齐)
- * @param  data: 源数据 (32B)
- * @retval HAL_OK=成功
- */
-static HAL_StatusTypeDef write_flash_word(uint32_t addr, const uint8_t* data)
-{
-    HAL_StatusTypeDef status;
-    
-    /* 复制到对齐缓冲区 */
-    memcpy(s_flash_write_buf, data, IAP_FLASH_WORD_SIZE);
-    
-    /* 禁用中断，清理 D-Cache */
-    __disable_irq();
-    SCB_CleanDCache();
-    
-    HAL_FLASH_Unlock();
-    
-    status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_FLASHWORD, addr, (uint32_t)s_flash_write_buf);
-    
-    HAL_FLASH_Lock();
-    
-    /* 清理并使 D-Cache 无效，恢复中断 */
-    SCB_CleanInvalidateDCache();
-    __enable_irq();
-    
-    return status;
+    for (int pass = 0; pass < 2; pass++) {
+        for (uint32_t off = 0; off < TRAILER_SIZE; off += IAP_FLASH_WORD_SIZE) {
+            uint32_t addr = LOGICAL_TRAILER_INACTIVE_BASE + off;
+            if (word_is_erased(addr)) {
+                return (FlashPort_Program(addr, mark, IAP_FLASH_WORD_SIZE, IAP_PROG_FLAGS) == 0) ? 0 : -1;
+            }
+        }
+        if (pass == 0 && FlashPort_EraseSector(LOGICAL_TRAILER_INACTIVE_BASE) != 0) break;
+    }
+    return -1;
 }
 
 /*============================================================================
@@ -172,7 +124,8 @@ static int IAP_EraseSectorRaw(uint32_t sector_index)
     printf("[IAP] Erasing sector %lu at 0x%08lX...\r\n", 
            (unsigned long)sector_index, (unsigned long)sector_addr);
     
-    if (erase_sector_at(sector_addr) != HAL_OK) {
+    if (FlashPort_EraseSector(sector_addr) != 0) {
+        printf("[IAP] Erase failed: sector at 0x%08lX\r\n", (unsigned long)sector_addr);
         return -2;
     }
     
@@ -282,6 +235,9 @@ int IAP_Begin(iap_writer_t* w, uint32_t dst_base, uint32_t dst_size)
     w->fill  = 0;
     memset(w->buf32, 0xFF, sizeof(w->buf32));  /* 填充 0xFF */
     
+    /* 改动 Slot 之前先作废启动校验记录 */
+    if (session_mark(dst_size) != 0) return -4;
+    
     // printf("[IAP] Write session started: 0x%08lX - 0x%08lX\r\n",
     //        (unsigned long)w->base, (unsigned long)w->limit);
     
@@ -313,7 +269,7 @@ int IAP_Write(iap_writer_t* w, const uint8_t* data, uint32_t len)
         
         /* 缓冲区满，写入 Flash */
         if (w->fill == IAP_FLASH_WORD_SIZE) {
-            if (write_flash_word(w->addr, w->buf32) != HAL_OK) {
+            if (FlashPort_Program(w->addr, w->buf32, IAP_FLASH_WORD_SIZE, IAP_PROG_FLAGS) != 0) {
                 printf("[IAP] Write failed at 0x%08lX\r\n", (unsigned long)w->addr);
                 return -3;
             }
@@ -337,7 +293,7 @@ int IAP_End(iap_writer_t* w)
     /* 如果缓冲区有剩余数据，补齐 0xFF 后写入 */
     if (w->fill > 0) {
         /* buf32 已经预填充 0xFF，直接写入 */
-        if (write_flash_word(w->addr, w->buf32) != HAL_OK) {
+        if (FlashPort_Program(w->addr, w->buf32, IAP_FLASH_WORD_SIZE, IAP_PROG_FLAGS) != 0) {
             printf("[IAP] Final write failed at 0x%08lX\r\n", (unsigned long)w->addr);
             return -2;
         }
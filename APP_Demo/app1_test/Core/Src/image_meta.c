@@ -7,6 +7,8 @@
   */
 
 #include "image_meta.h"
+#include "flash_port.h"
+#include "flash_ram.h"
 #include "stm32h7xx_hal.h"
 #include <stdio.h>
 #include <string.h>
@@ -25,6 +27,11 @@
  */
 #define ACTIVE_SLOT_BASE      (FLASH_BANK1_BASE + BOOTLOADER_SIZE)
 #define ACTIVE_TRAILER_BASE   (ACTIVE_SLOT_BASE + SLOT_TOTAL_SIZE - TRAILER_SIZE)
+#define TR_REC_COUNT          (TRAILER_SIZE / sizeof(tr_rec_t))   /* 4096 条 32B 记录 */
+
+/* trailer 整理快照：RTC 备份寄存器 BKP7R..BKP12R (与 Bootloader boot_attempt.c 一致)，
+ * BKP12R = 其余五个寄存器与 SNAP_KEY 的异或时有效 */
+#define SNAP_KEY              0xC0A1E5CEu
 
 
 __attribute__((section(".app_header"), used, aligned(4)))
@@ -62,64 +69,62 @@ static int rec_is_empty(const tr_rec_t* r)
 }
 
 /**
- * @brief  擦除单个 Flash 扇区
- * @param  addr: 扇区内任意地址
- * @retval HAL_OK=成功
+ * @brief  擦除活动 Slot 的 trailer 扇区
+ * @param  cb: 等待期间的回调 (可为 NULL)
+ * @param  arg: 回调参数
+ * @retval 0=成功, -1=失败
  */
-static HAL_StatusTypeDef erase_sector(void)
+static int erase_sector(flash_ram_poll_cb_t cb, void* arg)
 {
-    FLASH_EraseInitTypeDef erase_cfg = {0};
-    uint32_t sector_error = 0;
-    HAL_StatusTypeDef status;
-    
-    erase_cfg.TypeErase    = FLASH_TYPEERASE_SECTORS;
-    erase_cfg.Banks        = FLASH_BANK_1;
-    erase_cfg.Sector       = 7;
-    erase_cfg.NbSectors    = 1;
-    erase_cfg.VoltageRange = FLASH_VOLTAGE_RANGE_3;  /* 2.7V - 3.6V */
-    
-    /* 禁用中断，清理 D-Cache */
-    __disable_irq();
-    SCB_CleanDCache();
-    
-    HAL_FLASH_Unlock();
-    
-    status = HAL_FLASHEx_Erase(&erase_cfg, &sector_error);
-    
-    HAL_FLASH_Lock();
-    
-    /* 清理并使 D-Cache 无效，恢复中断 */
-    SCB_CleanInvalidateDCache();
-    __enable_irq();
-    
-    if (status != HAL_OK) {
-        printf("[IAP] Erase failed: bank=%lu, sector=%lu, error=0x%08lX\r\n",
-               (unsigned long)erase_cfg.Banks, (unsigned long)erase_cfg.Sector,
-               (unsigned long)sector_error);
+    if (FlashRam_EraseSector(ACTIVE_TRAILER_BASE, cb, arg) != 0) {
+        printf("[IAP] Erase failed: trailer at 0x%08lX\r\n", (unsigned long)ACTIVE_TRAILER_BASE);
+        return -1;
     }
-    
-    return status;
+    return 0;
 }
 
 
+/**
+ * @brief  二分查找第一个空位 (记录只追加，空位之后全部为空)
+ * @retval 第一个空位的序号，TR_REC_COUNT 表示扇区已满
+ */
+static uint32_t trailer_end_app(uint32_t base)
+{
+    uint32_t lo = 0, hi = TR_REC_COUNT;
+
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (rec_is_empty((const tr_rec_t*)(base + mid * sizeof(tr_rec_t)))) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+/**
+ * @brief  逻辑地址对应的物理地址 (Bank Swap 时两个 Bank 的逻辑地址互换)
+ */
+static uint32_t phys_addr(uint32_t addr)
+{
+    return FlashPort_GetSwap() ? (addr ^ (FLASH_BANK1_BASE ^ FLASH_BANK2_BASE)) : addr;
+}
+
 /**
  * @brief  读取 trailer 扇区的最后一条有效记录
  */
 static int trailer_read_last_app(uint32_t base, tr_rec_t* out) 
 {
-    const tr_rec_t* last = NULL;
-
-    for (uint32_t off = 0; off < TRAILER_SIZE; off += sizeof(tr_rec_t)) {
-        const tr_rec_t* r = (const tr_rec_t*)(base + off);
-        if (rec_is_empty(r)) break;
+    /* 从末尾向前跳过其他记录 (校验记录、IAP 会话标记/断点) */
+    for (uint32_t i = trailer_end_app(base); i > 0; i--) {
+        const tr_rec_t* r = (const tr_rec_t*)(base + (i - 1) * sizeof(tr_rec_t));
         if (rec_is_valid(r)) {
-            last = r;
+            *out = *r;
+            return 0;
         }
     }
-
-    if (!last) return -1;
-    *out = *last;
-    return 0;
+    return -1;
 }
 
 /**
@@ -134,49 +139,100 @@ static uint32_t trailer_next_seq_app(uint32_t base)
     return 1;
 }
 
-/* 静态 32B 对齐缓冲区，用于 Flash 写入 */
-static uint8_t s_flash_write_buf[32] __attribute__((aligned(32)));
+/**
+ * @brief  打开 RTC 备份寄存器的写访问 (快照保存/清除前调用)
+ */
+static void bkp_enable(void)
+{
+    __HAL_RCC_RTC_CLK_ENABLE();
+    HAL_PWR_EnableBkUpAccess();
+}
 
 /**
- * @brief  追加写入一条 trailer 记录 (App 侧)
+ * @brief  保存整理快照 (擦除前)，擦除/重写期间掉电由 Bootloader 按快照恢复
  */
-static int trailer_append_app(uint32_t base, const tr_rec_t* rec_in) 
+static void snap_save(const tr_rec_t* r)
 {
-    tr_rec_t rec;                      /* 可修改的本地副本 */
-    uint32_t write_addr = 0;
-    int found_empty = 0;
+    uint32_t addr = phys_addr(ACTIVE_TRAILER_BASE);
 
-    /* 复制输入记录到本地副本，之后修改副本的 addr */
-    memcpy(&rec, rec_in, sizeof(tr_rec_t));
+    bkp_enable();
 
-    /* 找到第一个空位 */
-    for (uint32_t off = 0; off < TRAILER_SIZE; off += sizeof(tr_rec_t)) {
-        const tr_rec_t* r = (const tr_rec_t*)(base + off);
-        if (rec_is_empty(r)) { 
-            write_addr = base + off; 
-            rec.addr = write_addr;
-            found_empty = 1;
-            break; 
-        }
+    RTC->BKP7R  = addr;
+    RTC->BKP8R  = r->seq;
+    RTC->BKP9R  = r->state;
+    RTC->BKP10R = r->attempt;
+    RTC->BKP11R = r->img_crc32;
+    RTC->BKP12R = addr ^ r->seq ^ r->state ^ r->attempt ^ r->img_crc32 ^ SNAP_KEY;
+}
+
+/**
+ * @brief  清除整理快照 (整理完成)
+ */
+static void snap_clear(void)
+{
+    bkp_enable();
+    RTC->BKP12R = 0;
+}
+
+/**
+ * @brief  整理 trailer：快照最后一条状态记录 → 擦除 → 在扇区起始处重写这一条
+ * @param  cb: 擦除/编程等待期间的回调 (可为 NULL)
+ * @param  arg: 回调参数
+ * @retval 0=成功, -1=擦除失败, -2=写入失败
+ * @note   重写的记录 seq/state/attempt/img_crc32 不变，Bootloader 的判断不受影响；
+ *         校验记录等其他记录不保留 (下次启动重新做一次完整 CRC)。
+ *         扇区为空时直接擦除
+ */
+static int trailer_compact_app(flash_ram_poll_cb_t cb, void* arg)
+{
+    static tr_rec_t last;  /* 使用 static 避免栈对齐问题 */
+    int has_last = (trailer_read_last_app(ACTIVE_TRAILER_BASE, &last) == 0);
+
+    /* 1) 快照先于擦除 */
+    if (has_last) {
+        snap_save(&last);
     }
 
-    /* 扇区已满 */
-    if (!found_empty) {
-        erase_sector();
-        return trailer_append_app(base, rec_in);
+    /* 2) 擦除 (失败时保留快照，由 Bootloader 恢复) */
+    if (erase_sector(cb, arg) != 0) {
+        return -1;
     }
 
-    /* 准备 32B 对齐的数据 (使用静态缓冲区) */
-    memcpy(s_flash_write_buf, &rec, sizeof(tr_rec_t));
+    /* 3) 重写合并后的记录 */
+    if (has_last) {
+        last.addr = ACTIVE_TRAILER_BASE;    /* 自身地址：擦除后的第 0 条 */
+        if (FlashRam_Program(ACTIVE_TRAILER_BASE, &last, sizeof(tr_rec_t), cb, arg) != 0) {
+            return -2;
+        }
+        /* 4) 记录已写回，快照作废 */
+        snap_clear();
+    }
+    return 0;
+}
 
-    /* 按 32B (256-bit flash word) 写入 */
-    HAL_StatusTypeDef status;
-    
-    HAL_FLASH_Unlock();
-    status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_FLASHWORD, write_addr, (uint32_t)s_flash_write_buf);
-    HAL_FLASH_Lock();
+/**
+ * @brief  追加写入一条 trailer 记录 (App 侧)
+ */
+static int trailer_append_app(uint32_t base, const tr_rec_t* rec_in) 
+{
+    tr_rec_t rec;                      /* 可修改的本地副本 */
+    uint32_t end = trailer_end_app(base);
+
+    /* 扇区已满 (App 没有在空闲时整理)：先整理，之后至少还有一个空位 */
+    if (end >= TR_REC_COUNT) {
+        if (trailer_compact_app(NULL, NULL) != 0) {
+            return -2;
+        }
+        end = trailer_end_app(base);
+    }
+
+    /* 复制输入记录到本地副本，之后修改副本的 addr */
+    memcpy(&rec, rec_in, sizeof(tr_rec_t));
+    rec.addr = base + end * sizeof(tr_rec_t);
 
-    return (status == HAL_OK) ? 0 : -2;
+    /* 按 32B (256-bit flash word) 写入。trailer 与 App 在同一 Bank，
+     * 由 ITCM 中的驱动编程，期间中断保持开启 */
+    return (FlashRam_Program(rec.addr, &rec, sizeof(tr_rec_t), NULL, NULL) == 0) ? 0 : -2;
 }
 
 /*============================================================================
@@ -222,6 +278,22 @@ int App_ConfirmSelf(void)
     return trailer_append_app(ACTIVE_TRAILER_BASE, &new_rec);
 }
 
+/**
+ * @brief  空闲时整理 trailer
+ */
+int App_TrailerCompact(flash_ram_poll_cb_t cb, void* arg)
+{
+    uint32_t end = trailer_end_app(ACTIVE_TRAILER_BASE);
+
+    if (end < TRAILER_COMPACT_HWM) {
+        return 0;
+    }
+
+    printf("[Trailer] %lu/%lu records used, compacting\r\n",
+           (unsigned long)end, (unsigned long)TR_REC_COUNT);
+    return (trailer_compact_app(cb, arg) == 0) ? 1 : -1;
+}
+
 /**
  * @brief  检查当前镜像是否处于 PENDING 状态
  */
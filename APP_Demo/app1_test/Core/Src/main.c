@@ -28,6 +28,7 @@
 /* USER CODE BEGIN Includes */
 #include "image_meta.h"
 #include "iap_upgrade.h"
+#include "flash_ram.h"
 #include "lwrb.h"
 /* USER CODE END Includes */
 
@@ -37,7 +38,8 @@
 
 /* Private define ------------------------------------------------------------*/
 /* USER CODE BEGIN PD */
-
+/* 串口静默这么久后才整理 trailer (擦除 128KB 扇区期间 1~2s 不处理串口) */
+#define TRAILER_IDLE_MS   2000u
 /* USER CODE END PD */
 
 /* Private macro -------------------------------------------------------------*/
@@ -53,6 +55,10 @@ __attribute__((aligned(32))) static uint8_t dma_rx_buf[256];
 static uint8_t rb_buf[2048];
 static lwrb_t uart_rb;
 static uint16_t old_pos = 0;
+static volatile uint32_t rx_tick;       /* 最近一次收到串口数据的时刻 */
+static volatile uint8_t compact_armed;  /* 1=下次空闲时检查 trailer 高水位 */
+static uint16_t erase_rx_pos;           /* trailer 整理期间 DMA 的上次写位置 */
+static uint32_t erase_rx_bytes;         /* trailer 整理期间 DMA 收到的字节数 */
 uint32_t g_JumpInit __attribute__((at(0x20000000), zero_init));  /* 跳转标志 */
 /* USER CODE END PV */
 
@@ -72,6 +78,19 @@ static inline void dcache_invalidate(void* addr, uint32_t len)
     uint32_t end = (a + len + 31U) & ~31U;
     SCB_InvalidateDCache_by_Addr((uint32_t*)start, end - start);
 }
+/**
+ * @brief  trailer 整理等待期间的回调 (ITCM)：统计 DMA 收到的字节数
+ * @note   USART1/DMA1 中断在操作期间被 BASEPRI 推迟，数据超过一圈 DMA 缓冲区时
+ *         操作结束后补发的空闲中断无法分辨，由主循环丢弃
+ */
+FLASH_RAM_FUNC static void compact_rx_poll(void* arg)
+{
+    (void)arg;
+    uint16_t pos = (uint16_t)(sizeof(dma_rx_buf) - DMA1_Stream0->NDTR);
+    erase_rx_bytes += (uint16_t)(pos - erase_rx_pos) % sizeof(dma_rx_buf);
+    erase_rx_pos = pos;
+}
+
 void UartDmaRx_ResetPos(void)
 {
     // 读取 DMA 当前已经写到的位置
@@ -109,7 +128,7 @@ int main(void)
   HAL_Init();
 
   /* USER CODE BEGIN Init */
-
+  FlashRam_Init();    /* 向量表移到 RAM，写 trailer 期间中断取向量不访问 Flash */
   /* USER CODE END Init */
 
   /* Configure the system clock */
@@ -144,6 +163,10 @@ int main(void)
     printf("App is in NEW or REJECTED state.\r\n");
   }
 
+  /* trailer 整理推迟到主循环中串口空闲时 */
+  rx_tick = HAL_GetTick();
+  compact_armed = 1;
+
   //测试trailer写入
   // for(int i=0; i<4095; i++) {
   //   if(App_ConfirmSelf()==-1){
@@ -176,6 +199,24 @@ int main(void)
             g_JumpInit = 0;
             NVIC_SystemReset();
             }
+          rx_tick = HAL_GetTick();
+        }
+    } else if (compact_armed && HAL_GetTick() - rx_tick >= TRAILER_IDLE_MS) {
+        /* 串口空闲 (升级在上面的分支中同步进行，此时不会在升级中)：
+         * 已用记录达到高水位时整理 trailer，Bootloader 启动时的写入总有空位。
+         * 本次运行中 trailer 只在启动确认时写入，检查一次即可，收到数据后重新检查 */
+        compact_armed = 0;
+        erase_rx_pos = (uint16_t)(sizeof(dma_rx_buf) - DMA1_Stream0->NDTR);
+        erase_rx_bytes = 0;
+        if (App_TrailerCompact(compact_rx_poll, NULL) < 0) {
+          printf("Trailer compaction failed!\r\n");
+        }
+        if (erase_rx_bytes >= sizeof(dma_rx_buf)) {
+          /* 整理期间 DMA 缓冲区已绕过一圈，补发的空闲中断写入的数据不完整 */
+          printf("UART overrun during trailer compaction, %lu bytes dropped\r\n",
+                 (unsigned long)erase_rx_bytes);
+          lwrb_reset(&uart_rb);
+          UartDmaRx_ResetPos();
         }
     }
     /* USER CODE END WHILE */
@@ -254,6 +295,8 @@ void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size)
     uint16_t pos = (uint16_t)(sizeof(dma_rx_buf) - __HAL_DMA_GET_COUNTER(huart->hdmarx));
     dcache_invalidate(dma_rx_buf, sizeof(dma_rx_buf));
     if (pos != old_pos) {
+        rx_tick = HAL_GetTick();
+        compact_armed = 1;
         if (pos > old_pos) {
             lwrb_write(&uart_rb, &dma_rx_buf[old_pos], pos - old_pos);
         } else {
@@ -270,8 +313,8 @@ void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size)
 
 
 
-//定时器中断回调
-void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
+//定时器中断回调 (控制周期，在 ITCM 中运行：写 trailer 期间不停，不能调用 Flash 中的函数)
+FLASH_RAM_FUNC void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
 {
     if (htim == &htim2) {
       //printf("Watchdog refreshed.\r\n");
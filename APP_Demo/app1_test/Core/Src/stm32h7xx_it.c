@@ -22,6 +22,7 @@
 #include "stm32h7xx_it.h"
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include "flash_ram.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -183,12 +184,14 @@ void PendSV_Handler(void)
 /**
   * @brief This function handles System tick timer.
   */
-void SysTick_Handler(void)
+/* 优先级 0 (高于 FLASH_RAM_BASEPRI)，写自身 Bank 期间也要运行：放在 ITCM，
+ * 直接累加 uwTick (HAL_IncTick 在 Flash 中) */
+FLASH_RAM_FUNC void SysTick_Handler(void)
 {
   /* USER CODE BEGIN SysTick_IRQn 0 */
 
   /* USER CODE END SysTick_IRQn 0 */
-  HAL_IncTick();
+  uwTick += (uint32_t)uwTickFreq;
   /* USER CODE BEGIN SysTick_IRQn 1 */
 
   /* USER CODE END SysTick_IRQn 1 */
@@ -232,12 +235,18 @@ void DMA1_Stream1_IRQHandler(void)
 /**
   * @brief This function handles TIM2 global interrupt.
   */
-void TIM2_IRQHandler(void)
+/* 控制周期中断，优先级 0：放在 ITCM，只处理已使能的更新中断
+ * (HAL_TIM_IRQHandler 在 Flash 中)，回调也在 ITCM (main.c) */
+FLASH_RAM_FUNC void TIM2_IRQHandler(void)
 {
   /* USER CODE BEGIN TIM2_IRQn 0 */
 
   /* USER CODE END TIM2_IRQn 0 */
-  HAL_TIM_IRQHandler(&htim2);
+  if (TIM2->SR & TIM_SR_UIF)
+  {
+    TIM2->SR = ~TIM_SR_UIF;
+    HAL_TIM_PeriodElapsedCallback(&htim2);
+  }
   /* USER CODE BEGIN TIM2_IRQn 1 */
 
   /* USER CODE END TIM2_IRQn 1 */
@@ -28,12 +28,19 @@
  *============================================================================*/
 
 /**
- * @brief  计算 CRC16-CCITT
+ * @brief  分段数据视图 (直接指向环形缓冲区存储，不复制)
+ * @note   数据在缓冲区末尾回绕时分为两段，否则 len[1] 为 0
  */
-static uint16_t calc_crc16(const uint8_t* data, uint32_t len)
+typedef struct {
+    const uint8_t* seg[2];  /* 各段起始地址 */
+    uint32_t       len[2];  /* 各段长度 */
+} ymodem_vec_t;
+
+/**
+ * @brief  CRC16-CCITT 续算 (初值 0)
+ */
+static uint16_t crc16_update(uint16_t crc, const uint8_t* data, uint32_t len)
 {
-    uint16_t crc = 0;
-    
     while (len--) {
         crc ^= (uint16_t)(*data++) << 8;
         for (int i = 0; i < 8; i++) {
@@ -49,44 +56,93 @@ static uint16_t calc_crc16(const uint8_t* data, uint32_t len)
 }
 
 /**
- * @brief  发送单个字符
+ * @brief  在环形缓冲区上建立 len 字节的分段视图 (不移动读指针)
+ * @note   调用前需确保缓冲区中至少有 len 字节
  */
-static void send_char(uint8_t ch)
+static void rb_peek_vec(lwrb_t* rb, uint32_t len, ymodem_vec_t* v)
 {
-    YmodemPort_SendByte(ch);
+    uint32_t linear = lwrb_get_linear_block_read_length(rb);
+    
+    v->seg[0] = (const uint8_t*)lwrb_get_linear_block_read_address(rb);
+    v->len[0] = (len < linear) ? len : linear;
+    v->seg[1] = rb->buff;               /* 回绕部分从存储区起始处继续 */
+    v->len[1] = len - v->len[0];
 }
 
 /**
- * @brief  等待指定数量的字节
- * @retval 0=成功, -1=超时
+ * @brief  读取视图中偏移 off 处的字节
  */
-static int wait_for_bytes(lwrb_t* rb, uint32_t count, uint32_t timeout_ms)
+static uint8_t vec_byte(const ymodem_vec_t* v, uint32_t off)
 {
-    uint32_t start = YmodemPort_GetTick();
+    return (off < v->len[0]) ? v->seg[0][off] : v->seg[1][off - v->len[0]];
+}
 
-    while (lwrb_get_full(rb) < count) {
-        if ((YmodemPort_GetTick() - start) > timeout_ms) {
-            return -1;
-        }
-        // 可以加一点点让步，避免死等占满CPU
-        // YmodemPort_Delay(1);
-        // 或者在这里喂狗
+/**
+ * @brief  截取子视图 [off, off + len)
+ */
+static void vec_slice(const ymodem_vec_t* v, uint32_t off, uint32_t len, ymodem_vec_t* out)
+{
+    if (off < v->len[0]) {
+        uint32_t n0 = v->len[0] - off;
+        if (n0 > len) n0 = len;
+        out->seg[0] = v->seg[0] + off;
+        out->len[0] = n0;
+        out->seg[1] = v->seg[1];
+        out->len[1] = len - n0;
+    } else {
+        out->seg[0] = v->seg[1] + (off - v->len[0]);
+        out->len[0] = len;
+        out->seg[1] = NULL;
+        out->len[1] = 0;
     }
-    return 0;
 }
 
+/**
+ * @brief  计算视图数据的 CRC16 (跨段续算)
+ */
+static uint16_t vec_crc16(const ymodem_vec_t* v)
+{
+    uint16_t crc = crc16_update(0, v->seg[0], v->len[0]);
+    if (v->len[1] > 0) {
+        crc = crc16_update(crc, v->seg[1], v->len[1]);
+    }
+    return crc;
+}
+
+/**
+ * @brief  将视图复制到连续缓冲区 (只用于 packet 0 的文件信息解析)
+ */
+static void vec_copy(const ymodem_vec_t* v, uint8_t* dst)
+{
+    memcpy(dst, v->seg[0], v->len[0]);
+    if (v->len[1] > 0) {
+        memcpy(dst + v->len[0], v->seg[1], v->len[1]);
+    }
+}
 
 /**
- * @brief  读取一个字节
- * @retval 0=成功, -1=超时
+ * @brief  将数据视图逐段交给 on_data (回绕时调用两次)
+ * @retval 0=成功, <0=回调要求取消
  */
-static int read_byte(lwrb_t* rb, uint8_t* out, uint32_t timeout_ms)
+static int deliver_data(const ymodem_cb_t* cb, const ymodem_vec_t* v)
 {
-    if (wait_for_bytes(rb, 1, timeout_ms) != 0) {
-        return -1;
+    if (cb->on_data) {
+        for (int i = 0; i < 2; i++) {
+            if (v->len[i] > 0 && cb->on_data(v->seg[i], v->len[i]) != 0) {
+                return -1;
+            }
+        }
     }
     
-    return (lwrb_read(rb, out, 1) == 1) ? 0 : -1;
+    return 0;
+}
+
+/**
+ * @brief  发送单个字符
+ */
+static void send_char(uint8_t ch)
+{
+    YmodemPort_SendByte(ch);
 }
 
 /**
@@ -140,253 +196,320 @@ static int parse_file_info(const uint8_t* data, uint32_t len,
     return 0;
 }
 
-/*============================================================================
- * 公共函数实现
- *============================================================================*/
+/**
+ * @brief  结束会话并记录结果
+ */
+static int finish(ymodem_t* ym, int code)
+{
+    ym->result = code;
+    ym->state = (code == YMODEM_OK) ? YMODEM_STATE_DONE : YMODEM_STATE_ERROR;
+    return code;
+}
 
-void Ymodem_Cancel(void)
+/**
+ * @brief  包错误计数，超过 MAX_PACKET_ERRORS 时取消传输
+ * @retval YMODEM_BUSY=已 NAK 继续, <0=错误码
+ */
+static int packet_error(ymodem_t* ym, int code)
 {
-    /* 发送多个 CAN 取消传输 */
-    for (int i = 0; i < 5; i++) {
-        send_char(YMODEM_CAN);
-        YmodemPort_Delay(10);
+    send_char(YMODEM_NAK);
+    if (++ym->packet_errs >= MAX_PACKET_ERRORS) {
+        YmodemPort_Log("[YMODEM] Too many packet errors\r\n");
+        Ymodem_Cancel();
+        if (ym->cb->on_error) ym->cb->on_error(code);
+        return finish(ym, code);
     }
+    return YMODEM_BUSY;
 }
 
-int Ymodem_Receive(lwrb_t* rb, const ymodem_cb_t* cb, uint32_t timeout_ms)
+/**
+ * @brief  等待包头超时处理
+ * @retval YMODEM_BUSY=继续等待, <0=错误码
+ */
+static int handle_timeout(ymodem_t* ym)
 {
-    static uint8_t packet_buf[YMODEM_PACKET_1K + PACKET_OVERHEAD];
-
-    if (!rb || !cb) {
-        return YMODEM_ERR_PARAM;
+    const ymodem_cb_t* cb = ym->cb;
+
+    if (ym->state == YMODEM_STATE_WAIT_START) {
+        /* 还在等待开始，重发 'C' */
+        if (++ym->retry_count >= MAX_RETRY) {
+            YmodemPort_Log("[YMODEM] Timeout waiting for sender\r\n");
+            if (cb->on_error) cb->on_error(YMODEM_ERR_TIMEOUT);
+            return finish(ym, YMODEM_ERR_TIMEOUT);
+        }
+        send_char(YMODEM_C);
+        return YMODEM_BUSY;
     }
 
-    char filename[128];
-    uint32_t filesize = 0;
-    uint32_t received_bytes = 0;
-    uint8_t expected_seq = 0;
-    int retry_count = 0;
-    int packet_errs = 0; /* 新增 */
-    int state = 0;  /* 0=等待开始, 1=接收数据, 2=等待结束 */
-
-    YmodemPort_Log("[YMODEM] Waiting for sender (send 'C')...\r\n");
-    send_char(YMODEM_C);
+    YmodemPort_Log("[YMODEM] Timeout during transfer\r\n");
+    Ymodem_Cancel();
+    if (cb->on_error) cb->on_error(YMODEM_ERR_TIMEOUT);
+    return finish(ym, YMODEM_ERR_TIMEOUT);
+}
 
-    while (1) {
-        uint8_t header;
-        uint32_t packet_size = 0;  /* 关键：初始化，避免未赋值 */
-        uint8_t eot_handled = 0;
-
-        /* 读取包头 */
-        if (read_byte(rb, &header, timeout_ms) != 0) {
-            if (state == 0) {
-                retry_count++;
-                if (retry_count >= MAX_RETRY) {
-                    YmodemPort_Log("[YMODEM] Timeout waiting for sender\r\n");
-                    if (cb->on_error) cb->on_error(YMODEM_ERR_TIMEOUT);
-                    return YMODEM_ERR_TIMEOUT;
-                }
+/**
+ * @brief  处理单字节控制字符 (EOT / CAN / 未知字符)
+ * @retval YMODEM_BUSY=继续, <0=错误码
+ */
+static int handle_control(ymodem_t* ym, uint8_t header)
+{
+    switch (header) {
+        case YMODEM_EOT:
+            if (ym->state == YMODEM_STATE_RECEIVING) {
+                /* 第一个 EOT，发送 NAK */
+                send_char(YMODEM_NAK);
+                ym->state = YMODEM_STATE_WAIT_END;
+            } else if (ym->state == YMODEM_STATE_WAIT_END) {
+                /* 第二个 EOT，发送 ACK + C，等待结束包 */
+                send_char(YMODEM_ACK);
                 send_char(YMODEM_C);
-                continue;
-            } else {
-                YmodemPort_Log("[YMODEM] Timeout during transfer\r\n");
-                Ymodem_Cancel();
-                if (cb->on_error) cb->on_error(YMODEM_ERR_TIMEOUT);
-                return YMODEM_ERR_TIMEOUT;
+                ym->expected_seq = 0;
             }
-        }
+            /* 等待开始时的 EOT 是噪声/残留，忽略 */
+            return YMODEM_BUSY;
 
-        retry_count = 0;
+        case YMODEM_CAN:
+            YmodemPort_Log("[YMODEM] Transfer cancelled by sender\r\n");
+            if (ym->cb->on_error) ym->cb->on_error(YMODEM_ERR_CANCEL);
+            return finish(ym, YMODEM_ERR_CANCEL);
 
-        switch (header) {
-            case YMODEM_SOH:
-                packet_size = YMODEM_PACKET_128;
-                break;
+        default:
+            return YMODEM_BUSY;
+    }
+}
 
-            case YMODEM_STX:
-                packet_size = YMODEM_PACKET_1K;
-                break;
+/**
+ * @brief  处理一个已完整到达的数据包 (包体留在环形缓冲区中原地校验，处理完后释放)
+ * @retval YMODEM_BUSY=继续, YMODEM_OK=传输完成, <0=错误码
+ */
+static int handle_packet(ymodem_t* ym, uint32_t packet_size)
+{
+    static uint8_t packet_buf[YMODEM_PACKET_1K];     /* 只存放 packet 0 (文件信息) */
+    lwrb_t* rb = ym->rb;
+    const ymodem_cb_t* cb = ym->cb;
+    uint32_t total_len = 2 + packet_size + 2;       /* SeqNo + ~SeqNo + Data + CRC */
+    ymodem_vec_t pkt;
+    ymodem_vec_t data;
+
+    rb_peek_vec(rb, total_len, &pkt);
+    vec_slice(&pkt, 2, packet_size, &data);
+
+    uint8_t seq_no = vec_byte(&pkt, 0);
+    uint8_t seq_comp = vec_byte(&pkt, 1);
+    uint16_t recv_crc = ((uint16_t)vec_byte(&pkt, 2 + packet_size) << 8)
+                      |  (uint16_t)vec_byte(&pkt, 2 + packet_size + 1);
+
+    if ((uint8_t)(seq_no ^ seq_comp) != 0xFF) {
+        lwrb_skip(rb, total_len);
+        return packet_error(ym, YMODEM_ERR_SEQ);
+    }
 
-            case YMODEM_EOT:
-                /* 修复：state==0 时必须处理掉，不能落到读包体逻辑 */
-                if (state == 0) {
-                    continue; /* 忽略噪声/残留 */
-                }
-                if (state == 1) {
-                    send_char(YMODEM_NAK);
-                    state = 2;
-                    eot_handled = 1;
-                } else if (state == 2) {
-                    send_char(YMODEM_ACK);
-                    send_char(YMODEM_C);
-                    expected_seq = 0;
-                    eot_handled = 1;
-                }
-                if (eot_handled) continue;
-                /* 其他状态不应该到这里 */
-                continue;
+    if (vec_crc16(&data) != recv_crc) {
+        lwrb_skip(rb, total_len);
+        return packet_error(ym, YMODEM_ERR_CRC);
+    }
 
-            case YMODEM_CAN:
-                /* 可选：更严格可以再读一个 CAN 确认，这里先保持你原逻辑 */
-                YmodemPort_Log("[YMODEM] Transfer cancelled by sender\r\n");
-                if (cb->on_error) cb->on_error(YMODEM_ERR_CANCEL);
-                return YMODEM_ERR_CANCEL;
+    /* CRC/格式都正确 -> 清 packet_errs */
+    ym->packet_errs = 0;
 
-            default:
-                continue;
+    /* 序列号检查 */
+    if (seq_no != ym->expected_seq) {
+        lwrb_skip(rb, total_len);
+        if (seq_no == (uint8_t)(ym->expected_seq - 1)) {
+            send_char(YMODEM_ACK);
+            return YMODEM_BUSY;
         }
+        YmodemPort_Log("[YMODEM] Sequence error (expect=%d, recv=%d)\r\n",
+                       ym->expected_seq, seq_no);
+        Ymodem_Cancel();
+        if (cb->on_error) cb->on_error(YMODEM_ERR_SEQ);
+        return finish(ym, YMODEM_ERR_SEQ);
+    }
 
-        /* 读包体：SeqNo + ~SeqNo + Data + CRC */
-        uint32_t total_len = 2 + packet_size + 2;
+    /* ---------- 处理 packet 0（文件信息/结束） ---------- */
 
-        if (wait_for_bytes(rb, total_len, INTER_CHAR_TIMEOUT * 10) != 0) {
-            YmodemPort_Log("[YMODEM] Incomplete packet\r\n");
-            send_char(YMODEM_NAK);
-            if (++packet_errs >= MAX_PACKET_ERRORS) {
-                YmodemPort_Log("[YMODEM] Too many packet errors\r\n");
-                Ymodem_Cancel();
-                if (cb->on_error) cb->on_error(YMODEM_ERR_CRC);
-                return YMODEM_ERR_CRC;
+    if (seq_no == 0 && ym->state != YMODEM_STATE_RECEIVING) {
+        /* 文件信息需要连续存放，只有 packet 0 复制出来 */
+        vec_copy(&data, packet_buf);
+        lwrb_skip(rb, total_len);
+
+        if (parse_file_info(packet_buf, packet_size, ym->filename, &ym->filesize) != 0) {
+            return packet_error(ym, YMODEM_ERR_PARAM);
+        }
+
+        if (ym->filename[0] == '\0') {
+            /* 空文件名 = batch 结束 */
+            if (ym->state == YMODEM_STATE_WAIT_END) {
+                YmodemPort_Log("\r\n[YMODEM] Transfer complete: %lu bytes\r\n",
+                               (unsigned long)ym->received_bytes);
+                if (cb->on_end) cb->on_end();
+            } else {
+                YmodemPort_Log("[YMODEM] All transfers complete\r\n");
             }
-            continue;
+            send_char(YMODEM_ACK);
+            return finish(ym, YMODEM_OK);
         }
 
-        packet_buf[0] = header;
+        /* 非空文件名：不论等待开始还是等待结束，都当作“开始新文件” */
+        YmodemPort_Log("[YMODEM] File: %s, Size: %lu bytes\r\n",
+                       ym->filename, (unsigned long)ym->filesize);
 
-        /* 强校验：必须读满 */
-        if (lwrb_read(rb, &packet_buf[1], total_len) != total_len) {
-            send_char(YMODEM_NAK);
-            if (++packet_errs >= MAX_PACKET_ERRORS) {
+        if (cb->on_begin) {
+            if (cb->on_begin(ym->filename, ym->filesize) != 0) {
+                YmodemPort_Log("[YMODEM] Callback rejected transfer\r\n");
                 Ymodem_Cancel();
-                if (cb->on_error) cb->on_error(YMODEM_ERR_TIMEOUT);
-                return YMODEM_ERR_TIMEOUT;
+                return finish(ym, YMODEM_ERR_CALLBACK);
             }
-            continue;
         }
 
-        uint8_t seq_no = packet_buf[1];
-        uint8_t seq_comp = packet_buf[2];
-        uint8_t* data = &packet_buf[3];
-        uint16_t recv_crc = ((uint16_t)packet_buf[3 + packet_size] << 8)
-                          |  (uint16_t)packet_buf[3 + packet_size + 1];
+        ym->state = YMODEM_STATE_RECEIVING;
+        ym->expected_seq = 1;
+        ym->received_bytes = 0;
 
-        if ((uint8_t)(seq_no ^ seq_comp) != 0xFF) {
-            send_char(YMODEM_NAK);
-            if (++packet_errs >= MAX_PACKET_ERRORS) {
-                Ymodem_Cancel();
-                if (cb->on_error) cb->on_error(YMODEM_ERR_SEQ);
-                return YMODEM_ERR_SEQ;
-            }
-            continue;
+        send_char(YMODEM_ACK);
+        send_char(YMODEM_C);
+        return YMODEM_BUSY;
+    }
+
+    /* ---------- 数据包 ---------- */
+
+    if (ym->state == YMODEM_STATE_RECEIVING || ym->state == YMODEM_STATE_WAIT_END) {
+        uint32_t data_len = packet_size;
+
+        if (ym->filesize > 0 && ym->received_bytes + data_len > ym->filesize) {
+            data_len = ym->filesize - ym->received_bytes;
         }
 
-        uint16_t calc_crc = calc_crc16(data, packet_size);
-        if (calc_crc != recv_crc) {
-            send_char(YMODEM_NAK);
-            if (++packet_errs >= MAX_PACKET_ERRORS) {
-                Ymodem_Cancel();
-                if (cb->on_error) cb->on_error(YMODEM_ERR_CRC);
-                return YMODEM_ERR_CRC;
-            }
-            continue;
+        /* 直接从环形缓冲区交给回调，回调返回后才释放这段空间 */
+        ymodem_vec_t chunk;
+        vec_slice(&data, 0, data_len, &chunk);
+        int r = deliver_data(cb, &chunk);
+        lwrb_skip(rb, total_len);
+        if (r != 0) {
+            YmodemPort_Log("[YMODEM] Data callback error\r\n");
+            Ymodem_Cancel();
+            return finish(ym, YMODEM_ERR_CALLBACK);
         }
 
-        /* CRC/格式都正确 -> 清 packet_errs */
-        packet_errs = 0;
+        ym->received_bytes += data_len;
+        ym->expected_seq = (uint8_t)(ym->expected_seq + 1);
 
-        /* 序列号检查 */
-        if (seq_no != expected_seq) {
-            if (seq_no == (uint8_t)(expected_seq - 1)) {
-                send_char(YMODEM_ACK);
-                continue;
-            }
-            YmodemPort_Log("[YMODEM] Sequence error (expect=%d, recv=%d)\r\n",
-                           expected_seq, seq_no);
-            Ymodem_Cancel();
-            if (cb->on_error) cb->on_error(YMODEM_ERR_SEQ);
-            return YMODEM_ERR_SEQ;
+        if (ym->filesize > 0) {
+            YmodemPort_Log("\r[YMODEM] Progress: %lu/%lu (%lu%%)",
+                           (unsigned long)ym->received_bytes,
+                           (unsigned long)ym->filesize,
+                           (unsigned long)(ym->received_bytes * 100 / ym->filesize));
         }
 
-        /* ---------- 处理 packet 0（文件信息/结束） ---------- */
+        send_char(YMODEM_ACK);
+        return YMODEM_BUSY;
+    }
 
-        if (seq_no == 0 && (state == 0 || state == 2)) {
-            int r = parse_file_info(data, packet_size, filename, &filesize);
-            if (r != 0) {
-                send_char(YMODEM_NAK);
-                if (++packet_errs >= MAX_PACKET_ERRORS) {
-                    Ymodem_Cancel();
-                    if (cb->on_error) cb->on_error(YMODEM_ERR_PARAM);
-                    return YMODEM_ERR_PARAM;
-                }
-                continue;
-            }
+    /* 不应该走到这里，兜底 ACK */
+    lwrb_skip(rb, total_len);
+    send_char(YMODEM_ACK);
+    return YMODEM_BUSY;
+}
 
-            if (filename[0] == '\0') {
-                /* 空文件名 = batch 结束 */
-                if (state == 2) {
-                    YmodemPort_Log("\r\n[YMODEM] Transfer complete: %lu bytes\r\n",
-                                   (unsigned long)received_bytes);
-                    if (cb->on_end) cb->on_end();
-                } else {
-                    YmodemPort_Log("[YMODEM] All transfers complete\r\n");
-                }
-                send_char(YMODEM_ACK);
-                return YMODEM_OK;
-            }
+/*============================================================================
+ * 公共函数实现
+ *============================================================================*/
 
-            /* 非空文件名：不论 state==0 还是 state==2，都当作“开始新文件” */
-            YmodemPort_Log("[YMODEM] File: %s, Size: %lu bytes\r\n",
-                           filename, (unsigned long)filesize);
+void Ymodem_Cancel(void)
+{
+    /* 发送多个 CAN 取消传输 */
+    for (int i = 0; i < 5; i++) {
+        send_char(YMODEM_CAN);
+        YmodemPort_Delay(10);
+    }
+}
 
-            if (cb->on_begin) {
-                if (cb->on_begin(filename, filesize) != 0) {
-                    YmodemPort_Log("[YMODEM] Callback rejected transfer\r\n");
-                    Ymodem_Cancel();
-                    return YMODEM_ERR_CALLBACK;
-                }
-            }
+int Ymodem_Init(ymodem_t* ym, lwrb_t* rb, const ymodem_cb_t* cb, uint32_t timeout_ms)
+{
+    if (!ym || !rb || !cb) {
+        return YMODEM_ERR_PARAM;
+    }
 
-            state = 1;
-            expected_seq = 1;
-            received_bytes = 0;
+    memset(ym, 0, sizeof(*ym));
+    ym->rb = rb;
+    ym->cb = cb;
+    ym->timeout_ms = timeout_ms;
+    ym->state = YMODEM_STATE_WAIT_START;
+    ym->result = YMODEM_BUSY;
 
-            send_char(YMODEM_ACK);
-            send_char(YMODEM_C);
-            continue;
-        }
+    YmodemPort_Log("[YMODEM] Waiting for sender (send 'C')...\r\n");
+    send_char(YMODEM_C);
+    ym->tick = YmodemPort_GetTick();
+    return YMODEM_OK;
+}
 
-        /* ---------- 数据包 ---------- */
+int Ymodem_Poll(ymodem_t* ym)
+{
+    if (ym->state == YMODEM_STATE_DONE || ym->state == YMODEM_STATE_ERROR) {
+        return ym->result;
+    }
 
-        if (state >= 1) {
-            uint32_t data_len = packet_size;
+    while (1) {
+        uint32_t now = YmodemPort_GetTick();
 
-            if (filesize > 0 && received_bytes + data_len > filesize) {
-                data_len = filesize - received_bytes;
-            }
+        if (ym->header == 0) {
+            uint8_t header;
 
-            if (cb->on_data) {
-                if (cb->on_data(data, data_len) != 0) {
-                    YmodemPort_Log("[YMODEM] Data callback error\r\n");
-                    Ymodem_Cancel();
-                    return YMODEM_ERR_CALLBACK;
+            /* 读取包头 */
+            if (lwrb_read(ym->rb, &header, 1) != 1) {
+                if ((now - ym->tick) > ym->timeout_ms) {
+                    int ret = handle_timeout(ym);
+                    ym->tick = now;
+                    return ret;
                 }
+                return YMODEM_BUSY;
             }
 
-            received_bytes += data_len;
-            expected_seq = (uint8_t)(expected_seq + 1);
+            ym->tick = now;
+            ym->retry_count = 0;
 
-            if (filesize > 0) {
-                YmodemPort_Log("\r[YMODEM] Progress: %lu/%lu (%lu%%)",
-                               (unsigned long)received_bytes,
-                               (unsigned long)filesize,
-                               (unsigned long)(received_bytes * 100 / filesize));
+            if (header != YMODEM_SOH && header != YMODEM_STX) {
+                int ret = handle_control(ym, header);
+                if (ret != YMODEM_BUSY) return ret;
+                continue;
             }
+            ym->header = header;
+        }
 
-            send_char(YMODEM_ACK);
-            continue;
+        /* 等待完整数据包：SeqNo + ~SeqNo + Data + CRC */
+        uint32_t packet_size = (ym->header == YMODEM_STX) ? YMODEM_PACKET_1K : YMODEM_PACKET_128;
+        if (lwrb_get_full(ym->rb) < 2 + packet_size + 2) {
+            if ((now - ym->tick) > INTER_CHAR_TIMEOUT * 10) {
+                YmodemPort_Log("[YMODEM] Incomplete packet\r\n");
+                ym->header = 0;
+                ym->tick = now;
+                int ret = packet_error(ym, YMODEM_ERR_CRC);
+                if (ret != YMODEM_BUSY) return ret;
+                continue;
+            }
+            return YMODEM_BUSY;
         }
 
-        /* 不应该走到这里，兜底 ACK */
-        send_char(YMODEM_ACK);
+        ym->header = 0;
+        int ret = handle_packet(ym, packet_size);
+        if (ret != YMODEM_BUSY) return ret;
+        ym->tick = YmodemPort_GetTick();
     }
-}
\ No newline at end of file
+}
+
+int Ymodem_Receive(lwrb_t* rb, const ymodem_cb_t* cb, uint32_t timeout_ms)
+{
+    ymodem_t ym;
+    int ret = Ymodem_Init(&ym, rb, cb, timeout_ms);
+
+    if (ret != YMODEM_OK) {
+        return ret;
+    }
+
+    /* 阻塞封装：无数据时让出 CPU，等待 DMA/UART 中断或 SysTick 唤醒 */
+    while ((ret = Ymodem_Poll(&ym)) == YMODEM_BUSY) {
+        YmodemPort_Idle();
+    }
+
+    return ret;
+}
@@ -8,6 +8,7 @@
 
 #include "app_confirm.h"
 #include "image_header.h"
+#include "flash_port.h"
 #include "stm32h7xx_hal.h"
 #include <string.h>
 
@@ -82,9 +83,6 @@ static uint32_t trailer_next_seq_app(uint32_t base)
     return 1;
 }
 
-/* 静态 32B 对齐缓冲区，用于 Flash 写入 */
-static uint8_t s_flash_write_buf[32] __attribute__((aligned(32)));
-
 /**
  * @brief  追加写入一条 trailer 记录 (App 侧)
  */
@@ -108,17 +106,8 @@ static int trailer_append_app(uint32_t base, const tr_rec_t* rec)
         return -1;
     }
 
-    /* 准备 32B 对齐的数据 (使用静态缓冲区) */
-    memcpy(s_flash_write_buf, rec, sizeof(tr_rec_t));
-
-    /* 按 32B (256-bit flash word) 写入 */
-    HAL_StatusTypeDef status;
-    
-    HAL_FLASH_Unlock();
-    status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_FLASHWORD, write_addr, (uint32_t)s_flash_write_buf);
-    HAL_FLASH_Lock();
-
-    return (status == HAL_OK) ? 0 : -2;
+    /* 按 32B (256-bit flash word) 写入，记录为 packed 结构，由 FlashPort 经对齐缓冲区编程 */
+    return (FlashPort_Program(write_addr, rec, sizeof(tr_rec_t), 0) == 0) ? 0 : -2;
 }
 
 /*============================================================================
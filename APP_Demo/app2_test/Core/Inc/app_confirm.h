@@ -43,7 +43,9 @@ typedef struct __attribute__((packed)) {
   uint32_t state;       /* 状态：TR_STATE_xxx */
   uint32_t attempt;     /* 尝试次数 1..N */
   uint32_t img_crc32;   /* 绑定的镜像 CRC32，防止写错槽 */
-  uint32_t rsv[3];      /* 保留，padding to 32B */
+  uint32_t rsv[3];      /* rsv[0] 为本记录自身的地址 (逻辑地址，与 Bootloader 一致)：
+                         * 追加为 base + 序号 * 32，整理/恢复后重写的记录在第 0 条，即 base；
+                         * 其余保留 */
 } tr_rec_t;
 
 /*============================================================================
@@ -56,7 +58,9 @@ typedef struct __attribute__((packed)) {
  *         1. 获取当前 active slot 的 trailer 基地址
  *         2. 读取当前镜像的 CRC32
  *         3. 追加写入 CONFIRMED 记录
- * @retval 0=成功, -1=失败
+ * @retval 0=成功, -1=trailer 已满, -2=写入失败
+ * @note   trailer 与 App 在同一 Bank，App 不擦除 trailer：扇区已满时本次确认失败，
+ *         下次启动 Bootloader 写入时整理扇区，App 再次确认
  */
 int App_ConfirmSelf(void);
 
@@ -10,6 +10,9 @@
 #define IAP_SECTOR_SIZE       0x20000u    /* 128KB per sector */
 #define IAP_FLASH_WORD_SIZE   32u         /* 256-bit = 32 bytes per flash word */
 
+/* 写入会话开始标记 (与 Bootloader 相同)，使 Bootloader 的启动校验记录作废 */
+#define IAP_SESSION_MAGIC     0x53534553u /* 'SESS' */
+
 /*============================================================================
  * 数据结构
  *============================================================================*/
@@ -72,6 +75,7 @@ int IAP_EraseRange(uint32_t start_addr, uint32_t size);
  * @param  dst_base: 目标起始地址
  * @param  dst_size: 目标区域大小
  * @retval 0=成功, <0=失败
+ * @note   先在 trailer 写入会话标记 (IAP_SESSION_MAGIC)
  */
 int IAP_Begin(iap_writer_t* w, uint32_t dst_base, uint32_t dst_size);
 
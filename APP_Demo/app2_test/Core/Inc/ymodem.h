@@ -31,6 +31,7 @@
 #define YMODEM_PACKET_1K    1024
 
 /* 错误码 */
+#define YMODEM_BUSY             1       /* 传输进行中 (仅 Ymodem_Poll 返回) */
 #define YMODEM_OK               0
 #define YMODEM_ERR_TIMEOUT      -1
 #define YMODEM_ERR_CANCEL       -2
@@ -73,12 +74,44 @@ typedef struct {
     void (*on_error)(int code);
 } ymodem_cb_t;
 
+/*============================================================================
+ * 接收会话
+ *============================================================================*/
+
+/* 会话状态 */
+typedef enum {
+    YMODEM_STATE_WAIT_START = 0,    /* 已发送 'C'，等待文件信息包 */
+    YMODEM_STATE_RECEIVING,         /* 接收数据包 */
+    YMODEM_STATE_WAIT_END,          /* 已收到 EOT，等待结束包 */
+    YMODEM_STATE_DONE,              /* 传输完成 */
+    YMODEM_STATE_ERROR              /* 传输失败，错误码见 result */
+} ymodem_state_t;
+
+/**
+ * @brief  YMODEM 接收会话上下文
+ * @note   所有状态都保存在此结构中，字段只读
+ */
+typedef struct {
+    ringbuf_t*          rb;             /* 接收环形缓冲区 */
+    const ymodem_cb_t*  cb;             /* 回调函数 */
+    uint32_t            timeout_ms;     /* 等待包头超时 */
+    ymodem_state_t      state;          /* 当前状态 */
+    int                 result;         /* YMODEM_BUSY / YMODEM_OK / 错误码 */
+    uint8_t             header;         /* 已读取、等待数据到齐的包头 (0=无) */
+    uint8_t             expected_seq;   /* 期望序列号 */
+    int                 retry_count;    /* 等待开始的重试次数 */
+    uint32_t            tick;           /* 当前等待的起始时刻 */
+    uint32_t            filesize;       /* 文件大小 (来自 packet 0) */
+    uint32_t            received_bytes; /* 已接收字节数 */
+    char                filename[128];  /* 文件名 */
+} ymodem_t;
+
 /*============================================================================
  * 函数声明
  *============================================================================*/
 
 /**
- * @brief  YMODEM 接收
+ * @brief  YMODEM 接收 (阻塞，基于 Ymodem_Init/Ymodem_Poll)
  * @param  rb: 环形缓冲区 (需要提前初始化并启动 DMA)
  * @param  cb: 回调函数
  * @param  timeout_ms: 超时时间 (毫秒)
@@ -86,6 +119,26 @@ typedef struct {
  */
 int Ymodem_Receive(ringbuf_t* rb, const ymodem_cb_t* cb, uint32_t timeout_ms);
 
+/**
+ * @brief  初始化接收会话并发送 'C'
+ * @param  ym: 会话上下文
+ * @param  rb: 环形缓冲区 (需要提前初始化并启动 DMA)
+ * @param  cb: 回调函数 (会话期间须保持有效)
+ * @param  timeout_ms: 等待包头超时时间 (毫秒)
+ * @note   丢弃环形缓冲区中已有的数据
+ */
+void Ymodem_Init(ymodem_t* ym, ringbuf_t* rb, const ymodem_cb_t* cb, uint32_t timeout_ms);
+
+/**
+ * @brief  推进接收会话 (非阻塞)
+ * @param  ym: 会话上下文
+ * @retval YMODEM_BUSY=进行中, YMODEM_OK=完成, <0=错误码
+ * @note   处理环形缓冲区中已到达的全部完整数据包后立即返回，不等待数据。
+ *         可在主循环中与其他任务交替调用 (后台升级)；回调在调用者上下文中执行。
+ *         会话结束后重复调用返回同一结果
+ */
+int Ymodem_Poll(ymodem_t* ym);
+
 /**
  * @brief  取消 YMODEM 传输
  */
@@ -8,6 +8,7 @@
 
 #include "app_confirm.h"
 #include "image_header.h"
+#include "flash_port.h"
 #include "stm32h7xx_hal.h"
 #include <string.h>
 
@@ -25,6 +26,7 @@
  */
 #define ACTIVE_SLOT_BASE      (FLASH_BANK1_BASE + BOOTLOADER_SIZE)
 #define ACTIVE_TRAILER_BASE   (ACTIVE_SLOT_BASE + SLOT_TOTAL_SIZE - TRAILER_SIZE)
+#define TR_REC_COUNT          (TRAILER_SIZE / sizeof(tr_rec_t))   /* 4096 条 32B 记录 */
 
 /*============================================================================
  * 内部函数
@@ -50,24 +52,39 @@ static int rec_is_empty(const tr_rec_t* r)
     return 1;
 }
 
+/**
+ * @brief  二分查找第一个空位 (记录只追加，空位之后全部为空)
+ * @retval 第一个空位的序号，TR_REC_COUNT 表示扇区已满
+ */
+static uint32_t trailer_end_app(uint32_t base)
+{
+    uint32_t lo = 0, hi = TR_REC_COUNT;
+
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (rec_is_empty((const tr_rec_t*)(base + mid * sizeof(tr_rec_t)))) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
 /**
  * @brief  读取 trailer 扇区的最后一条有效记录
  */
 static int trailer_read_last_app(uint32_t base, tr_rec_t* out) 
 {
-    const tr_rec_t* last = NULL;
-
-    for (uint32_t off = 0; off < TRAILER_SIZE; off += sizeof(tr_rec_t)) {
-        const tr_rec_t* r = (const tr_rec_t*)(base + off);
-        if (rec_is_empty(r)) break;
+    /* 从末尾向前跳过其他记录 (校验记录、IAP 会话标记/断点) */
+    for (uint32_t i = trailer_end_app(base); i > 0; i--) {
+        const tr_rec_t* r = (const tr_rec_t*)(base + (i - 1) * sizeof(tr_rec_t));
         if (rec_is_valid(r)) {
-            last = r;
+            *out = *r;
+            return 0;
         }
     }
-
-    if (!last) return -1;
-    *out = *last;
-    return 0;
+    return -1;
 }
 
 /**
@@ -82,43 +99,25 @@ static uint32_t trailer_next_seq_app(uint32_t base)
     return 1;
 }
 
-/* 静态 32B 对齐缓冲区，用于 Flash 写入 */
-static uint8_t s_flash_write_buf[32] __attribute__((aligned(32)));
-
 /**
  * @brief  追加写入一条 trailer 记录 (App 侧)
  */
-static int trailer_append_app(uint32_t base, const tr_rec_t* rec) 
+static int trailer_append_app(uint32_t base, const tr_rec_t* rec_in) 
 {
-    uint32_t write_addr = 0;
-    int found_empty = 0;
-
-    /* 找到第一个空位 */
-    for (uint32_t off = 0; off < TRAILER_SIZE; off += sizeof(tr_rec_t)) {
-        const tr_rec_t* r = (const tr_rec_t*)(base + off);
-        if (rec_is_empty(r)) { 
-            write_addr = base + off; 
-            found_empty = 1;
-            break; 
-        }
-    }
+    static tr_rec_t rec;               /* 使用 static 避免栈对齐问题 */
+    uint32_t end = trailer_end_app(base);
 
-    /* 扇区已满 */
-    if (!found_empty) {
+    /* 扇区已满：trailer 与 App 在同一 Bank，擦除期间 CPU 停住，App 不擦除，
+     * 留给 Bootloader 下次写入时整理 (本次确认失败，下次启动重试) */
+    if (end >= TR_REC_COUNT) {
         return -1;
     }
 
-    /* 准备 32B 对齐的数据 (使用静态缓冲区) */
-    memcpy(s_flash_write_buf, rec, sizeof(tr_rec_t));
-
-    /* 按 32B (256-bit flash word) 写入 */
-    HAL_StatusTypeDef status;
-    
-    HAL_FLASH_Unlock();
-    status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_FLASHWORD, write_addr, (uint32_t)s_flash_write_buf);
-    HAL_FLASH_Lock();
+    rec = *rec_in;
+    rec.rsv[0] = base + end * sizeof(tr_rec_t);
 
-    return (status == HAL_OK) ? 0 : -2;
+    /* 按 32B (256-bit flash word) 写入，记录为 packed 结构，由 FlashPort 经对齐缓冲区编程 */
+    return (FlashPort_Program(rec.rsv[0], &rec, sizeof(tr_rec_t), 0) == 0) ? 0 : -2;
 }
 
 /*============================================================================
@@ -27,12 +27,19 @@
  *============================================================================*/
 
 /**
- * @brief  计算 CRC16-CCITT
+ * @brief  分段数据视图 (直接指向环形缓冲区存储，不复制)
+ * @note   数据在缓冲区末尾回绕时分为两段，否则 len[1] 为 0
  */
-static uint16_t calc_crc16(const uint8_t* data, uint32_t len)
+typedef struct {
+    const uint8_t* seg[2];  /* 各段起始地址 */
+    uint32_t       len[2];  /* 各段长度 */
+} ymodem_vec_t;
+
+/**
+ * @brief  CRC16-CCITT 续算 (初值 0)
+ */
+static uint16_t crc16_update(uint16_t crc, const uint8_t* data, uint32_t len)
 {
-    uint16_t crc = 0;
-    
     while (len--) {
         crc ^= (uint16_t)(*data++) << 8;
         for (int i = 0; i < 8; i++) {
@@ -48,48 +55,108 @@ static uint16_t calc_crc16(const uint8_t* data, uint32_t len)
 }
 
 /**
- * @brief  发送单个字符
+ * @brief  在环形缓冲区上建立 len 字节的分段视图 (不移动读指针)
+ * @note   调用前需确保缓冲区中至少有 len 字节
  */
-static void send_char(uint8_t ch)
+static void rb_peek_vec(ringbuf_t* rb, uint32_t len, ymodem_vec_t* v)
 {
-    YmodemPort_SendByte(ch);
+    uint32_t linear = rb->size - rb->tail;
+    
+    v->seg[0] = &rb->buffer[rb->tail];
+    v->len[0] = (len < linear) ? len : linear;
+    v->seg[1] = rb->buffer;             /* 回绕部分从缓冲区起始处继续 */
+    v->len[1] = len - v->len[0];
 }
 
 /**
- * @brief  等待指定数量的字节
- * @retval 0=成功, -1=超时
+ * @brief  读取视图中偏移 off 处的字节
  */
-static int wait_for_bytes(ringbuf_t* rb, uint32_t count, uint32_t timeout_ms)
+static uint8_t vec_byte(const ymodem_vec_t* v, uint32_t off)
 {
-    uint32_t start = YmodemPort_GetTick();
-    
-    while (RingBuf_Available(rb) < count) {
-        /* 主动更新 DMA head (关键！DMA 中断只在半满/全满时触发) */
-        YmodemPort_UpdateRxHead(rb);
-        
-        if ((YmodemPort_GetTick() - start) > timeout_ms) {
-            return -1;
+    return (off < v->len[0]) ? v->seg[0][off] : v->seg[1][off - v->len[0]];
+}
+
+/**
+ * @brief  截取子视图 [off, off + len)
+ */
+static void vec_slice(const ymodem_vec_t* v, uint32_t off, uint32_t len, ymodem_vec_t* out)
+{
+    if (off < v->len[0]) {
+        uint32_t n0 = v->len[0] - off;
+        if (n0 > len) n0 = len;
+        out->seg[0] = v->seg[0] + off;
+        out->len[0] = n0;
+        out->seg[1] = v->seg[1];
+        out->len[1] = len - n0;
+    } else {
+        out->seg[0] = v->seg[1] + (off - v->len[0]);
+        out->len[0] = len;
+        out->seg[1] = NULL;
+        out->len[1] = 0;
+    }
+}
+
+/**
+ * @brief  计算视图数据的 CRC16 (跨段续算)
+ */
+static uint16_t vec_crc16(const ymodem_vec_t* v)
+{
+    uint16_t crc = crc16_update(0, v->seg[0], v->len[0]);
+    if (v->len[1] > 0) {
+        crc = crc16_update(crc, v->seg[1], v->len[1]);
+    }
+    return crc;
+}
+
+/**
+ * @brief  将视图复制到连续缓冲区 (只用于 packet 0 的文件信息解析)
+ */
+static void vec_copy(const ymodem_vec_t* v, uint8_t* dst)
+{
+    memcpy(dst, v->seg[0], v->len[0]);
+    if (v->len[1] > 0) {
+        memcpy(dst + v->len[0], v->seg[1], v->len[1]);
+    }
+}
+
+/**
+ * @brief  将数据视图逐段交给 on_data (回绕时调用两次)
+ * @retval 0=成功, <0=回调要求取消
+ */
+static int deliver_data(const ymodem_cb_t* cb, const ymodem_vec_t* v)
+{
+    if (cb->on_data) {
+        for (int i = 0; i < 2; i++) {
+            if (v->len[i] > 0 && cb->on_data(v->seg[i], v->len[i]) != 0) {
+                return -1;
+            }
         }
-        /* 让出 CPU，可以在这里喂狗 */
     }
     
-    /* D-Cache Invalidate: 确保 CPU 读取 DMA 写入的最新数据 */
-    YmodemPort_InvalidateCache(rb->buffer, rb->size);
-    
     return 0;
 }
 
 /**
- * @brief  读取一个字节
- * @retval 0=成功, -1=超时
+ * @brief  发送单个字符
  */
-static int read_byte(ringbuf_t* rb, uint8_t* out, uint32_t timeout_ms)
+static void send_char(uint8_t ch)
 {
-    if (wait_for_bytes(rb, 1, timeout_ms) != 0) {
-        return -1;
-    }
+    YmodemPort_SendByte(ch);
+}
+
+/**
+ * @brief  同步 DMA 写位置并使接收缓冲区的 Cache 失效
+ * @note   DMA 中断只在半满/全满时触发，读取前主动更新 head
+ * @retval 可读字节数
+ */
+static uint32_t rx_update(ringbuf_t* rb)
+{
+    YmodemPort_UpdateRxHead(rb);
+    
+    /* D-Cache Invalidate: 确保 CPU 读取 DMA 写入的最新数据 */
+    YmodemPort_InvalidateCache(rb->buffer, rb->size);
     
-    return RingBuf_ReadByte(rb, out);
+    return RingBuf_Available(rb);
 }
 
 /**
@@ -122,6 +189,202 @@ static int parse_file_info(const uint8_t* data, uint32_t len,
     return 0;
 }
 
+/**
+ * @brief  结束会话并记录结果
+ */
+static int finish(ymodem_t* ym, int code)
+{
+    ym->result = code;
+    ym->state = (code == YMODEM_OK) ? YMODEM_STATE_DONE : YMODEM_STATE_ERROR;
+    return code;
+}
+
+/**
+ * @brief  等待包头超时处理
+ * @retval YMODEM_BUSY=继续等待, <0=错误码
+ */
+static int handle_timeout(ymodem_t* ym)
+{
+    const ymodem_cb_t* cb = ym->cb;
+
+    if (ym->state == YMODEM_STATE_WAIT_START) {
+        /* 还在等待开始，重发 'C' */
+        if (++ym->retry_count >= MAX_RETRY) {
+            YmodemPort_Log("[YMODEM] Timeout waiting for sender\r\n");
+            if (cb->on_error) cb->on_error(YMODEM_ERR_TIMEOUT);
+            return finish(ym, YMODEM_ERR_TIMEOUT);
+        }
+        send_char(YMODEM_C);
+        return YMODEM_BUSY;
+    }
+
+    YmodemPort_Log("[YMODEM] Timeout during transfer\r\n");
+    Ymodem_Cancel();
+    if (cb->on_error) cb->on_error(YMODEM_ERR_TIMEOUT);
+    return finish(ym, YMODEM_ERR_TIMEOUT);
+}
+
+/**
+ * @brief  处理单字节控制字符 (EOT / CAN / 未知字符)
+ * @retval YMODEM_BUSY=继续, <0=错误码
+ */
+static int handle_control(ymodem_t* ym, uint8_t header)
+{
+    switch (header) {
+        case YMODEM_EOT:
+            if (ym->state == YMODEM_STATE_RECEIVING) {
+                /* 第一个 EOT，发送 NAK */
+                send_char(YMODEM_NAK);
+                ym->state = YMODEM_STATE_WAIT_END;
+            } else if (ym->state == YMODEM_STATE_WAIT_END) {
+                /* 第二个 EOT，发送 ACK + C，等待结束包 */
+                send_char(YMODEM_ACK);
+                send_char(YMODEM_C);
+                ym->expected_seq = 0;
+            }
+            /* 等待开始时的 EOT 是噪声/残留，忽略 */
+            return YMODEM_BUSY;
+
+        case YMODEM_CAN:
+            YmodemPort_Log("[YMODEM] Transfer cancelled by sender\r\n");
+            if (ym->cb->on_error) ym->cb->on_error(YMODEM_ERR_CANCEL);
+            return finish(ym, YMODEM_ERR_CANCEL);
+
+        default:
+            return YMODEM_BUSY;
+    }
+}
+
+/**
+ * @brief  处理一个已完整到达的数据包 (包体留在环形缓冲区中原地校验，处理完后释放)
+ * @retval YMODEM_BUSY=继续, YMODEM_OK=传输完成, <0=错误码
+ */
+static int handle_packet(ymodem_t* ym, uint32_t packet_size)
+{
+    static uint8_t packet_buf[YMODEM_PACKET_1K];     /* 只存放 packet 0 (文件信息) */
+    ringbuf_t* rb = ym->rb;
+    const ymodem_cb_t* cb = ym->cb;
+    uint32_t total_len = 2 + packet_size + 2;       /* SeqNo + ~SeqNo + Data + CRC */
+    ymodem_vec_t pkt;
+    ymodem_vec_t data;
+
+    rb_peek_vec(rb, total_len, &pkt);
+    vec_slice(&pkt, 2, packet_size, &data);
+
+    uint8_t seq_no = vec_byte(&pkt, 0);
+    uint8_t seq_comp = vec_byte(&pkt, 1);
+    uint16_t recv_crc = ((uint16_t)vec_byte(&pkt, 2 + packet_size) << 8)
+                      |  (uint16_t)vec_byte(&pkt, 2 + packet_size + 1);
+
+    if ((uint8_t)(seq_no ^ seq_comp) != 0xFF) {
+        RingBuf_Skip(rb, total_len);
+        send_char(YMODEM_NAK);
+        return YMODEM_BUSY;
+    }
+
+    if (vec_crc16(&data) != recv_crc) {
+        RingBuf_Skip(rb, total_len);
+        send_char(YMODEM_NAK);
+        return YMODEM_BUSY;
+    }
+
+    /* 序列号检查 */
+    if (seq_no != ym->expected_seq) {
+        RingBuf_Skip(rb, total_len);
+        if (seq_no == (uint8_t)(ym->expected_seq - 1)) {
+            send_char(YMODEM_ACK);
+            return YMODEM_BUSY;
+        }
+        YmodemPort_Log("[YMODEM] Sequence error (expect=%d, recv=%d)\r\n",
+                       ym->expected_seq, seq_no);
+        Ymodem_Cancel();
+        if (cb->on_error) cb->on_error(YMODEM_ERR_SEQ);
+        return finish(ym, YMODEM_ERR_SEQ);
+    }
+
+    /* ---------- 处理 packet 0（文件信息/结束） ---------- */
+
+    if (seq_no == 0 && ym->state != YMODEM_STATE_RECEIVING) {
+        /* 文件信息需要连续存放，只有 packet 0 复制出来 */
+        vec_copy(&data, packet_buf);
+        RingBuf_Skip(rb, total_len);
+
+        parse_file_info(packet_buf, packet_size, ym->filename, &ym->filesize);
+
+        if (ym->filename[0] == '\0') {
+            /* 空文件名 = batch 结束 */
+            if (ym->state == YMODEM_STATE_WAIT_END) {
+                YmodemPort_Log("\r\n[YMODEM] Transfer complete: %lu bytes\r\n",
+                               (unsigned long)ym->received_bytes);
+                if (cb->on_end) cb->on_end();
+            } else {
+                YmodemPort_Log("[YMODEM] All transfers complete\r\n");
+            }
+            send_char(YMODEM_ACK);
+            return finish(ym, YMODEM_OK);
+        }
+
+        /* 非空文件名：不论等待开始还是等待结束，都当作“开始新文件” */
+        YmodemPort_Log("[YMODEM] File: %s, Size: %lu bytes\r\n",
+                       ym->filename, (unsigned long)ym->filesize);
+
+        if (cb->on_begin) {
+            if (cb->on_begin(ym->filename, ym->filesize) != 0) {
+                YmodemPort_Log("[YMODEM] Callback rejected transfer\r\n");
+                Ymodem_Cancel();
+                return finish(ym, YMODEM_ERR_CALLBACK);
+            }
+        }
+
+        ym->state = YMODEM_STATE_RECEIVING;
+        ym->expected_seq = 1;
+        ym->received_bytes = 0;
+
+        send_char(YMODEM_ACK);
+        send_char(YMODEM_C);
+        return YMODEM_BUSY;
+    }
+
+    /* ---------- 数据包 ---------- */
+
+    if (ym->state == YMODEM_STATE_RECEIVING || ym->state == YMODEM_STATE_WAIT_END) {
+        uint32_t data_len = packet_size;
+
+        if (ym->filesize > 0 && ym->received_bytes + data_len > ym->filesize) {
+            data_len = ym->filesize - ym->received_bytes;
+        }
+
+        /* 直接从环形缓冲区交给回调，回调返回后才释放这段空间 */
+        ymodem_vec_t chunk;
+        vec_slice(&data, 0, data_len, &chunk);
+        int r = deliver_data(cb, &chunk);
+        RingBuf_Skip(rb, total_len);
+        if (r != 0) {
+            YmodemPort_Log("[YMODEM] Data callback error\r\n");
+            Ymodem_Cancel();
+            return finish(ym, YMODEM_ERR_CALLBACK);
+        }
+
+        ym->received_bytes += data_len;
+        ym->expected_seq = (uint8_t)(ym->expected_seq + 1);
+
+        if (ym->filesize > 0) {
+            YmodemPort_Log("\r[YMODEM] Progress: %lu/%lu (%lu%%)",
+                           (unsigned long)ym->received_bytes,
+                           (unsigned long)ym->filesize,
+                           (unsigned long)(ym->received_bytes * 100 / ym->filesize));
+        }
+
+        send_char(YMODEM_ACK);
+        return YMODEM_BUSY;
+    }
+
+    /* 不应该走到这里，兜底 ACK */
+    RingBuf_Skip(rb, total_len);
+    send_char(YMODEM_ACK);
+    return YMODEM_BUSY;
+}
+
 /*============================================================================
  * 公共函数实现
  *============================================================================*/
@@ -135,217 +398,88 @@ void Ymodem_Cancel(void)
     }
 }
 
-int Ymodem_Receive(ringbuf_t* rb, const ymodem_cb_t* cb, uint32_t timeout_ms)
+void Ymodem_Init(ymodem_t* ym, ringbuf_t* rb, const ymodem_cb_t* cb, uint32_t timeout_ms)
 {
-    static uint8_t packet_buf[YMODEM_PACKET_1K + PACKET_OVERHEAD];
-    char filename[128];
-    uint32_t filesize = 0;
-    uint32_t received_bytes = 0;
-    uint8_t expected_seq = 0;
-    int retry_count = 0;
-    int state = 0;  /* 0=等待开始, 1=接收数据, 2=等待结束 */
-    
-    YmodemPort_Log("[YMODEM] Waiting for sender (send 'C')...\r\n");
-    
-    /* 同步 DMA 当前位置 (不能用 Reset，DMA 已经在运行) */
+    memset(ym, 0, sizeof(*ym));
+    ym->rb = rb;
+    ym->cb = cb;
+    ym->timeout_ms = timeout_ms;
+    ym->state = YMODEM_STATE_WAIT_START;
+    ym->result = YMODEM_BUSY;
+
+    /* 同步 DMA 当前位置并丢弃已有数据 (不能用 Reset，DMA 已经在运行) */
     YmodemPort_UpdateRxHead(rb);
-    rb->tail = rb->head;  /* 丢弃已有数据 */
-    
-    /* 发送 'C' 请求 CRC 模式 */
+    rb->tail = rb->head;
+
+    YmodemPort_Log("[YMODEM] Waiting for sender (send 'C')...\r\n");
     send_char(YMODEM_C);
-    
+    ym->tick = YmodemPort_GetTick();
+}
+
+int Ymodem_Poll(ymodem_t* ym)
+{
+    if (ym->state == YMODEM_STATE_DONE || ym->state == YMODEM_STATE_ERROR) {
+        return ym->result;
+    }
+
     while (1) {
-        uint8_t header;
-        uint32_t packet_size;
-        
-        /* 读取包头 */
-        if (read_byte(rb, &header, timeout_ms) != 0) {
-            /* 超时 */
-            if (state == 0) {
-                /* 还在等待开始，重发 'C' */
-                retry_count++;
-                if (retry_count >= MAX_RETRY) {
-                    YmodemPort_Log("[YMODEM] Timeout waiting for sender\r\n");
-                    if (cb->on_error) cb->on_error(YMODEM_ERR_TIMEOUT);
-                    return YMODEM_ERR_TIMEOUT;
+        uint32_t now = YmodemPort_GetTick();
+
+        if (ym->header == 0) {
+            uint8_t header;
+
+            /* 读取包头 */
+            if (rx_update(ym->rb) == 0 || RingBuf_ReadByte(ym->rb, &header) != 0) {
+                if ((now - ym->tick) > ym->timeout_ms) {
+                    int ret = handle_timeout(ym);
+                    ym->tick = now;
+                    return ret;
                 }
-                send_char(YMODEM_C);
-                continue;
-            } else {
-                /* 数据传输中超时 */
-                YmodemPort_Log("[YMODEM] Timeout during transfer\r\n");
-                Ymodem_Cancel();
-                if (cb->on_error) cb->on_error(YMODEM_ERR_TIMEOUT);
-                return YMODEM_ERR_TIMEOUT;
+                return YMODEM_BUSY;
             }
-        }
-        
-        retry_count = 0;  /* 收到数据，重置重试计数 */
-        
-        /* 解析包头 */
-        switch (header) {
-            case YMODEM_SOH:
-                packet_size = YMODEM_PACKET_128;
-                break;
-                
-            case YMODEM_STX:
-                packet_size = YMODEM_PACKET_1K;
-                break;
-                
-            case YMODEM_EOT:
-                /* 传输结束 */
-                if (state == 1) {
-                    /* 第一个 EOT，发送 NAK */
-                    send_char(YMODEM_NAK);
-                    state = 2;
-                    continue;
-                } else if (state == 2) {
-                    /* 第二个 EOT，发送 ACK + C */
-                    send_char(YMODEM_ACK);
-                    send_char(YMODEM_C);
-                    
-                    /* 重置期望序列号，等待结束包 (packet 0，空文件名) */
-                    expected_seq = 0;
-                    continue;
-                }
-                break;
-                
-            case YMODEM_CAN:
-                /* 发送方取消 */
-                YmodemPort_Log("[YMODEM] Transfer cancelled by sender\r\n");
-                if (cb->on_error) cb->on_error(YMODEM_ERR_CANCEL);
-                return YMODEM_ERR_CANCEL;
-                
-            default:
-                /* 未知字符，忽略 */
-                continue;
-        }
-        
-        /* 读取完整数据包 */
-        uint32_t total_len = 2 + packet_size + 2;  /* SeqNo + ~SeqNo + Data + CRC */
-        if (wait_for_bytes(rb, total_len, INTER_CHAR_TIMEOUT * 10) != 0) {
-            YmodemPort_Log("[YMODEM] Incomplete packet\r\n");
-            send_char(YMODEM_NAK);
-            continue;
-        }
-        
-        /* 读取数据包 */
-        packet_buf[0] = header;
-        RingBuf_Read(rb, &packet_buf[1], total_len);
-        
-        uint8_t seq_no = packet_buf[1];
-        uint8_t seq_comp = packet_buf[2];
-        uint8_t* data = &packet_buf[3];
-        uint16_t recv_crc = (packet_buf[3 + packet_size] << 8) | packet_buf[3 + packet_size + 1];
-        
-        /* 验证序列号补码 */
-        if ((seq_no ^ seq_comp) != 0xFF) {
-            send_char(YMODEM_NAK);
-            continue;
-        }
-        
-        /* 验证 CRC */
-        uint16_t calc_crc = calc_crc16(data, packet_size);
-        if (calc_crc != recv_crc) {
-            send_char(YMODEM_NAK);
-            continue;
-        }
-        
-        /* 验证序列号 */
-        if (seq_no != expected_seq) {
-            if (seq_no == (uint8_t)(expected_seq - 1)) {
-                /* 重复包，发送 ACK 但不处理 */
-                send_char(YMODEM_ACK);
+
+            ym->tick = now;
+            ym->retry_count = 0;
+
+            if (header != YMODEM_SOH && header != YMODEM_STX) {
+                int ret = handle_control(ym, header);
+                if (ret != YMODEM_BUSY) return ret;
                 continue;
             }
-            YmodemPort_Log("[YMODEM] Sequence error (expect=%d, recv=%d)\r\n", expected_seq, seq_no);
-            Ymodem_Cancel();
-            if (cb->on_error) cb->on_error(YMODEM_ERR_SEQ);
-            return YMODEM_ERR_SEQ;
+            ym->header = header;
         }
-        
-        /* 处理数据包 */
-        if (state == 0 && seq_no == 0) {
-            /* Packet 0: 文件信息 */
-            parse_file_info(data, packet_size, filename, &filesize);
-            
-            if (filename[0] == '\0') {
-                /* 空文件名 = 传输完全结束 */
-                YmodemPort_Log("[YMODEM] All transfers complete\r\n");
-                send_char(YMODEM_ACK);
-                return YMODEM_OK;
-            }
-            
-            YmodemPort_Log("[YMODEM] File: %s, Size: %lu bytes\r\n", filename, (unsigned long)filesize);
-            
-            /* 调用开始回调 */
-            if (cb->on_begin) {
-                if (cb->on_begin(filename, filesize) != 0) {
-                    YmodemPort_Log("[YMODEM] Callback rejected transfer\r\n");
-                    Ymodem_Cancel();
-                    return YMODEM_ERR_CALLBACK;
-                }
-            }
-            
-            state = 1;
-            expected_seq = 1;
-            received_bytes = 0;
-            
-            send_char(YMODEM_ACK);
-            send_char(YMODEM_C);  /* 请求数据包 */
-            continue;
-        }
-        
-        if (state >= 1 && seq_no != 0) {
-            /* 数据包 */
-            uint32_t data_len = packet_size;
-            
-            /* 如果知道文件大小，裁剪最后一个包 */
-            if (filesize > 0 && received_bytes + data_len > filesize) {
-                data_len = filesize - received_bytes;
-            }
-            
-            /* 调用数据回调 */
-            if (cb->on_data) {
-                if (cb->on_data(data, data_len) != 0) {
-                    YmodemPort_Log("[YMODEM] Data callback error\r\n");
-                    Ymodem_Cancel();
-                    return YMODEM_ERR_CALLBACK;
-                }
-            }
-            
-            received_bytes += data_len;
-            expected_seq = (expected_seq + 1) & 0xFF;
-            
-            /* 进度显示 */
-            if (filesize > 0) {
-                YmodemPort_Log("\r[YMODEM] Progress: %lu/%lu (%lu%%)", 
-                       (unsigned long)received_bytes, (unsigned long)filesize,
-                       (unsigned long)(received_bytes * 100 / filesize));
-            }
-            
-            send_char(YMODEM_ACK);
-            continue;
-        }
-        
-        if (state == 2 && seq_no == 0) {
-            /* 结束时的 packet 0 (空文件名) */
-            parse_file_info(data, packet_size, filename, &filesize);
-            
-            if (filename[0] == '\0') {
-                /* 传输完成 */
-                YmodemPort_Log("\r\n[YMODEM] Transfer complete: %lu bytes\r\n", (unsigned long)received_bytes);
-                
-                if (cb->on_end) {
-                    cb->on_end();
-                }
-                
-                send_char(YMODEM_ACK);
-                return YMODEM_OK;
+
+        /* 等待完整数据包：SeqNo + ~SeqNo + Data + CRC */
+        uint32_t packet_size = (ym->header == YMODEM_STX) ? YMODEM_PACKET_1K : YMODEM_PACKET_128;
+        if (rx_update(ym->rb) < 2 + packet_size + 2) {
+            if ((now - ym->tick) > INTER_CHAR_TIMEOUT * 10) {
+                YmodemPort_Log("[YMODEM] Incomplete packet\r\n");
+                ym->header = 0;
+                ym->tick = now;
+                send_char(YMODEM_NAK);
+                continue;
             }
+            return YMODEM_BUSY;
         }
-        
-        /* 默认发送 ACK */
-        send_char(YMODEM_ACK);
+
+        ym->header = 0;
+        int ret = handle_packet(ym, packet_size);
+        if (ret != YMODEM_BUSY) return ret;
+        ym->tick = YmodemPort_GetTick();
     }
 }
+
+int Ymodem_Receive(ringbuf_t* rb, const ymodem_cb_t* cb, uint32_t timeout_ms)
+{
+    ymodem_t ym;
+    int ret;
+
+    Ymodem_Init(&ym, rb, cb, timeout_ms);
+
+    /* 阻塞封装：无数据时让出 CPU，等待 DMA/UART 中断或 SysTick 唤醒 */
+    while ((ret = Ymodem_Poll(&ym)) == YMODEM_BUSY) {
+        YmodemPort_Idle();
+    }
+
+    return ret;
+}
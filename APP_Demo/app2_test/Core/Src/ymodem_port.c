@@ -43,6 +43,12 @@ void YmodemPort_InvalidateCache(void* buf, uint32_t size)
                                   (size + 31) & ~31U);
 }
 
+void YmodemPort_Idle(void)
+{
+    /* 休眠到下一个中断 (DMA 半满/全满或 SysTick)，避免空转占满 CPU */
+    __WFI();
+}
+
 void YmodemPort_Log(const char* fmt, ...)
 {
     va_list args;
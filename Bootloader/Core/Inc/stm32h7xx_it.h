@@ -60,6 +60,8 @@ void DMA1_Stream1_IRQHandler(void);
 void USART1_IRQHandler(void);
 void TIM5_IRQHandler(void);
 /* USER CODE BEGIN EFP */
+void FLASH_IRQHandler(void);
+void MDMA_IRQHandler(void);
 
 /* USER CODE END EFP */
 
@@ -62,8 +62,13 @@ uint32_t cnt = 0;
  */
 uint32_t g_JumpInit __attribute__((at(0x20000000), zero_init));  /* 跳转标志 */
 __attribute__((aligned(32))) static uint8_t dma_rx_buf[256];
-static uint8_t rb_buf[2048];
+/*
+ * YMODEM-G 下发送方不等待 ACK，写 Flash 期间到达的数据全部堆积在环形缓冲区，
+ * 需容纳数个 1029 字节的数据包 (460800bps 下约 22ms/包)
+ */
+static uint8_t rb_buf[4096];
 lwrb_t uart_rb;
+volatile uint32_t uart_rb_overflow = 0;   /* lwrb 写不下导致丢弃数据的次数 */
 static uint16_t old_pos = 0;
 
 /* USER CODE END PV */
@@ -85,6 +90,27 @@ void UartDmaRx_ResetPos(void)
     uint16_t pos = (uint16_t)(sizeof(dma_rx_buf) - __HAL_DMA_GET_COUNTER(huart1.hdmarx));
     old_pos = pos;
 }
+/**
+ * @brief  切换 USART1 波特率并重新启动 DMA 接收
+ * @note   会等待当前发送完成，环形缓冲区中的旧数据被丢弃
+ */
+HAL_StatusTypeDef UartDmaRx_SetBaud(uint32_t baud)
+{
+    HAL_StatusTypeDef status;
+
+    while (__HAL_UART_GET_FLAG(&huart1, UART_FLAG_TC) == RESET) {}
+
+    HAL_UART_AbortReceive(&huart1);
+    huart1.Init.BaudRate = baud;
+    status = HAL_UART_Init(&huart1);   /* gState 非 RESET，不会重复执行 MspInit */
+
+    lwrb_reset(&uart_rb);
+    old_pos = 0;
+    if (status == HAL_OK) {
+        status = HAL_UARTEx_ReceiveToIdle_DMA(&huart1, dma_rx_buf, sizeof(dma_rx_buf));
+    }
+    return status;
+}
 /* USER CODE END PFP */
 
 /* Private user code ---------------------------------------------------------*/
@@ -190,10 +216,8 @@ int main(void)
     if (lwrb_read(&uart_rb, &ch_byte, 1) == 1) {
         //printf("收到: %c\r\n", ch_byte);
         if (ch_byte == 'U') {
-          /* 擦除 inactive slot */
-          if (IAP_EraseSlot() != 0) {
-              printf("Failed to erase slot!\r\n");
-          }
+          /* 查找可续传断点 (扇区在写入时按需擦除) */
+          IAP_PrepareSlot();
           lwrb_reset(&uart_rb);
           UartDmaRx_ResetPos();
           int result = IAP_UpgradeViaYmodem(&uart_rb, 2000);
@@ -276,12 +300,19 @@ void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size)
     uint16_t pos = (uint16_t)(sizeof(dma_rx_buf) - __HAL_DMA_GET_COUNTER(huart->hdmarx));
     dcache_invalidate(dma_rx_buf, sizeof(dma_rx_buf));
     if (pos != old_pos) {
+        uint32_t want, done;
         if (pos > old_pos) {
-            lwrb_write(&uart_rb, &dma_rx_buf[old_pos], pos - old_pos);
+            want = pos - old_pos;
+            done = lwrb_write(&uart_rb, &dma_rx_buf[old_pos], want);
         } else {
-            lwrb_write(&uart_rb, &dma_rx_buf[old_pos], sizeof(dma_rx_buf) - old_pos);
-            if (pos > 0) lwrb_write(&uart_rb, &dma_rx_buf[0], pos);
+            want = sizeof(dma_rx_buf) - old_pos;
+            done = lwrb_write(&uart_rb, &dma_rx_buf[old_pos], want);
+            if (pos > 0) {
+                want += pos;
+                done += lwrb_write(&uart_rb, &dma_rx_buf[0], pos);
+            }
         }
+        if (done != want) uart_rb_overflow++;
         old_pos = pos;
     }
 }
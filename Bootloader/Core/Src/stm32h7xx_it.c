@@ -22,6 +22,7 @@
 #include "stm32h7xx_it.h"
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include "boot_crc.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -258,4 +259,20 @@ void TIM5_IRQHandler(void)
 
 /* USER CODE BEGIN 1 */
 
+/**
+  * @brief This function handles FLASH global interrupt (IAP 后台擦除完成通知).
+  */
+void FLASH_IRQHandler(void)
+{
+  HAL_FLASH_IRQHandler();
+}
+
+/**
+  * @brief This function handles MDMA global interrupt (镜像 CRC 校验).
+  */
+void MDMA_IRQHandler(void)
+{
+  Boot_CRCIRQHandler();
+}
+
 /* USER CODE END 1 */
@@ -0,0 +1,65 @@
+#ifndef __BOOT_ATTEMPT_H
+#define __BOOT_ATTEMPT_H
+
+#include <stdint.h>
+#include "trailer.h"
+
+/*============================================================================
+ * 说明
+ *============================================================================*/
+/*
+ * PENDING 镜像的启动尝试计数：每次启动的 attempt+1 记在 RTC 备份寄存器
+ * (BKP2R..BKP6R，带校验)，不再写 trailer 扇区；PENDING/CONFIRMED/REJECTED
+ * 状态变化仍写入 Flash。
+ *
+ * 备份寄存器中的计数绑定 trailer 的物理地址、最后一条状态记录的 seq 和
+ * img_crc32，与当前记录不符 (新记录、另一个 Bank) 时从 Flash 中的 attempt
+ * 开始计数。备份域掉电 (校验失败) 时退回 Flash 计数：这次的 attempt+1 照常
+ * 写入 trailer，之前只记在备份寄存器中的次数丢失，计数不会低于 Flash 记录。
+ *
+ * trailer 整理快照 (BKP7R..BKP12R)：App 空闲时整理 trailer (image_meta.c
+ * App_TrailerCompact)，擦除前把最后一条状态记录写入备份寄存器，重写完成后
+ * 清除。启动时快照仍然有效说明整理被中断，按快照恢复这条记录。
+ */
+
+/*============================================================================
+ * 配置
+ *============================================================================*/
+
+/* 1=attempt 计数记在 RTC 备份寄存器, 0=每次启动写 trailer */
+#ifndef BOOT_ATTEMPT_BKP
+#define BOOT_ATTEMPT_BKP    1
+#endif
+
+/*============================================================================
+ * 函数声明
+ *============================================================================*/
+
+/**
+ * @brief  读取 PENDING 记录的有效尝试次数
+ * @param  trailer_base: trailer 扇区基地址 (逻辑地址)
+ * @param  rec: 最后一条状态记录
+ * @param  attempt: 输出，备份寄存器计数与 rec->attempt 中较大者
+ * @retval 1=备份域有效 (attempt+1 可以只记在备份寄存器),
+ *         0=备份域掉电或未启用 (attempt+1 需要写 trailer)
+ * @note   备份域无效时重新初始化为空计数，之后的启动即可使用
+ */
+int Boot_AttemptLoad(uint32_t trailer_base, const tr_rec_t* rec, uint32_t* attempt);
+
+/**
+ * @brief  保存尝试次数
+ * @param  trailer_base: trailer 扇区基地址 (逻辑地址)
+ * @param  rec: 计数所属的状态记录 (Flash 中的最后一条)
+ * @param  attempt: 新的尝试次数
+ */
+void Boot_AttemptStore(uint32_t trailer_base, const tr_rec_t* rec, uint32_t attempt);
+
+/**
+ * @brief  恢复被中断的 trailer 整理 (在读取 trailer 之前调用)
+ * @param  trailer_base: trailer 扇区基地址 (逻辑地址)
+ * @retval 1=已按快照恢复, 0=无需恢复, -1=恢复失败 (快照保留，下次启动重试)
+ * @note   扇区不是全空 (擦除被中断或重写不完整) 时先擦除再写入
+ */
+int Boot_TrailerRestore(uint32_t trailer_base);
+
+#endif /* __BOOT_ATTEMPT_H */
@@ -0,0 +1,80 @@
+#ifndef __BOOT_CRC_H
+#define __BOOT_CRC_H
+
+#include <stdint.h>
+
+/*============================================================================
+ * 说明
+ *============================================================================*/
+/*
+ * 镜像 CRC32 计算引擎，两种方式结果相同 (按字输入，尾部不足 4 字节补 0xFF，
+ * 与 fill_hdr_crc.py 一致)：
+ *   - CPU : 分块调用 HAL_CRC_Accumulate，计算期间 CPU 一直忙
+ *   - MDMA: 按链表节点 (每个节点 64KB) 把数据直接搬到 CRC->DR，
+ *           全部节点完成后中断通知；尾字由 CPU 在完成后补入
+ *
+ * Boot_CRCStart() 返回后 CPU 可以做不使用 CRC 外设的工作 (读 trailer、
+ * 检查另一个 Slot 的镜像头)，再用 Boot_CRCWait() 取结果。
+ * 同一时刻只能有一个计算在进行。
+ */
+
+/*============================================================================
+ * 配置
+ *============================================================================*/
+
+/* 1=编译 MDMA 路径并默认使用, 0=只用 CPU */
+#ifndef BOOT_CRC_MDMA
+#define BOOT_CRC_MDMA       1
+#endif
+
+/* 小于此长度的计算由 CPU 完成 (如 512 字节的镜像头，配置链表的开销更大) */
+#ifndef BOOT_CRC_MDMA_MIN
+#define BOOT_CRC_MDMA_MIN   4096u
+#endif
+
+/*============================================================================
+ * 数据类型定义
+ *============================================================================*/
+
+typedef enum {
+    BOOT_CRC_CPU = 0,
+    BOOT_CRC_DMA
+} boot_crc_engine_t;
+
+/*============================================================================
+ * 函数声明
+ *============================================================================*/
+
+/**
+ * @brief  选择 CRC 计算引擎 (BOOT_CRC_MDMA=0 时固定为 CPU)
+ */
+void Boot_CRCSetEngine(boot_crc_engine_t engine);
+
+/**
+ * @brief  开始计算 [addr, addr+size) 的 CRC32
+ * @param  addr: 起始地址 (4 字节对齐，Flash 或 RAM)
+ * @param  size: 字节数
+ * @note   CPU 方式或长度小于 BOOT_CRC_MDMA_MIN 时直接算完再返回；
+ *         MDMA 配置失败时同样退回 CPU
+ */
+void Boot_CRCStart(uint32_t addr, uint32_t size);
+
+/**
+ * @brief  查询计算是否仍在进行
+ * @retval 1=MDMA 传输进行中, 0=已完成 (可以调用 Boot_CRCWait 取结果)
+ */
+int Boot_CRCBusy(void);
+
+/**
+ * @brief  等待计算完成并取结果
+ * @param  crc: 输出 CRC32
+ * @retval 0=成功, -1=MDMA 传输错误或超时 (如 Flash 读出 ECC 双错，结果无效)
+ */
+int Boot_CRCWait(uint32_t* crc);
+
+/**
+ * @brief  MDMA 中断处理 (在 MDMA_IRQHandler 中调用)
+ */
+void Boot_CRCIRQHandler(void);
+
+#endif /* __BOOT_CRC_H */
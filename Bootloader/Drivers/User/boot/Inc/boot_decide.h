@@ -0,0 +1,74 @@
+#ifndef __BOOT_DECIDE_H
+#define __BOOT_DECIDE_H
+
+#include <stdint.h>
+#include "boot_core.h"
+#include "image_header.h"
+
+/*============================================================================
+ * 说明
+ *============================================================================*/
+/*
+ * 回滚决策 (不访问 Flash)：输入两个 Slot 的廉价信息 (镜像头、向量表、
+ * trailer 状态、版本号)，完整 CRC 只在结论依赖它时才通过回调求值，
+ * 每个 Slot 最多一次。输出决策结果与需要写入的 trailer 记录，
+ * 由 Boot_RollbackDecision 执行写入。
+ *
+ * 不需要完整 CRC 的典型情况：
+ *   - active 是 PENDING (未超限) / 无 trailer / trailer 属于旧镜像：不看 inactive
+ *   - active 已确认，inactive 版本不高于 active，或已被 REJECTED/CONFIRMED
+ *   - active 绑定的 trailer 是 REJECTED：无论 active 是否有效都回滚到 inactive
+ */
+
+/*============================================================================
+ * 数据类型定义
+ *============================================================================*/
+
+/* 单个 Slot 的廉价信息 */
+typedef struct {
+    int      hdr_ok;            /* magic + 向量表有效 (以下镜像头字段仅在此时有意义) */
+    semver_t ver;               /* 镜像头版本 */
+    uint32_t img_crc32;         /* 镜像头中的 CRC */
+    int      has_tr;            /* trailer 有状态记录 */
+    uint32_t tr_state;
+    uint32_t tr_attempt;
+    uint32_t tr_crc32;          /* trailer 绑定的镜像 CRC */
+} boot_slot_facts_t;
+
+#define BOOT_SLOT_ACTIVE        0
+#define BOOT_SLOT_INACTIVE      1
+
+/**
+ * @brief  完整 CRC 回调
+ * @param  slot: BOOT_SLOT_ACTIVE / BOOT_SLOT_INACTIVE
+ * @retval 1=通过, 0=失败
+ */
+typedef int (*boot_crc_check_t)(int slot, void* arg);
+
+/* 决策需要写入的 trailer 记录 */
+#define BOOT_WR_ACTIVE_PENDING      (1u << 0)   /* active 写 PENDING(attempt=1) */
+#define BOOT_WR_ACTIVE_ATTEMPT      (1u << 1)   /* active 写 PENDING(attempt+1) */
+#define BOOT_WR_ACTIVE_REJECTED     (1u << 2)   /* active 写 REJECTED */
+#define BOOT_WR_INACTIVE_PENDING    (1u << 3)   /* inactive 写 PENDING(attempt=1) */
+
+typedef struct {
+    rollback_action_t action;
+    uint32_t writes;            /* BOOT_WR_xxx，按位顺序执行 */
+    uint8_t  crc_checked;       /* 实际求值过完整 CRC 的 Slot (bit0=active, bit1=inactive) */
+} boot_plan_t;
+
+/*============================================================================
+ * 函数声明
+ *============================================================================*/
+
+/**
+ * @brief  回滚决策 (结果与先校验两个 Slot 再决策完全相同)
+ * @param  active, inactive: 两个 Slot 的廉价信息
+ * @param  check: 完整 CRC 回调，只在需要时调用
+ * @param  arg: 回调参数
+ * @retval 决策结果与需要写入的记录
+ */
+boot_plan_t Boot_Decide(const boot_slot_facts_t* active, const boot_slot_facts_t* inactive,
+                        boot_crc_check_t check, void* arg);
+
+#endif /* __BOOT_DECIDE_H */
@@ -57,9 +57,27 @@ int Boot_CheckVector(uint32_t app_entry);
  * @param  hdr_size: 镜像头大小
  * @param  img_size: 镜像体大小 (不含镜像头)
  * @retval CRC32 计算结果
+ * @note   使用 boot_crc 引擎并等待完成；MDMA 出错时退回 CPU 重算
  */
 uint32_t Boot_CalcImageCRC(uint32_t base, uint32_t hdr_size, uint32_t img_size);
 
+/**
+ * @brief  开始校验镜像 CRC，不等待完成 (MDMA 方式下随即返回)
+ * @param  slot_base: Slot 基地址
+ * @param  hdr: 镜像头指针
+ * @retval 0=已开始, -1=img_size 无效 (不必再调用 Boot_CheckCRCFinish)
+ * @note   返回后到 Boot_CheckCRCFinish 之前不能使用 CRC 外设
+ */
+int Boot_CheckCRCStart(uint32_t slot_base, const image_hdr_t* hdr);
+
+/**
+ * @brief  等待 Boot_CheckCRCStart 开始的计算完成并与镜像头比较
+ * @param  slot_base: Slot 基地址
+ * @param  hdr: 镜像头指针
+ * @retval 1=校验通过, 0=校验失败或读取出错
+ */
+int Boot_CheckCRCFinish(uint32_t slot_base, const image_hdr_t* hdr);
+
 /**
  * @brief  校验镜像 CRC
  * @param  slot_base: Slot 基地址
@@ -76,11 +94,4 @@ int Boot_CheckCRC(uint32_t slot_base, const image_hdr_t* hdr);
  */
 int Boot_SemverCompare(semver_t a, semver_t b);
 
-/**
- * @brief  检查指定 Slot 的镜像，返回镜像信息
- * @param  slot_base: Slot 基地址
- * @retval 镜像信息结构体
- */
-image_t Boot_InspectImage(uint32_t slot_base);
-
 #endif /* __BOOT_IMAGE_H */
@@ -9,6 +9,7 @@
 
 #define BOOTLOADER_SIZE       0x00020000u   /* Bootloader 占用 128KB */
 #define SLOT_TOTAL_SIZE       0x000E0000u   /* Slot 总大小 896KB (1MB - 128KB) */
+#define SLOT_SECTOR_SIZE      0x00020000u   /* Flash 扇区 128KB */
 
 /*============================================================================
  * Slot 信息结构体
@@ -46,6 +47,21 @@ slot_info_t Boot_GetInactiveSlot(void);
  */
 uint32_t Boot_GetPhysicalBankBase(int is_active);
 
+/**
+ * @brief  逻辑地址对应的物理地址 (Bank Swap 时两个 Bank 的逻辑地址互换)
+ * @param  addr: 逻辑地址
+ * @retval 物理地址 (RTC 备份寄存器、校验记录中保存的地址不随 swap 变化)
+ */
+uint32_t Boot_PhysAddr(uint32_t addr);
+
+/**
+ * @brief  检查扇区是否为空 (全 0xFF)
+ * @param  addr: 扇区起始地址
+ * @retval 1=全空, 0=有已写入的字
+ * @note   先丢弃扇区的旧 Cache 行，读到的是 Flash 当前内容
+ */
+int Boot_SectorIsBlank(uint32_t addr);
+
 /**
  * @brief  获取 Slot 对应的 App 入口地址
  * @param  slot: Slot 信息
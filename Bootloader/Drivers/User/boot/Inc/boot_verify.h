@@ -0,0 +1,91 @@
+#ifndef __BOOT_VERIFY_H
+#define __BOOT_VERIFY_H
+
+#include <stdint.h>
+#include "boot_image.h"
+#include "boot_slots.h"
+#include "trailer.h"
+
+/*============================================================================
+ * 说明
+ *============================================================================*/
+/*
+ * 启动校验缓存：完整 CRC 校验通过后，在 Slot 自己的 trailer 中写一条
+ * tr_verify_t 记录 (镜像头物理地址 + 镜像头 CRC32 + img_crc32 + trailer 状态)。
+ * 之后的启动只检查镜像头、向量表并与记录比较，不再扫描整个镜像。
+ *
+ * 以下情况仍做完整校验：
+ *   - 没有记录，或记录之后有 IAP 写入 (会话标记/断点使记录作废)
+ *   - 镜像头内容或 trailer 状态与记录不一致
+ *   - 每 BOOT_VERIFY_SCRUB_EVERY 次启动的定期复查 (计数保存在 RTC 备份寄存器)
+ *
+ * 校验分三步 (Prepare -> Start -> Finish)：Start 开始的完整 CRC 由 MDMA 执行
+ * (见 boot_crc.h)，Finish 之前 CPU 可以处理另一个 Slot 的 trailer 与镜像头，
+ * Boot_RollbackDecision (boot_core.c) 按这个顺序检查两个 Slot。
+ */
+
+/*============================================================================
+ * 配置
+ *============================================================================*/
+
+/* 每 N 次启动做一次完整校验 (0=只在缓存失效时校验) */
+#ifndef BOOT_VERIFY_SCRUB_EVERY
+#define BOOT_VERIFY_SCRUB_EVERY   32u
+#endif
+
+/*============================================================================
+ * 数据类型定义
+ *============================================================================*/
+
+typedef enum {
+    BOOT_VERIFY_DONE = 0,               /* 已有结论 (镜像头无效/缓存命中/CRC 已完成) */
+    BOOT_VERIFY_PREPARED,               /* 镜像头有效，校验记录已读取 */
+    BOOT_VERIFY_RUNNING                 /* 完整 CRC 进行中 */
+} boot_verify_stage_t;
+
+/* 单个 Slot 的校验过程 */
+typedef struct {
+    slot_info_t slot;
+    image_t     img;
+    tr_verify_t rec;                    /* trailer 中的校验记录 */
+    int         has_rec;
+    uint32_t    hash;                   /* 镜像头 CRC32 */
+    uint32_t    state;                  /* trailer 状态 */
+    uint32_t    t0;                     /* Start 的开始时刻 (DWT 周期) */
+    uint32_t    cycles;                 /* Prepare 用去的周期数 */
+    const char* why;                    /* 需要完整 CRC 的原因 */
+    boot_verify_stage_t stage;
+} boot_verify_ctx_t;
+
+/*============================================================================
+ * 函数声明
+ *============================================================================*/
+
+/**
+ * @brief  本次启动是否需要定期复查 (每次启动调用一次，计数加 1)
+ * @retval 1=需要完整校验, 0=可以使用缓存
+ * @note   计数保存在 RTC 备份寄存器 BKP0R/BKP1R (带校验)；备份域掉电后
+ *         从 0 重新计数，不会强制复查
+ */
+int Boot_VerifyScrubDue(void);
+
+/**
+ * @brief  校验第一步：检查镜像头与向量表，读取校验记录 (不使用 CRC 外设)
+ */
+void Boot_VerifyPrepare(boot_verify_ctx_t* v, slot_info_t slot);
+
+/**
+ * @brief  校验第二步：与校验记录比较，缓存失效时开始完整 CRC (不等待)
+ * @param  tr_state: trailer 最后一条状态记录的 state (无记录为 0)
+ * @param  scrub: 1=忽略缓存，强制完整校验
+ * @note   使用 CRC 外设，调用前上一个 Slot 的 Boot_VerifyFinish 必须已返回
+ */
+void Boot_VerifyStart(boot_verify_ctx_t* v, uint32_t tr_state, int scrub);
+
+/**
+ * @brief  校验第三步：等待完整 CRC，通过时写入校验记录
+ * @retval 镜像信息结构体
+ */
+image_t Boot_VerifyFinish(boot_verify_ctx_t* v);
+
+#endif /* __BOOT_VERIFY_H */
@@ -1,4 +1,7 @@
 // image_header.h
+#ifndef __IMAGE_HEADER_H
+#define __IMAGE_HEADER_H
+
 #include <stdint.h>
 
 #define IMG_HDR_MAGIC  (0xA5A55A5Au)
@@ -23,3 +26,5 @@ typedef struct __attribute__((packed, aligned(4))) {
     uint32_t img_size;  // 建议：不含 header
     uint32_t img_crc32; // 建议：不含 header
 } image_hdr_t;
+
+#endif /* __IMAGE_HEADER_H */
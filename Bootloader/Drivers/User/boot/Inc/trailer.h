@@ -6,6 +6,7 @@
  *============================================================================*/
 
 #define TR_MAGIC          0x544C5252u   /* 'TLRR' trailer magic */
+#define TR_VERIFY_MAGIC   0x59465256u   /* 'VRFY' 启动校验缓存记录 */
 #define TRAILER_SIZE      0x00020000u   /* 128KB trailer 扇区大小 */
 #define MAX_ATTEMPTS      3u            /* 最大尝试次数，超过则回滚 */
 
@@ -31,13 +32,56 @@ typedef struct __attribute__((packed)) {
   uint32_t state;       /* 状态：TR_STATE_xxx */
   uint32_t attempt;     /* 尝试次数 1..N */
   uint32_t img_crc32;   /* 绑定的镜像 CRC32，防止写错槽 */
-  uint32_t rsv[3];      /* 保留，padding to 32B */
+  uint32_t rsv[3];      /* rsv[0] 为本记录自身的地址 (App 侧的 addr 字段)，其余保留 */
 } tr_rec_t;
 
+/*
+ * 启动校验缓存记录 (32B，与 tr_rec_t 共用 append-only 空间，trailer_read_last 按 magic 跳过)
+ * 完整 CRC 校验通过后写入；之后出现的任何非状态记录 (如 IAP 会话标记、断点) 使其作废
+ */
+typedef struct __attribute__((packed)) {
+  uint32_t magic;       /* TR_VERIFY_MAGIC */
+  uint32_t hdr_addr;    /* 镜像头物理地址 (不随 Bank Swap 变化) */
+  uint32_t hdr_hash;    /* 镜像头 (HDR_SIZE 字节) 的 CRC32 */
+  uint32_t img_crc32;   /* 校验通过的镜像 CRC32 */
+  uint32_t state;       /* 校验时最后一条状态记录的 state (无记录为 0) */
+  uint32_t cycles;      /* 完整校验耗时 (CPU 周期，用于报告快速路径节省的时间) */
+  uint32_t rsv[2];      /* 保留，padding to 32B */
+} tr_verify_t;
+
+#define TR_REC_COUNT      (TRAILER_SIZE / sizeof(tr_rec_t))   /* 4096 条 32B 记录 */
+
+/*
+ * trailer 句柄：扫描一次后缓存最后一条状态记录、下一个序列号和第一个空位，
+ * 之后的读取、写满判断和追加都不再扫描扇区。
+ *   - 通过句柄写入/擦除时同步更新缓存
+ *   - Bank Swap 后 (SWAP_BANK 与扫描时不同) 自动重新扫描
+ *   - 追加前检查缓存的空位：其他代码追加过记录 (如校验记录) 或擦除过扇区时重新扫描
+ *   - 绕过句柄写入状态记录或擦除后，调用 trailer_invalidate 使 trailer_last 重新扫描
+ */
+typedef struct {
+  uint32_t base;        /* trailer 扇区基地址 */
+  uint32_t swap;        /* 扫描时的 SWAP_BANK 状态 */
+  uint32_t end;         /* 第一个空位的记录序号 (等于记录总数表示已满) */
+  uint32_t next_seq;    /* 下一条状态记录的序列号 */
+  tr_rec_t last;        /* 最后一条状态记录 (has_last=1 时有效) */
+  uint8_t  has_last;
+  uint8_t  valid;       /* 0=下次使用时重新扫描 */
+} trailer_t;
+
 /*============================================================================
  * 函数声明
  *============================================================================*/
 
+/**
+ * @brief  二分查找 trailer 扇区已写入区域的末尾
+ * @param  trailer_base: trailer 扇区基地址
+ * @retval 第一个空位的序号，TR_REC_COUNT 表示扇区已满
+ * @note   扇区内所有 32B 记录 (状态、校验、IAP 会话标记/断点) 都只追加，
+ *         其他模块扫描记录时也从这里向前读
+ */
+uint32_t trailer_find_end(uint32_t trailer_base);
+
 /**
  * @brief  读取 trailer 扇区的最后一条有效记录
  * @param  trailer_base: trailer 扇区基地址
@@ -54,6 +98,22 @@ int trailer_read_last(uint32_t trailer_base, tr_rec_t* out);
  */
 int trailer_append(uint32_t trailer_base, const tr_rec_t* rec);
 
+/**
+ * @brief  读取仍然有效的启动校验记录
+ * @param  trailer_base: trailer 扇区基地址
+ * @param  out: 输出的记录指针
+ * @retval 0=成功, -1=无记录或已被之后的非状态记录作废
+ */
+int trailer_read_verify(uint32_t trailer_base, tr_verify_t* out);
+
+/**
+ * @brief  追加写入一条启动校验记录
+ * @param  trailer_base: trailer 扇区基地址
+ * @param  rec: 要写入的记录
+ * @retval 0=成功, -1=扇区已满 (不为此擦除), -2=写入失败
+ */
+int trailer_append_verify(uint32_t trailer_base, const tr_verify_t* rec);
+
 /**
  * @brief  擦除 trailer 扇区 (仅在需要清空/写满时调用)
  * @param  trailer_base: trailer 扇区基地址
@@ -74,3 +134,45 @@ int trailer_is_full(uint32_t trailer_base);
  * @retval 下一个序列号 (当前最大 seq + 1，若无记录则返回 1)
  */
 uint32_t trailer_next_seq(uint32_t trailer_base);
+
+/**
+ * @brief  绑定 trailer 扇区并扫描一次
+ * @param  t: 句柄
+ * @param  trailer_base: trailer 扇区基地址
+ */
+void trailer_open(trailer_t* t, uint32_t trailer_base);
+
+/**
+ * @brief  使缓存失效，下次使用时重新扫描 (绕过句柄写入/擦除后调用)
+ */
+void trailer_invalidate(trailer_t* t);
+
+/**
+ * @brief  读取缓存的最后一条状态记录
+ * @param  t: 句柄
+ * @param  out: 输出的记录指针
+ * @retval 0=成功, -1=无有效记录
+ */
+int trailer_last(trailer_t* t, tr_rec_t* out);
+
+/**
+ * @brief  检查 trailer 扇区是否写满 (使用缓存的空位)
+ * @retval 1=已满, 0=未满
+ */
+int trailer_full(trailer_t* t);
+
+/**
+ * @brief  追加一条状态记录 (序列号取缓存值，扇区已满时先擦除)
+ * @param  t: 句柄
+ * @param  state: TR_STATE_xxx
+ * @param  attempt: 尝试次数
+ * @param  img_crc32: 绑定的镜像 CRC32
+ * @retval 0=成功, -1=擦除失败, -2=写入失败
+ */
+int trailer_write(trailer_t* t, uint32_t state, uint32_t attempt, uint32_t img_crc32);
+
+/**
+ * @brief  通过句柄擦除 trailer 扇区 (缓存同步为空扇区)
+ * @retval 0=成功, -1=擦除失败
+ */
+int trailer_clear(trailer_t* t);
@@ -0,0 +1,135 @@
+/**
+  ******************************************************************************
+  * @file           : boot_attempt.c
+  * @brief          : PENDING 镜像的启动尝试计数与 trailer 整理快照
+  * @description    : 每次启动的 attempt+1 记在 RTC 备份寄存器，备份域掉电时
+  *                   退回 trailer 中的计数；App 整理 trailer 被中断时按快照恢复
+  ******************************************************************************
+  */
+
+#include "boot_attempt.h"
+#include "boot_slots.h"
+#include "flash_port.h"
+#include "stm32h7xx_hal.h"
+#include <string.h>
+#include <stdio.h>
+
+/*============================================================================
+ * 内部常量
+ *============================================================================*/
+
+/* BKP6R = 其余四个寄存器与 ATTEMPT_KEY 的异或时计数有效 (备份域掉电后全部为 0) */
+#define ATTEMPT_KEY       0xA77E3B7Du
+
+/* BKP12R = BKP7R..BKP11R 与 SNAP_KEY 的异或时整理快照有效 (与 App image_meta.c 一致) */
+#define SNAP_KEY          0xC0A1E5CEu
+
+/*============================================================================
+ * 私有函数
+ *============================================================================*/
+
+#if BOOT_ATTEMPT_BKP
+
+static void bkp_write(uint32_t addr, uint32_t seq, uint32_t img_crc32, uint32_t attempt)
+{
+    RTC->BKP2R = addr;
+    RTC->BKP3R = seq;
+    RTC->BKP4R = img_crc32;
+    RTC->BKP5R = attempt;
+    RTC->BKP6R = addr ^ seq ^ img_crc32 ^ attempt ^ ATTEMPT_KEY;
+}
+
+#endif /* BOOT_ATTEMPT_BKP */
+
+/*============================================================================
+ * 公共函数实现
+ *============================================================================*/
+
+/**
+ * @brief  读取 PENDING 记录的有效尝试次数
+ */
+int Boot_AttemptLoad(uint32_t trailer_base, const tr_rec_t* rec, uint32_t* attempt)
+{
+    *attempt = rec->attempt;
+
+#if BOOT_ATTEMPT_BKP
+    __HAL_RCC_RTC_CLK_ENABLE();
+    HAL_PWR_EnableBkUpAccess();
+
+    uint32_t addr = RTC->BKP2R, seq = RTC->BKP3R, crc = RTC->BKP4R, n = RTC->BKP5R;
+    if (RTC->BKP6R != (addr ^ seq ^ crc ^ n ^ ATTEMPT_KEY)) {
+        bkp_write(0, 0, 0, 0);          /* 备份域掉电：本次退回 Flash 计数 */
+        return 0;
+    }
+
+    /* 只认同一个 trailer 中同一条记录的计数 */
+    if (addr == Boot_PhysAddr(trailer_base) && seq == rec->seq && crc == rec->img_crc32 && n > *attempt) {
+        *attempt = n;
+    }
+    return 1;
+#else
+    (void)trailer_base;
+    return 0;
+#endif
+}
+
+/**
+ * @brief  保存尝试次数
+ */
+void Boot_AttemptStore(uint32_t trailer_base, const tr_rec_t* rec, uint32_t attempt)
+{
+#if BOOT_ATTEMPT_BKP
+    bkp_write(Boot_PhysAddr(trailer_base), rec->seq, rec->img_crc32, attempt);
+#else
+    (void)trailer_base;
+    (void)rec;
+    (void)attempt;
+#endif
+}
+
+/**
+ * @brief  恢复被中断的 trailer 整理
+ */
+int Boot_TrailerRestore(uint32_t trailer_base)
+{
+    static tr_rec_t rec;  /* 使用 static 避免栈对齐问题 */
+    const tr_rec_t* first = (const tr_rec_t*)trailer_base;
+    uint32_t addr;
+
+    __HAL_RCC_RTC_CLK_ENABLE();
+    HAL_PWR_EnableBkUpAccess();
+
+    addr = RTC->BKP7R;
+    if (RTC->BKP12R != (addr ^ RTC->BKP8R ^ RTC->BKP9R ^ RTC->BKP10R ^ RTC->BKP11R ^ SNAP_KEY) ||
+        addr != Boot_PhysAddr(trailer_base)) {
+        return 0;
+    }
+
+    memset(&rec, 0, sizeof(rec));
+    rec.magic     = TR_MAGIC;
+    rec.seq       = RTC->BKP8R;
+    rec.state     = RTC->BKP9R;
+    rec.attempt   = RTC->BKP10R;
+    rec.img_crc32 = RTC->BKP11R;
+    rec.rsv[0]    = trailer_base;           /* 自身地址：擦除后的第 0 条 (App 侧的 addr 字段) */
+
+    /* 重写已完成，只是没来得及清除快照 */
+    FlashPort_InvalidateCache(trailer_base, sizeof(tr_rec_t));
+    if (first->magic == TR_MAGIC && first->seq == rec.seq && first->state == rec.state &&
+        first->attempt == rec.attempt && first->img_crc32 == rec.img_crc32) {
+        RTC->BKP12R = 0;
+        return 0;
+    }
+
+    printf("[Boot] Trailer compaction was interrupted, restoring seq=%lu state=0x%08lX\r\n",
+           (unsigned long)rec.seq, (unsigned long)rec.state);
+    if (!Boot_SectorIsBlank(trailer_base) && trailer_erase(trailer_base) != 0) {
+        return -1;
+    }
+    if (trailer_append(trailer_base, &rec) != 0) {
+        return -1;
+    }
+
+    RTC->BKP12R = 0;
+    return 1;
+}
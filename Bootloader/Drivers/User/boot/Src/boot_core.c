@@ -7,9 +7,12 @@
   */
 
 #include "boot_core.h"
+#include "boot_attempt.h"
+#include "boot_decide.h"
 #include "boot_image.h"
 #include "boot_slots.h"
 #include "boot_swap.h"
+#include "boot_verify.h"
 #include "trailer.h"
 #include "gpio.h"
 #include "key.h"
@@ -22,165 +25,88 @@
 extern lwrb_t uart_rb;
 extern void UartDmaRx_ResetPos(void);
 extern lwrb_t uart_rb;
+/*============================================================================
+ * 私有变量
+ *============================================================================*/
+
+/* 本次启动两个 Slot 的 trailer (句柄与最后一条状态记录) 与校验过程 (下标 BOOT_SLOT_xxx) */
+static trailer_t         s_trailer[2];
+static tr_rec_t          s_tr[2];
+static boot_verify_ctx_t s_verify[2];
+static int               s_scrub;
+static int               s_attempt_bkp;     /* 1=active 的 attempt+1 只记在备份寄存器 */
+
 /*============================================================================
  * 私有函数声明
  *============================================================================*/
 
-static int trailer_write_pending(slot_info_t slot, uint32_t img_crc32);
-static int trailer_write_rejected(slot_info_t slot, uint32_t img_crc32);
-static int trailer_increment_attempt(slot_info_t slot, const tr_rec_t* current);
-static int check_upgrade_eligible(const image_t* inactive, const image_t* active,
-                                  const tr_rec_t* inactive_tr, int has_inactive_tr);
-static int check_trailer_binding(const tr_rec_t* tr, const image_t* img);
+static int slot_crc_check(int slot, void* arg);
+static void slot_prepare(int slot, slot_info_t info, boot_slot_facts_t* f);
+static void slot_print(const char* name, slot_info_t info, const boot_slot_facts_t* f);
 
 /*============================================================================
  * 私有函数实现
  *============================================================================*/
 
 /**
- * @brief  写入 PENDING 状态记录 (attempt=1)
+ * @brief  Boot_Decide 的完整 CRC 回调 (校验缓存有效时不扫描镜像)
  */
-static int trailer_write_pending(slot_info_t slot, uint32_t img_crc32)
+static int slot_crc_check(int slot, void* arg)
 {
-    static tr_rec_t rec;  /* 使用 static 避免栈对齐问题 */
-    memset(&rec, 0, sizeof(rec));
-    
-    /* 如果扇区满了，先擦除 */
-    if (trailer_is_full(slot.trailer_base)) {
-        if (trailer_erase(slot.trailer_base) != 0) {
-            return -1;
-        }
-    }
-    
-    rec.magic     = TR_MAGIC;
-    rec.seq       = trailer_next_seq(slot.trailer_base);
-    rec.state     = TR_STATE_PENDING;
-    rec.attempt   = 1;
-    rec.img_crc32 = img_crc32;
-    
-    return trailer_append(slot.trailer_base, &rec);
-}
+    (void)arg;
 
-/**
- * @brief  写入 REJECTED 状态记录
- */
-static int trailer_write_rejected(slot_info_t slot, uint32_t img_crc32)
-{
-    static tr_rec_t rec;  /* 使用 static 避免栈对齐问题 */
-    memset(&rec, 0, sizeof(rec));
-    
-    /* 如果扇区满了，先擦除 */
-    if (trailer_is_full(slot.trailer_base)) {
-        if (trailer_erase(slot.trailer_base) != 0) {
-            return -1;
-        }
+    /* active 的 CRC 可能已在 MDMA 上运行：先等它结束再使用 CRC 外设 */
+    if (slot != BOOT_SLOT_ACTIVE && s_verify[BOOT_SLOT_ACTIVE].stage == BOOT_VERIFY_RUNNING) {
+        (void)Boot_VerifyFinish(&s_verify[BOOT_SLOT_ACTIVE]);
     }
-    
-    rec.magic     = TR_MAGIC;
-    rec.seq       = trailer_next_seq(slot.trailer_base);
-    rec.state     = TR_STATE_REJECTED;
-    rec.attempt   = 0;
-    rec.img_crc32 = img_crc32;
-    
-    return trailer_append(slot.trailer_base, &rec);
+
+    Boot_VerifyStart(&s_verify[slot], s_tr[slot].state, s_scrub);
+    return Boot_VerifyFinish(&s_verify[slot]).valid;
 }
 
 /**
- * @brief  递增 attempt 计数并写入新记录
+ * @brief  读取 Slot 的 trailer 并检查镜像头，填写决策用的廉价信息
  */
-static int trailer_increment_attempt(slot_info_t slot, const tr_rec_t* current)
+static void slot_prepare(int slot, slot_info_t info, boot_slot_facts_t* f)
 {
-    static tr_rec_t rec;  /* 使用 static 避免栈对齐问题 */
-    memset(&rec, 0, sizeof(rec));
-    
-    /* 如果扇区满了，先擦除 */
-    if (trailer_is_full(slot.trailer_base)) {
-        if (trailer_erase(slot.trailer_base) != 0) {
-            return -1;
-        }
+    boot_verify_ctx_t* v = &s_verify[slot];
+
+    memset(&s_tr[slot], 0, sizeof(s_tr[slot]));
+    memset(f, 0, sizeof(*f));
+    trailer_open(&s_trailer[slot], info.trailer_base);     /* 只扫描这一次，之后的写入使用缓存 */
+    f->has_tr = (trailer_last(&s_trailer[slot], &s_tr[slot]) == 0);
+    f->tr_state   = s_tr[slot].state;
+    f->tr_attempt = s_tr[slot].attempt;
+    f->tr_crc32   = s_tr[slot].img_crc32;
+
+    /* active 的尝试次数：备份寄存器中的计数可能比 Flash 记录更新 */
+    if (slot == BOOT_SLOT_ACTIVE) {
+        s_attempt_bkp = Boot_AttemptLoad(info.trailer_base, &s_tr[slot], &f->tr_attempt);
     }
-    
-    rec.magic     = TR_MAGIC;
-    rec.seq       = trailer_next_seq(slot.trailer_base);
-    rec.state     = TR_STATE_PENDING;
-    rec.attempt   = current->attempt + 1;
-    rec.img_crc32 = current->img_crc32;
-    
-    return trailer_append(slot.trailer_base, &rec);
-}
 
-/**
- * @brief  检查 trailer 记录是否与镜像绑定一致
- * @param  tr: trailer 记录
- * @param  img: 镜像信息
- * @retval 1=绑定一致, 0=不一致或无效
- */
-static int check_trailer_binding(const tr_rec_t* tr, const image_t* img)
-{
-    if (!img->valid) return 0;
-    return (tr->img_crc32 == img->hdr->img_crc32);
+    Boot_VerifyPrepare(v, info);
+    f->hdr_ok = (v->stage == BOOT_VERIFY_PREPARED);
+    if (f->hdr_ok) {
+        f->ver       = v->img.hdr->ver;
+        f->img_crc32 = v->img.hdr->img_crc32;
+    }
 }
 
 /**
- * @brief  【规则1】检查 inactive 是否满足"升级"条件 (upgrade policy)
- * @note   升级条件组合：
- *         1. inactive 镜像 valid (magic+vector+CRC 都 OK)
- *         2. inactive 版本号 > active 版本号 (active 必须 valid)
- *         3. inactive trailer 当前不是 REJECTED (针对该镜像)
- *         4. inactive 不能已经是 CONFIRMED (说明是回滚到旧版本)
- * 
- *         ！！！注意：这只用于"升级"场景，不用于"容错"场景！！！
- *         容错 (failover) 在 active 无效时必须无条件启动 inactive
- * 
- * @param  inactive: inactive slot 镜像信息
- * @param  active: active slot 镜像信息 (必须 valid)
- * @param  inactive_tr: inactive slot 的 trailer 记录
- * @param  has_inactive_tr: 是否有有效的 inactive trailer 记录
- * @retval 1=满足升级条件, 0=不满足
+ * @brief  打印 Slot 信息 (CRC 在决策中按需校验，见 [Verify]/[CRC] 日志)
  */
-static int check_upgrade_eligible(const image_t* inactive, const image_t* active,
-                                  const tr_rec_t* inactive_tr, int has_inactive_tr)
+static void slot_print(const char* name, slot_info_t info, const boot_slot_facts_t* f)
 {
-    /* 前置条件: 此函数仅在 active valid 时被调用 */
-    if (!active->valid) {
-        /* 这种情况应该走 failover 逻辑，不是 upgrade */
-        return 0;
-    }
-    
-    /* 条件1: inactive 镜像必须有效 */
-    if (!inactive->valid) {
-        return 0;
-    }
-    
-    /* 条件2: inactive 版本必须高于 active */
-    if (Boot_SemverCompare(inactive->hdr->ver, active->hdr->ver) <= 0) {
-        /* inactive 版本不高于 active，不需要升级 */
-        return 0;
+    printf("[Boot] %s Slot (0x%08lX): %s", name, (unsigned long)info.base, f->hdr_ok ? "header ok" : "invalid");
+    if (f->hdr_ok) {
+        printf(", ver=%d.%d.%d, crc=0x%08lX",
+               f->ver.major, f->ver.minor, f->ver.patch, (unsigned long)f->img_crc32);
     }
-    
-    /* 条件3: 检查 inactive trailer 状态 */
-    if (has_inactive_tr && check_trailer_binding(inactive_tr, inactive)) {
-        if (inactive_tr->state == TR_STATE_REJECTED) {
-            /* 该镜像已被标记为 REJECTED，拒绝升级 */
-            printf("[Boot] Upgrade blocked: inactive image is REJECTED\r\n");
-            return 0;
-        }
-        /* 如果已经是 CONFIRMED，说明曾经是主槽被确认过，然后被换下去了
-           现在又想升级回来？不允许，避免版本循环 */
-        if (inactive_tr->state == TR_STATE_CONFIRMED) {
-            printf("[Boot] Upgrade blocked: inactive image already CONFIRMED (version rollback?)\r\n");
-            return 0;
-        }
-        /* 如果已经是 PENDING，说明正在升级过程中，不要重复写 */
-        if (inactive_tr->state == TR_STATE_PENDING) {
-            printf("[Boot] Upgrade in progress: inactive already PENDING\r\n");
-            /* 返回 1 继续执行 swap，但不需要再写 PENDING */
-            return 1;
-        }
+    if (f->has_tr) {
+        printf(", trailer: state=0x%08lX, attempt=%lu, crc=0x%08lX", 
+               (unsigned long)f->tr_state, (unsigned long)f->tr_attempt, (unsigned long)f->tr_crc32);
     }
-    /* else: trailer CRC 不匹配，说明是旧镜像的 trailer，忽略 */
-    
-    return 1;
+    printf("\r\n");
 }
 
 /*============================================================================
@@ -259,188 +185,62 @@ rollback_action_t Boot_RollbackDecision(void)
 {
     slot_info_t active_slot   = Boot_GetActiveSlot();
     slot_info_t inactive_slot = Boot_GetInactiveSlot();
+    static boot_slot_facts_t facts[2];  /* 使用 static 避免栈对齐问题 */
     
-    /* 检查两个 Slot 的镜像 */
-    image_t active   = Boot_InspectImage(active_slot.base);
-    image_t inactive = Boot_InspectImage(inactive_slot.base);
+    /* App 整理 trailer 时掉电：先按快照恢复最后一条状态记录 */
+    (void)Boot_TrailerRestore(active_slot.trailer_base);
+    (void)Boot_TrailerRestore(inactive_slot.trailer_base);
     
-    /* 读取 trailer 记录 (使用 static 避免栈对齐问题) */
-    static tr_rec_t active_tr;
-    static tr_rec_t inactive_tr;
-    memset(&active_tr, 0, sizeof(active_tr));
-    memset(&inactive_tr, 0, sizeof(inactive_tr));
-    int has_active_tr   = (trailer_read_last(active_slot.trailer_base, &active_tr) == 0);
-    int has_inactive_tr = (trailer_read_last(inactive_slot.trailer_base, &inactive_tr) == 0);
+    /* 廉价信息：trailer 状态、magic、向量表、版本号 */
+    s_scrub = Boot_VerifyScrubDue();
+    slot_prepare(BOOT_SLOT_ACTIVE, active_slot, &facts[BOOT_SLOT_ACTIVE]);
     
-    /* 打印调试信息 */
-    printf("[Boot] Active   Slot (0x%08lX): %s", (unsigned long)active_slot.base, active.valid ? "valid" : "invalid");
-    if (active.valid) {
-        printf(", ver=%d.%d.%d, crc=0x%08lX",
-               active.hdr->ver.major, active.hdr->ver.minor, active.hdr->ver.patch,
-               (unsigned long)active.hdr->img_crc32);
+    /* active 的 CRC 几乎总会用到 (唯一例外是它绑定的 trailer 为 REJECTED)：
+     * 先让 MDMA 开始计算，同时读取 inactive 的 trailer 和镜像头 */
+    if (!(facts[BOOT_SLOT_ACTIVE].has_tr &&
+          facts[BOOT_SLOT_ACTIVE].tr_crc32 == facts[BOOT_SLOT_ACTIVE].img_crc32 &&
+          facts[BOOT_SLOT_ACTIVE].tr_state == TR_STATE_REJECTED)) {
+        Boot_VerifyStart(&s_verify[BOOT_SLOT_ACTIVE], s_tr[BOOT_SLOT_ACTIVE].state, s_scrub);
     }
-    if (has_active_tr) {
-        printf(", trailer: state=0x%08lX, attempt=%lu, crc=0x%08lX", 
-               (unsigned long)active_tr.state, (unsigned long)active_tr.attempt, (unsigned long)active_tr.img_crc32);
-    }
-    printf("\r\n");
+    slot_prepare(BOOT_SLOT_INACTIVE, inactive_slot, &facts[BOOT_SLOT_INACTIVE]);
     
-    printf("[Boot] Inactive Slot (0x%08lX): %s", (unsigned long)inactive_slot.base, inactive.valid ? "valid" : "invalid");
-    if (inactive.valid) {
-        printf(", ver=%d.%d.%d, crc=0x%08lX",
-               inactive.hdr->ver.major, inactive.hdr->ver.minor, inactive.hdr->ver.patch,
-               (unsigned long)inactive.hdr->img_crc32);
-    }
-    if (has_inactive_tr) {
-        printf(", trailer: state=0x%08lX, attempt=%lu, crc=0x%08lX", 
-               (unsigned long)inactive_tr.state, (unsigned long)inactive_tr.attempt, (unsigned long)inactive_tr.img_crc32);
-    }
-    printf("\r\n");
-    
-    /*=========================================================================
-     * 分支 1: A (active) 无效
-     *         → 必须进行容错启动 (failover)，不受任何升级策略限制
-     *=========================================================================*/
-    if (!active.valid) {
-        if (inactive.valid) {
-            /* ★★★ FAILOVER: inactive 有效，但还要检查是否被 REJECTED ★★★ */
-            if (has_inactive_tr && check_trailer_binding(&inactive_tr, &inactive) &&
-                inactive_tr.state == TR_STATE_REJECTED) {
-                printf("[Boot] FAILOVER blocked: inactive image is REJECTED, entering DFU mode\r\n");
-                return ROLLBACK_DFU_MODE;
-            }
-            printf("[Boot] FAILOVER: Active is invalid, switching to valid inactive slot\r\n");
-            /* 确保 inactive 有 PENDING trailer，swap 后 App 才能确认自己 */
-            if (!has_inactive_tr || !check_trailer_binding(&inactive_tr, &inactive)) {
-                printf("[Boot] Writing PENDING(attempt=1) for inactive slot before swap\r\n");
-                trailer_write_pending(inactive_slot, inactive.hdr->img_crc32);
-            }
-            return ROLLBACK_SWAP_TO_OLD;  /* 容错切换 */
-        } else {
-            /* 两个都无效，只能 DFU */
-            printf("[Boot] No valid image found, entering DFU mode\r\n");
-            return ROLLBACK_DFU_MODE;
-        }
-    }
+    /* 打印调试信息 */
+    slot_print("Active  ", active_slot, &facts[BOOT_SLOT_ACTIVE]);
+    slot_print("Inactive", inactive_slot, &facts[BOOT_SLOT_INACTIVE]);
     
-    /*=========================================================================
-     * 分支 2: A (active) 有效
-     *         → 先处理 PENDING/REJECTED 状态，再考虑是否升级到 B
-     *=========================================================================*/
+    /* 决策 (完整 CRC 只对影响结论的 Slot 求值) */
+    boot_plan_t plan = Boot_Decide(&facts[BOOT_SLOT_ACTIVE], &facts[BOOT_SLOT_INACTIVE], slot_crc_check, NULL);
     
-    /* 阶段 2.1: 处理 active 的 trailer 状态 (规则2: PENDING 计数) */
-    if (has_active_tr && check_trailer_binding(&active_tr, &active)) {
-        switch (active_tr.state) {
-            case TR_STATE_PENDING:
-                /* 
-                 * 【规则2核心逻辑】
-                 * active 正在试运行，App 还没有调用 App_ConfirmSelf()
-                 * 这意味着上一次启动要么崩溃了，要么 App 没来得及确认
-                 */
-                if (active_tr.attempt >= MAX_ATTEMPTS) {
-                    /* 超过最大尝试次数，标记为 REJECTED 并回滚 */
-                    printf("[Boot] PENDING attempt=%lu >= MAX_ATTEMPTS=%u\r\n",
-                           (unsigned long)active_tr.attempt, MAX_ATTEMPTS);
-                    printf("[Boot] Marking as REJECTED, will rollback to old version\r\n");
-                    trailer_write_rejected(active_slot, active.hdr->img_crc32);
-                    
-                    /* 检查是否有可以回滚的旧版本 */
-                    if (inactive.valid) {
-                        /* inactive 也被 REJECTED 则进入 DFU */
-                        if (has_inactive_tr && check_trailer_binding(&inactive_tr, &inactive) &&
-                            inactive_tr.state == TR_STATE_REJECTED) {
-                            printf("[Boot] Both images REJECTED, entering DFU mode\r\n");
-                            return ROLLBACK_DFU_MODE;
-                        }
-                        /* 确保 inactive 有 PENDING trailer */
-                        if (!has_inactive_tr || !check_trailer_binding(&inactive_tr, &inactive)) {
-                            printf("[Boot] Writing PENDING(attempt=1) for inactive slot before swap\r\n");
-                            trailer_write_pending(inactive_slot, inactive.hdr->img_crc32);
-                        }
-                        return ROLLBACK_SWAP_TO_OLD;
-                    } else {
-                        /* 无可回滚版本，REJECTED 镜像绝不启动，进入 DFU */
-                        printf("[Boot] REJECTED + no valid inactive, entering DFU mode\r\n");
-                        return ROLLBACK_DFU_MODE;
-                    }
-                }
-                
-                /* 递增 attempt 计数并写入新记录，继续尝试启动 */
-                printf("[Boot] PENDING attempt=%lu -> %lu, continue testing\r\n", 
-                       (unsigned long)active_tr.attempt, (unsigned long)(active_tr.attempt + 1));
-                trailer_increment_attempt(active_slot, &active_tr);
-                return ROLLBACK_CONTINUE_PENDING;
-                
-            case TR_STATE_CONFIRMED:
-                /* 已确认，继续执行阶段 2.2 检查是否有更高版本 */
-                printf("[Boot] Active image is CONFIRMED\r\n");
-                break;
-                
-            case TR_STATE_REJECTED:
-                /* active 已被拒绝，需要回滚到 inactive */
-                printf("[Boot] Active image is REJECTED\r\n");
-                if (inactive.valid) {
-                    /* inactive 也被 REJECTED 则进入 DFU */
-                    if (has_inactive_tr && check_trailer_binding(&inactive_tr, &inactive) &&
-                        inactive_tr.state == TR_STATE_REJECTED) {
-                        printf("[Boot] Both images REJECTED, entering DFU mode\r\n");
-                        return ROLLBACK_DFU_MODE;
-                    }
-                    printf("[Boot] Rollback to inactive slot\r\n");
-                    /* 确保 inactive 有 PENDING trailer */
-                    if (!has_inactive_tr || !check_trailer_binding(&inactive_tr, &inactive)) {
-                        printf("[Boot] Writing PENDING(attempt=1) for inactive slot before swap\r\n");
-                        trailer_write_pending(inactive_slot, inactive.hdr->img_crc32);
-                    }
-                    return ROLLBACK_SWAP_TO_OLD;
-                }
-                /* 无可回滚版本，REJECTED 镜像绝不启动，进入 DFU */
-                printf("[Boot] REJECTED + no valid inactive, entering DFU mode\r\n");
-                return ROLLBACK_DFU_MODE;
-                
-            default:
-                /* 未知状态，当作无 trailer 处理 */
-                printf("[Boot] Unknown trailer state 0x%08lX, ignoring\r\n", (unsigned long)active_tr.state);
-                break;
+    for (int slot = 0; slot < 2; slot++) {
+        if (s_verify[slot].stage == BOOT_VERIFY_RUNNING) {
+            (void)Boot_VerifyFinish(&s_verify[slot]);
+        } else if (facts[slot].hdr_ok && !(plan.crc_checked & (1u << slot))) {
+            printf("[Boot] %s slot CRC not needed for this decision\r\n", slot ? "Inactive" : "Active");
         }
-    } else if (has_active_tr && active.valid) {
-        /* trailer CRC 与镜像 CRC 不匹配，说明 trailer 是旧镜像的 */
-        printf("[Boot] Active trailer CRC mismatch (0x%08lX != 0x%08lX), treating as new image\r\n",
-               (unsigned long)active_tr.img_crc32, (unsigned long)active.hdr->img_crc32);
-        /* 为新镜像写入 PENDING(attempt=1) */
-        printf("[Boot] Writing PENDING(attempt=1) for new active image\r\n");
-        trailer_write_pending(active_slot, active.hdr->img_crc32);
-        return ROLLBACK_CONTINUE_PENDING;
-    } else if (!has_active_tr && active.valid) {
-        /* 没有 trailer 记录，说明是全新镜像（直接烧录或首次启动） */
-        printf("[Boot] No trailer for active image, treating as new image\r\n");
-        printf("[Boot] Writing PENDING(attempt=1) for new active image\r\n");
-        trailer_write_pending(active_slot, active.hdr->img_crc32);
-        return ROLLBACK_CONTINUE_PENDING;
     }
     
-    /* 阶段 2.2: 检查是否满足"升级"条件 (upgrade policy) */
-    if (check_upgrade_eligible(&inactive, &active, &inactive_tr, has_inactive_tr)) {
-        /* 检查 inactive 是否已经是 PENDING 状态 (正在升级中，之前可能被中断) */
-        int already_pending = has_inactive_tr && 
-                              check_trailer_binding(&inactive_tr, &inactive) &&
-                              inactive_tr.state == TR_STATE_PENDING;
+    /* 执行决策需要的 trailer 写入 (active 在前，与决策中的顺序一致；写满时先擦除) */
+    if (plan.writes & BOOT_WR_ACTIVE_PENDING) {
+        trailer_write(&s_trailer[BOOT_SLOT_ACTIVE], TR_STATE_PENDING, 1, facts[BOOT_SLOT_ACTIVE].img_crc32);
+    }
+    if (plan.writes & BOOT_WR_ACTIVE_ATTEMPT) {
+        uint32_t attempt = facts[BOOT_SLOT_ACTIVE].tr_attempt + 1;
         
-        if (!already_pending) {
-            /* 写入 PENDING(attempt=1) 到 inactive slot */
-            printf("[Boot] Writing PENDING(attempt=1) to inactive slot\r\n");
-            trailer_write_pending(inactive_slot, inactive.hdr->img_crc32);
-        } else {
-            printf("[Boot] Inactive already PENDING, continuing swap\r\n");
+        /* 备份域掉电 (或未启用) 时退回 Flash 计数，之后的计数绑定新写入的记录 */
+        if (!s_attempt_bkp) {
+            trailer_write(&s_trailer[BOOT_SLOT_ACTIVE], TR_STATE_PENDING, attempt, s_tr[BOOT_SLOT_ACTIVE].img_crc32);
+            (void)trailer_last(&s_trailer[BOOT_SLOT_ACTIVE], &s_tr[BOOT_SLOT_ACTIVE]);
         }
-        
-        printf("[Boot] Swapping to inactive slot (version upgrade)\r\n");
-        return ROLLBACK_SWAP_TO_NEW;
+        Boot_AttemptStore(active_slot.trailer_base, &s_tr[BOOT_SLOT_ACTIVE], attempt);
+    }
+    if (plan.writes & BOOT_WR_ACTIVE_REJECTED) {
+        trailer_write(&s_trailer[BOOT_SLOT_ACTIVE], TR_STATE_REJECTED, 0, facts[BOOT_SLOT_ACTIVE].img_crc32);
+    }
+    if (plan.writes & BOOT_WR_INACTIVE_PENDING) {
+        trailer_write(&s_trailer[BOOT_SLOT_INACTIVE], TR_STATE_PENDING, 1, facts[BOOT_SLOT_INACTIVE].img_crc32);
     }
     
-    /* 阶段 2.3: 无需任何操作，正常启动 active */
-    printf("[Boot] Booting active slot\r\n");
-    return ROLLBACK_NONE;
+    return plan.action;
 }
 
 /**
@@ -471,9 +271,7 @@ void Boot_ExecuteRollbackAction(rollback_action_t action)
         case ROLLBACK_YMODEM_UPGRADE:
         {
             printf("[Boot] Starting Ymodem upgrade...\r\n");
-            if (IAP_EraseSlot() != 0) {
-                printf("Failed to erase slot!\r\n");
-            }
+            IAP_PrepareSlot();
             lwrb_reset(&uart_rb);
             UartDmaRx_ResetPos();
             int result = IAP_UpgradeViaYmodem(&uart_rb, 2000);
@@ -505,9 +303,7 @@ void Boot_ExecuteRollbackAction(rollback_action_t action)
                 if (flag & KEY_FLAG_KEY0) {
                     /* KEY0: Ymodem 升级 */
                     printf("[Boot] KEY0 pressed: Starting Ymodem upgrade...\r\n");
-                    if (IAP_EraseSlot() != 0) {
-                        printf("Failed to erase slot!\r\n");
-                    }
+                    IAP_PrepareSlot();
                     lwrb_reset(&uart_rb);
                     UartDmaRx_ResetPos();
                     int ym_result = IAP_UpgradeViaYmodem(&uart_rb, 2000);
@@ -0,0 +1,268 @@
+/**
+  ******************************************************************************
+  * @file           : boot_crc.c
+  * @brief          : 镜像 CRC32 计算引擎
+  * @description    : CPU 分块累加，或 MDMA 按链表节点把 Flash 内容搬到 CRC->DR，
+  *                   传输完成中断通知，期间 CPU 可以做其他启动检查
+  ******************************************************************************
+  */
+
+#include "boot_crc.h"
+#include "crc.h"
+#include <string.h>
+#include <stdio.h>
+
+/*============================================================================
+ * 外部变量
+ *============================================================================*/
+
+extern CRC_HandleTypeDef hcrc;
+
+/*============================================================================
+ * 内部常量
+ *============================================================================*/
+
+#define CRC_CPU_CHUNK       512u            /* CPU 每次累加 512 words = 2KB */
+#define CRC_DMA_BLOCK       0x10000u        /* 每个链表节点 64KB (CBNDTR.BNDT 上限) */
+#define CRC_DMA_MAX_BLOCKS  16u             /* 最多 1MB (Boot_CheckCRC 的长度上限) */
+#define CRC_DMA_TIMEOUT_MS  1000u
+
+/*============================================================================
+ * 私有变量
+ *============================================================================*/
+
+static volatile uint8_t s_busy;             /* MDMA 传输进行中 */
+static volatile uint8_t s_error;            /* MDMA 传输错误 */
+static uint32_t s_tail;                     /* 尾部不足 4 字节的数据 (已补 0xFF) */
+static uint8_t  s_has_tail;
+
+#if BOOT_CRC_MDMA
+static boot_crc_engine_t s_engine = BOOT_CRC_DMA;
+static MDMA_HandleTypeDef s_mdma;
+static uint8_t s_mdma_ready;
+
+/* 第一个块由通道寄存器描述，其余块各占一个链表节点 (MDMA 直接读取，需 8 字节对齐) */
+static MDMA_LinkNodeTypeDef s_nodes[CRC_DMA_MAX_BLOCKS - 1] __attribute__((aligned(32)));
+#else
+static boot_crc_engine_t s_engine = BOOT_CRC_CPU;
+#endif
+
+/*============================================================================
+ * 私有函数
+ *============================================================================*/
+
+/**
+ * @brief  CPU 分块累加 (每块之间可喂狗)
+ */
+static void cpu_accumulate(const uint8_t* p, uint32_t words)
+{
+    while (words) {
+        uint32_t n = (words > CRC_CPU_CHUNK) ? CRC_CPU_CHUNK : words;
+        HAL_CRC_Accumulate(&hcrc, (uint32_t *)p, n);
+        p += n * 4;
+        words -= n;
+        /* 可在此处喂狗 IWDG->KR = 0xAAAA; */
+    }
+}
+
+#if BOOT_CRC_MDMA
+
+static void mdma_done(MDMA_HandleTypeDef* hmdma)
+{
+    (void)hmdma;
+    s_busy = 0;
+}
+
+static void mdma_fail(MDMA_HandleTypeDef* hmdma)
+{
+    (void)hmdma;
+    s_error = 1;
+    s_busy  = 0;
+}
+
+/**
+ * @brief  重新初始化 MDMA 通道 (同时清空上一次的链表)
+ */
+static int mdma_init(void)
+{
+    if (!s_mdma_ready) {
+        __HAL_RCC_MDMA_CLK_ENABLE();
+        HAL_NVIC_SetPriority(MDMA_IRQn, 0, 0);
+        HAL_NVIC_EnableIRQ(MDMA_IRQn);
+        s_mdma_ready = 1;
+    }
+
+    s_mdma.Instance = MDMA_Channel0;
+    HAL_MDMA_DeInit(&s_mdma);
+
+    s_mdma.Init.Request                  = MDMA_REQUEST_SW;
+    s_mdma.Init.TransferTriggerMode      = MDMA_FULL_TRANSFER;     /* 一次软件请求走完整个链表 */
+    s_mdma.Init.Priority                 = MDMA_PRIORITY_HIGH;
+    s_mdma.Init.Endianness               = MDMA_LITTLE_ENDIANNESS_PRESERVE;
+    s_mdma.Init.SourceInc                = MDMA_SRC_INC_WORD;
+    s_mdma.Init.DestinationInc           = MDMA_DEST_INC_DISABLE;  /* 一直写 CRC->DR */
+    s_mdma.Init.SourceDataSize           = MDMA_SRC_DATASIZE_WORD;
+    s_mdma.Init.DestDataSize             = MDMA_DEST_DATASIZE_WORD;
+    s_mdma.Init.DataAlignment            = MDMA_DATAALIGN_PACKENABLE;
+    s_mdma.Init.BufferTransferLength     = 128;
+    s_mdma.Init.SourceBurst              = MDMA_SOURCE_BURST_16BEATS;
+    s_mdma.Init.DestBurst                = MDMA_DEST_BURST_SINGLE;
+    s_mdma.Init.SourceBlockAddressOffset = 0;
+    s_mdma.Init.DestBlockAddressOffset   = 0;
+    if (HAL_MDMA_Init(&s_mdma) != HAL_OK) {
+        return -1;
+    }
+
+    s_mdma.XferCpltCallback  = mdma_done;
+    s_mdma.XferErrorCallback = mdma_fail;
+    return 0;
+}
+
+/**
+ * @brief  按 64KB 一块建立链表并启动传输
+ * @param  bytes: 字节数 (4 的倍数，不超过 CRC_DMA_MAX_BLOCKS 块)
+ */
+static int mdma_start(uint32_t addr, uint32_t bytes)
+{
+    static MDMA_LinkNodeConfTypeDef cfg;    /* 使用 static 避免栈对齐问题 */
+    uint32_t dst    = (uint32_t)&hcrc.Instance->DR;
+    uint32_t blocks = (bytes + CRC_DMA_BLOCK - 1) / CRC_DMA_BLOCK;
+
+    if (blocks > CRC_DMA_MAX_BLOCKS || mdma_init() != 0) {
+        return -1;
+    }
+
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.Init       = s_mdma.Init;
+    cfg.DstAddress = dst;
+    cfg.BlockCount = 1;
+
+    for (uint32_t i = 1; i < blocks; i++) {
+        uint32_t off = i * CRC_DMA_BLOCK;
+
+        cfg.SrcAddress      = addr + off;
+        cfg.BlockDataLength = (bytes - off > CRC_DMA_BLOCK) ? CRC_DMA_BLOCK : (bytes - off);
+        if (HAL_MDMA_LinkedList_CreateNode(&s_nodes[i - 1], &cfg) != HAL_OK ||
+            HAL_MDMA_LinkedList_AddNode(&s_mdma, &s_nodes[i - 1], NULL) != HAL_OK) {
+            return -1;
+        }
+    }
+    SCB_CleanDCache_by_Addr((uint32_t *)s_nodes, sizeof(s_nodes));
+
+    s_error = 0;
+    s_busy  = 1;
+    if (HAL_MDMA_Start_IT(&s_mdma, addr, dst, (bytes > CRC_DMA_BLOCK) ? CRC_DMA_BLOCK : bytes, 1) != HAL_OK) {
+        s_busy = 0;
+        return -1;
+    }
+    return 0;
+}
+
+#endif /* BOOT_CRC_MDMA */
+
+/*============================================================================
+ * 公共函数实现
+ *============================================================================*/
+
+/**
+ * @brief  选择 CRC 计算引擎
+ */
+void Boot_CRCSetEngine(boot_crc_engine_t engine)
+{
+#if BOOT_CRC_MDMA
+    s_engine = engine;
+#else
+    (void)engine;
+#endif
+}
+
+/**
+ * @brief  开始计算 CRC32
+ */
+void Boot_CRCStart(uint32_t addr, uint32_t size)
+{
+    uint32_t words = size / 4;
+    uint32_t tail  = size % 4;
+
+    if (s_busy) {
+        uint32_t discard;
+        (void)Boot_CRCWait(&discard);       /* 上一次结果未取走：等它结束再复位 CRC */
+    }
+
+    __HAL_CRC_DR_RESET(&hcrc);  /* 复位 CRC 到初始值 */
+    s_error = 0;
+
+    /* 尾部不足 4 字节：先取出来补 0xFF，完成后由 CPU 补入 */
+    s_has_tail = (tail != 0);
+    if (s_has_tail) {
+        s_tail = 0xFFFFFFFFu;
+        memcpy(&s_tail, (const uint8_t *)(addr + words * 4), tail);
+    }
+
+#if BOOT_CRC_MDMA
+    if (s_engine == BOOT_CRC_DMA && words && size >= BOOT_CRC_MDMA_MIN) {
+        /* RAM 数据可能还在 D-Cache 中，MDMA 直接读内存 */
+        if (addr >= 0x20000000u) {
+            SCB_CleanDCache_by_Addr((uint32_t *)addr, (int32_t)(words * 4));
+        }
+        if (mdma_start(addr, words * 4) == 0) {
+            return;
+        }
+        printf("[CRC] MDMA start failed, using CPU\r\n");
+    }
+#endif
+
+    cpu_accumulate((const uint8_t *)addr, words);
+}
+
+/**
+ * @brief  查询计算是否仍在进行
+ */
+int Boot_CRCBusy(void)
+{
+    return s_busy;
+}
+
+/**
+ * @brief  等待计算完成并取结果
+ */
+int Boot_CRCWait(uint32_t* crc)
+{
+#if BOOT_CRC_MDMA
+    uint32_t t0 = HAL_GetTick();
+
+    while (s_busy) {
+        __WFI();                            /* 睡眠到 MDMA 完成中断 (或 SysTick) */
+        /* 可在此处喂狗 IWDG->KR = 0xAAAA; */
+        if (HAL_GetTick() - t0 > CRC_DMA_TIMEOUT_MS) {
+            HAL_MDMA_Abort(&s_mdma);
+            s_error = 1;
+            s_busy  = 0;
+        }
+    }
+
+    if (s_error) {
+        printf("[CRC] MDMA transfer error 0x%08lX\r\n", (unsigned long)HAL_MDMA_GetError(&s_mdma));
+        s_has_tail = 0;
+        return -1;
+    }
+#endif
+
+    if (s_has_tail) {
+        HAL_CRC_Accumulate(&hcrc, &s_tail, 1);
+        s_has_tail = 0;
+    }
+
+    *crc = hcrc.Instance->DR;
+    return 0;
+}
+
+/**
+ * @brief  MDMA 中断处理
+ */
+void Boot_CRCIRQHandler(void)
+{
+#if BOOT_CRC_MDMA
+    HAL_MDMA_IRQHandler(&s_mdma);
+#endif
+}
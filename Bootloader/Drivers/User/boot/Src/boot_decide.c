@@ -0,0 +1,232 @@
+/**
+  ******************************************************************************
+  * @file           : boot_decide.c
+  * @brief          : 回滚决策
+  * @description    : 先用镜像头、向量表、trailer 状态和版本号决策，
+  *                   完整 CRC 只对影响结论的 Slot 求值
+  ******************************************************************************
+  */
+
+#include "boot_decide.h"
+#include "boot_image.h"
+#include "trailer.h"
+#include <stdio.h>
+
+/*============================================================================
+ * 私有变量
+ *============================================================================*/
+
+/* 本次决策的输入与已求值的 CRC 结果 */
+static struct {
+    const boot_slot_facts_t* f[2];
+    boot_crc_check_t check;
+    void*            arg;
+    int8_t           valid[2];          /* -1=尚未求值 */
+    boot_plan_t      plan;
+} s_d;
+
+/*============================================================================
+ * 私有函数
+ *============================================================================*/
+
+/**
+ * @brief  Slot 是否有效 (magic + 向量表 + CRC)，CRC 按需求值且只求一次
+ */
+static int slot_valid(int slot)
+{
+    if (!s_d.f[slot]->hdr_ok) {
+        return 0;
+    }
+    if (s_d.valid[slot] < 0) {
+        s_d.valid[slot] = (int8_t)(s_d.check(slot, s_d.arg) ? 1 : 0);
+        s_d.plan.crc_checked |= (uint8_t)(1u << slot);
+    }
+    return s_d.valid[slot];
+}
+
+/**
+ * @brief  trailer 是否属于当前镜像头 (不含镜像有效性，调用方另行判断)
+ */
+static int slot_bound(int slot)
+{
+    const boot_slot_facts_t* f = s_d.f[slot];
+    return f->hdr_ok && f->has_tr && (f->tr_crc32 == f->img_crc32);
+}
+
+static boot_plan_t finish(rollback_action_t action)
+{
+    s_d.plan.action = action;
+    return s_d.plan;
+}
+
+/**
+ * @brief  回滚/容错到 inactive (inactive 无效或已被 REJECTED 时进入 DFU)
+ */
+static boot_plan_t fall_back(const char* what)
+{
+    if (!slot_valid(BOOT_SLOT_INACTIVE)) {
+        printf("[Boot] %s: no valid inactive image, entering DFU mode\r\n", what);
+        return finish(ROLLBACK_DFU_MODE);
+    }
+
+    /* inactive 也被 REJECTED 则进入 DFU */
+    if (slot_bound(BOOT_SLOT_INACTIVE) && s_d.f[BOOT_SLOT_INACTIVE]->tr_state == TR_STATE_REJECTED) {
+        printf("[Boot] %s blocked: inactive image is REJECTED, entering DFU mode\r\n", what);
+        return finish(ROLLBACK_DFU_MODE);
+    }
+
+    printf("[Boot] %s: switching to valid inactive slot\r\n", what);
+    /* 确保 inactive 有 PENDING trailer，swap 后 App 才能确认自己 */
+    if (!slot_bound(BOOT_SLOT_INACTIVE)) {
+        printf("[Boot] Writing PENDING(attempt=1) for inactive slot before swap\r\n");
+        s_d.plan.writes |= BOOT_WR_INACTIVE_PENDING;
+    }
+    return finish(ROLLBACK_SWAP_TO_OLD);
+}
+
+/**
+ * @brief  【规则1】检查 inactive 是否满足"升级"条件 (前提：active 有效)
+ * @note   先比较版本号与 trailer 状态，结论为"可以升级"时才求值 inactive 的 CRC
+ */
+static int upgrade_eligible(void)
+{
+    const boot_slot_facts_t* a = s_d.f[BOOT_SLOT_ACTIVE];
+    const boot_slot_facts_t* b = s_d.f[BOOT_SLOT_INACTIVE];
+
+    if (!b->hdr_ok) {
+        return 0;
+    }
+
+    /* inactive 版本不高于 active，不需要升级 */
+    if (Boot_SemverCompare(b->ver, a->ver) <= 0) {
+        return 0;
+    }
+
+    if (slot_bound(BOOT_SLOT_INACTIVE)) {
+        if (b->tr_state == TR_STATE_REJECTED) {
+            printf("[Boot] Upgrade blocked: inactive image is REJECTED\r\n");
+            return 0;
+        }
+        /* 曾经在主槽被确认过又被换下去，不允许再升级回来，避免版本循环 */
+        if (b->tr_state == TR_STATE_CONFIRMED) {
+            printf("[Boot] Upgrade blocked: inactive image already CONFIRMED (version rollback?)\r\n");
+            return 0;
+        }
+    }
+    /* else: trailer CRC 不匹配，说明是旧镜像的 trailer，忽略 */
+
+    return slot_valid(BOOT_SLOT_INACTIVE);
+}
+
+/*============================================================================
+ * 公共函数实现
+ *============================================================================*/
+
+/**
+ * @brief  回滚决策
+ */
+boot_plan_t Boot_Decide(const boot_slot_facts_t* active, const boot_slot_facts_t* inactive,
+                        boot_crc_check_t check, void* arg)
+{
+    const boot_slot_facts_t* a = active;
+
+    s_d.f[BOOT_SLOT_ACTIVE]   = active;
+    s_d.f[BOOT_SLOT_INACTIVE] = inactive;
+    s_d.check    = check;
+    s_d.arg      = arg;
+    s_d.valid[0] = -1;
+    s_d.valid[1] = -1;
+    s_d.plan.action      = ROLLBACK_NONE;
+    s_d.plan.writes      = 0;
+    s_d.plan.crc_checked = 0;
+
+    /*=========================================================================
+     * active 绑定的 trailer 是 REJECTED：active 有效时回滚、无效时容错，
+     * 两者结论相同，不需要 active 的 CRC
+     *=========================================================================*/
+    if (slot_bound(BOOT_SLOT_ACTIVE) && a->tr_state == TR_STATE_REJECTED) {
+        printf("[Boot] Active image is REJECTED\r\n");
+        return fall_back("Rollback");
+    }
+
+    /*=========================================================================
+     * 分支 1: A (active) 无效
+     *         → 必须进行容错启动 (failover)，不受任何升级策略限制
+     *=========================================================================*/
+    if (!slot_valid(BOOT_SLOT_ACTIVE)) {
+        printf("[Boot] Active image is invalid\r\n");
+        return fall_back("FAILOVER");
+    }
+
+    /*=========================================================================
+     * 分支 2: A (active) 有效
+     *         → 先处理 PENDING 状态，再考虑是否升级到 B
+     *=========================================================================*/
+
+    /* 阶段 2.1: 处理 active 的 trailer 状态 (规则2: PENDING 计数) */
+    if (slot_bound(BOOT_SLOT_ACTIVE)) {
+        switch (a->tr_state) {
+            case TR_STATE_PENDING:
+                /*
+                 * 【规则2核心逻辑】
+                 * active 正在试运行，App 还没有调用 App_ConfirmSelf()
+                 * 这意味着上一次启动要么崩溃了，要么 App 没来得及确认
+                 */
+                if (a->tr_attempt >= MAX_ATTEMPTS) {
+                    /* 超过最大尝试次数，标记为 REJECTED 并回滚 */
+                    printf("[Boot] PENDING attempt=%lu >= MAX_ATTEMPTS=%u\r\n",
+                           (unsigned long)a->tr_attempt, MAX_ATTEMPTS);
+                    printf("[Boot] Marking as REJECTED, will rollback to old version\r\n");
+                    s_d.plan.writes |= BOOT_WR_ACTIVE_REJECTED;
+                    return fall_back("Rollback");
+                }
+
+                /* 递增 attempt 计数并写入新记录，继续尝试启动 */
+                printf("[Boot] PENDING attempt=%lu -> %lu, continue testing\r\n",
+                       (unsigned long)a->tr_attempt, (unsigned long)(a->tr_attempt + 1));
+                s_d.plan.writes |= BOOT_WR_ACTIVE_ATTEMPT;
+                return finish(ROLLBACK_CONTINUE_PENDING);
+
+            case TR_STATE_CONFIRMED:
+                /* 已确认，继续执行阶段 2.2 检查是否有更高版本 */
+                printf("[Boot] Active image is CONFIRMED\r\n");
+                break;
+
+            default:
+                /* 未知状态，当作无 trailer 处理 */
+                printf("[Boot] Unknown trailer state 0x%08lX, ignoring\r\n", (unsigned long)a->tr_state);
+                break;
+        }
+    } else if (a->has_tr) {
+        /* trailer CRC 与镜像 CRC 不匹配，说明 trailer 是旧镜像的 */
+        printf("[Boot] Active trailer CRC mismatch (0x%08lX != 0x%08lX), treating as new image\r\n",
+               (unsigned long)a->tr_crc32, (unsigned long)a->img_crc32);
+        printf("[Boot] Writing PENDING(attempt=1) for new active image\r\n");
+        s_d.plan.writes |= BOOT_WR_ACTIVE_PENDING;
+        return finish(ROLLBACK_CONTINUE_PENDING);
+    } else {
+        /* 没有 trailer 记录，说明是全新镜像（直接烧录或首次启动） */
+        printf("[Boot] No trailer for active image, treating as new image\r\n");
+        printf("[Boot] Writing PENDING(attempt=1) for new active image\r\n");
+        s_d.plan.writes |= BOOT_WR_ACTIVE_PENDING;
+        return finish(ROLLBACK_CONTINUE_PENDING);
+    }
+
+    /* 阶段 2.2: 检查是否满足"升级"条件 (upgrade policy) */
+    if (upgrade_eligible()) {
+        /* inactive 已经是 PENDING：正在升级中 (之前可能被中断)，不要重复写 */
+        if (slot_bound(BOOT_SLOT_INACTIVE) && inactive->tr_state == TR_STATE_PENDING) {
+            printf("[Boot] Inactive already PENDING, continuing swap\r\n");
+        } else {
+            printf("[Boot] Writing PENDING(attempt=1) to inactive slot\r\n");
+            s_d.plan.writes |= BOOT_WR_INACTIVE_PENDING;
+        }
+
+        printf("[Boot] Swapping to inactive slot (version upgrade)\r\n");
+        return finish(ROLLBACK_SWAP_TO_NEW);
+    }
+
+    /* 阶段 2.3: 无需任何操作，正常启动 active */
+    printf("[Boot] Booting active slot\r\n");
+    return finish(ROLLBACK_NONE);
+}
@@ -7,7 +7,7 @@
   */
 
 #include "boot_slots.h"
-#include "boot_swap.h"
+#include "flash_port.h"
 #include "trailer.h"
 
 /*============================================================================
@@ -67,7 +67,7 @@ slot_info_t Boot_GetInactiveSlot(void)
  */
 uint32_t Boot_GetPhysicalBankBase(int is_active)
 {
-    uint8_t swap = Boot_GetSwapState();
+    int swap = FlashPort_GetSwap();
     
     if (is_active) {
         /* 活动 Slot 的物理 Bank */
@@ -77,3 +77,27 @@ uint32_t Boot_GetPhysicalBankBase(int is_active)
         return swap ? FLASH_BANK1_BASE : FLASH_BANK2_BASE;
     }
 }
+
+/**
+ * @brief  逻辑地址对应的物理地址
+ */
+uint32_t Boot_PhysAddr(uint32_t addr)
+{
+    return FlashPort_GetSwap() ? (addr ^ (FLASH_BANK1_BASE ^ FLASH_BANK2_BASE)) : addr;
+}
+
+/**
+ * @brief  检查扇区是否为空
+ * @note   按 64 位读取，每个 32B flash word 合并比较一次，遇到非空字立即返回
+ */
+int Boot_SectorIsBlank(uint32_t addr)
+{
+    const volatile uint64_t* p = (const volatile uint64_t*)addr;
+
+    FlashPort_InvalidateCache(addr, SLOT_SECTOR_SIZE);
+
+    for (uint32_t i = 0; i < SLOT_SECTOR_SIZE / 8u; i += 4u) {
+        if ((p[i] & p[i + 1] & p[i + 2] & p[i + 3]) != UINT64_MAX) return 0;
+    }
+    return 1;
+}
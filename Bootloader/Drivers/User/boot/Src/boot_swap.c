@@ -8,6 +8,7 @@
 
 #include "boot_swap.h"
 #include "boot_core.h"
+#include "flash_port.h"
 #include "stm32h7xx_hal.h"
 
 /*============================================================================
@@ -25,9 +26,7 @@ extern uint32_t g_JumpInit;
  */
 uint8_t Boot_GetSwapState(void)
 {
-    FLASH_OBProgramInitTypeDef ob = {0};
-    HAL_FLASHEx_OBGetConfig(&ob);
-    return (ob.USERConfig & OB_SWAP_BANK_ENABLE) ? 1 : 0;
+    return (uint8_t)FlashPort_GetSwap();
 }
 
 /**
@@ -35,28 +34,10 @@ uint8_t Boot_GetSwapState(void)
  */
 void Boot_SetSwapBank(uint32_t enable)
 {
-    FLASH_OBProgramInitTypeDef ob = {0};
-
     __disable_irq();
 
-    HAL_FLASH_Unlock();
-    HAL_FLASH_OB_Unlock();
-
-    /* 读取当前 Option Bytes 配置 */
-    HAL_FLASHEx_OBGetConfig(&ob);
-
-    /* 配置 Swap Bank 选项 */
-    ob.OptionType = OPTIONBYTE_USER;
-    ob.USERType   = OB_USER_SWAP_BANK;
-    ob.USERConfig = enable ? OB_SWAP_BANK_ENABLE : OB_SWAP_BANK_DISABLE;
-
-    if (HAL_FLASHEx_OBProgram(&ob) != HAL_OK) {
-        /* 编程失败，死循环 */
-        while (1) {}
-    }
-
-    /* 触发 Option Bytes 重载，此处会产生复位 */
-    if (HAL_FLASH_OB_Launch() != HAL_OK) {
+    /* 写入 Option Bytes 并重载，此处通常已产生复位；失败时死循环 */
+    if (FlashPort_SetSwap(enable ? 1 : 0) != 0) {
         while (1) {}
     }
 
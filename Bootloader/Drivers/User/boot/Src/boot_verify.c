@@ -0,0 +1,160 @@
+/**
+  ******************************************************************************
+  * @file           : boot_verify.c
+  * @brief          : 启动校验缓存
+  * @description    : 完整 CRC 校验通过后在 trailer 中记录结果，之后的启动只检查
+  *                   镜像头与向量表；定期复查计数保存在 RTC 备份寄存器
+  ******************************************************************************
+  */
+
+#include "boot_verify.h"
+#include "flash_port.h"
+#include "stm32h7xx_hal.h"
+#include <string.h>
+#include <stdio.h>
+
+/*============================================================================
+ * 内部常量
+ *============================================================================*/
+
+/* BKP1R = BKP0R ^ SCRUB_KEY 时计数有效 (备份域掉电后两者均为 0) */
+#define SCRUB_KEY         0xB007C0DEu
+
+/*============================================================================
+ * 私有函数
+ *============================================================================*/
+
+/**
+ * @brief  镜像头内容的 CRC32 (与镜像体 CRC 使用同一个 CRC 外设)
+ */
+static uint32_t hdr_hash(uint32_t slot_base)
+{
+    SCB_InvalidateDCache_by_Addr((uint32_t *)slot_base, HDR_SIZE);
+    return Boot_CalcImageCRC(slot_base, 0, HDR_SIZE);
+}
+
+/*============================================================================
+ * 公共函数实现
+ *============================================================================*/
+
+/**
+ * @brief  本次启动是否需要定期复查
+ */
+int Boot_VerifyScrubDue(void)
+{
+#if BOOT_VERIFY_SCRUB_EVERY
+    uint32_t count;
+
+    __HAL_RCC_RTC_CLK_ENABLE();
+    HAL_PWR_EnableBkUpAccess();
+
+    count = RTC->BKP0R;
+    if (RTC->BKP1R != (count ^ SCRUB_KEY)) {
+        count = 0;                      /* 备份域掉电：重新计数 */
+    }
+
+    count++;
+    int due = (count >= BOOT_VERIFY_SCRUB_EVERY);
+    if (due) count = 0;
+
+    RTC->BKP0R = count;
+    RTC->BKP1R = count ^ SCRUB_KEY;
+    return due;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief  第一步：检查镜像头与向量表，读取校验记录 (不使用 CRC 外设)
+ */
+void Boot_VerifyPrepare(boot_verify_ctx_t* v, slot_info_t slot)
+{
+    memset(v, 0, sizeof(*v));
+    v->slot          = slot;
+    v->img.slot_base = slot.base;
+    v->img.app_entry = Boot_GetAppEntry(slot, HDR_SIZE);
+    v->img.hdr       = Boot_GetImageHeader(slot.base);
+
+    uint32_t t0 = FlashPort_StatsNow();
+
+    /* 镜像头与向量表每次都检查 (读取量很小) */
+    if (!Boot_CheckMagic(v->img.hdr) || !Boot_CheckVector(v->img.app_entry)) {
+        v->stage = BOOT_VERIFY_DONE;
+        return;
+    }
+
+    v->has_rec = (trailer_read_verify(slot.trailer_base, &v->rec) == 0);
+    v->stage   = BOOT_VERIFY_PREPARED;
+    v->cycles  = FlashPort_StatsNow() - t0;
+}
+
+/**
+ * @brief  第二步：与校验记录比较，需要时开始完整 CRC
+ */
+void Boot_VerifyStart(boot_verify_ctx_t* v, uint32_t tr_state, int scrub)
+{
+    if (v->stage != BOOT_VERIFY_PREPARED) {
+        return;
+    }
+
+    v->t0    = FlashPort_StatsNow();
+    v->state = tr_state;
+    v->hash  = hdr_hash(v->slot.base);
+
+    if (scrub) {
+        v->why = "scrub";
+    } else if (!v->has_rec) {
+        v->why = "no record";
+    } else if (v->rec.hdr_addr != Boot_PhysAddr(v->slot.base) || v->rec.hdr_hash != v->hash ||
+               v->rec.img_crc32 != v->img.hdr->img_crc32) {
+        v->why = "header changed";
+    } else if (v->rec.state != tr_state) {
+        v->why = "state changed";
+    } else {
+        uint32_t dt = v->cycles + (FlashPort_StatsNow() - v->t0);
+        printf("[Verify] 0x%08lX: cached, %lu cycles (full CRC %lu cycles, saved %lu%%)\r\n",
+               (unsigned long)v->slot.base, (unsigned long)dt, (unsigned long)v->rec.cycles,
+               (unsigned long)(v->rec.cycles > dt ? (uint64_t)(v->rec.cycles - dt) * 100u / v->rec.cycles : 0));
+        v->img.valid = 1;
+        v->stage = BOOT_VERIFY_DONE;
+        return;
+    }
+
+    v->stage = (Boot_CheckCRCStart(v->slot.base, v->img.hdr) == 0) ? BOOT_VERIFY_RUNNING : BOOT_VERIFY_DONE;
+}
+
+/**
+ * @brief  第三步：等待完整 CRC 并记录结果
+ */
+image_t Boot_VerifyFinish(boot_verify_ctx_t* v)
+{
+    static tr_verify_t rec;             /* 使用 static 避免栈对齐问题 */
+
+    if (v->stage != BOOT_VERIFY_RUNNING) {
+        return v->img;
+    }
+    v->stage = BOOT_VERIFY_DONE;
+
+    if (!Boot_CheckCRCFinish(v->slot.base, v->img.hdr)) {
+        return v->img;
+    }
+    v->img.valid = 1;
+
+    uint32_t dt = v->cycles + (FlashPort_StatsNow() - v->t0);
+    printf("[Verify] 0x%08lX: full CRC (%s), %lu cycles\r\n",
+           (unsigned long)v->slot.base, v->why, (unsigned long)dt);
+
+    /* 记录校验结果；trailer 已满时不为此擦除，等下一次状态写入清空扇区 */
+    memset(&rec, 0xFF, sizeof(rec));
+    rec.magic     = TR_VERIFY_MAGIC;
+    rec.hdr_addr  = Boot_PhysAddr(v->slot.base);
+    rec.hdr_hash  = v->hash;
+    rec.img_crc32 = v->img.hdr->img_crc32;
+    rec.state     = v->state;
+    rec.cycles    = dt;
+    if (trailer_append_verify(v->slot.trailer_base, &rec) != 0) {
+        printf("[Verify] 0x%08lX: record not written\r\n", (unsigned long)v->slot.base);
+    }
+    return v->img;
+}
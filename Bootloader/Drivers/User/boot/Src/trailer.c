@@ -2,13 +2,14 @@
   ******************************************************************************
   * @file           : trailer.c
   * @brief          : Trailer 扇区管理模块
-  * @description    : 提供 trailer 记录的读/写/擦除功能，用于回滚状态机
+  * @description    : 提供 trailer 记录的读/写/擦除功能，用于回滚状态机。
+  *                   记录只追加，已写入区域的末尾用二分查找定位
   ******************************************************************************
   */
 
 #include "trailer.h"
 #include "boot_slots.h"
-#include "stm32h7xx_hal.h"
+#include "flash_port.h"
 #include <string.h>
 
 /*============================================================================
@@ -36,96 +37,104 @@ static int rec_is_empty(const tr_rec_t* r)
 }
 
 /**
- * @brief  获取 trailer 扇区对应的 Flash Bank 编号
+ * @brief  第 idx 条记录的地址
  */
-static uint32_t get_flash_bank(uint32_t addr)
+static const tr_rec_t* rec_at(uint32_t base, uint32_t idx)
 {
-    /* Bank1: 0x08000000 - 0x080FFFFF, Bank2: 0x08100000 - 0x081FFFFF */
-    return (addr >= FLASH_BANK2_BASE) ? FLASH_BANK_2 : FLASH_BANK_1;
+    return (const tr_rec_t*)(base + idx * sizeof(tr_rec_t));
 }
 
 /**
- * @brief  获取 trailer 扇区对应的 Flash Sector 编号
- * @note   STM32H7 每个 Bank 有 8 个 128KB 扇区 (Sector 0-7)
- *         trailer 位于 Slot 末尾 128KB，即每个 Bank 的最后一个扇区 (Sector 7)
+ * @brief  在第一个空位追加一条 32B 记录
+ * @retval 0=成功, -1=扇区已满, -2=写入失败
  */
-static uint32_t get_flash_sector(uint32_t addr)
+static int append_rec(uint32_t base, const void* rec)
 {
-    uint32_t bank_base = (addr >= FLASH_BANK2_BASE) ? FLASH_BANK2_BASE : FLASH_BANK1_BASE;
-    uint32_t offset = addr - bank_base;
-    return offset / 0x20000u;  /* 128KB per sector */
+    uint32_t end = trailer_find_end(base);
+
+    /* 扇区已满，需要先擦除 */
+    if (end >= TR_REC_COUNT) {
+        return -1;
+    }
+
+    /* 按 32B (256-bit flash word) 写入，记录为 packed 结构，由 FlashPort 经对齐缓冲区编程 */
+    return (FlashPort_Program((uint32_t)rec_at(base, end), rec, sizeof(tr_rec_t), 0) == 0) ? 0 : -2;
 }
 
 /*============================================================================
  * 公共函数实现
  *============================================================================*/
 
+/**
+ * @brief  二分查找已写入区域的末尾 (第一个空位)
+ * @retval 第一个空位的序号，TR_REC_COUNT 表示扇区已满
+ * @note   记录只追加不改写，空位之后全部为空，因此 "是否为空" 在扇区内单调，
+ *         最多读 log2(TR_REC_COUNT)+1 = 13 条记录。写入中断 (掉电) 的记录
+ *         不是全 0xFF，算作已写入，由调用方向前跳过
+ */
+uint32_t trailer_find_end(uint32_t base)
+{
+    uint32_t lo = 0, hi = TR_REC_COUNT;     /* lo 之前已写入，hi 及之后为空 */
+
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (rec_is_empty(rec_at(base, mid))) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
 /**
  * @brief  读取 trailer 扇区的最后一条有效记录
  */
 int trailer_read_last(uint32_t base, tr_rec_t* out) 
 {
-    const tr_rec_t* last = NULL;
-
-    /* 扫描整个 trailer 扇区，找到最后一条有效记录 */
-    for (uint32_t off = 0; off < TRAILER_SIZE; off += sizeof(tr_rec_t)) {
-        const tr_rec_t* r = (const tr_rec_t*)(base + off);
-        
-        /* 遇到空记录停止 (append-only 特性) */
-        if (rec_is_empty(r)) break;
-        
-        /* 有效记录则更新 last */
+    /* 从末尾向前跳过其他记录 (校验记录、IAP 会话标记/断点) 和写入中断的记录 */
+    for (uint32_t i = trailer_find_end(base); i > 0; i--) {
+        const tr_rec_t* r = rec_at(base, i - 1);
         if (rec_is_valid(r)) {
-            last = r;
+            *out = *r;
+            return 0;
         }
     }
-
-    if (!last) return -1;
-    
-    *out = *last;
-    return 0;
+    return -1;
 }
 
-/* 静态 32B 对齐缓冲区，用于 Flash 写入 */
-static uint8_t s_flash_write_buf[32] __attribute__((aligned(32)));
-
 /**
  * @brief  追加写入一条 trailer 记录
  */
 int trailer_append(uint32_t base, const tr_rec_t* rec) 
 {
-    uint32_t write_addr = 0;
-    int found_empty = 0;
+    return append_rec(base, rec);
+}
 
-    /* 1) 找到第一个空位 */
-    for (uint32_t off = 0; off < TRAILER_SIZE; off += sizeof(tr_rec_t)) {
-        const tr_rec_t* r = (const tr_rec_t*)(base + off);
-        if (rec_is_empty(r)) { 
-            write_addr = base + off; 
-            found_empty = 1;
-            break; 
-        }
-    }
+/**
+ * @brief  读取仍然有效的启动校验记录
+ */
+int trailer_read_verify(uint32_t base, tr_verify_t* out)
+{
+    /* 状态记录不影响校验记录；最后一条非状态记录不是校验记录 (如 IAP 会话标记)
+     * 说明 Slot 内容可能已改变 */
+    for (uint32_t i = trailer_find_end(base); i > 0; i--) {
+        const tr_rec_t* r = rec_at(base, i - 1);
+        if (rec_is_valid(r)) continue;
+        if (r->magic != TR_VERIFY_MAGIC) break;
 
-    /* 扇区已满，需要先擦除 */
-    if (!found_empty) {
-        return -1;
+        *out = *(const tr_verify_t*)r;
+        return 0;
     }
+    return -1;
+}
 
-    /* 2) 准备 32B 对齐的数据 (使用静态缓冲区) */
-    memcpy(s_flash_write_buf, rec, sizeof(tr_rec_t));
-
-    /* 3) 按 32B (256-bit flash word) 写入 */
-    HAL_StatusTypeDef status;
-    
-    HAL_FLASH_Unlock();
-    
-    /* STM32H7 使用 FLASH_TYPEPROGRAM_FLASHWORD 一次写 256 bits = 32 bytes */
-    status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_FLASHWORD, write_addr, (uint32_t)s_flash_write_buf);
-    
-    HAL_FLASH_Lock();
-
-    return (status == HAL_OK) ? 0 : -2;
+/**
+ * @brief  追加写入一条启动校验记录
+ */
+int trailer_append_verify(uint32_t base, const tr_verify_t* rec)
+{
+    return append_rec(base, rec);
 }
 
 /**
@@ -133,23 +142,8 @@ int trailer_append(uint32_t base, const tr_rec_t* rec)
  */
 int trailer_erase(uint32_t base)
 {
-    FLASH_EraseInitTypeDef erase_cfg = {0};
-    uint32_t page_error = 0;
-    HAL_StatusTypeDef status;
-
-    erase_cfg.TypeErase = FLASH_TYPEERASE_SECTORS;
-    erase_cfg.Banks     = get_flash_bank(base);
-    erase_cfg.Sector    = get_flash_sector(base);
-    erase_cfg.NbSectors = 1;
-    erase_cfg.VoltageRange = FLASH_VOLTAGE_RANGE_3;  /* 2.7V - 3.6V */
-
-    HAL_FLASH_Unlock();
-    
-    status = HAL_FLASHEx_Erase(&erase_cfg, &page_error);
-    
-    HAL_FLASH_Lock();
-
-    return (status == HAL_OK) ? 0 : -1;
+    /* trailer 位于 Slot 末尾 128KB，即每个 Bank 的最后一个扇区 (Sector 7) */
+    return FlashPort_EraseSector(base);
 }
 
 /**
@@ -158,9 +152,7 @@ int trailer_erase(uint32_t base)
 int trailer_is_full(uint32_t base)
 {
     /* 检查最后一个 slot 是否为空 */
-    uint32_t last_slot = base + TRAILER_SIZE - sizeof(tr_rec_t);
-    const tr_rec_t* r = (const tr_rec_t*)last_slot;
-    return !rec_is_empty(r);
+    return !rec_is_empty(rec_at(base, TR_REC_COUNT - 1));
 }
 
 /**
@@ -174,3 +166,135 @@ uint32_t trailer_next_seq(uint32_t base)
     }
     return 1;  /* 无记录时从 1 开始 */
 }
+
+/*============================================================================
+ * trailer 句柄
+ *============================================================================*/
+
+/**
+ * @brief  扫描扇区，重建缓存
+ */
+static void handle_scan(trailer_t* t)
+{
+    t->swap     = (uint32_t)FlashPort_GetSwap();
+    t->end      = trailer_find_end(t->base);
+    t->has_last = 0;
+    t->next_seq = 1;                        /* 无记录时从 1 开始 */
+
+    for (uint32_t i = t->end; i > 0; i--) {
+        const tr_rec_t* r = rec_at(t->base, i - 1);
+        if (rec_is_valid(r)) {
+            t->last     = *r;
+            t->has_last = 1;
+            t->next_seq = r->seq + 1;
+            break;
+        }
+    }
+    t->valid = 1;
+}
+
+/**
+ * @brief  缓存失效或 Bank Swap 之后重新扫描
+ */
+static void handle_sync(trailer_t* t)
+{
+    if (!t->valid || t->swap != (uint32_t)FlashPort_GetSwap()) {
+        handle_scan(t);
+    }
+}
+
+/**
+ * @brief  绑定 trailer 扇区并扫描一次
+ */
+void trailer_open(trailer_t* t, uint32_t base)
+{
+    t->base = base;
+    handle_scan(t);
+}
+
+/**
+ * @brief  使缓存失效
+ */
+void trailer_invalidate(trailer_t* t)
+{
+    t->valid = 0;
+}
+
+/**
+ * @brief  读取缓存的最后一条状态记录
+ */
+int trailer_last(trailer_t* t, tr_rec_t* out)
+{
+    handle_sync(t);
+    if (!t->has_last) return -1;
+
+    *out = t->last;
+    return 0;
+}
+
+/**
+ * @brief  检查 trailer 扇区是否写满
+ */
+int trailer_full(trailer_t* t)
+{
+    handle_sync(t);
+    return (t->end >= TR_REC_COUNT);
+}
+
+/**
+ * @brief  通过句柄擦除 trailer 扇区
+ */
+int trailer_clear(trailer_t* t)
+{
+    if (trailer_erase(t->base) != 0) {
+        t->valid = 0;                       /* 擦除状态不确定，下次重新扫描 */
+        return -1;
+    }
+
+    t->swap     = (uint32_t)FlashPort_GetSwap();
+    t->end      = 0;
+    t->has_last = 0;
+    t->next_seq = 1;
+    t->valid    = 1;
+    return 0;
+}
+
+/**
+ * @brief  追加一条状态记录
+ */
+int trailer_write(trailer_t* t, uint32_t state, uint32_t attempt, uint32_t img_crc32)
+{
+    static tr_rec_t rec;  /* 使用 static 避免栈对齐问题 */
+
+    handle_sync(t);
+
+    /* 缓存的空位必须仍是边界：其他代码追加过记录或擦除过扇区时重新扫描 */
+    if ((t->end < TR_REC_COUNT && !rec_is_empty(rec_at(t->base, t->end))) ||
+        (t->end > 0 && rec_is_empty(rec_at(t->base, t->end - 1)))) {
+        handle_scan(t);
+    }
+
+    /* 如果扇区满了，先擦除 */
+    if (t->end >= TR_REC_COUNT && trailer_clear(t) != 0) {
+        return -1;
+    }
+
+    memset(&rec, 0, sizeof(rec));
+    rec.magic     = TR_MAGIC;
+    rec.seq       = t->next_seq;
+    rec.state     = state;
+    rec.attempt   = attempt;
+    rec.img_crc32 = img_crc32;
+    rec.rsv[0]    = (uint32_t)rec_at(t->base, t->end);
+
+    if (FlashPort_Program(rec.rsv[0], &rec, sizeof(rec), 0) != 0) {
+        t->valid = 0;                       /* 该位置可能已部分写入 */
+        return -2;
+    }
+
+    t->last     = rec;
+    t->has_last = 1;
+    t->next_seq = rec.seq + 1;
+    t->end++;
+    return 0;
+}
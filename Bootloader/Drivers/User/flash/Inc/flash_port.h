@@ -0,0 +1,204 @@
+/**
+  ******************************************************************************
+  * @file           : flash_port.h
+  * @brief          : Flash 平台抽象层接口
+  * @description    : 解锁/编程/擦除/ECC/Bank Swap 的统一入口。
+  *                   flash_port.c 为 STM32H7 HAL 实现；主机构建 (Tools/ymodem_bench)
+  *                   用内存模拟两个 1MB Bank，按配置时间模拟编程/擦除
+  * @note           : 地址均为逻辑地址 (Bank Swap 后 0x08000000 始终是当前运行的 Bank)
+  ******************************************************************************
+  */
+
+#ifndef __FLASH_PORT_H
+#define __FLASH_PORT_H
+
+#include <stdint.h>
+
+/*============================================================================
+ * 配置
+ *============================================================================*/
+
+/* 1=提供后台擦除 (FlashPort_EraseStart/EraseCancel 与 HAL 的 FLASH 中断回调)，
+ *   工程须在 FLASH_IRQHandler 中调用 HAL_FLASH_IRQHandler；
+ * 0=只提供阻塞操作，不定义 HAL 回调 (没有 FLASH_IRQHandler 的工程，如 App 示例) */
+#ifndef FLASH_PORT_USE_IT
+#define FLASH_PORT_USE_IT         1
+#endif
+
+/*============================================================================
+ * STM32H7 Flash 几何参数
+ *============================================================================*/
+
+#define FLASH_PORT_WORD_SIZE      32u         /* 256-bit flash word，最小编程单位 */
+#define FLASH_PORT_SECTOR_SIZE    0x20000u    /* 128KB，最小擦除单位 */
+
+/* FlashPort_Program 选项 */
+#define FLASH_PORT_IRQ_OFF        (1u << 0)   /* 编程期间屏蔽全局中断 */
+#define FLASH_PORT_CACHE_ALL      (1u << 1)   /* 编程前后整片 Clean/Invalidate D-Cache (默认只 Invalidate 写入范围) */
+
+/* FlashPort_EccCheck 返回值 */
+#define FLASH_PORT_ECC_NONE       0
+#define FLASH_PORT_ECC_SINGLE     1           /* 单位错误，已纠正 */
+#define FLASH_PORT_ECC_DOUBLE     2           /* 双位错误，不可纠正 */
+
+/* 统计的操作类型 (flash_port_stats_t.op 下标) */
+#define FLASH_OP_PROGRAM          0           /* FlashPort_Program，每次调用一个样本，按 flash word 平均 */
+#define FLASH_OP_ERASE            1           /* 扇区擦除 (阻塞与后台)，每个扇区一个样本 */
+#define FLASH_OP_COUNT            2
+
+#define FLASH_PORT_HIST_BINS      24          /* 延迟直方图：bin i 为 [2^i, 2^(i+1)) us (bin 0 含 0us)，最后一个 bin 不封顶 */
+#define FLASH_PORT_SECTORS        16          /* 物理扇区数：Bank1 为 0-7，Bank2 为 8-15 (不随 Bank Swap 变化) */
+
+/* 单类操作的延迟统计 (周期数来自 DWT->CYCCNT，换算为 us 需除以 SystemCoreClock/1e6) */
+typedef struct {
+  uint32_t count;                             /* 样本数 */
+  uint32_t errors;                            /* 失败次数 (不计入延迟) */
+  uint64_t bytes;                             /* 处理的字节数 (擦除按扇区大小计) */
+  uint64_t cycles;                            /* 累计周期 */
+  uint32_t min_cycles;                        /* 单个样本的最小/最大周期 (编程为每 flash word) */
+  uint32_t max_cycles;
+  uint32_t hist[FLASH_PORT_HIST_BINS];
+} flash_op_stats_t;
+
+/* 单个物理扇区的擦除时间 (器件老化时擦除变慢) */
+typedef struct {
+  uint32_t erases;                            /* 本次上电以来的擦除次数 */
+  uint32_t last_cycles;                       /* 最近一次擦除 */
+  uint32_t max_cycles;
+  uint64_t cycles;                            /* 累计，均值 = cycles / erases */
+} flash_sector_stats_t;
+
+typedef struct {
+  flash_op_stats_t     op[FLASH_OP_COUNT];
+  flash_sector_stats_t sector[FLASH_PORT_SECTORS];
+} flash_port_stats_t;
+
+/**
+ * @brief  后台擦除完成回调 (中断上下文)
+ * @param  status: 0=成功, <0=失败
+ * @param  error: 失败时 HAL 报告的出错扇区/地址
+ * @note   调用前已重新上锁 Flash；Cache 维护留给线程上下文 (FlashPort_InvalidateCache)
+ */
+typedef void (*flash_port_erase_cb_t)(int status, uint32_t error);
+
+/*============================================================================
+ * 编程与擦除
+ *============================================================================*/
+
+/**
+ * @brief  编程连续的 flash word (一次解锁)
+ * @param  addr: 目标地址 (32B 对齐)
+ * @param  data: 源数据 (不要求对齐，未对齐时逐字经内部缓冲区)
+ * @param  len: 数据长度 (32 的整数倍)
+ * @param  flags: FLASH_PORT_IRQ_OFF 等选项
+ * @retval 0=成功, -1=参数错误, -2=编程失败 (含后台擦除进行中)
+ * @note   目标必须已擦除；返回前丢弃写入范围的旧 Cache 行，之后读到的是 Flash 实际内容
+ */
+int FlashPort_Program(uint32_t addr, const void* data, uint32_t len, uint32_t flags);
+
+/**
+ * @brief  擦除地址所在的扇区 (阻塞)
+ * @param  addr: 扇区内任意地址
+ * @retval 0=成功, -1=失败
+ */
+int FlashPort_EraseSector(uint32_t addr);
+
+#if FLASH_PORT_USE_IT
+/**
+ * @brief  启动地址所在扇区的后台擦除
+ * @param  addr: 扇区内任意地址
+ * @param  cb: 完成回调 (中断上下文)
+ * @retval 0=已启动, -1=启动失败 (不会回调)
+ * @note   擦除期间同一 Bank 不能编程/擦除，读访问会阻塞总线；
+ *         HAL 实现需在 FLASH_IRQHandler 中调用 HAL_FLASH_IRQHandler
+ */
+int FlashPort_EraseStart(uint32_t addr, flash_port_erase_cb_t cb);
+
+/**
+ * @brief  放弃等待后台擦除 (调用方已超时)
+ * @param  timeout_ms: 继续等待硬件结束的时间
+ * @retval 0=硬件已结束 (成功或失败) 并已收尾, -1=Bank 仍忙
+ * @note   之后不再回调。硬件结束后代替中断收尾 (HAL 过程状态、中断使能、标志)，
+ *         该 Bank 可以继续使用；返回 -1 时复位前不得再访问该 Bank
+ */
+int FlashPort_EraseCancel(uint32_t timeout_ms);
+#endif
+
+/**
+ * @brief  丢弃指定范围的 D-Cache 行 (擦除/外部修改 Flash 后调用)
+ */
+void FlashPort_InvalidateCache(uint32_t addr, uint32_t len);
+
+/*============================================================================
+ * ECC
+ *============================================================================*/
+
+/**
+ * @brief  清除地址所在 Bank 的 ECC 纠错/检错标志
+ */
+void FlashPort_EccClear(uint32_t addr);
+
+/**
+ * @brief  检查上次清除以来地址所在 Bank 的读访问是否发生 ECC 错误
+ * @param  addr: Bank 内任意地址
+ * @param  fail_addr: 输出出错的 flash word 地址 (有错误时)
+ * @retval FLASH_PORT_ECC_NONE / FLASH_PORT_ECC_SINGLE / FLASH_PORT_ECC_DOUBLE
+ * @note   有错误时同时清除标志
+ */
+int FlashPort_EccCheck(uint32_t addr, uint32_t* fail_addr);
+
+/*============================================================================
+ * Bank Swap
+ *============================================================================*/
+
+/**
+ * @brief  获取当前 Bank Swap 状态 (Option Bytes 中的 SWAP_BANK)
+ * @retval 1=已交换, 0=未交换
+ */
+int FlashPort_GetSwap(void);
+
+/**
+ * @brief  修改 Bank Swap 状态并生效
+ * @param  enable: 1=交换, 0=不交换
+ * @retval 0=成功, <0=失败
+ * @note   HAL 实现写入后重载 Option Bytes，通常在此复位；返回 0 时由调用方复位。
+ *         主机实现立即重新映射两个 Bank
+ */
+int FlashPort_SetSwap(int enable);
+
+/*============================================================================
+ * 统计 (flash_stats.c，与后端无关)
+ *============================================================================*/
+
+/**
+ * @brief  获取上电 (或 FlashPort_ResetStats) 以来的 Flash 操作统计
+ */
+const flash_port_stats_t* FlashPort_GetStats(void);
+
+/**
+ * @brief  清零统计
+ */
+void FlashPort_ResetStats(void);
+
+/**
+ * @brief  打印统计：每类操作的次数/字节数/延迟与直方图，以及擦除过的物理扇区
+ * @note   最近一次擦除明显慢于该扇区的平均值时标记 SLOW
+ */
+void FlashPort_PrintStats(void);
+
+/**
+ * @brief  读取周期计数器 (首次调用时启用 DWT)，供后端在操作前后计时
+ */
+uint32_t FlashPort_StatsNow(void);
+
+/**
+ * @brief  记录一次操作 (后端调用，可在中断上下文)
+ * @param  op: FLASH_OP_xxx
+ * @param  addr: 操作的逻辑地址 (擦除时用于定位物理扇区)
+ * @param  bytes: 字节数
+ * @param  cycles: 耗时
+ * @param  ok: 0=操作失败
+ */
+void FlashPort_StatsRecord(uint32_t op, uint32_t addr, uint32_t bytes, uint32_t cycles, int ok);
+
+#endif /* __FLASH_PORT_H */
@@ -0,0 +1,312 @@
+/**
+  ******************************************************************************
+  * @file           : flash_port.c
+  * @brief          : Flash 平台抽象层实现 (STM32H7 + HAL)
+  * @description    : 封装 HAL 的解锁/编程/擦除序列、Cache 维护、ECC 标志
+  *                   与 Option Bytes 中的 Bank Swap
+  ******************************************************************************
+  */
+
+#include "flash_port.h"
+#include "stm32h7xx_hal.h"
+#include <string.h>
+
+/*============================================================================
+ * 配置
+ *============================================================================*/
+
+#if FLASH_PORT_USE_IT
+/* FLASH 中断优先级 (低于串口 DMA/USART，只用于通知擦除完成) */
+#ifndef FLASH_PORT_IRQ_PRIO
+#define FLASH_PORT_IRQ_PRIO   5u
+#endif
+#endif
+
+/*============================================================================
+ * 静态变量
+ *============================================================================*/
+
+/* 源数据未对齐时的 32B 对齐缓冲区 */
+static uint8_t s_word_buf[FLASH_PORT_WORD_SIZE] __attribute__((aligned(32)));
+
+#if FLASH_PORT_USE_IT
+/* 后台擦除完成回调 (NULL=无后台擦除) */
+static flash_port_erase_cb_t s_erase_cb;
+static uint32_t              s_erase_addr;
+static uint32_t              s_erase_t0;
+#endif
+
+/*============================================================================
+ * 内部函数
+ *============================================================================*/
+
+/**
+ * @brief  获取地址对应的 Flash Bank 编号
+ */
+static uint32_t get_flash_bank(uint32_t addr)
+{
+    return (addr >= FLASH_BANK2_BASE) ? FLASH_BANK_2 : FLASH_BANK_1;
+}
+
+/**
+ * @brief  获取地址对应的 Flash Sector 编号 (0-7)
+ * @note   STM32H7 每个 Bank 有 8 个 128KB 扇区
+ */
+static uint32_t get_flash_sector(uint32_t addr)
+{
+    uint32_t bank_base = (addr >= FLASH_BANK2_BASE) ? FLASH_BANK2_BASE : FLASH_BANK1_BASE;
+    return (addr - bank_base) / FLASH_PORT_SECTOR_SIZE;
+}
+
+static void erase_cfg_init(FLASH_EraseInitTypeDef* cfg, uint32_t addr)
+{
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->TypeErase    = FLASH_TYPEERASE_SECTORS;
+    cfg->Banks        = get_flash_bank(addr);
+    cfg->Sector       = get_flash_sector(addr);
+    cfg->NbSectors    = 1;
+    cfg->VoltageRange = FLASH_VOLTAGE_RANGE_3;  /* 2.7V - 3.6V */
+}
+
+/*============================================================================
+ * 编程与擦除
+ *============================================================================*/
+
+int FlashPort_Program(uint32_t addr, const void* data, uint32_t len, uint32_t flags)
+{
+    const uint8_t* src = (const uint8_t*)data;
+    HAL_StatusTypeDef status = HAL_OK;
+    int aligned = (((uint32_t)src & 3u) == 0);
+
+    if (!data || (addr % FLASH_PORT_WORD_SIZE) != 0 || (len % FLASH_PORT_WORD_SIZE) != 0) {
+        return -1;
+    }
+
+    uint32_t t0 = FlashPort_StatsNow();
+
+    if (flags & FLASH_PORT_IRQ_OFF) __disable_irq();
+    if (flags & FLASH_PORT_CACHE_ALL) SCB_CleanDCache();
+
+    HAL_FLASH_Unlock();
+
+    for (uint32_t off = 0; off < len && status == HAL_OK; off += FLASH_PORT_WORD_SIZE) {
+        const uint8_t* p = src + off;
+        if (!aligned) {
+            memcpy(s_word_buf, p, FLASH_PORT_WORD_SIZE);
+            p = s_word_buf;
+        }
+        status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_FLASHWORD, addr + off, (uint32_t)p);
+    }
+
+    HAL_FLASH_Lock();
+
+    /* Flash 为默认的 Write-Through 属性，写入不会滞留在 Cache 中；
+     * 只需丢弃写入范围内的旧 Cache 行 (32B 对齐)，之后读回的是 Flash 实际内容 */
+    if (flags & FLASH_PORT_CACHE_ALL) {
+        SCB_CleanInvalidateDCache();
+    } else if (len > 0) {
+        SCB_InvalidateDCache_by_Addr((uint32_t*)addr, (int32_t)len);
+    }
+
+    if (flags & FLASH_PORT_IRQ_OFF) __enable_irq();
+
+    FlashPort_StatsRecord(FLASH_OP_PROGRAM, addr, len, FlashPort_StatsNow() - t0, status == HAL_OK);
+    return (status == HAL_OK) ? 0 : -2;
+}
+
+int FlashPort_EraseSector(uint32_t addr)
+{
+    FLASH_EraseInitTypeDef erase_cfg;
+    uint32_t sector_error = 0;
+    HAL_StatusTypeDef status;
+
+    erase_cfg_init(&erase_cfg, addr);
+
+    uint32_t t0 = FlashPort_StatsNow();
+
+    HAL_FLASH_Unlock();
+    status = HAL_FLASHEx_Erase(&erase_cfg, &sector_error);
+    HAL_FLASH_Lock();
+
+    FlashPort_StatsRecord(FLASH_OP_ERASE, addr, FLASH_PORT_SECTOR_SIZE,
+                          FlashPort_StatsNow() - t0, status == HAL_OK);
+    FlashPort_InvalidateCache(addr & ~(FLASH_PORT_SECTOR_SIZE - 1u), FLASH_PORT_SECTOR_SIZE);
+
+    return (status == HAL_OK) ? 0 : -1;
+}
+
+#if FLASH_PORT_USE_IT
+int FlashPort_EraseStart(uint32_t addr, flash_port_erase_cb_t cb)
+{
+    FLASH_EraseInitTypeDef erase_cfg;
+
+    erase_cfg_init(&erase_cfg, addr);
+
+    HAL_NVIC_SetPriority(FLASH_IRQn, FLASH_PORT_IRQ_PRIO, 0);
+    HAL_NVIC_EnableIRQ(FLASH_IRQn);
+
+    s_erase_cb   = cb;
+    s_erase_addr = addr;
+    s_erase_t0   = FlashPort_StatsNow();
+
+    HAL_FLASH_Unlock();
+    if (HAL_FLASHEx_Erase_IT(&erase_cfg) != HAL_OK) {
+        HAL_FLASH_Lock();
+        s_erase_cb = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+int FlashPort_EraseCancel(uint32_t timeout_ms)
+{
+    uint32_t bank = get_flash_bank(s_erase_addr);
+
+    /* 迟到的完成中断不再回调 */
+    __disable_irq();
+    s_erase_cb = NULL;
+    __enable_irq();
+
+    /* 出错时也会清 QW，只有 HAL_TIMEOUT 表示仍在擦除 */
+    if (FLASH_WaitForLastOperation(timeout_ms, bank) == HAL_TIMEOUT) {
+        return -1;
+    }
+
+    /* 代替 HAL_FLASH_IRQHandler 收尾，否则 HAL 认为擦除过程仍在进行 */
+    __disable_irq();
+    if (bank == FLASH_BANK_1) {
+        __HAL_FLASH_DISABLE_IT_BANK1(FLASH_IT_ALL_BANK1);
+        CLEAR_BIT(FLASH->CR1, FLASH_CR_SER | FLASH_CR_SNB);
+        __HAL_FLASH_CLEAR_FLAG_BANK1(FLASH_FLAG_EOP_BANK1 | FLASH_FLAG_ALL_ERRORS_BANK1);
+    } else {
+        __HAL_FLASH_DISABLE_IT_BANK2(FLASH_IT_ALL_BANK2);
+        CLEAR_BIT(FLASH->CR2, FLASH_CR_SER | FLASH_CR_SNB);
+        __HAL_FLASH_CLEAR_FLAG_BANK2(FLASH_FLAG_EOP_BANK2 | FLASH_FLAG_ALL_ERRORS_BANK2);
+    }
+    HAL_NVIC_ClearPendingIRQ(FLASH_IRQn);
+    pFlash.ProcedureOnGoing = FLASH_PROC_NONE;
+    __HAL_UNLOCK(&pFlash);
+    __enable_irq();
+
+    HAL_FLASH_Lock();
+    FlashPort_StatsRecord(FLASH_OP_ERASE, s_erase_addr, FLASH_PORT_SECTOR_SIZE,
+                          FlashPort_StatsNow() - s_erase_t0, 0);
+    return 0;
+}
+#endif
+
+void FlashPort_InvalidateCache(uint32_t addr, uint32_t len)
+{
+    SCB_InvalidateDCache_by_Addr((uint32_t*)addr, (int32_t)len);
+}
+
+#if FLASH_PORT_USE_IT
+/*============================================================================
+ * FLASH 中断回调 (HAL_FLASH_IRQHandler 调用)
+ *============================================================================*/
+
+/**
+ * @brief  擦除/编程完成回调
+ * @note   按扇区擦除时每个扇区回调一次，全部完成时 ReturnValue 为 0xFFFFFFFF
+ */
+void HAL_FLASH_EndOfOperationCallback(uint32_t ReturnValue)
+{
+    flash_port_erase_cb_t cb = s_erase_cb;
+
+    if (!cb || ReturnValue != 0xFFFFFFFFu) return;
+
+    s_erase_cb = NULL;
+    HAL_FLASH_Lock();
+    FlashPort_StatsRecord(FLASH_OP_ERASE, s_erase_addr, FLASH_PORT_SECTOR_SIZE,
+                          FlashPort_StatsNow() - s_erase_t0, 1);
+    cb(0, 0);
+}
+
+/**
+ * @brief  擦除/编程出错回调
+ */
+void HAL_FLASH_OperationErrorCallback(uint32_t ReturnValue)
+{
+    flash_port_erase_cb_t cb = s_erase_cb;
+
+    if (!cb) return;
+
+    s_erase_cb = NULL;
+    HAL_FLASH_Lock();
+    FlashPort_StatsRecord(FLASH_OP_ERASE, s_erase_addr, FLASH_PORT_SECTOR_SIZE, 0, 0);
+    cb(-1, ReturnValue);
+}
+#endif
+
+/*============================================================================
+ * ECC
+ *============================================================================*/
+
+void FlashPort_EccClear(uint32_t addr)
+{
+    int bank2 = (get_flash_bank(addr) == FLASH_BANK_2);
+
+    __HAL_FLASH_CLEAR_FLAG(bank2 ? FLASH_FLAG_SNECCERR_BANK2 : FLASH_FLAG_SNECCERR_BANK1);
+    __HAL_FLASH_CLEAR_FLAG(bank2 ? FLASH_FLAG_DBECCERR_BANK2 : FLASH_FLAG_DBECCERR_BANK1);
+}
+
+int FlashPort_EccCheck(uint32_t addr, uint32_t* fail_addr)
+{
+    int bank2 = (get_flash_bank(addr) == FLASH_BANK_2);
+    uint32_t sneccerr = bank2 ? FLASH_FLAG_SNECCERR_BANK2 : FLASH_FLAG_SNECCERR_BANK1;
+    uint32_t dbeccerr = bank2 ? FLASH_FLAG_DBECCERR_BANK2 : FLASH_FLAG_DBECCERR_BANK1;
+    int result;
+
+    if (__HAL_FLASH_GET_FLAG(dbeccerr)) {
+        result = FLASH_PORT_ECC_DOUBLE;
+    } else if (__HAL_FLASH_GET_FLAG(sneccerr)) {
+        result = FLASH_PORT_ECC_SINGLE;
+    } else {
+        return FLASH_PORT_ECC_NONE;
+    }
+
+    /* ECC_FAx 为 Bank 内的 flash word 序号 (HAL_FLASHEx_GetEccInfo 需要 USE_FLASH_ECC) */
+    uint32_t fa = (bank2 ? FLASH->ECC_FA2 : FLASH->ECC_FA1) & FLASH_ECC_FA_FAIL_ECC_ADDR;
+    *fail_addr = (bank2 ? FLASH_BANK2_BASE : FLASH_BANK1_BASE) + fa * FLASH_PORT_WORD_SIZE;
+
+    __HAL_FLASH_CLEAR_FLAG(sneccerr);
+    __HAL_FLASH_CLEAR_FLAG(dbeccerr);
+    return result;
+}
+
+/*============================================================================
+ * Bank Swap
+ *============================================================================*/
+
+int FlashPort_GetSwap(void)
+{
+    FLASH_OBProgramInitTypeDef ob = {0};
+    HAL_FLASHEx_OBGetConfig(&ob);
+    return (ob.USERConfig & OB_SWAP_BANK_ENABLE) ? 1 : 0;
+}
+
+int FlashPort_SetSwap(int enable)
+{
+    FLASH_OBProgramInitTypeDef ob = {0};
+
+    HAL_FLASH_Unlock();
+    HAL_FLASH_OB_Unlock();
+
+    /* 读取当前 Option Bytes 配置 */
+    HAL_FLASHEx_OBGetConfig(&ob);
+
+    /* 配置 Swap Bank 选项 */
+    ob.OptionType = OPTIONBYTE_USER;
+    ob.USERType   = OB_USER_SWAP_BANK;
+    ob.USERConfig = enable ? OB_SWAP_BANK_ENABLE : OB_SWAP_BANK_DISABLE;
+
+    if (HAL_FLASHEx_OBProgram(&ob) != HAL_OK) {
+        return -1;
+    }
+
+    /* 触发 Option Bytes 重载，此处会产生复位 */
+    if (HAL_FLASH_OB_Launch() != HAL_OK) {
+        return -2;
+    }
+    return 0;
+}
@@ -0,0 +1,157 @@
+/**
+  ******************************************************************************
+  * @file           : flash_stats.c
+  * @brief          : Flash 操作统计 (延迟直方图、字节计数、扇区擦除时间)
+  * @description    : 由 flash_port 后端在每次编程/擦除后调用 FlashPort_StatsRecord，
+  *                   与后端无关 (目标板与主机仿真共用)
+  ******************************************************************************
+  */
+
+#include "flash_port.h"
+#include "stm32h7xx_hal.h"
+#include <stdio.h>
+#include <string.h>
+
+/*============================================================================
+ * 配置
+ *============================================================================*/
+
+/* 最近一次擦除超过该扇区平均值的百分比时标记 SLOW */
+#ifndef FLASH_STATS_SLOW_PCT
+#define FLASH_STATS_SLOW_PCT  150u
+#endif
+
+/*============================================================================
+ * 静态变量
+ *============================================================================*/
+
+static flash_port_stats_t s_stats;
+
+/*============================================================================
+ * 内部函数
+ *============================================================================*/
+
+/**
+ * @brief  周期数对应的直方图 bin (按 us 取 log2)
+ */
+static uint32_t hist_bin(uint32_t cycles)
+{
+    uint32_t us = cycles / (SystemCoreClock / 1000000u);
+    uint32_t bin = 0;
+
+    while (us > 1u && bin < FLASH_PORT_HIST_BINS - 1u) {
+        us >>= 1;
+        bin++;
+    }
+    return bin;
+}
+
+/**
+ * @brief  逻辑地址对应的物理扇区编号 (Bank Swap 时两个 Bank 的逻辑地址互换)
+ */
+static uint32_t phys_sector(uint32_t addr)
+{
+    uint32_t bank = (addr >= FLASH_BANK2_BASE) ? 1u : 0u;
+
+    if (FlashPort_GetSwap()) bank ^= 1u;
+    return bank * 8u + ((addr & (FLASH_BANK_SIZE - 1u)) / FLASH_PORT_SECTOR_SIZE) % 8u;
+}
+
+/*============================================================================
+ * 公共函数实现
+ *============================================================================*/
+
+const flash_port_stats_t* FlashPort_GetStats(void)
+{
+    return &s_stats;
+}
+
+void FlashPort_ResetStats(void)
+{
+    memset(&s_stats, 0, sizeof(s_stats));
+}
+
+uint32_t FlashPort_StatsNow(void)
+{
+    if (!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)) {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->LAR = 0xC5ACCE55;          /* Cortex-M7 需先解锁 DWT */
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    }
+    return DWT->CYCCNT;
+}
+
+void FlashPort_StatsRecord(uint32_t op, uint32_t addr, uint32_t bytes, uint32_t cycles, int ok)
+{
+    flash_op_stats_t* st;
+    uint32_t sample = cycles;
+
+    if (op >= FLASH_OP_COUNT) return;
+    st = &s_stats.op[op];
+
+    if (!ok) {
+        st->errors++;
+        return;
+    }
+
+    /* 编程按 flash word 平均，不同长度的调用可以放进同一个直方图 */
+    if (op == FLASH_OP_PROGRAM && bytes >= FLASH_PORT_WORD_SIZE) {
+        sample = cycles / (bytes / FLASH_PORT_WORD_SIZE);
+    }
+
+    if (st->count == 0 || sample < st->min_cycles) st->min_cycles = sample;
+    if (sample > st->max_cycles) st->max_cycles = sample;
+    st->count++;
+    st->bytes  += bytes;
+    st->cycles += cycles;
+    st->hist[hist_bin(sample)]++;
+
+    if (op == FLASH_OP_ERASE) {
+        flash_sector_stats_t* sec = &s_stats.sector[phys_sector(addr)];
+        sec->erases++;
+        sec->last_cycles = cycles;
+        sec->cycles += cycles;
+        if (cycles > sec->max_cycles) sec->max_cycles = cycles;
+    }
+}
+
+void FlashPort_PrintStats(void)
+{
+    static const char* const names[FLASH_OP_COUNT] = { "program", "erase" };
+    static const char* const units[FLASH_OP_COUNT] = { "us/word", "ms" };
+    uint32_t mhz = SystemCoreClock / 1000000u;
+
+    for (uint32_t op = 0; op < FLASH_OP_COUNT; op++) {
+        const flash_op_stats_t* st = &s_stats.op[op];
+        uint32_t div = (op == FLASH_OP_ERASE) ? mhz * 1000u : mhz;
+        uint64_t n = (op == FLASH_OP_PROGRAM) ? st->bytes / FLASH_PORT_WORD_SIZE : st->count;
+
+        if (st->count == 0 && st->errors == 0) continue;
+
+        printf("[FLASH] %s: %lu ops, %lu KB, %lu errors, min/mean/max %lu/%lu/%lu %s\r\n",
+               names[op], (unsigned long)st->count, (unsigned long)(st->bytes / 1024u),
+               (unsigned long)st->errors, (unsigned long)(st->min_cycles / div),
+               (unsigned long)(n ? st->cycles / n / div : 0),
+               (unsigned long)(st->max_cycles / div), units[op]);
+
+        printf("[FLASH] %s hist (us):", names[op]);
+        for (uint32_t i = 0; i < FLASH_PORT_HIST_BINS; i++) {
+            if (st->hist[i]) printf(" <%lu:%lu", 2ul << i, (unsigned long)st->hist[i]);
+        }
+        printf("\r\n");
+    }
+
+    for (uint32_t i = 0; i < FLASH_PORT_SECTORS; i++) {
+        const flash_sector_stats_t* sec = &s_stats.sector[i];
+        if (sec->erases == 0) continue;
+
+        uint64_t mean = sec->cycles / sec->erases;
+        int slow = (sec->erases > 1u) &&
+                   (uint64_t)sec->last_cycles * 100u > mean * FLASH_STATS_SLOW_PCT;
+
+        printf("[FLASH] bank%lu sector%lu: %lu erases, last/mean/max %lu/%lu/%lu ms%s\r\n",
+               (unsigned long)(i / 8u + 1u), (unsigned long)(i % 8u), (unsigned long)sec->erases,
+               (unsigned long)(sec->last_cycles / mhz / 1000u), (unsigned long)(mean / mhz / 1000u),
+               (unsigned long)(sec->max_cycles / mhz / 1000u), slow ? " SLOW" : "");
+    }
+}
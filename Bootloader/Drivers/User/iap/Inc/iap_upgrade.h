@@ -17,14 +17,93 @@ extern "C" {
 #include "ymodem.h"
 #include "lwrb.h"
 
+/*
+ * 断点续传握手
+ *
+ * IAP_PrepareSlot 发现可续传断点时保留 Slot 内容，IAP_UpgradeViaYmodem 在发起
+ * YMODEM 之前输出一行:
+ *
+ *     "RESUME <file_size> <img_crc32 hex> <offset>\r\n"
+ *
+ * 支持续传的发送方若本地文件大小与镜像头 img_crc32 都一致，则在 packet 0 的
+ * 大小字段之后追加 "+<offset>" 扩展字段，并从 offset 处开始发送数据；
+ * 否则按普通 YMODEM 从头发送，接收方在重新写入每个扇区前将其擦除。
+ */
+#define IAP_RESUME_BANNER   "RESUME"
+
+/*
+ * 波特率与接收模式协商 (在续传握手之前，控制台波特率下进行)
+ *
+ *   设备 -> "BAUD? <max> <gmax>\r\n"     可支持的最高速率；YMODEM-G 可用的最高速率 (0=不可用)
+ *   主机 -> "BAUD <rate>[ G]\r\n"        300ms 内提议，不提议则保持原速率与经典 YMODEM；
+ *                                         " G" 请求 YMODEM-G，<rate> 可等于控制台速率 (只请求模式)
+ *   设备 -> "BAUD OK <rate>[ G]\r\n"     " G" 表示获准使用 YMODEM-G (<rate> 不超过 <gmax>)；
+ *                                         或 "BAUD NO\r\n" (速率不可实现)
+ *   速率改变时双方切换到 <rate>，主机发送 IAP_BAUD_PROBE，设备 500ms 内原样回显；
+ *   任一方超时则回退到控制台速率与经典 YMODEM (设备额外输出 "BAUD FAIL\r\n")。
+ *   会话结束 (成功或失败) 后设备恢复控制台速率。
+ */
+#define IAP_BAUD_BANNER     "BAUD?"
+#define IAP_BAUD_PROBE      "SYNC\x55\xAA\x0F\xF0"
+
+/**
+ * @brief  接收/编程流水线统计 (最近一次升级)
+ */
+typedef struct {
+    uint32_t packets;           /* 进入暂存队列的数据包数 */
+    uint32_t stalls;            /* 队列满时在回调中同步写入的次数 (ACK 被推迟) */
+    uint32_t max_depth;         /* 队列最大深度 (RAM 窗口作为队列时按 1KB 计) */
+    uint32_t wire_ms;           /* 传输总耗时 (on_begin → on_end) */
+    uint64_t prog_cycles;       /* Flash 编程总耗时 (CPU 周期) */
+    uint64_t overlap_cycles;    /* 其中在等待下一包期间完成、与线路时间重叠的部分 */
+    uint32_t ram_staged;        /* 1=整个镜像先在 RAM 中校验，再写入 Flash */
+    uint32_t commit_ms;         /* RAM 暂存时从校验到写完 Flash 的耗时 */
+    uint32_t ram_spilled;       /* RAM 窗口放不下镜像时，传输期间从窗口写入 Flash 的字节数 */
+} iap_pipe_stats_t;
+
+/**
+ * @brief  安装方式
+ * @note   IAP_INSTALL_RAM: 文件不超过 RAM 窗口 (IAP_RAM_WIN_SIZE) 且不是续传时，
+ *         整个文件先接收到 AXI SRAM，镜像 CRC 在 RAM 中校验通过后才擦除/编程
+ *         非活动 Slot，损坏的上传不会改动 Slot，这种情况不记录断点 (中断后
+ *         只能从头上传)。结束包在 RAM 校验通过后即 ACK，会话结束后才写入 Slot，
+ *         写入失败时 IAP_UpgradeViaYmodem 返回错误并记录 IAP_CKPT_FAILED。
+ *         文件超过窗口或续传时，窗口作为环形暂存队列，最早的数据在传输期间
+ *         写入 Slot (记录断点)，Slot 在校验之前即被改动，控制台输出提示
+ */
+typedef enum {
+    IAP_INSTALL_STREAM = 0,     /* 边接收边写入 Flash */
+    IAP_INSTALL_RAM,            /* 先在 RAM 中接收并校验，再写入 Flash */
+} iap_install_mode_t;
+
+/**
+ * @brief  升级前准备非活动 Slot (替代直接调用 IAP_EraseSlot)
+ * @note   只查找可续传断点，不擦除 Flash (不会失败)：扇区在写入时按文件大小
+ *         按需擦除，trailer 扇区在镜像 CRC 校验通过后才擦除。断点与 Slot 内容
+ *         不符时输出提示，本次只能从头上传
+ */
+void IAP_PrepareSlot(void);
+
 /**
  * @brief  通过 YMODEM 协议进行固件升级
  * @param  rb: 环形缓冲区指针（用于 UART 接收）
  * @param  timeout_ms: 超时时间 (ms)
  * @retval 0=成功, <0=失败
+ * @note   调用前须先调用 IAP_PrepareSlot
  */
 int IAP_UpgradeViaYmodem(lwrb_t* rb, uint32_t timeout_ms);
 
+/**
+ * @brief  选择安装方式 (默认 IAP_INSTALL_STREAM，IAP_RAM_STAGE=0 时只支持流式)
+ */
+void IAP_SetInstallMode(iap_install_mode_t mode);
+
+/**
+ * @brief  获取最近一次升级的流水线统计
+ * @retval 统计数据 (只读)
+ */
+const iap_pipe_stats_t* IAP_GetPipelineStats(void);
+
 #ifdef __cplusplus
 }
 #endif
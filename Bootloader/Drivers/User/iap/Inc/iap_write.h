@@ -10,18 +10,83 @@
 #define IAP_SECTOR_SIZE       0x20000u    /* 128KB per sector */
 #define IAP_FLASH_WORD_SIZE   32u         /* 256-bit = 32 bytes per flash word */
 
+/* IAP_ProgramWords 选项 */
+#define IAP_PROG_IRQ_OFF      (1u << 0)   /* 编程期间屏蔽全局中断 (默认不屏蔽，串口 DMA 照常服务) */
+#define IAP_PROG_VERIFY       (1u << 1)   /* 编程后逐字读回比较，并检查 ECC 纠错/检错标志 */
+
+/* 读回校验失败原因 (iap_verify_cb_t 的 reason) */
+#define IAP_VERIFY_MISMATCH   1u          /* 读回内容与源数据不符 */
+#define IAP_VERIFY_ECC_SINGLE 2u          /* 读回时发生单位 ECC 纠错 (存储单元余量不足) */
+#define IAP_VERIFY_ECC_DOUBLE 3u          /* 读回时检测到双位 ECC 错误 */
+
+/*============================================================================
+ * 断点续传
+ *============================================================================*/
+
+#define IAP_CKPT_MAGIC        0x54504B43u /* 'CKPT' 断点记录魔数 (与 TR_MAGIC 区分) */
+#define IAP_SESSION_MAGIC     0x53534553u /* 'SESS' 写入会话开始标记，使之前的启动校验记录作废 */
+#define IAP_CKPT_ACTIVE       0xFFFFFFFFu /* 上传进行中 */
+#define IAP_CKPT_DONE         0x00000000u /* 上传已完成且 CRC 校验通过 (run_crc == img_crc32) */
+#define IAP_CKPT_BAD_CRC      0x0000FFFFu /* 上传已完成但 CRC 不符，不可续传 */
+#define IAP_CKPT_FAILED       0xFFFF0000u /* 写入失败 (读回校验无法退回断点，或结束包 ACK 之后的提交失败)，不可续传 */
+
+/* 断点间隔 (必须是 1KB 的整数倍，保证续传偏移落在 YMODEM 包边界) */
+#ifndef IAP_CKPT_INTERVAL
+#define IAP_CKPT_INTERVAL     0x8000u     /* 32KB */
+#endif
+
 /*============================================================================
  * 数据结构
  *============================================================================*/
 
+/*
+ * 断点记录 (32B，写在非活动 Slot 的 trailer 扇区)
+ * 与 tr_rec_t 共用 append-only 空间，trailer_read_last 按 magic 跳过本记录
+ */
+typedef struct __attribute__((packed)) {
+  uint32_t magic;         /* IAP_CKPT_MAGIC */
+  uint32_t file_size;     /* 文件总大小 (镜像头 + 镜像体)，镜像身份之一 */
+  uint32_t img_crc32;     /* 镜像头中的 img_crc32，镜像身份之一 */
+  uint32_t committed;     /* 已写入 Flash 的字节数 (相对 Slot 起始) */
+  uint32_t run_crc;       /* 镜像体前 crc_len 字节的 CRC32 中间值 (完成时为最终值) */
+  uint32_t status;        /* IAP_CKPT_ACTIVE / IAP_CKPT_DONE / IAP_CKPT_BAD_CRC / IAP_CKPT_FAILED */
+  uint32_t crc_len;       /* run_crc 覆盖的镜像体长度 (进行中为 4 的整数倍，完成时为 img_size) */
+  uint32_t rsv;           /* 保留，padding to 32B */
+} iap_ckpt_t;
+
 typedef struct {
   uint32_t base;          /* 目标区域起始地址 */
   uint32_t limit;         /* 目标区域结束地址 (base + size) */
   uint32_t addr;          /* 当前写入地址 */
   uint8_t  buf32[32];     /* 32B 对齐缓冲区 (flash word) */
   uint32_t fill;          /* buf32 中已填充的字节数 */
+  uint32_t ckpt_next;     /* 下一次记录断点的地址 (0=不记录) */
+  uint32_t img_end;       /* 镜像体结束地址 (来自已写入的镜像头，0=尚未读取) */
+  uint32_t crc_addr;      /* run_crc 已覆盖到的地址 */
+  uint32_t run_crc;       /* 镜像体 CRC32 中间值 (随写入逐包累加) */
+  uint32_t erased_end;    /* 本次会话已擦除到的地址 (扇区边界，首次写入某扇区前擦除) */
 } iap_writer_t;
 
+/* 编程/擦除统计 (DWT 周期计数器需由调用方启用) */
+typedef struct {
+  uint32_t bursts;        /* IAP_ProgramWords 调用次数 */
+  uint32_t bytes;         /* 编程字节数 */
+  uint64_t cycles;        /* 编程累计 CPU 周期 (含解锁与 Cache 维护) */
+  uint32_t skipped_words; /* 源数据全 0xFF、目标已擦除而跳过编程的 flash word 数 */
+  uint32_t verify_errors; /* 读回校验失败次数 */
+  uint32_t erases;        /* 擦除的扇区数 */
+  uint32_t blank_sectors; /* 查空后发现已是空扇区而跳过擦除的次数 */
+  uint64_t erase_cycles;  /* 擦除累计耗时 (启动 → FLASH 中断) */
+  uint64_t erase_wait_cycles; /* 其中 CPU 阻塞等待的部分 (其余与接收重叠) */
+} iap_prog_stats_t;
+
+/**
+ * @brief  读回校验失败回调
+ * @param  addr: 出错的 flash word 地址 (ECC 错误时为 FLASH 记录的出错地址)
+ * @param  reason: IAP_VERIFY_xxx
+ */
+typedef void (*iap_verify_cb_t)(uint32_t addr, uint32_t reason);
+
 /*============================================================================
  * 函数声明
  *============================================================================*/
@@ -58,6 +123,20 @@ int IAP_EraseSector(uint32_t sector_index);
  */
 int IAP_EraseSlot(void);
 
+/**
+ * @brief  后台擦除是否进行中
+ * @retval 1=进行中 (此时不应访问非活动 Bank), 0=空闲
+ * @note   IAP_Write 在写入接近已擦除区域末尾时启动下一个扇区的后台擦除，
+ *         完成由 FLASH 中断通知 (需在 FLASH_IRQHandler 中调用 HAL_FLASH_IRQHandler)
+ */
+int IAP_EraseBusy(void);
+
+/**
+ * @brief  等待后台擦除结束
+ * @retval 0=无擦除或擦除成功, <0=擦除失败
+ */
+int IAP_EraseWait(void);
+
 /**
  * @brief  擦除指定地址范围 (自动计算需要擦除的扇区)
  * @param  start_addr: 起始地址 (必须在非活动 Slot 范围内)
@@ -66,30 +145,105 @@ int IAP_EraseSlot(void);
  */
 int IAP_EraseRange(uint32_t start_addr, uint32_t size);
 
+/**
+ * @brief  批量编程连续的 flash word (一次解锁)
+ * @param  addr: 目标地址 (32B 对齐，位于非活动 Slot 内，含 trailer)
+ * @param  data: 源数据 (4 字节对齐时直接编程，否则逐字经对齐缓冲区)
+ * @param  len: 数据长度 (32 的整数倍)
+ * @param  flags: IAP_PROG_IRQ_OFF 等选项
+ * @retval 0=成功, -1=参数错误, -2=编程失败, -3=读回校验失败 (IAP_PROG_VERIFY)
+ * @note   目标必须已擦除；结束后只 Invalidate 写入范围的 D-Cache
+ */
+int IAP_ProgramWords(uint32_t addr, const uint8_t* data, uint32_t len, uint32_t flags);
+
+/**
+ * @brief  设置读回校验失败回调 (NULL=不回调)
+ */
+void IAP_SetVerifyCallback(iap_verify_cb_t cb);
+
+/**
+ * @brief  获取编程/擦除统计 (每 KB 周期数 = cycles * 1024 / bytes)
+ */
+const iap_prog_stats_t* IAP_GetProgStats(void);
+
+/**
+ * @brief  清零编程/擦除统计
+ */
+void IAP_ResetProgStats(void);
+
 /**
  * @brief  开始 IAP 写入会话
  * @param  w: 写入器实例
  * @param  dst_base: 目标起始地址
  * @param  dst_size: 目标区域大小
  * @retval 0=成功, <0=失败
+ * @note   先在 trailer 写入会话标记 (IAP_SESSION_MAGIC)，不擦除 App 区域，
+ *         扇区在写入时按需擦除
  */
 int IAP_Begin(iap_writer_t* w, uint32_t dst_base, uint32_t dst_size);
 
+/**
+ * @brief  后台擦除写入会话的下一个扇区 (不等待)
+ * @param  w: 写入器实例
+ * @retval 1=擦除进行中或刚启动, 0=会话所需扇区已全部擦除, <0=擦除失败
+ * @note   数据暂存在 RAM、暂不写入时在主循环中反复调用，擦除与接收重叠；
+ *         之后 IAP_Write 跳过已擦除的扇区
+ */
+int IAP_EraseNext(iap_writer_t* w);
+
 /**
  * @brief  写入数据 (自动处理 32B 对齐)
  * @param  w: 写入器实例
  * @param  data: 源数据
  * @param  len: 数据长度
- * @retval 0=成功, <0=失败
+ * @retval 0=成功, <0=失败 (-4=镜像头无效, -6=读回校验失败)
+ * @note   读回校验失败 (或续传时目标字已写入不同内容) 时断点退回出错扇区的
+ *         起始处，续传只需重传该扇区；
+ *         首次写入某扇区前先擦除该扇区 (只擦除文件实际占用的扇区)；
+ *         每次调用后从 Flash 读回新写入的镜像体，累加 CRC32。
+ *         后台擦除进行中时先阻塞等待其结束，调用方可用 IAP_EraseBusy 避开
  */
 int IAP_Write(iap_writer_t* w, const uint8_t* data, uint32_t len);
 
 /**
- * @brief  结束 IAP 写入会话 (刷新剩余缓冲区)
+ * @brief  从断点恢复 IAP 写入会话
  * @param  w: 写入器实例
+ * @param  ck: IAP_CheckpointLoad 返回的断点
  * @retval 0=成功, <0=失败
+ * @note   之后的 IAP_Write 从 base + ck->committed 处继续写入；
+ *         断点所在扇区视为已擦除，之后的扇区在写入时重新擦除
+ */
+int IAP_Resume(iap_writer_t* w, const iap_ckpt_t* ck);
+
+/**
+ * @brief  读取非活动 Slot 上可续传的断点
+ * @param  out: 输出的断点记录
+ * @retval 0=可续传, -1=无断点/已完成, -2=Flash 中的镜像头与断点不符, -3=已写入数据 CRC 不符,
+ *         -4=最近一次写入会话以 IAP_CKPT_FAILED 结束 (写入失败，Slot 中的镜像不可用)
+ * @note   会重新计算已写入区域的 CRC32，确认数据在掉电/复位后仍然完整；
+ *         只查看最后一个会话标记 (IAP_SESSION_MAGIC) 之后的记录
+ */
+int IAP_CheckpointLoad(iap_ckpt_t* out);
+
+/**
+ * @brief  结束 IAP 写入会话 (刷新剩余缓冲区并校验镜像 CRC)
+ * @param  w: 写入器实例
+ * @retval 0=成功, <0=失败 (-4=镜像头无效, -5=CRC 不符, -6=读回校验失败)
+ * @note   CRC 与 Boot_CalcImageCRC 算法相同 (按字累加，尾部补 0xFF)，
+ *         与镜像头 img_crc32 比较。CRC 通过时擦除 trailer 扇区 (清除旧镜像的
+ *         状态记录) 后写入 IAP_CKPT_DONE，否则追加 IAP_CKPT_BAD_CRC，
+ *         之后的 IAP_CheckpointLoad 不再返回该断点。
+ *         结束前打印 Flash 操作统计 (FlashPort_PrintStats)
  */
 int IAP_End(iap_writer_t* w);
 
+/**
+ * @brief  放弃写入会话 (写入失败且已无法通知发送方时)
+ * @param  w: 写入器实例
+ * @retval 0=已追加 IAP_CKPT_FAILED 记录, <0=未记录 (镜像头尚未写入)
+ * @note   之后 IAP_CheckpointLoad 返回 -4，Slot 中的数据不再续传
+ */
+int IAP_Abort(iap_writer_t* w);
+
 
 #endif /* IAP_WRITE_H */
@@ -2,42 +2,585 @@
   ******************************************************************************
   * @file           : iap_upgrade.c
   * @brief          : IAP 升级模块实现（整合 YMODEM + IAP 写入）
+  * @description    : 两级流水线：YMODEM 回调只把数据包拷贝到暂存队列，
+  *                   ACK 立即发出；Flash 编程在等待下一包期间从队列中取出执行，
+  *                   使编程时间与串口线路时间重叠；下一个扇区在后台擦除，
+  *                   擦除期间数据包留在队列中。启用 AXI SRAM 窗口时由窗口
+  *                   充当大容量暂存队列，整个扇区擦除期间到达的数据都能放下；
+  *                   RAM 安装方式下，能放进窗口的镜像先整体接收并在
+  *                   RAM 中校验 CRC，通过后再逐扇区写入，损坏的上传不会改动
+  *                   非活动 Slot；放不下的镜像与续传同样边收边写入 Flash
   ******************************************************************************
   */
 
 #include "iap_upgrade.h"
 #include "iap_write.h"
+#include "boot_image.h"
 #include "ymodem.h"
+#include "ymodem_port.h"
 #include "lwrb.h"
+#include "stm32h7xx_hal.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*============================================================================
+ * 配置
+ *============================================================================*/
+
+/* 接收模式：默认经典 YMODEM (每包 ACK，出错 NAK 重传)。
+ * YMODEM-G 没有重传，任何 CRC/序号错误或溢出都会取消整个传输，只在主机于
+ * 波特率协商中请求 ("BAUD <rate> G") 时使用；0=不接受请求 */
+#ifndef IAP_YMODEM_G
+#define IAP_YMODEM_G        1
+#endif
+
+/* YMODEM-G 允许的最高速率。G 模式没有流控，线路速率必须低于 Slot 的持续写入
+ * 速率 (每 flash word 编程 ~100us 时约 320KB/s，不含擦除)，否则接收缓冲必然溢出；
+ * 更高的速率只允许经典 YMODEM (每包 ACK 即流控) */
+#ifndef IAP_YMODEM_G_BAUD_MAX
+#define IAP_YMODEM_G_BAUD_MAX   1000000u
+#endif
+
+/* 暂存队列深度 (每项 1KB，队列满时在回调中同步写入，ACK 随之推迟)。
+ * 后台擦除期间数据包在此排队：深度 × 1KB 覆盖擦除时间内到达的数据时，擦除不阻塞发送方 */
+#ifndef IAP_STAGE_DEPTH
+#define IAP_STAGE_DEPTH     32
+#endif
+
+/* AXI SRAM 窗口 (0=不占用，只用上面的暂存队列，也不接受 YMODEM-G)。
+ * 流式安装时窗口作为环形暂存队列，扇区擦除期间到达的数据留在窗口中，
+ * YMODEM-G 发送方不必等待擦除；选择 IAP_INSTALL_RAM 后先在窗口中校验再写入。
+ * RAM 校验方式下结束包在 RAM 校验通过后即 ACK (毫秒级，在发送方的标准超时之内)，
+ * 会话结束后才写入 Slot；写入失败记录为断点状态 IAP_CKPT_FAILED */
+#ifndef IAP_RAM_STAGE
+#define IAP_RAM_STAGE       1
+#endif
+
+/* 1 = 接收期间在后台擦除文件所需的扇区，提交时只剩编程与 trailer 擦除 (最坏约 4.2s)；
+ *     代价是 Slot 在镜像校验之前就被改动，损坏的上传也会擦掉其中已有的镜像
+ * 0 = 校验通过后才擦除，损坏的上传不改动 Slot */
+#ifndef IAP_RAM_PRE_ERASE
+#define IAP_RAM_PRE_ERASE   0
+#endif
+
+/* RAM 窗口：AXI SRAM (0x24000000, 512KB) 的高 384KB，低 128KB 留给 RW/ZI 与栈。
+ * 位置由分散加载文件的 RW_IAP_WIN 区域 (0x24020000 UNINIT) 决定，修改大小时同步修改 */
+#ifndef IAP_RAM_WIN_SIZE
+#define IAP_RAM_WIN_SIZE    0x60000u
+#endif
+
+/* 窗口放不下整个镜像 (或续传) 时，每次从窗口写入 Flash 的最大字节数：
+ * 在等待下一包期间写入，与暂存队列的单包写入粒度相同 */
+#ifndef IAP_RAM_SPILL_CHUNK
+#define IAP_RAM_SPILL_CHUNK YMODEM_PACKET_1K
+#endif
+
+/* 升级会话波特率提速 (主机不响应时保持控制台波特率) */
+#ifndef IAP_BAUD_UPSHIFT
+#define IAP_BAUD_UPSHIFT    1
+#endif
+
+#define IAP_BAUD_MAX        4000000u    /* 最高 4Mbaud (PCLK2 120MHz / 30) */
+#define IAP_BAUD_OFFER_MS   300u        /* 等待主机提议速率的时间 */
+#define IAP_BAUD_PROBE_MS   500u        /* 切换后等待探测串的时间 */
+
+/*============================================================================
+ * 私有类型
+ *============================================================================*/
+
+typedef struct {
+    uint32_t len;                       /* 有效数据长度 */
+    uint8_t  data[YMODEM_PACKET_1K];    /* 数据包内容 */
+} iap_stage_t;
 
 /*============================================================================
  * 私有变量
  *============================================================================*/
 
 static iap_writer_t s_iap_writer;
+static ymodem_t     s_ym;
+
+static iap_stage_t s_stage[IAP_STAGE_DEPTH] __attribute__((aligned(32)));
+static uint32_t s_stage_head;           /* 下一个写入位置 */
+static uint32_t s_stage_tail;           /* 下一个编程位置 */
+static uint32_t s_stage_count;          /* 队列中的数据包数 */
+static int      s_stage_err;            /* 延迟写入错误 (0=无) */
+
+static iap_pipe_stats_t s_stats;
+static uint32_t s_begin_tick;
+
+#if IAP_RAM_STAGE
+/* 独立的 UNINIT 区域：不参与 .ANY 分配，启动时不清零 (AC5/AC6 相同的节名) */
+#if defined(__CC_ARM)
+static uint8_t s_ram_win[IAP_RAM_WIN_SIZE] __attribute__((section(".bss.iap_ram_win"), zero_init, aligned(32)));
+#else
+static uint8_t s_ram_win[IAP_RAM_WIN_SIZE] __attribute__((section(".bss.iap_ram_win"), aligned(32)));
+#endif
+static iap_install_mode_t s_install_mode = IAP_INSTALL_STREAM;
+static int      s_ram_active;           /* 1=本次会话暂存在 RAM 窗口中 */
+static int      s_ram_spill;            /* 1=窗口作为环形队列边收边写 (流式安装，或放不下整个镜像/续传) */
+static uint32_t s_ram_fill;             /* 本次会话已接收的字节数 */
+static uint32_t s_ram_spilled;          /* 其中已从窗口写入 Flash 的字节数 (s_ram_spill) */
+static int      s_ram_begun;            /* 1=写入会话已在接收期间开始 (IAP_RAM_PRE_ERASE / s_ram_spill) */
+static int      s_ram_commit;           /* 1=镜像已在 RAM 中校验通过，会话结束后写入 Slot */
+#endif
+
+static iap_ckpt_t s_ckpt;               /* 非活动 Slot 上的断点 */
+static int        s_ckpt_valid;         /* 1=存在可续传断点 (Slot 未擦除) */
+static int        s_resume;             /* 1=发送方已确认续传 */
+
+/*============================================================================
+ * 暂存队列
+ *============================================================================*/
+
+/**
+ * @brief  启用 DWT 周期计数器 (用于流水线统计)
+ */
+static void cycle_counter_init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->LAR = 0xC5ACCE55;              /* Cortex-M7 需先解锁 DWT */
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+static void stage_reset(void)
+{
+    s_stage_head = 0;
+    s_stage_tail = 0;
+    s_stage_count = 0;
+    s_stage_err = 0;
+}
+
+/**
+ * @brief  从队列取出最早的数据包写入 Flash
+ * @param  overlapped: 1=在等待下一包期间执行 (与线路时间重叠), 0=阻塞在 ACK 路径上
+ * @retval 0=成功或队列为空, <0=写入失败
+ */
+static int stage_drain_one(int overlapped)
+{
+    if (s_stage_err) return s_stage_err;
+    if (s_stage_count == 0) return 0;
+
+    iap_stage_t* st = &s_stage[s_stage_tail];
+    uint32_t t0 = DWT->CYCCNT;
+    int ret = IAP_Write(&s_iap_writer, st->data, st->len);
+    uint32_t dt = DWT->CYCCNT - t0;
+
+    s_stats.prog_cycles += dt;
+    if (overlapped) s_stats.overlap_cycles += dt;
+
+    s_stage_tail = (s_stage_tail + 1) % IAP_STAGE_DEPTH;
+    s_stage_count--;
+
+    if (ret != 0) s_stage_err = ret;
+    return ret;
+}
+
+/**
+ * @brief  写完队列中的全部数据包
+ */
+static int stage_flush(void)
+{
+    while (s_stage_count > 0) {
+        if (stage_drain_one(0) != 0) break;
+    }
+    return s_stage_err;
+}
+
+/*============================================================================
+ * RAM 暂存安装
+ *============================================================================*/
+
+#if IAP_RAM_STAGE
+/**
+ * @brief  在 RAM 中校验镜像头与 CRC (结束包 ACK 之前调用，毫秒级)
+ * @retval 0=有效, -1=镜像无效 (Slot 未改动)
+ */
+static int ram_verify(void)
+{
+    const image_hdr_t* hdr = (const image_hdr_t*)s_ram_win;
+    const char* slot = s_ram_begun ? "" : ", slot untouched";
+
+    if (s_ram_fill < HDR_SIZE || !Boot_CheckMagic(hdr) ||
+        hdr->img_size > s_ram_fill - HDR_SIZE) {
+        printf("[IAP] Invalid image header%s\r\n", slot);
+        return -1;
+    }
+
+    uint32_t crc = Boot_CalcImageCRC((uint32_t)s_ram_win, HDR_SIZE, hdr->img_size);
+    if (crc != hdr->img_crc32) {
+        printf("[IAP] Image CRC mismatch in RAM (calc=0x%08lX, expect=0x%08lX)%s\r\n",
+               (unsigned long)crc, (unsigned long)hdr->img_crc32, slot);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief  把已校验的镜像逐扇区写入非活动 Slot 并收尾
+ * @retval 0=成功, <0=写入或读回校验失败
+ * @note   在 YMODEM 会话结束 (结束包已 ACK) 之后调用，发送方已无法得知结果：
+ *         失败时追加 IAP_CKPT_FAILED 记录 (IAP_Abort)，由返回值与断点状态报告。
+ *         IAP_Begin 在此处才调用 (它会开始后台擦除第一个扇区)；
+ *         IAP_RAM_PRE_ERASE=1 时会话已在 on_begin 开始，扇区已在接收期间擦除
+ */
+static int ram_commit(void)
+{
+    uint32_t t0 = HAL_GetTick();
+
+    if (!s_ram_begun &&
+        IAP_Begin(&s_iap_writer, IAP_GetInactiveSlotBase(), s_ram_fill) != 0) {
+        printf("Flash write failed: session start\r\n");
+        return -2;
+    }
+
+    /* Slot 起始地址按扇区对齐，每次写入一个扇区 */
+    for (uint32_t off = 0; off < s_ram_fill; ) {
+        uint32_t n = IAP_SECTOR_SIZE - (off % IAP_SECTOR_SIZE);
+        if (n > s_ram_fill - off) n = s_ram_fill - off;
+
+        uint32_t c0 = DWT->CYCCNT;
+        int ret = IAP_Write(&s_iap_writer, s_ram_win + off, n);
+        s_stats.prog_cycles += DWT->CYCCNT - c0;
+        if (ret != 0) {
+            printf("Flash write failed: %d\r\n", ret);
+            IAP_Abort(&s_iap_writer);
+            return -2;
+        }
+        off += n;
+    }
+
+    int ret = IAP_End(&s_iap_writer);
+    s_stats.commit_ms = HAL_GetTick() - t0;
+    if (ret != 0) {
+        printf("Firmware verify failed: %d\r\n", ret);
+        IAP_Abort(&s_iap_writer);
+        return ret;
+    }
+    printf("Firmware written successfully!\r\n");
+    return 0;
+}
+
+/**
+ * @brief  把数据追加到环形窗口 (s_ram_spill 时回绕)
+ */
+static void ram_put(const uint8_t* data, uint32_t len)
+{
+    while (len > 0) {
+        uint32_t pos = s_ram_fill % IAP_RAM_WIN_SIZE;
+        uint32_t n = IAP_RAM_WIN_SIZE - pos;
+        if (n > len) n = len;
+
+        memcpy(s_ram_win + pos, data, n);
+        s_ram_fill += n;
+        data += n;
+        len -= n;
+    }
+}
+
+/**
+ * @brief  把窗口中最早的一块数据写入 Flash (s_ram_spill)
+ * @param  overlapped: 1=在等待下一包期间执行, 0=窗口已满，阻塞在 ACK 路径上
+ * @retval 0=成功或窗口为空, <0=写入失败
+ */
+static int ram_spill(int overlapped)
+{
+    if (s_stage_err) return s_stage_err;
+
+    uint32_t pos = s_ram_spilled % IAP_RAM_WIN_SIZE;
+    uint32_t n = s_ram_fill - s_ram_spilled;
+    if (n > IAP_RAM_WIN_SIZE - pos) n = IAP_RAM_WIN_SIZE - pos;
+    if (n > IAP_RAM_SPILL_CHUNK) n = IAP_RAM_SPILL_CHUNK;
+    if (n == 0) return 0;
+
+    uint32_t t0 = DWT->CYCCNT;
+    int ret = IAP_Write(&s_iap_writer, s_ram_win + pos, n);
+    uint32_t dt = DWT->CYCCNT - t0;
+
+    s_stats.prog_cycles += dt;
+    if (overlapped) s_stats.overlap_cycles += dt;
+    s_ram_spilled += n;
+
+    if (ret != 0) s_stage_err = ret;
+    return ret;
+}
+#endif
+
+/*============================================================================
+ * 波特率协商
+ *============================================================================*/
+
+/**
+ * @brief  从环形缓冲区读取一行 (以 '\n' 结束，忽略 '\r')
+ * @retval 0=成功, -1=超时
+ */
+static int read_line(lwrb_t* rb, char* line, uint32_t size, uint32_t timeout_ms)
+{
+    uint32_t start = HAL_GetTick();
+    uint32_t n = 0;
+    uint8_t ch;
+
+    while ((HAL_GetTick() - start) < timeout_ms) {
+        if (lwrb_read(rb, &ch, 1) != 1) {
+            YmodemPort_Idle();
+            continue;
+        }
+        if (ch == '\n') {
+            line[n] = '\0';
+            return 0;
+        }
+        if (ch != '\r' && n < size - 1) {
+            line[n++] = (char)ch;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief  等待主机在新波特率下发送探测串，收到后原样回显
+ * @retval 0=链路正常, -1=超时
+ * @note   切换瞬间可能收到乱码，因此在接收流中搜索探测串而不是要求首字节对齐
+ */
+static int probe_echo(lwrb_t* rb, uint32_t timeout_ms)
+{
+    static const uint8_t probe[] = IAP_BAUD_PROBE;
+    const uint32_t len = sizeof(probe) - 1;
+    uint8_t win[sizeof(probe) - 1] = {0};
+    uint32_t start = HAL_GetTick();
+    uint8_t ch;
+
+    while ((HAL_GetTick() - start) < timeout_ms) {
+        if (lwrb_read(rb, &ch, 1) != 1) {
+            YmodemPort_Idle();
+            continue;
+        }
+        memmove(win, win + 1, len - 1);
+        win[len - 1] = ch;
+        if (memcmp(win, probe, len) == 0) {
+            for (uint32_t i = 0; i < len; i++) {
+                YmodemPort_SendByte(probe[i]);
+            }
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief  与主机协商升级会话的波特率与接收模式
+ * @param  stream: 输出 1=主机请求且获准使用 YMODEM-G
+ * @retval 协商后使用的波特率 (失败时为控制台波特率)
+ */
+static uint32_t baud_negotiate(lwrb_t* rb, int* stream)
+{
+    uint32_t console = YmodemPort_GetBaud();
+    uint32_t clk = YmodemPort_GetUartClock();
+    uint32_t max = clk / 16;            /* 16 倍过采样，BRR >= 16 */
+    uint32_t gmax;
+    char line[32];
+    char* mode;
+
+    *stream = 0;
+    if (max > IAP_BAUD_MAX) max = IAP_BAUD_MAX;
+    /* YMODEM-G 依赖 RAM 窗口吸收扇区擦除期间到达的数据 */
+    gmax = (!IAP_YMODEM_G || !IAP_RAM_STAGE) ? 0 : (max > IAP_YMODEM_G_BAUD_MAX) ? IAP_YMODEM_G_BAUD_MAX : max;
+
+    printf(IAP_BAUD_BANNER " %lu %lu\r\n", (unsigned long)max, (unsigned long)gmax);
+
+    /* 主机未提议 (如普通终端程序)：保持当前速率与经典 YMODEM */
+    if (read_line(rb, line, sizeof(line), IAP_BAUD_OFFER_MS) != 0 ||
+        strncmp(line, "BAUD ", 5) != 0) {
+        return console;
+    }
+
+    uint32_t baud = strtoul(line + 5, &mode, 10);
+    int want_g = (strcmp(mode, " G") == 0);
+
+    /* 只请求 YMODEM-G、不提速 */
+    if (baud == console) {
+        *stream = (want_g && baud <= gmax);
+        printf("BAUD OK %lu%s\r\n", (unsigned long)baud, *stream ? " G" : "");
+        return console;
+    }
+
+    /* 只接受整数分频误差 < 1% 的速率 */
+    uint32_t div = (baud > 0) ? (clk + baud / 2) / baud : 0;
+    uint32_t real = (div > 0) ? clk / div : 0;
+    uint32_t err = (real > baud) ? real - baud : baud - real;
+    if (baud < console || baud > max || div < 16 || err * 100 > baud) {
+        printf("BAUD NO\r\n");
+        return console;
+    }
+
+    int g = (want_g && baud <= gmax);
+    printf("BAUD OK %lu%s\r\n", (unsigned long)baud, g ? " G" : "");
+
+    if (YmodemPort_SetBaud(baud) == 0 && probe_echo(rb, IAP_BAUD_PROBE_MS) == 0) {
+        *stream = g;
+        return baud;
+    }
+
+    /* 探测失败：回退到控制台速率与经典 YMODEM，主机超时后也会回退 */
+    YmodemPort_SetBaud(console);
+    printf("BAUD FAIL\r\n");
+    return console;
+}
 
 /*============================================================================
  * YMODEM 回调函数
  *============================================================================*/
 
+static int on_seek(uint32_t offset)
+{
+    /* 只接受与断点完全一致的续传 (同一镜像、同一偏移) */
+    if (!s_ckpt_valid || offset != s_ckpt.committed) {
+        printf("Resume rejected: offset %lu\r\n", (unsigned long)offset);
+        return -1;
+    }
+    s_resume = 1;
+    return 0;
+}
+
 static int on_begin(const char* name, uint32_t size)
 {
-    printf("Receiving: %s (%lu bytes)\r\n", name, (unsigned long)size); 
-    /* 初始化写入器 */
-    return IAP_Begin(&s_iap_writer, IAP_GetInactiveSlotBase(), size);
+    printf("Receiving: %s (%lu bytes)\r\n", name, (unsigned long)size);
+
+    stage_reset();
+    memset(&s_stats, 0, sizeof(s_stats));
+    IAP_ResetProgStats();
+    s_begin_tick = HAL_GetTick();
+
+#if IAP_RAM_STAGE
+    s_ram_fill = 0;
+    s_ram_spilled = 0;
+    s_ram_begun = 0;
+    s_ram_active = (size > 0);
+    s_ram_spill = 0;
+    if (s_install_mode == IAP_INSTALL_RAM && s_ram_active && !s_resume && size <= IAP_RAM_WIN_SIZE) {
+        s_ckpt_valid = 0;
+        s_stats.ram_staged = 1;
+#if IAP_RAM_PRE_ERASE
+        /* 写入会话现在开始，主循环在接收期间逐个后台擦除所需扇区 */
+        if (IAP_Begin(&s_iap_writer, IAP_GetInactiveSlotBase(), size) != 0) return -1;
+        s_ram_begun = 1;
+#endif
+        return 0;
+    }
+    if (s_ram_active) {
+        /* 窗口作为环形暂存队列，最早的数据边收边写入。RAM 安装方式下是因为窗口
+         * 放不下整个镜像，或续传时 Slot 中已有前半部分：Slot 在校验之前即被改动 */
+        if (s_install_mode == IAP_INSTALL_RAM) {
+            printf("[IAP] %s: RAM window (%lu KB) spills to flash during transfer\r\n",
+                   s_resume ? "Resume" : "Image larger than window",
+                   (unsigned long)(IAP_RAM_WIN_SIZE / 1024u));
+        }
+        s_ram_spill = 1;
+        s_ram_begun = 1;
+    }
+#endif
+
+    if (s_resume) {
+        if (size != s_ckpt.file_size) {
+            printf("Resume rejected: size mismatch\r\n");
+            return -1;
+        }
+        if (IAP_Resume(&s_iap_writer, &s_ckpt) != 0) return -1;
+    } else {
+        /* 发送方从头发送：保留的断点作废，已写入的扇区在重新写入前擦除 */
+        s_ckpt_valid = 0;
+        if (IAP_Begin(&s_iap_writer, IAP_GetInactiveSlotBase(), size) != 0) return -1;
+    }
+
+    /* 不预先擦除：扇区在写入前后台擦除，擦除期间数据留在暂存队列 (窗口) 中 */
+    return 0;
 }
 
-static int on_data(const uint8_t* data, uint32_t len)
+static int on_data_vec(const ymodem_vec_t* vec)
 {
-    /* 写入 Flash */
-    return IAP_Write(&s_iap_writer, data, len);
+    /* 之前的数据包写入失败：拒绝后续数据，由 YMODEM 取消传输 */
+    if (s_stage_err) return -1;
+
+#if IAP_RAM_STAGE
+    if (s_ram_active) {
+        uint32_t len = vec->len[0] + vec->len[1];
+
+        if (s_ram_spill) {
+            /* 窗口满：先同步写出最早的数据 (此时 ACK 被推迟) */
+            while (len > IAP_RAM_WIN_SIZE - (s_ram_fill - s_ram_spilled)) {
+                s_stats.stalls++;
+                if (ram_spill(0) != 0) return -1;
+            }
+        } else if (len > IAP_RAM_WIN_SIZE - s_ram_fill) {
+            return -1;
+        }
+
+        ram_put(vec->seg[0], vec->len[0]);
+        ram_put(vec->seg[1], vec->len[1]);
+        s_stats.packets++;
+
+        /* 深度按 1KB 包计，与暂存队列一致 */
+        uint32_t depth = (s_ram_fill - s_ram_spilled + YMODEM_PACKET_1K - 1u) / YMODEM_PACKET_1K;
+        if (s_ram_spill && depth > s_stats.max_depth) s_stats.max_depth = depth;
+        return 0;
+    }
+#endif
+
+    /* 队列满：先同步写入最早的一包 (此时 ACK 被推迟) */
+    if (s_stage_count == IAP_STAGE_DEPTH) {
+        s_stats.stalls++;
+        if (stage_drain_one(0) != 0) return -1;
+    }
+
+    /* 从环形缓冲区拷贝到暂存队列 (回绕时分两段)，返回后立即 ACK */
+    iap_stage_t* st = &s_stage[s_stage_head];
+    memcpy(st->data, vec->seg[0], vec->len[0]);
+    if (vec->len[1] > 0) {
+        memcpy(st->data + vec->len[0], vec->seg[1], vec->len[1]);
+    }
+    st->len = vec->len[0] + vec->len[1];
+
+    s_stage_head = (s_stage_head + 1) % IAP_STAGE_DEPTH;
+    s_stage_count++;
+    s_stats.packets++;
+    if (s_stage_count > s_stats.max_depth) s_stats.max_depth = s_stage_count;
+
+    return 0;
 }
 
 static int on_end(void)
 {
-    /* 刷新缓冲区 */
-    IAP_End(&s_iap_writer);
+#if IAP_RAM_STAGE
+    /* 镜像在 RAM 中校验通过即 ACK 结束包，写入 Slot 在会话结束后进行 */
+    if (s_ram_active && !s_ram_spill) {
+        s_stats.wire_ms = HAL_GetTick() - s_begin_tick;
+        if (ram_verify() != 0) return -1;
+        s_ram_commit = 1;
+        return 0;
+    }
+
+    /* 写完窗口中剩余的数据，之后与流式写入相同 */
+    if (s_ram_spill && s_install_mode == IAP_INSTALL_RAM) s_stats.ram_spilled = s_ram_spilled;
+    while (s_ram_active && s_ram_spilled < s_ram_fill) {
+        if (ram_spill(0) != 0) {
+            printf("Flash write failed: %d\r\n", s_stage_err);
+            return -1;
+        }
+    }
+#endif
+    /* 写完暂存队列，再刷新写入器缓冲区 */
+    if (stage_flush() != 0) {
+        printf("Flash write failed: %d\r\n", s_stage_err);
+        return -1;
+    }
+    /* 刷新并校验镜像 CRC，不符时不 ACK 结束包，发送方立即得知失败 */
+    int ret = IAP_End(&s_iap_writer);
+    s_stats.wire_ms = HAL_GetTick() - s_begin_tick;
+    if (ret != 0) {
+        printf("Firmware verify failed: %d\r\n", ret);
+        return -1;
+    }
     printf("Firmware written successfully!\r\n");
     return 0;
 }
@@ -47,20 +590,171 @@ static void on_error(int code)
     printf("YMODEM error: %d\r\n", code);
 }
 
+/* 读回校验失败：写入器已把断点退回出错扇区的起始处，传输随后取消 */
+static void on_verify_fail(uint32_t addr, uint32_t reason)
+{
+    static const char* const names[] = { "?", "data mismatch", "ECC corrected", "ECC uncorrectable" };
+
+    printf("Flash verify failed at 0x%08lX: %s\r\n", (unsigned long)addr,
+           names[reason < sizeof(names) / sizeof(names[0]) ? reason : 0]);
+}
+
 /*============================================================================
  * 公共函数
  *============================================================================*/
 
+void IAP_PrepareSlot(void)
+{
+    int ret = IAP_CheckpointLoad(&s_ckpt);
+
+    s_resume = 0;
+    s_ckpt_valid = (ret == 0);
+
+    if (s_ckpt_valid) {
+        /* 保留已写入的数据，等待发送方决定是否续传 */
+        printf("[IAP] Resumable upload found: %lu/%lu bytes\r\n",
+               (unsigned long)s_ckpt.committed, (unsigned long)s_ckpt.file_size);
+    } else if (ret == -4) {
+        printf("[IAP] Previous upload failed to write the slot, upload starts over\r\n");
+    } else if (ret < -1) {
+        /* 有未完成的上传，但镜像头或已写入部分与断点不符：只能从头上传 */
+        printf("[IAP] Checkpoint discarded (%d), upload starts over\r\n", ret);
+    }
+
+    /* 不在这里擦除：写入器按 YMODEM 文件大小只擦除用到的扇区 */
+}
+
 int IAP_UpgradeViaYmodem(lwrb_t* rb, uint32_t timeout_ms)
 {
     ymodem_cb_t callbacks = {
-        .on_begin = on_begin,
-        .on_data  = on_data,
-        .on_end   = on_end,
-        .on_error = on_error
+        .on_seek     = on_seek,
+        .on_begin    = on_begin,
+        .on_data     = NULL,
+        .on_data_vec = on_data_vec,
+        .on_end      = on_end,
+        .on_error    = on_error
     };
-    
-    int result = Ymodem_Receive(rb, &callbacks, timeout_ms);
-    
+    int result;
+    uint32_t console_baud = YmodemPort_GetBaud();
+    uint32_t baud = console_baud;
+    int stream = 0;
+
+    cycle_counter_init();
+    stage_reset();
+    s_resume = 0;
+#if IAP_RAM_STAGE
+    s_ram_active = 0;
+    s_ram_spill = 0;
+    s_ram_begun = 0;
+    s_ram_commit = 0;
+#endif
+    IAP_SetVerifyCallback(on_verify_fail);
+
+#if IAP_BAUD_UPSHIFT
+    baud = baud_negotiate(rb, &stream);
+#endif
+
+    /* 续传握手：在发起 YMODEM 之前告知发送方镜像身份与已写入字节数 */
+    if (s_ckpt_valid) {
+        printf(IAP_RESUME_BANNER " %lu %08lX %lu\r\n",
+               (unsigned long)s_ckpt.file_size, (unsigned long)s_ckpt.img_crc32,
+               (unsigned long)s_ckpt.committed);
+    }
+
+    Ymodem_Init(&s_ym, rb, &callbacks, timeout_ms, stream ? YMODEM_MODE_G : YMODEM_MODE_CRC);
+
+    while ((result = Ymodem_Poll(&s_ym)) == YMODEM_BUSY) {
+#if IAP_RAM_STAGE
+#if IAP_RAM_PRE_ERASE
+        /* 数据在 RAM 中，擦除非活动 Bank 不影响接收 */
+        if (s_ram_begun && !s_ram_spill && !s_stage_err && IAP_EraseNext(&s_iap_writer) < 0) {
+            s_stage_err = -3;
+            Ymodem_Abort(&s_ym, YMODEM_ERR_CALLBACK);
+            continue;
+        }
+#endif
+        /* 窗口作为暂存队列：与暂存队列相同，擦除期间数据留在窗口中 */
+        if (s_ram_spill) {
+            if (s_ram_spilled == s_ram_fill || IAP_EraseBusy()) {
+                YmodemPort_Idle();
+            } else if (ram_spill(1) != 0) {
+                printf("Flash write failed: %d\r\n", s_stage_err);
+                Ymodem_Abort(&s_ym, YMODEM_ERR_CALLBACK);
+            }
+            continue;
+        }
+#endif
+        /* 后台擦除期间不访问 Flash，数据包留在队列中 */
+        if (s_stage_count == 0 || IAP_EraseBusy()) {
+            YmodemPort_Idle();
+            continue;
+        }
+
+        /* 发送方正在传输下一包，此时编程与线路时间重叠 */
+        if (stage_drain_one(1) != 0) {
+            /* 延迟取消：出错的数据包早已 ACK，只能用 CAN 终止发送方 */
+            printf("Flash write failed: %d\r\n", s_stage_err);
+            Ymodem_Abort(&s_ym, YMODEM_ERR_CALLBACK);
+        }
+    }
+
+    /* 传输中止时可能还有后台擦除未结束 */
+    IAP_EraseWait();
+
+    /* 恢复控制台波特率 (等待最后的 ACK/CAN 发送完成) */
+    if (baud != console_baud) {
+        YmodemPort_Delay(20);           /* 给主机留出切换回控制台速率的时间 */
+        YmodemPort_SetBaud(console_baud);
+    }
+
+#if IAP_RAM_STAGE
+    /* 发送方已收到结束包的 ACK：之后的写入失败只能通过返回值与断点状态报告 */
+    if (result == YMODEM_OK && s_ram_commit && ram_commit() != 0) {
+        result = YMODEM_ERR_CALLBACK;
+    }
+#endif
+
+    if (result == YMODEM_OK && s_stats.packets > 0) {
+        uint32_t mhz = SystemCoreClock / 1000000u;
+        const iap_prog_stats_t* ps = IAP_GetProgStats();
+        printf("[IAP] %lu pkts, wire %lu ms, prog %lu us (overlapped %lu us, %lu%%), "
+               "max depth %lu, stalls %lu\r\n",
+               (unsigned long)s_stats.packets, (unsigned long)s_stats.wire_ms,
+               (unsigned long)(s_stats.prog_cycles / mhz),
+               (unsigned long)(s_stats.overlap_cycles / mhz),
+               (unsigned long)(s_stats.prog_cycles ? s_stats.overlap_cycles * 100 / s_stats.prog_cycles : 0),
+               (unsigned long)s_stats.max_depth, (unsigned long)s_stats.stalls);
+        if (s_stats.ram_staged) {
+            printf("[IAP] RAM staged: verified before flash, commit %lu ms\r\n",
+                   (unsigned long)s_stats.commit_ms);
+        }
+        if (s_stats.ram_spilled) {
+            printf("[IAP] RAM window spilled: %lu bytes written during transfer\r\n",
+                   (unsigned long)s_stats.ram_spilled);
+        }
+        printf("[IAP] flash: %lu bytes in %lu bursts, %lu cycles/KB, %lu blank words skipped\r\n",
+               (unsigned long)ps->bytes, (unsigned long)ps->bursts,
+               (unsigned long)(ps->bytes ? ps->cycles * 1024u / ps->bytes : 0),
+               (unsigned long)ps->skipped_words);
+        printf("[IAP] erase: %lu sectors, %lu ms (blocked %lu ms), %lu blank sectors skipped\r\n",
+               (unsigned long)ps->erases, (unsigned long)(ps->erase_cycles / mhz / 1000u),
+               (unsigned long)(ps->erase_wait_cycles / mhz / 1000u),
+               (unsigned long)ps->blank_sectors);
+    }
+
     return (result == YMODEM_OK) ? 0 : result;
 }
+
+void IAP_SetInstallMode(iap_install_mode_t mode)
+{
+#if IAP_RAM_STAGE
+    s_install_mode = mode;
+#else
+    (void)mode;
+#endif
+}
+
+const iap_pipe_stats_t* IAP_GetPipelineStats(void)
+{
+    return &s_stats;
+}
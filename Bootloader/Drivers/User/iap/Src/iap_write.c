@@ -7,18 +7,58 @@
   */
 
 #include "iap_write.h"
+#include "image_header.h"
+#include "trailer.h"
+#include "boot_slots.h"
+#include "crc.h"
+#include "flash_port.h"
 #include "stm32h7xx_hal.h"
 #include <string.h>
 #include <stdio.h>
 
+/*============================================================================
+ * 配置
+ *============================================================================*/
+
+/*
+ * 1 = 批量编程：一次解锁编程多个 flash word，只对写入范围做 Cache 维护
+ * 0 = 逐字编程：每个 flash word 屏蔽中断、整片 Clean/Invalidate D-Cache (旧实现，用于对比)
+ */
+#ifndef IAP_PROG_BURST
+#define IAP_PROG_BURST        1
+#endif
+
+/*
+ * 1 = 写入接近已擦除区域末尾时，后台擦除下一个扇区 (FLASH 中断通知完成)
+ * 0 = 只在首次写入某扇区时同步擦除
+ */
+#ifndef IAP_ERASE_AHEAD
+#define IAP_ERASE_AHEAD       1
+#endif
+
+/*
+ * 距已擦除区域末尾多少字节时开始擦除下一个扇区。擦除期间编程暂停、数据在队列中
+ * 排队；留出半个扇区让队列在两次擦除之间排空，避免连续擦除叠加阻塞
+ */
+#ifndef IAP_ERASE_AHEAD_MARGIN
+#define IAP_ERASE_AHEAD_MARGIN  (IAP_SECTOR_SIZE / 2u)
+#endif
+
+/* 等待后台擦除的超时 (128KB 扇区擦除典型 2s，最大约 4s) */
+#ifndef IAP_ERASE_TIMEOUT_MS
+#define IAP_ERASE_TIMEOUT_MS  6000u
+#endif
+
+/* 1 = 写入器编程后逐字读回比较并检查 ECC 标志 (IAP_PROG_VERIFY) */
+#ifndef IAP_WRITE_VERIFY
+#define IAP_WRITE_VERIFY      1
+#endif
+
 /*============================================================================
  * 内部常量
  *============================================================================*/
 
-/* Slot 布局 (与 Bootloader 保持一致) */
-#define BOOTLOADER_SIZE       0x00020000u   /* Bootloader 占用 128KB */
-#define SLOT_TOTAL_SIZE       0x000E0000u   /* Slot 总大小 896KB (1MB - 128KB) */
-#define TRAILER_SIZE          0x00020000u   /* Trailer 占用 128KB (最后一个扇区) */
+/* Slot 布局 (BOOTLOADER_SIZE / SLOT_TOTAL_SIZE 见 boot_slots.h) */
 #define APP_SLOT_SIZE         (SLOT_TOTAL_SIZE - TRAILER_SIZE)  /* App 可用 768KB */
 
 /* 逻辑地址 */
@@ -30,6 +70,15 @@
 /* 包含 Trailer 的总扇区数 (896KB / 128KB = 7 个扇区) */
 #define SLOT_SECTOR_COUNT     7u
 
+/* 非活动 Slot 的 trailer 扇区 (断点记录写在这里) */
+#define LOGICAL_TRAILER_INACTIVE_BASE  (LOGICAL_SLOT_INACTIVE_BASE + APP_SLOT_SIZE)  /* 0x081E0000 */
+
+/*============================================================================
+ * 外部变量
+ *============================================================================*/
+
+extern CRC_HandleTypeDef hcrc;
+
 /*============================================================================
  * 静态缓冲区 (32B 对齐，用于 Flash 写入)
  *============================================================================*/
@@ -37,96 +86,378 @@
 static uint8_t s_flash_write_buf[32] __attribute__((aligned(32)));
 
 /*============================================================================
- * 内部函数
+ * 统计
  *============================================================================*/
 
-/**
- * @brief  获取地址对应的 Flash Bank 编号
- */
-static uint32_t get_flash_bank(uint32_t addr)
-{
-    return (addr >= FLASH_BANK2_BASE) ? FLASH_BANK_2 : FLASH_BANK_1;
-}
+static iap_prog_stats_t s_prog_stats;
+
+/*============================================================================
+ * 写入校验
+ *============================================================================*/
+
+static iap_verify_cb_t s_verify_cb;
+static uint32_t s_verify_addr;          /* 最近一次校验失败的 flash word 地址 */
+
+#if IAP_WRITE_VERIFY
+#define WRITE_PROG_FLAGS      IAP_PROG_VERIFY
+#else
+#define WRITE_PROG_FLAGS      0u
+#endif
+
+/*============================================================================
+ * 后台擦除状态机
+ *
+ *   IDLE --erase_start--> BUSY --FLASH 中断--> DONE / ERROR --erase_wait--> IDLE
+ *
+ * 中断中只记录结果；Cache 维护和统计在线程上下文的 erase_wait 中完成。
+ * BUSY 期间同一 Bank 不能编程，读访问会阻塞总线直到擦除结束
+ *============================================================================*/
+
+typedef enum {
+    IAP_ERASE_IDLE = 0,     /* 无擦除 */
+    IAP_ERASE_BUSY,         /* 擦除进行中 */
+    IAP_ERASE_DONE,         /* 擦除完成，等待收尾 */
+    IAP_ERASE_ERROR         /* 擦除失败，等待收尾 */
+} iap_erase_state_t;
+
+static volatile iap_erase_state_t s_erase_state;
+static volatile uint32_t s_erase_t1;    /* 完成时的 DWT 周期数 (中断中记录) */
+static volatile uint32_t s_erase_err;   /* 出错时 FlashPort 报告的扇区/地址 */
+static uint32_t s_erase_addr;           /* 正在擦除的扇区地址 */
+static uint32_t s_erase_t0;             /* 开始时的 DWT 周期数 */
+static uint8_t  s_flash_fault;          /* 1=擦除超时后 Bank 仍忙，复位前拒绝一切 Flash 操作 */
+
+/*============================================================================
+ * 内部函数
+ *============================================================================*/
 
 /**
- * @brief  获取地址对应的 Flash Sector 编号 (0-7)
- * @note   STM32H7 每个 Bank 有 8 个 128KB 扇区
+ * @brief  后台擦除完成回调 (FLASH 中断上下文)
  */
-static uint32_t get_flash_sector(uint32_t addr)
+static void erase_done(int status, uint32_t error)
 {
-    uint32_t bank_base = (addr >= FLASH_BANK2_BASE) ? FLASH_BANK2_BASE : FLASH_BANK1_BASE;
-    uint32_t offset = addr - bank_base;
-    return offset / IAP_SECTOR_SIZE;
+    /* 已被 erase_wait 判为超时：迟到的完成通知不再改写结果 */
+    if (s_erase_state != IAP_ERASE_BUSY) return;
+    
+    s_erase_err   = error;
+    s_erase_t1    = DWT->CYCCNT;
+    s_erase_state = (status == 0) ? IAP_ERASE_DONE : IAP_ERASE_ERROR;
 }
 
 /**
- * @brief  擦除单个 Flash 扇区
+ * @brief  启动单个扇区的后台擦除
  * @param  addr: 扇区内任意地址
- * @retval HAL_OK=成功
+ * @retval 0=已启动 (或扇区本来就是空的，无需擦除), -1=启动失败
+ * @note   调用前状态必须为 IAP_ERASE_IDLE；擦除期间中断保持开启
  */
-static HAL_StatusTypeDef erase_sector_at(uint32_t addr)
+static int erase_start(uint32_t addr)
 {
-    FLASH_EraseInitTypeDef erase_cfg = {0};
-    uint32_t sector_error = 0;
-    HAL_StatusTypeDef status;
-    
-    erase_cfg.TypeErase    = FLASH_TYPEERASE_SECTORS;
-    erase_cfg.Banks        = get_flash_bank(addr);
-    erase_cfg.Sector       = get_flash_sector(addr);
-    erase_cfg.NbSectors    = 1;
-    erase_cfg.VoltageRange = FLASH_VOLTAGE_RANGE_3;  /* 2.7V - 3.6V */
-    
-    /* 禁用中断，清理 D-Cache */
-    __disable_irq();
-    SCB_CleanDCache();
+    addr &= ~(IAP_SECTOR_SIZE - 1u);
     
-    HAL_FLASH_Unlock();
-    
-    status = HAL_FLASHEx_Erase(&erase_cfg, &sector_error);
+    /* 空扇区 (如上次只写了一部分的 Slot 尾部) 跳过擦除，状态保持 IDLE */
+    if (Boot_SectorIsBlank(addr)) {
+        s_prog_stats.blank_sectors++;
+        return 0;
+    }
     
-    HAL_FLASH_Lock();
+    if (s_flash_fault) return -1;
     
-    /* 清理并使 D-Cache 无效，恢复中断 */
-    SCB_CleanInvalidateDCache();
-    __enable_irq();
+    s_erase_addr  = addr;
+    s_erase_t0    = DWT->CYCCNT;
+    s_erase_state = IAP_ERASE_BUSY;
     
-    if (status != HAL_OK) {
-        printf("[IAP] Erase failed: bank=%lu, sector=%lu, error=0x%08lX\r\n",
-               (unsigned long)erase_cfg.Banks, (unsigned long)erase_cfg.Sector,
-               (unsigned long)sector_error);
+    if (FlashPort_EraseStart(addr, erase_done) != 0) {
+        s_erase_state = IAP_ERASE_IDLE;
+        printf("[IAP] Erase start failed: sector at 0x%08lX\r\n", (unsigned long)addr);
+        return -1;
     }
+    return 0;
+}
+
+/**
+ * @brief  擦除超时：硬件可能仍在擦除，HAL 的过程状态也未结束
+ * @note   先等硬件结束并由 FlashPort 代替中断收尾，才报告失败；
+ *         再等一个超时仍不结束时锁死，复位前不再访问 Flash
+ */
+static void erase_timeout(void)
+{
+    s_erase_err = 0xFFFFFFFFu;
+    s_erase_t1  = DWT->CYCCNT;
     
-    return status;
+    if (FlashPort_EraseCancel(IAP_ERASE_TIMEOUT_MS) != 0) {
+        s_flash_fault = 1;
+        printf("[IAP] Flash still busy after erase timeout, writes disabled until reset\r\n");
+    }
 }
 
 /**
- * @brief  写入 32B flash word
- * @param  addr: 目标地址 (必须 32B 对齐)
- * @param  data: 源数据 (32B)
- * @retval HAL_OK=成功
+ * @brief  等待后台擦除结束并收尾 (丢弃扇区的旧 Cache 行、统计)
+ * @retval 0=无擦除或擦除成功, -1=擦除失败、超时或 Flash 已锁死
+ * @note   阻塞等待的时间计入 erase_wait_cycles (即擦除出现在关键路径上的部分)；
+ *         等待期间睡眠到 FLASH 中断 (或 SysTick)，超过 IAP_ERASE_TIMEOUT_MS
+ *         按失败处理 (error=0xFFFFFFFF)。所有编程/擦除之前都经过这里
  */
-static HAL_StatusTypeDef write_flash_word(uint32_t addr, const uint8_t* data)
+static int erase_wait(void)
 {
-    HAL_StatusTypeDef status;
+    if (s_flash_fault) return -1;
+    if (s_erase_state == IAP_ERASE_IDLE) return 0;
     
-    /* 复制到对齐缓冲区 */
-    memcpy(s_flash_write_buf, data, IAP_FLASH_WORD_SIZE);
+    if (s_erase_state == IAP_ERASE_BUSY) {
+        uint32_t t0 = DWT->CYCCNT;
+        uint32_t tick0 = HAL_GetTick();
+        
+        while (s_erase_state == IAP_ERASE_BUSY) {
+            __WFI();                        /* 睡眠到 FLASH 完成中断 (或 SysTick) */
+            /* 可在此处喂狗 IWDG->KR = 0xAAAA; */
+            if (HAL_GetTick() - tick0 > IAP_ERASE_TIMEOUT_MS) {
+                __disable_irq();
+                int timed_out = (s_erase_state == IAP_ERASE_BUSY);
+                if (timed_out) s_erase_state = IAP_ERASE_ERROR;
+                __enable_irq();
+                if (timed_out) erase_timeout();
+            }
+        }
+        s_prog_stats.erase_wait_cycles += DWT->CYCCNT - t0;
+    }
     
-    /* 禁用中断，清理 D-Cache */
-    __disable_irq();
-    SCB_CleanDCache();
+    FlashPort_InvalidateCache(s_erase_addr, IAP_SECTOR_SIZE);
     
-    HAL_FLASH_Unlock();
+    s_prog_stats.erases++;
+    s_prog_stats.erase_cycles += s_erase_t1 - s_erase_t0;
     
-    status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_FLASHWORD, addr, (uint32_t)s_flash_write_buf);
+    int ok = (s_erase_state == IAP_ERASE_DONE);
+    s_erase_state = IAP_ERASE_IDLE;
     
-    HAL_FLASH_Lock();
+    if (!ok) {
+        printf("[IAP] Erase failed: sector at 0x%08lX, error=0x%08lX\r\n",
+               (unsigned long)s_erase_addr, (unsigned long)s_erase_err);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief  擦除单个 Flash 扇区 (启动后台擦除并等待完成)
+ * @param  addr: 扇区内任意地址
+ * @retval 0=成功, -1=失败
+ */
+static int erase_sector_at(uint32_t addr)
+{
+    if (erase_wait() != 0 || erase_start(addr) != 0 || erase_wait() != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief  以指定值为初值续算 CRC32 (与 Boot_CalcImageCRC 相同的算法)
+ * @param  crc: 前一段的 CRC 中间值 (从头计算时为 0xFFFFFFFF)
+ * @param  data: 数据地址 (Flash 或 RAM，4 字节对齐)
+ * @param  len: 数据长度 (4 的整数倍)
+ * @retval 新的 CRC 中间值
+ */
+static uint32_t crc32_continue(uint32_t crc, const uint32_t* data, uint32_t len)
+{
+    /* 临时改写 INIT 寄存器，复位 DR 后即从 crc 继续累加 */
+    hcrc.Instance->INIT = crc;
+    __HAL_CRC_DR_RESET(&hcrc);
+    HAL_CRC_Accumulate(&hcrc, (uint32_t *)data, len / 4);
+    crc = hcrc.Instance->DR;
+    hcrc.Instance->INIT = 0xFFFFFFFFu;  /* 恢复默认初值 */
+
+    return crc;
+}
+
+/**
+ * @brief  检查 32B 区域是否为空 (全 0xFF)
+ */
+static int word_is_erased(const void* p)
+{
+    const uint32_t* w = (const uint32_t*)p;
+    for (int i = 0; i < 8; i++) {
+        if (w[i] != 0xFFFFFFFFu) return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief  检查源数据中的 32B 是否全为 0xFF (不要求对齐)
+ */
+static int data_is_erased(const uint8_t* p)
+{
+    uint32_t w[IAP_FLASH_WORD_SIZE / 4u];
+    memcpy(w, p, sizeof(w));
+    return word_is_erased(w);
+}
+
+/**
+ * @brief  写入连续的 flash word，不需要编程的字跳过
+ * @param  addr: 目标地址 (32B 对齐)
+ * @param  data: 源数据
+ * @param  len: 数据长度 (32 的整数倍)
+ * @retval 0=成功, -2=编程失败, -3=读回校验失败 (含目标已有不同内容)
+ * @note   源数据全 0xFF 且目标已擦除的字 (镜像中的填充区) 不编程。
+ *         续传时断点之后的部分数据可能已经写入 (断点只是定期记录)，
+ *         而 Flash 不允许对未擦除的字重复编程；内容不同 (如掉电时编程到一半
+ *         的字) 时无法原地写入，与读回校验失败相同处理，由调用方退回断点。
+ *         连续需要编程的字合并为一次批量编程
+ */
+static int program_range(uint32_t addr, const uint8_t* data, uint32_t len)
+{
+    uint32_t run = 0;   /* 待编程的连续字节数 */
+
+    for (uint32_t off = 0; off < len; off += IAP_FLASH_WORD_SIZE) {
+        const void* dst = (const void*)(addr + off);
+        int erased = word_is_erased(dst);
+        
+        if (erased && !data_is_erased(data + off)) {
+            run += IAP_FLASH_WORD_SIZE;
+            continue;
+        }
+        if (run > 0) {
+            int ret = IAP_ProgramWords(addr + off - run, data + off - run, run, WRITE_PROG_FLAGS);
+            if (ret != 0) return ret;
+        }
+        run = 0;
+        if (erased) {
+            s_prog_stats.skipped_words++;
+            continue;
+        }
+        if (memcmp(dst, data + off, IAP_FLASH_WORD_SIZE) != 0) {
+            s_prog_stats.verify_errors++;
+            s_verify_addr = addr + off;
+            printf("[IAP] Word at 0x%08lX already programmed with different data\r\n",
+                   (unsigned long)(addr + off));
+            if (s_verify_cb) s_verify_cb(addr + off, IAP_VERIFY_MISMATCH);
+            return -3;
+        }
+    }
+
+    if (run > 0) {
+        return IAP_ProgramWords(addr + len - run, data + len - run, run, WRITE_PROG_FLAGS);
+    }
+    return 0;
+}
+
+/**
+ * @brief  在 trailer 扇区追加一条 32B 记录 (断点或会话标记)
+ * @retval 0=成功, -1=扇区已满, -2=写入失败
+ */
+static int ckpt_append(const iap_ckpt_t* ck)
+{
+    uint32_t end = trailer_find_end(LOGICAL_TRAILER_INACTIVE_BASE);
+
+    if (end >= TR_REC_COUNT) {
+        return -1;
+    }
+    /* 记录为 packed 结构，先复制到对齐缓冲区 */
+    memcpy(s_flash_write_buf, ck, sizeof(*ck));
+    return (IAP_ProgramWords(LOGICAL_TRAILER_INACTIVE_BASE + end * sizeof(*ck), s_flash_write_buf,
+                             sizeof(*ck), WRITE_PROG_FLAGS) == 0) ? 0 : -2;
+}
+
+/**
+ * @brief  累加新写入 Flash 的镜像体 CRC32
+ * @retval 0=成功, -4=镜像头无效
+ * @note   从 Flash 读回而不是使用源数据，编程错误也会反映在结果中。
+ *         只累加完整的字，尾部不足 4 字节的部分在 IAP_End 中补 0xFF 处理
+ */
+static int crc_update(iap_writer_t* w)
+{
+    const image_hdr_t* hdr = (const image_hdr_t*)w->base;
+
+    /* 镜像头写入 Flash 后才知道镜像体范围 */
+    if (w->addr < w->base + HDR_SIZE) return 0;
+
+    if (w->img_end == 0) {
+        if (hdr->magic != IMG_HDR_MAGIC || HDR_SIZE + hdr->img_size > w->limit - w->base) {
+            printf("[IAP] Invalid image header (magic=0x%08lX, img_size=%lu)\r\n",
+                   (unsigned long)hdr->magic, (unsigned long)hdr->img_size);
+            return -4;
+        }
+        w->img_end = w->base + HDR_SIZE + hdr->img_size;
+    }
+
+    uint32_t end = w->img_end & ~3u;
+    if (end > w->addr) end = w->addr;
+
+    if (end > w->crc_addr) {
+        w->run_crc  = crc32_continue(w->run_crc, (const uint32_t*)w->crc_addr, end - w->crc_addr);
+        w->crc_addr = end;
+    }
+    return 0;
+}
+
+/**
+ * @brief  记录当前写入进度
+ * @param  status: IAP_CKPT_ACTIVE / IAP_CKPT_DONE / IAP_CKPT_BAD_CRC / IAP_CKPT_FAILED
+ * @retval 0=成功, <0=未记录
+ * @note   镜像头 (含 img_crc32) 写入 Flash 之后才能记录，否则无法确认镜像身份
+ */
+static int ckpt_save(iap_writer_t* w, uint32_t status)
+{
+    const image_hdr_t* hdr = (const image_hdr_t*)w->base;
+    iap_ckpt_t ck;
+
+    /* 下一次记录点 */
+    while (w->ckpt_next != 0 && w->ckpt_next <= w->addr) {
+        w->ckpt_next += IAP_CKPT_INTERVAL;
+    }
+
+    if (w->img_end == 0) {
+        return -1;
+    }
+
+    memset(&ck, 0xFF, sizeof(ck));
+    ck.magic     = IAP_CKPT_MAGIC;
+    ck.file_size = w->limit - w->base;
+    ck.img_crc32 = hdr->img_crc32;
+    ck.committed = w->addr - w->base;
+    ck.run_crc   = w->run_crc;
+    ck.status    = status;
+    ck.crc_len   = w->crc_addr - (w->base + HDR_SIZE);
+
+    int ret = ckpt_append(&ck);
+    if (ret != 0) {
+        printf("[IAP] Checkpoint write failed: %d\r\n", ret);
+    }
+    return ret;
+}
+
+/**
+ * @brief  读回校验失败后，把断点退回到出错字所在扇区的起始处
+ * @param  bad_addr: 出错的 flash word 地址
+ * @note   出错的字不能原地重写，必须重新擦除所在扇区。IAP_Resume 会在写入前
+ *         擦除断点之后的扇区，因此重新追加扇区起始处的那条断点记录 (断点间隔
+ *         整除扇区大小，正常情况下该记录存在)，下次续传只需重传这一个扇区。
+ *         找不到记录 (如出错的是第一个扇区) 时标记为不可续传
+ */
+static void ckpt_rollback(iap_writer_t* w, uint32_t bad_addr)
+{
+    const image_hdr_t* hdr = (const image_hdr_t*)w->base;
+    uint32_t target = (bad_addr - LOGICAL_SLOT_INACTIVE_BASE) & ~(IAP_SECTOR_SIZE - 1u);
+    const iap_ckpt_t* found = NULL;
     
-    /* 清理并使 D-Cache 无效，恢复中断 */
-    SCB_CleanInvalidateDCache();
-    __enable_irq();
+    if (w->img_end != 0) {
+        /* 从末尾向前找最后一条匹配的记录 */
+        for (uint32_t i = trailer_find_end(LOGICAL_TRAILER_INACTIVE_BASE); i > 0 && !found; i--) {
+            const iap_ckpt_t* r = (const iap_ckpt_t*)(LOGICAL_TRAILER_INACTIVE_BASE + (i - 1) * sizeof(*r));
+            if (r->magic == IAP_CKPT_MAGIC && r->status == IAP_CKPT_ACTIVE &&
+                r->img_crc32 == hdr->img_crc32 && r->file_size == w->limit - w->base &&
+                r->committed == target) {
+                found = r;
+            }
+        }
+    }
     
-    return status;
+    if (found) {
+        iap_ckpt_t ck = *found;
+        if (ckpt_append(&ck) == 0) {
+            printf("[IAP] Resume point moved back to %lu\r\n", (unsigned long)target);
+            return;
+        }
+    }
+    ckpt_save(w, IAP_CKPT_FAILED);
 }
 
 /*============================================================================
@@ -172,7 +503,7 @@ static int IAP_EraseSectorRaw(uint32_t sector_index)
     printf("[IAP] Erasing sector %lu at 0x%08lX...\r\n", 
            (unsigned long)sector_index, (unsigned long)sector_addr);
     
-    if (erase_sector_at(sector_addr) != HAL_OK) {
+    if (erase_sector_at(sector_addr) != 0) {
         return -2;
     }
     
@@ -214,6 +545,22 @@ int IAP_EraseSlot(void)
     return 0;
 }
 
+/**
+ * @brief  后台擦除是否进行中
+ */
+int IAP_EraseBusy(void)
+{
+    return s_erase_state == IAP_ERASE_BUSY;
+}
+
+/**
+ * @brief  等待后台擦除结束
+ */
+int IAP_EraseWait(void)
+{
+    return erase_wait();
+}
+
 /**
  * @brief  擦除指定地址范围
  */
@@ -254,6 +601,195 @@ int IAP_EraseRange(uint32_t start_addr, uint32_t size)
  * 公共函数实现 - 写入操作
  *============================================================================*/
 
+/**
+ * @brief  读回比较刚编程的区域，并检查读回期间的 ECC 标志
+ * @param  reason: 输出失败原因 (IAP_VERIFY_xxx)
+ * @retval 0=通过, 否则为出错 flash word 的地址
+ * @note   调用前写入范围的 D-Cache 已失效，读到的是 Flash 实际内容。
+ *         双位 ECC 错误在读访问时还会产生总线错误，需由 BusFault 处理
+ */
+static uint32_t verify_range(uint32_t addr, const uint8_t* data, uint32_t len, uint32_t* reason)
+{
+    uint32_t ecc_addr = 0;
+    
+    for (uint32_t off = 0; off < len; off += IAP_FLASH_WORD_SIZE) {
+        const volatile uint64_t* f = (const volatile uint64_t*)(addr + off);
+        uint64_t src[IAP_FLASH_WORD_SIZE / 8u];
+        
+        memcpy(src, data + off, sizeof(src));
+        if (f[0] != src[0] || f[1] != src[1] || f[2] != src[2] || f[3] != src[3]) {
+            *reason = IAP_VERIFY_MISMATCH;
+            return addr + off;
+        }
+    }
+    
+    /* 读回内容正确但经过了纠错：存储单元余量不足，同样视为失败 */
+    switch (FlashPort_EccCheck(addr, &ecc_addr)) {
+    case FLASH_PORT_ECC_SINGLE:
+        *reason = IAP_VERIFY_ECC_SINGLE;
+        return ecc_addr;
+    case FLASH_PORT_ECC_DOUBLE:
+        *reason = IAP_VERIFY_ECC_DOUBLE;
+        return ecc_addr;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * @brief  批量编程连续的 flash word
+ */
+int IAP_ProgramWords(uint32_t addr, const uint8_t* data, uint32_t len, uint32_t flags)
+{
+    int status;
+    uint32_t slot_base = LOGICAL_SLOT_INACTIVE_BASE;
+    uint32_t slot_end  = slot_base + SLOT_TOTAL_SIZE;
+
+    if (!data || (addr % IAP_FLASH_WORD_SIZE) != 0 || (len % IAP_FLASH_WORD_SIZE) != 0 ||
+        addr < slot_base || addr + len > slot_end || addr + len < addr) {
+        return -1;
+    }
+    if (len == 0) return 0;
+
+    /* 同一 Bank 的后台擦除结束前不能编程 */
+    if (erase_wait() != 0) return -2;
+
+    uint32_t t0 = DWT->CYCCNT;
+
+    /* 编程前清除 ECC 标志，之后置位的标志来自读回 */
+    if (flags & IAP_PROG_VERIFY) FlashPort_EccClear(addr);
+
+#if IAP_PROG_BURST
+    /* 一次解锁编程整段，只丢弃写入范围的旧 Cache 行 */
+    status = FlashPort_Program(addr, data, len, (flags & IAP_PROG_IRQ_OFF) ? FLASH_PORT_IRQ_OFF : 0);
+#else
+    /* 逐字屏蔽中断、整片 Clean/Invalidate D-Cache */
+    status = 0;
+    for (uint32_t off = 0; off < len && status == 0; off += IAP_FLASH_WORD_SIZE) {
+        status = FlashPort_Program(addr + off, data + off, IAP_FLASH_WORD_SIZE,
+                                   FLASH_PORT_IRQ_OFF | FLASH_PORT_CACHE_ALL);
+    }
+#endif
+
+    if (status != 0) {
+        s_prog_stats.cycles += DWT->CYCCNT - t0;
+        printf("[IAP] Program failed in 0x%08lX - 0x%08lX\r\n",
+               (unsigned long)addr, (unsigned long)(addr + len - 1));
+        return -2;
+    }
+
+    uint32_t reason = 0;
+    uint32_t bad = (flags & IAP_PROG_VERIFY) ? verify_range(addr, data, len, &reason) : 0;
+
+    s_prog_stats.bursts++;
+    s_prog_stats.bytes  += len;
+    s_prog_stats.cycles += DWT->CYCCNT - t0;
+
+    if (bad != 0) {
+        s_prog_stats.verify_errors++;
+        s_verify_addr = bad;
+        printf("[IAP] Verify failed at 0x%08lX (reason %lu)\r\n",
+               (unsigned long)bad, (unsigned long)reason);
+        if (s_verify_cb) s_verify_cb(bad, reason);
+        return -3;
+    }
+    return 0;
+}
+
+void IAP_SetVerifyCallback(iap_verify_cb_t cb)
+{
+    s_verify_cb = cb;
+}
+
+const iap_prog_stats_t* IAP_GetProgStats(void)
+{
+    return &s_prog_stats;
+}
+
+void IAP_ResetProgStats(void)
+{
+    memset(&s_prog_stats, 0, sizeof(s_prog_stats));
+}
+
+/**
+ * @brief  擦除 [w->erased_end, end) 覆盖的扇区 (erased_end 按扇区推进)
+ * @retval 0=成功, -1=擦除失败
+ * @note   只擦除 App 区域，trailer 扇区由 IAP_End 在提交时擦除
+ */
+static int erase_until(iap_writer_t* w, uint32_t end)
+{
+    /* erased_end 包含后台擦除中的扇区 */
+    if (erase_wait() != 0) return -1;
+    
+    while (w->erased_end < end) {
+        if (IAP_EraseSector((w->erased_end - LOGICAL_SLOT_INACTIVE_BASE) / IAP_SECTOR_SIZE) != 0) {
+            return -1;
+        }
+        w->erased_end += IAP_SECTOR_SIZE;
+    }
+    return 0;
+}
+
+/**
+ * @brief  写入位置接近已擦除区域末尾时，后台擦除下一个扇区
+ * @note   擦除期间调用方应暂停写入 (IAP_EraseBusy)，数据在 RAM 中排队；
+ *         只擦除到文件结束所在的扇区
+ */
+static void erase_ahead(iap_writer_t* w)
+{
+#if IAP_ERASE_AHEAD
+    uint32_t end = (w->limit + IAP_SECTOR_SIZE - 1u) & ~(IAP_SECTOR_SIZE - 1u);
+    
+    /* 上一次擦除仍在进行，或失败结果留给下一次 IAP_Write 报告 */
+    if (s_erase_state == IAP_ERASE_BUSY || s_erase_state == IAP_ERASE_ERROR) return;
+    erase_wait();
+    if (w->erased_end >= end || w->addr + IAP_ERASE_AHEAD_MARGIN < w->erased_end) return;
+    
+    if (erase_start(w->erased_end) == 0) {
+        w->erased_end += IAP_SECTOR_SIZE;
+    }
+#else
+    (void)w;
+#endif
+}
+
+/**
+ * @brief  处理 program_range 的失败
+ * @retval -6=读回校验失败或目标已有不同内容 (断点已退回), -3=其他写入失败
+ */
+static int write_failed(iap_writer_t* w, int ret)
+{
+    printf("[IAP] Write failed at 0x%08lX\r\n", (unsigned long)w->addr);
+    if (ret != -3) return -3;
+    
+    ckpt_rollback(w, s_verify_addr);
+    return -6;
+}
+
+/**
+ * @brief  写入会话开始标记
+ * @note   Bootloader 的启动校验记录 (tr_verify_t) 之后出现其他记录即作废，
+ *         写入与原镜像头相同的镜像时也不会沿用旧的校验结果。trailer 已满时
+ *         擦除：其中的记录属于即将被覆盖的旧镜像
+ */
+static int session_mark(const iap_writer_t* w)
+{
+    iap_ckpt_t mark;
+
+    memset(&mark, 0xFF, sizeof(mark));
+    mark.magic     = IAP_SESSION_MAGIC;
+    mark.file_size = w->limit - w->base;
+
+    int ret = ckpt_append(&mark);
+    if (ret == -1 && IAP_EraseSectorRaw(APP_SECTOR_COUNT) == 0) {
+        ret = ckpt_append(&mark);
+    }
+    if (ret != 0) {
+        printf("[IAP] Session mark failed: %d\r\n", ret);
+    }
+    return ret;
+}
+
 /**
  * @brief  开始 IAP 写入会话
  */
@@ -282,12 +818,42 @@ int IAP_Begin(iap_writer_t* w, uint32_t dst_base, uint32_t dst_size)
     w->fill  = 0;
     memset(w->buf32, 0xFF, sizeof(w->buf32));  /* 填充 0xFF */
     
+    /* 镜像体 CRC 从镜像头之后开始累加 */
+    w->ckpt_next = dst_base + IAP_CKPT_INTERVAL;
+    w->img_end   = 0;
+    w->crc_addr  = dst_base + HDR_SIZE;
+    w->run_crc   = 0xFFFFFFFFu;
+    
+    /* 改动 Slot 之前先作废启动校验记录 */
+    if (session_mark(w) != 0) return -4;
+    
+    /* 不预先擦除：首次写入某扇区前再擦除 (第一个扇区立即开始后台擦除) */
+    w->erased_end = slot_base + ((dst_base - slot_base) & ~(IAP_SECTOR_SIZE - 1u));
+    erase_ahead(w);
+    
     printf("[IAP] Write session started: 0x%08lX - 0x%08lX\r\n",
            (unsigned long)w->base, (unsigned long)w->limit);
     
     return 0;
 }
 
+/**
+ * @brief  后台擦除写入会话的下一个扇区 (不等待)
+ */
+int IAP_EraseNext(iap_writer_t* w)
+{
+    if (!w) return -1;
+    if (s_erase_state == IAP_ERASE_BUSY) return 1;
+    if (erase_wait() != 0) return -2;
+    
+    uint32_t end = (w->limit + IAP_SECTOR_SIZE - 1u) & ~(IAP_SECTOR_SIZE - 1u);
+    if (w->erased_end >= end) return 0;
+    
+    if (erase_start(w->erased_end) != 0) return -2;
+    w->erased_end += IAP_SECTOR_SIZE;
+    return 1;
+}
+
 /**
  * @brief  写入数据
  */
@@ -295,6 +861,9 @@ int IAP_Write(iap_writer_t* w, const uint8_t* data, uint32_t len)
 {
     if (!w || !data) return -1;
     
+    /* 后台擦除结束前不能访问非活动 Bank */
+    if (erase_wait() != 0) return -3;
+    
     while (len > 0) {
         /* 检查是否超出边界 */
         if (w->addr >= w->limit && w->fill == 0) {
@@ -302,28 +871,51 @@ int IAP_Write(iap_writer_t* w, const uint8_t* data, uint32_t len)
             return -2;
         }
         
-        /* 填充缓冲区 */
-        uint32_t space = IAP_FLASH_WORD_SIZE - w->fill;
-        uint32_t copy_len = (len < space) ? len : space;
-        
-        memcpy(&w->buf32[w->fill], data, copy_len);
-        w->fill += copy_len;
-        data    += copy_len;
-        len     -= copy_len;
-        
-        /* 缓冲区满，写入 Flash */
-        if (w->fill == IAP_FLASH_WORD_SIZE) {
-            if (write_flash_word(w->addr, w->buf32) != HAL_OK) {
-                printf("[IAP] Write failed at 0x%08lX\r\n", (unsigned long)w->addr);
-                return -3;
-            }
+        /* 缓冲区为空：整字部分直接从源数据批量编程 (不越过下一个断点) */
+        if (w->fill == 0 && len >= IAP_FLASH_WORD_SIZE) {
+            uint32_t n = len & ~(IAP_FLASH_WORD_SIZE - 1u);
+            uint32_t room = ((w->limit + IAP_FLASH_WORD_SIZE - 1u) & ~(IAP_FLASH_WORD_SIZE - 1u)) - w->addr;
+            if (n > room) n = room;
+            if (w->ckpt_next != 0 && n > w->ckpt_next - w->addr) n = w->ckpt_next - w->addr;
+            
+            if (erase_until(w, w->addr + n) != 0) return -3;
+            int ret = program_range(w->addr, data, n);
+            if (ret != 0) return write_failed(w, ret);
+            w->addr += n;
+            data    += n;
+            len     -= n;
+        } else {
+            /* 填充缓冲区 */
+            uint32_t space = IAP_FLASH_WORD_SIZE - w->fill;
+            uint32_t copy_len = (len < space) ? len : space;
+            
+            memcpy(&w->buf32[w->fill], data, copy_len);
+            w->fill += copy_len;
+            data    += copy_len;
+            len     -= copy_len;
             
+            /* 缓冲区未满，等待更多数据 */
+            if (w->fill < IAP_FLASH_WORD_SIZE) continue;
+            
+            if (erase_until(w, w->addr + IAP_FLASH_WORD_SIZE) != 0) return -3;
+            int ret = program_range(w->addr, w->buf32, IAP_FLASH_WORD_SIZE);
+            if (ret != 0) return write_failed(w, ret);
             w->addr += IAP_FLASH_WORD_SIZE;
             w->fill = 0;
             memset(w->buf32, 0xFF, sizeof(w->buf32));  /* 重置为 0xFF */
         }
+        
+        /* 到达断点间隔，记录进度 (失败不影响写入，只是无法续传) */
+        if (w->ckpt_next != 0 && w->addr >= w->ckpt_next) {
+            if (crc_update(w) != 0) return -4;
+            ckpt_save(w, IAP_CKPT_ACTIVE);
+        }
     }
     
+    /* 累加本次写入的镜像体 CRC */
+    if (crc_update(w) != 0) return -4;
+    
+    erase_ahead(w);
     return 0;
 }
 
@@ -333,13 +925,16 @@ int IAP_Write(iap_writer_t* w, const uint8_t* data, uint32_t len)
 int IAP_End(iap_writer_t* w)
 {
     if (!w) return -1;
+    if (erase_wait() != 0) return -2;
     
     /* 如果缓冲区有剩余数据，补齐 0xFF 后写入 */
     if (w->fill > 0) {
         /* buf32 已经预填充 0xFF，直接写入 */
-        if (write_flash_word(w->addr, w->buf32) != HAL_OK) {
-            printf("[IAP] Final write failed at 0x%08lX\r\n", (unsigned long)w->addr);
-            return -2;
+        if (erase_until(w, w->addr + IAP_FLASH_WORD_SIZE) != 0) return -2;
+        int ret = program_range(w->addr, w->buf32, IAP_FLASH_WORD_SIZE);
+        if (ret != 0) {
+            ret = write_failed(w, ret);
+            return (ret == -6) ? ret : -2;
         }
         
         w->addr += IAP_FLASH_WORD_SIZE;
@@ -349,5 +944,134 @@ int IAP_End(iap_writer_t* w)
     printf("[IAP] Write session complete: %lu bytes written\r\n",
            (unsigned long)(w->addr - w->base));
     
+    if (crc_update(w) != 0 || w->img_end == 0) {
+        return -4;
+    }
+    
+    /* 尾部不足 4 字节：与 Boot_CalcImageCRC 相同，补 0xFF 凑成一个字 */
+    uint32_t tail = w->img_end & 3u;
+    if (tail) {
+        uint32_t last = 0xFFFFFFFFu;
+        memcpy(&last, (const void*)w->crc_addr, tail);
+        w->run_crc  = crc32_continue(w->run_crc, &last, 4);
+        w->crc_addr = w->img_end;
+    }
+    
+    const image_hdr_t* hdr = (const image_hdr_t*)w->base;
+    int ok = (w->run_crc == hdr->img_crc32);
+    
+    /* 提交：trailer 中是旧镜像的状态记录和本次的断点，此时才擦除。
+     * 擦除失败不影响镜像本身 (启动时按 img_crc32 区分记录归属)，只是记录可能写不进去 */
+    if (ok && IAP_EraseSectorRaw(APP_SECTOR_COUNT) != 0) {
+        printf("[IAP] Trailer erase failed\r\n");
+    }
+    
+    /* 标记上传完成 (同时防止下次升级误续传)；CRC 通过的记录可供启动时跳过重复校验 */
+    ckpt_save(w, ok ? IAP_CKPT_DONE : IAP_CKPT_BAD_CRC);
+    
+    /* 本次上电以来的 Flash 操作延迟 (含本次会话) */
+    FlashPort_PrintStats();
+    
+    if (!ok) {
+        printf("[IAP] Image CRC mismatch (calc=0x%08lX, expect=0x%08lX)\r\n",
+               (unsigned long)w->run_crc, (unsigned long)hdr->img_crc32);
+        return -5;
+    }
+    
+    printf("[IAP] Image CRC OK (0x%08lX)\r\n", (unsigned long)w->run_crc);
+    return 0;
+}
+
+/**
+ * @brief  放弃写入会话
+ */
+int IAP_Abort(iap_writer_t* w)
+{
+    if (!w) return -1;
+    
+    erase_wait();
+    return ckpt_save(w, IAP_CKPT_FAILED);
+}
+
+/**
+ * @brief  从断点恢复 IAP 写入会话
+ */
+int IAP_Resume(iap_writer_t* w, const iap_ckpt_t* ck)
+{
+    if (!w || !ck) return -1;
+    
+    uint32_t slot_base = LOGICAL_SLOT_INACTIVE_BASE;
+    
+    if (ck->file_size > APP_SLOT_SIZE || ck->committed > ck->file_size ||
+        (ck->committed % IAP_FLASH_WORD_SIZE) != 0 ||
+        ck->committed < HDR_SIZE || ck->crc_len > ck->committed - HDR_SIZE) {
+        printf("[IAP] Invalid checkpoint\r\n");
+        return -2;
+    }
+    
+    w->base  = slot_base;
+    w->limit = slot_base + ck->file_size;
+    w->addr  = slot_base + ck->committed;
+    w->fill  = 0;
+    memset(w->buf32, 0xFF, sizeof(w->buf32));
+    
+    w->ckpt_next = w->addr + IAP_CKPT_INTERVAL;
+    w->img_end   = 0;
+    w->crc_addr  = slot_base + HDR_SIZE + ck->crc_len;
+    w->run_crc   = ck->run_crc;
+    
+    /* 断点所在扇区在上次会话中已擦除 (断点之后可能已有部分数据，由 program_range 跳过)；
+     * 之后的扇区状态未知 (旧镜像或上次写入的一部分)，写入前重新擦除 */
+    w->erased_end = slot_base + ((ck->committed + IAP_SECTOR_SIZE - 1u) & ~(IAP_SECTOR_SIZE - 1u));
+    erase_ahead(w);
+    
+    printf("[IAP] Write session resumed at 0x%08lX (%lu/%lu bytes)\r\n",
+           (unsigned long)w->addr, (unsigned long)ck->committed,
+           (unsigned long)ck->file_size);
+    
+    return 0;
+}
+
+/**
+ * @brief  读取非活动 Slot 上可续传的断点
+ */
+int IAP_CheckpointLoad(iap_ckpt_t* out)
+{
+    const iap_ckpt_t* last = NULL;
+    
+    /* 从末尾向前找最后一条断点记录，先遇到会话标记说明最后一次会话还没有断点 */
+    for (uint32_t i = trailer_find_end(LOGICAL_TRAILER_INACTIVE_BASE); i > 0; i--) {
+        const iap_ckpt_t* r = (const iap_ckpt_t*)(LOGICAL_TRAILER_INACTIVE_BASE + (i - 1) * sizeof(*r));
+        if (r->magic == IAP_SESSION_MAGIC) break;
+        if (r->magic == IAP_CKPT_MAGIC) {
+            last = r;
+            break;
+        }
+    }
+    
+    if (last && last->status == IAP_CKPT_FAILED) {
+        return -4;
+    }
+    if (!last || last->status != IAP_CKPT_ACTIVE) {
+        return -1;
+    }
+    
+    /* Flash 中的镜像头必须与断点记录的镜像身份一致 */
+    const image_hdr_t* hdr = (const image_hdr_t*)LOGICAL_SLOT_INACTIVE_BASE;
+    if (hdr->magic != IMG_HDR_MAGIC || hdr->img_crc32 != last->img_crc32 ||
+        last->committed < HDR_SIZE || last->committed > last->file_size ||
+        HDR_SIZE + hdr->img_size > last->file_size ||
+        last->crc_len > last->committed - HDR_SIZE || (last->crc_len % 4) != 0) {
+        return -2;
+    }
+    
+    /* 重新校验已写入部分，防止记录之后数据被破坏 */
+    uint32_t crc = crc32_continue(0xFFFFFFFFu, (const uint32_t*)(LOGICAL_SLOT_INACTIVE_BASE + HDR_SIZE),
+                                  last->crc_len);
+    if (crc != last->run_crc) {
+        return -3;
+    }
+    
+    *out = *last;
     return 0;
 }
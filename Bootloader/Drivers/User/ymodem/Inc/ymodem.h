@@ -25,12 +25,21 @@
 #define YMODEM_NAK      0x15    /* 否定确认 */
 #define YMODEM_CAN      0x18    /* 取消传输 */
 #define YMODEM_C        0x43    /* 'C' - 请求 CRC 模式 */
+#define YMODEM_G        0x47    /* 'G' - 请求 YMODEM-G 流式模式 */
+
+/* packet 0 中续传偏移字段的前缀 (扩展，见 on_seek) */
+#define YMODEM_RESUME_TAG   '+'
 
 /* 数据包大小 */
 #define YMODEM_PACKET_128   128
 #define YMODEM_PACKET_1K    1024
 
+/* 接收模式 */
+#define YMODEM_MODE_CRC     0   /* 经典 YMODEM：每包 ACK，出错 NAK 重传 */
+#define YMODEM_MODE_G       1   /* YMODEM-G：不等待 ACK 连续发送，出错即取消 */
+
 /* 错误码 */
+#define YMODEM_BUSY             1       /* 传输进行中 (仅 Ymodem_Poll 返回) */
 #define YMODEM_OK               0
 #define YMODEM_ERR_TIMEOUT      -1
 #define YMODEM_ERR_CANCEL       -2
@@ -38,6 +47,21 @@
 #define YMODEM_ERR_SEQ          -4
 #define YMODEM_ERR_CALLBACK     -5
 #define YMODEM_ERR_TOO_LARGE    -6
+#define YMODEM_ERR_OVERFLOW     -7      /* 接收缓冲区溢出 (流式模式) */
+
+/*============================================================================
+ * 数据视图类型
+ *============================================================================*/
+
+/**
+ * @brief  分段数据视图 (直接指向环形缓冲区存储，不复制)
+ * @note   数据在环形缓冲区末尾回绕时分为两段，否则 len[1] 为 0
+ *         视图仅在回调期间有效，回调返回后对应空间会被释放
+ */
+typedef struct {
+    const uint8_t* seg[2];  /* 各段起始地址 */
+    uint32_t       len[2];  /* 各段长度 */
+} ymodem_vec_t;
 
 /*============================================================================
  * 回调函数类型
@@ -52,6 +76,14 @@ typedef struct {
      */
     int (*on_begin)(const char* name, uint32_t size);
     
+    /**
+     * @brief  续传回调 (可选，在 on_begin 之前调用)
+     * @param  offset: 发送方声明的起始偏移 (packet 0 中 "+offset" 扩展字段)
+     * @retval 0=接受, <0=拒绝 (取消传输)
+     * @note   仅当 offset > 0 时调用；未设置时拒绝所有续传
+     */
+    int (*on_seek)(uint32_t offset);
+    
     /**
      * @brief  数据接收回调
      * @param  data: 数据指针
@@ -59,10 +91,18 @@ typedef struct {
      * @retval 0=继续, <0=取消
      */
     int (*on_data)(const uint8_t* data, uint32_t len);
+
+    /**
+     * @brief  数据接收回调 (分段视图，零拷贝)
+     * @param  vec: 数据视图 (总长度 = len[0] + len[1])
+     * @retval 0=继续, <0=取消
+     * @note   设置后优先于 on_data；未设置时回绕数据会分两次调用 on_data
+     */
+    int (*on_data_vec)(const ymodem_vec_t* vec);
     
     /**
      * @brief  传输结束回调
-     * @retval 0=成功, <0=失败
+     * @retval 0=成功, <0=失败 (取消传输，不再 ACK 结束包)
      */
     int (*on_end)(void);
     
@@ -73,12 +113,48 @@ typedef struct {
     void (*on_error)(int code);
 } ymodem_cb_t;
 
+/*============================================================================
+ * 接收会话
+ *============================================================================*/
+
+/* 会话状态 */
+typedef enum {
+    YMODEM_STATE_WAIT_START = 0,    /* 已发送 'C'/'G'，等待文件信息包 */
+    YMODEM_STATE_RECEIVING,         /* 接收数据包 */
+    YMODEM_STATE_WAIT_END,          /* 已收到 EOT，等待结束包 */
+    YMODEM_STATE_DONE,              /* 传输完成 */
+    YMODEM_STATE_ERROR              /* 传输失败，错误码见 result */
+} ymodem_state_t;
+
+/**
+ * @brief  YMODEM 接收会话上下文
+ * @note   所有状态都保存在此结构中，可同时存在多个会话；字段只读
+ */
+typedef struct {
+    lwrb_t*             rb;             /* 接收环形缓冲区 */
+    const ymodem_cb_t*  cb;             /* 回调函数 */
+    uint32_t            timeout_ms;     /* 等待包头超时 */
+    ymodem_state_t      state;          /* 当前状态 */
+    int                 result;         /* YMODEM_BUSY / YMODEM_OK / 错误码 */
+    uint8_t             streaming;      /* 1=YMODEM-G 流式模式 */
+    uint8_t             start_ch;       /* 发起字符 'C' 或 'G' */
+    uint8_t             header;         /* 已读取、等待数据到齐的包头 (0=无) */
+    uint8_t             expected_seq;   /* 期望序列号 */
+    int                 retry_count;    /* 等待开始的重试次数 */
+    uint32_t            tick;           /* 当前等待的起始时刻 */
+    uint32_t            overflow_base;  /* 会话开始时的溢出计数 */
+    uint32_t            filesize;       /* 文件大小 (来自 packet 0) */
+    uint32_t            offset;         /* 续传起始偏移 (0=从头传输) */
+    uint32_t            received_bytes; /* 已接收字节数 (含续传偏移) */
+    char                filename[128];  /* 文件名 */
+} ymodem_t;
+
 /*============================================================================
  * 函数声明
  *============================================================================*/
 
 /**
- * @brief  YMODEM 接收
+ * @brief  YMODEM 接收 (阻塞，基于 Ymodem_Init/Ymodem_Poll)
  * @param  rb: 环形缓冲区 (需要提前初始化并启动 DMA)
  * @param  cb: 回调函数
  * @param  timeout_ms: 超时时间 (毫秒)
@@ -86,6 +162,50 @@ typedef struct {
  */
 int Ymodem_Receive(lwrb_t* rb, const ymodem_cb_t* cb, uint32_t timeout_ms);
 
+/**
+ * @brief  YMODEM 接收 (可选模式)
+ * @param  rb: 环形缓冲区 (需要提前初始化并启动 DMA)
+ * @param  cb: 回调函数
+ * @param  timeout_ms: 超时时间 (毫秒)
+ * @param  mode: YMODEM_MODE_CRC 或 YMODEM_MODE_G
+ * @retval 0=成功, <0=错误码
+ * @note   YMODEM_MODE_G 以 'G' 发起传输，发送方若连续 G_NEGOTIATE_RETRY 次
+ *         无响应则自动回退为 'C' (经典模式)。
+ *         流式模式下发送方不等待 ACK，环形缓冲区必须能容纳回调处理期间
+ *         到达的所有数据 (建议 >= 4 个 1K 包)，溢出时传输被取消
+ */
+int Ymodem_ReceiveEx(lwrb_t* rb, const ymodem_cb_t* cb, uint32_t timeout_ms, int mode);
+
+/**
+ * @brief  初始化接收会话并发送发起字符 ('C' 或 'G')
+ * @param  ym: 会话上下文
+ * @param  rb: 环形缓冲区 (需要提前初始化并启动 DMA)
+ * @param  cb: 回调函数 (会话期间须保持有效)
+ * @param  timeout_ms: 等待包头超时时间 (毫秒)
+ * @param  mode: YMODEM_MODE_CRC 或 YMODEM_MODE_G
+ */
+void Ymodem_Init(ymodem_t* ym, lwrb_t* rb, const ymodem_cb_t* cb, uint32_t timeout_ms, int mode);
+
+/**
+ * @brief  推进接收会话 (非阻塞)
+ * @param  ym: 会话上下文
+ * @retval YMODEM_BUSY=进行中, YMODEM_OK=完成, <0=错误码
+ * @note   处理环形缓冲区中已到达的全部完整数据包后立即返回，不等待数据。
+ *         可在主循环、DMA 空闲中断之后或 WFI 唤醒后调用；
+ *         回调在调用 Ymodem_Poll 的上下文中执行。
+ *         会话结束后重复调用返回同一结果
+ */
+int Ymodem_Poll(ymodem_t* ym);
+
+/**
+ * @brief  从外部终止接收会话 (延迟取消)
+ * @param  ym: 会话上下文
+ * @param  code: 记录到会话的错误码 (<0)
+ * @note   用于回调返回之后才发现的错误 (如已 ACK 的数据包写入失败)：
+ *         向发送方发送 CAN，调用 on_error，之后 Ymodem_Poll 返回 code
+ */
+void Ymodem_Abort(ymodem_t* ym, int code);
+
 /**
  * @brief  取消 YMODEM 传输
  */
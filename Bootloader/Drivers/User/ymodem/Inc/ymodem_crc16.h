@@ -0,0 +1,91 @@
+/**
+  ******************************************************************************
+  * @file           : ymodem_crc16.h
+  * @brief          : YMODEM CRC16-CCITT 计算引擎 (可选实现)
+  * @description    : 多种 CRC16 (poly 0x1021, init 0) 实现，编译期选择：
+  *                   - BITWISE : 逐位移位，无查表 (原实现，作为参考)
+  *                   - TABLE   : 256 项查表，表在编译期由宏生成 (512B Flash)
+  *                   - SLICE4  : slicing-by-4，每次处理 4 字节 (2KB Flash)
+  *                   - SLICE8  : slicing-by-8，每次处理 8 字节 (4KB Flash)
+  *                   - HW      : 复用 STM32H7 CRC 外设 (需实现 YmodemPort_HwCrc16)
+  * @note           : 除 HW 外均为纯 C 实现，可直接在主机上编译
+  ******************************************************************************
+  */
+
+#ifndef __YMODEM_CRC16_H
+#define __YMODEM_CRC16_H
+
+#include <stdint.h>
+
+/*============================================================================
+ * 引擎选择
+ *============================================================================*/
+
+#define YMODEM_CRC16_BITWISE    0
+#define YMODEM_CRC16_TABLE      1
+#define YMODEM_CRC16_SLICE4     2
+#define YMODEM_CRC16_SLICE8     3
+#define YMODEM_CRC16_HW         4
+
+/* 默认使用查表法，可在工程宏定义中覆盖 */
+#ifndef YMODEM_CRC16_ENGINE
+#define YMODEM_CRC16_ENGINE     YMODEM_CRC16_TABLE
+#endif
+
+/*
+ * 定义 YMODEM_CRC16_ALL_ENGINES 后编译全部软件引擎 (用于主机对比测试)，
+ * 否则只编译 BITWISE 与当前选择的引擎，节省 Flash
+ */
+
+/*============================================================================
+ * 函数声明
+ *============================================================================*/
+
+/**
+ * @brief  计算 CRC16-CCITT (使用 YMODEM_CRC16_ENGINE 选择的引擎)
+ * @param  data: 数据指针
+ * @param  len: 数据长度
+ * @retval CRC16 结果
+ */
+uint16_t Ymodem_Crc16(const uint8_t* data, uint32_t len);
+
+/**
+ * @brief  在已有 CRC 基础上续算 (用于分段数据，如环形缓冲区回绕)
+ * @param  crc: 前一段的 CRC 结果 (首段为 0)
+ * @param  data: 数据指针
+ * @param  len: 数据长度
+ * @retval CRC16 结果
+ */
+uint16_t Ymodem_Crc16Update(uint16_t crc, const uint8_t* data, uint32_t len);
+
+/*
+ * 以下为各引擎的直接入口，crc 参数为初始/续算值 (从头计算时传 0)
+ */
+
+/**
+ * @brief  逐位计算 CRC16 (参考实现，始终可用)
+ */
+uint16_t Ymodem_Crc16_Bitwise(uint16_t crc, const uint8_t* data, uint32_t len);
+
+#if (YMODEM_CRC16_ENGINE == YMODEM_CRC16_TABLE) || defined(YMODEM_CRC16_ALL_ENGINES)
+/**
+ * @brief  256 项查表计算 CRC16
+ */
+uint16_t Ymodem_Crc16_Table(uint16_t crc, const uint8_t* data, uint32_t len);
+#endif
+
+#if (YMODEM_CRC16_ENGINE == YMODEM_CRC16_SLICE4) || defined(YMODEM_CRC16_ALL_ENGINES)
+/**
+ * @brief  slicing-by-4 计算 CRC16
+ */
+uint16_t Ymodem_Crc16_Slice4(uint16_t crc, const uint8_t* data, uint32_t len);
+#endif
+
+#if (YMODEM_CRC16_ENGINE == YMODEM_CRC16_SLICE8) || defined(YMODEM_CRC16_ALL_ENGINES)
+/**
+ * @brief  slicing-by-8 计算 CRC16
+ */
+uint16_t Ymodem_Crc16_Slice8(uint16_t crc, const uint8_t* data, uint32_t len);
+#endif
+
+#endif /* __YMODEM_CRC16_H */
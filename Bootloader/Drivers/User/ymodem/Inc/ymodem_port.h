@@ -49,6 +49,55 @@ void YmodemPort_UpdateRxHead(void* rb);
  */
 void YmodemPort_InvalidateCache(void* buf, uint32_t size);
 
+/**
+ * @brief  空闲等待 (Ymodem_Receive 在无数据时调用)
+ * @note   可执行 WFI 休眠、喂狗等；必须能被串口接收中断或系统滴答唤醒
+ */
+void YmodemPort_Idle(void);
+
+/**
+ * @brief  获取接收缓冲区溢出计数
+ * @retval 自启动以来写入环形缓冲区失败 (数据丢失) 的次数
+ * @note   YMODEM-G 模式下用于检测丢包；不支持检测时返回 0
+ */
+uint32_t YmodemPort_GetRxOverflow(void);
+
+/*============================================================================
+ * 波特率切换 - 可选实现 (升级会话提速)
+ *============================================================================*/
+
+/**
+ * @brief  获取当前串口波特率
+ */
+uint32_t YmodemPort_GetBaud(void);
+
+/**
+ * @brief  获取串口内核时钟频率 (用于判断可实现的波特率)
+ */
+uint32_t YmodemPort_GetUartClock(void);
+
+/**
+ * @brief  切换串口波特率
+ * @param  baud: 新波特率
+ * @retval 0=成功, <0=失败
+ * @note   须等待发送完成后再切换；接收缓冲区中的旧数据被丢弃
+ */
+int YmodemPort_SetBaud(uint32_t baud);
+
+/*============================================================================
+ * 硬件 CRC - 可选实现
+ *============================================================================*/
+
+/**
+ * @brief  使用硬件 CRC 外设计算 CRC16-CCITT (poly 0x1021)
+ * @param  crc: 初始值 (从头计算时为 0，分段续算时为前一段结果)
+ * @param  data: 数据指针
+ * @param  len: 数据长度
+ * @retval CRC16 结果
+ * @note   仅在 YMODEM_CRC16_ENGINE == YMODEM_CRC16_HW 时需要实现
+ */
+uint16_t YmodemPort_HwCrc16(uint16_t crc, const uint8_t* data, uint32_t len);
+
 /*============================================================================
  * 日志输出 - 可选实现
  *============================================================================*/
@@ -8,8 +8,8 @@
 
 #include "ymodem.h"
 #include "ymodem_port.h"
+#include "ymodem_crc16.h"
 #include <string.h>
-#include <stdlib.h>
 
 /*============================================================================
  * 私有常量
@@ -20,6 +20,7 @@
 #define PACKET_OVERHEAD         (PACKET_HEADER_SIZE + PACKET_CRC_SIZE)
 
 #define MAX_RETRY               10      /* 最大重试次数 */
+#define G_NEGOTIATE_RETRY       3       /* 发送 'G' 无响应的次数，超过后回退到 'C' */
 #define INTER_CHAR_TIMEOUT      100     /* 字符间超时 (ms) */
 
 /*============================================================================
@@ -27,335 +28,535 @@
  *============================================================================*/
 
 /**
- * @brief  计算 CRC16-CCITT
+ * @brief  发送单个字符
  */
-static uint16_t calc_crc16(const uint8_t* data, uint32_t len)
+static void send_char(uint8_t ch)
 {
-    uint16_t crc = 0;
-    
-    while (len--) {
-        crc ^= (uint16_t)(*data++) << 8;
-        for (int i = 0; i < 8; i++) {
-            if (crc & 0x8000) {
-                crc = (crc << 1) ^ 0x1021;
-            } else {
-                crc <<= 1;
-            }
-        }
-    }
-    
-    return crc;
+    YmodemPort_SendByte(ch);
 }
 
 /**
- * @brief  发送单个字符
+ * @brief  在环形缓冲区上建立 len 字节的分段视图 (不移动读指针)
+ * @note   调用前需确保缓冲区中至少有 len 字节
  */
-static void send_char(uint8_t ch)
+static void rb_peek_vec(lwrb_t* rb, uint32_t len, ymodem_vec_t* v)
 {
-    YmodemPort_SendByte(ch);
+    uint32_t linear = lwrb_get_linear_block_read_length(rb);
+    
+    v->seg[0] = (const uint8_t*)lwrb_get_linear_block_read_address(rb);
+    v->len[0] = (len < linear) ? len : linear;
+    v->seg[1] = rb->buff;               /* 回绕部分从存储区起始处继续 */
+    v->len[1] = len - v->len[0];
 }
 
 /**
- * @brief  等待指定数量的字节
- * @retval 0=成功, -1=超时
+ * @brief  读取视图中偏移 off 处的字节
  */
-static int wait_for_bytes(lwrb_t* rb, uint32_t count, uint32_t timeout_ms)
+static uint8_t vec_byte(const ymodem_vec_t* v, uint32_t off)
 {
-    uint32_t start = YmodemPort_GetTick();
+    return (off < v->len[0]) ? v->seg[0][off] : v->seg[1][off - v->len[0]];
+}
 
-    while (lwrb_get_full(rb) < count) {
-        if ((YmodemPort_GetTick() - start) > timeout_ms) {
-            return -1;
-        }
-        // 可以加一点点让步，避免死等占满CPU
-        // YmodemPort_Delay(1);
-        // 或者在这里喂狗
+/**
+ * @brief  截取子视图 [off, off + len)
+ */
+static void vec_slice(const ymodem_vec_t* v, uint32_t off, uint32_t len, ymodem_vec_t* out)
+{
+    if (off < v->len[0]) {
+        uint32_t n0 = v->len[0] - off;
+        if (n0 > len) n0 = len;
+        out->seg[0] = v->seg[0] + off;
+        out->len[0] = n0;
+        out->seg[1] = v->seg[1];
+        out->len[1] = len - n0;
+    } else {
+        out->seg[0] = v->seg[1] + (off - v->len[0]);
+        out->len[0] = len;
+        out->seg[1] = NULL;
+        out->len[1] = 0;
     }
-    return 0;
 }
 
-
 /**
- * @brief  读取一个字节
- * @retval 0=成功, -1=超时
+ * @brief  计算视图数据的 CRC16 (跨段续算)
  */
-static int read_byte(lwrb_t* rb, uint8_t* out, uint32_t timeout_ms)
+static uint16_t vec_crc16(const ymodem_vec_t* v)
 {
-    if (wait_for_bytes(rb, 1, timeout_ms) != 0) {
-        return -1;
+    uint16_t crc = Ymodem_Crc16Update(0, v->seg[0], v->len[0]);
+    if (v->len[1] > 0) {
+        crc = Ymodem_Crc16Update(crc, v->seg[1], v->len[1]);
     }
-    
-    return (lwrb_read(rb, out, 1) == 1) ? 0 : -1;
+    return crc;
 }
 
 /**
- * @brief  解析文件信息包 (packet 0)
+ * @brief  将数据视图交给回调 (优先 on_data_vec，否则逐段调用 on_data)
+ * @retval 0=成功, <0=回调要求取消
  */
-static int parse_file_info(const uint8_t* data, uint32_t len, 
-                           char* filename, uint32_t* filesize)
+static int deliver_data(const ymodem_cb_t* cb, const ymodem_vec_t* v)
 {
-    /* 文件名 (以 0 结尾) */
-    const char* name = (const char*)data;
-    uint32_t name_len = strlen(name);
-    
-    if (name_len == 0) {
-        /* 空包表示传输结束 */
-        filename[0] = '\0';
-        *filesize = 0;
-        return 0;
+    if (cb->on_data_vec) {
+        return cb->on_data_vec(v);
     }
     
-    strncpy(filename, name, 127);
-    filename[127] = '\0';
-    
-    /* 文件大小 (紧跟文件名之后，ASCII 格式) */
-    if (name_len + 1 < len) {
-        *filesize = strtoul((const char*)(data + name_len + 1), NULL, 10);
-    } else {
-        *filesize = 0;
+    if (cb->on_data) {
+        for (int i = 0; i < 2; i++) {
+            if (v->len[i] > 0 && cb->on_data(v->seg[i], v->len[i]) != 0) {
+                return -1;
+            }
+        }
     }
     
     return 0;
 }
 
-/*============================================================================
- * 公共函数实现
- *============================================================================*/
-
-void Ymodem_Cancel(void)
+/**
+ * @brief  从视图中 pos 处解析十进制数 (跳过前导空格)，pos 移到数字之后
+ */
+static uint32_t vec_parse_dec(const ymodem_vec_t* v, uint32_t len, uint32_t* pos)
 {
-    /* 发送多个 CAN 取消传输 */
-    for (int i = 0; i < 5; i++) {
-        send_char(YMODEM_CAN);
-        YmodemPort_Delay(10);
+    uint32_t val = 0;
+    
+    while (*pos < len && vec_byte(v, *pos) == ' ') (*pos)++;
+    while (*pos < len) {
+        uint8_t ch = vec_byte(v, *pos);
+        if (ch < '0' || ch > '9') break;
+        val = val * 10u + (ch - '0');
+        (*pos)++;
     }
+    return val;
 }
 
-int Ymodem_Receive(lwrb_t* rb, const ymodem_cb_t* cb, uint32_t timeout_ms)
+/**
+ * @brief  解析环形缓冲区中的文件信息包 (packet 0)
+ * @param  data: 数据部分的视图 (128 或 1024 字节)
+ * @note   格式: "文件名\0大小 [其它字段]\0[+续传偏移\0]"
+ *         直接在视图上解析整个数据部分：1K 包头 (长路径) 的大小与续传字段
+ *         可能位于 128 字节之后。文件名超过 127 字节时截断，其余字段不受影响。
+ *         续传偏移为本工程的扩展字段，标准发送方不会发送 (offset=0)
+ */
+static void read_file_info(const ymodem_vec_t* data, char* filename,
+                           uint32_t* filesize, uint32_t* offset)
 {
-    static uint8_t packet_buf[YMODEM_PACKET_1K + PACKET_OVERHEAD];
-    char filename[128];
-    uint32_t filesize = 0;
-    uint32_t received_bytes = 0;
-    uint8_t expected_seq = 0;
-    int retry_count = 0;
-    int state = 0;  /* 0=等待开始, 1=接收数据, 2=等待结束 */
+    uint32_t len = data->len[0] + data->len[1];
+    uint32_t pos = 0;
+    uint32_t n = 0;
+    
+    *filesize = 0;
+    *offset = 0;
     
-    YmodemPort_Log("[YMODEM] Waiting for sender (send 'C')...\r\n");
+    /* 文件名 (以 0 结尾)，空文件名表示传输结束 */
+    while (pos < len && vec_byte(data, pos) != 0) {
+        if (n < 127) filename[n++] = (char)vec_byte(data, pos);
+        pos++;
+    }
+    filename[n] = '\0';
+    if (n == 0) return;
+    pos++;
     
-    // 丢弃升级命令后的残留数据，使用库API，不要碰指针
+    /* 文件大小 (紧跟文件名之后，ASCII 格式)，之后的其它字段跳过 */
+    *filesize = vec_parse_dec(data, len, &pos);
+    while (pos < len && vec_byte(data, pos) != 0) pos++;
+    pos++;
     
+    /* 可选续传偏移: 大小字段之后以 '+' 开头的十进制数 */
+    if (pos < len && vec_byte(data, pos) == YMODEM_RESUME_TAG) {
+        pos++;
+        *offset = vec_parse_dec(data, len, &pos);
+    }
+}
 
-    // 关键：如果你DMA→lwrb_write是通过 old_pos 增量搬运的
-    // 那你还需要把 old_pos 一起清零，否则会把一段旧数据“再搬一次”或出现错位。
-    // 例如提供一个函数：UartDmaRx_ResetPos(); 在这里调用你自己实现：old_pos = 当前DMA pos 或 0
+/**
+ * @brief  结束会话并记录结果
+ */
+static int finish(ymodem_t* ym, int code)
+{
+    ym->result = code;
+    ym->state = (code == YMODEM_OK) ? YMODEM_STATE_DONE : YMODEM_STATE_ERROR;
+    return code;
+}
 
-    send_char(YMODEM_C);
-    // uint32_t t0 = YmodemPort_GetTick();
-    // uint8_t debug_first = 0;
-    // while (YmodemPort_GetTick() - t0 < 2000) {
-    //     uint8_t b;
-    //     if (lwrb_read(rb, &b, 1) == 1) {
-    //         // 把首字节值打出来（注意：别用printf走同一串口，先点灯或存变量）
-    //         debug_first = b;
-    //         YmodemPort_Log("[YMODEM] First byte received: 0x%02X\r\n", debug_first);
-    //         break;
-    //     }
-    // }
+/**
+ * @brief  流式模式下的错误处理：YMODEM-G 没有重传，出错只能取消整个传输
+ */
+static int stream_abort(ymodem_t* ym, int code)
+{
+    Ymodem_Cancel();
+    if (ym->cb->on_error) ym->cb->on_error(code);
+    return finish(ym, code);
+}
 
+/**
+ * @brief  等待包头超时处理
+ * @retval YMODEM_BUSY=继续等待, <0=错误码
+ */
+static int handle_timeout(ymodem_t* ym)
+{
+    const ymodem_cb_t* cb = ym->cb;
     
-    while (1) {
-        uint8_t header;
-        uint32_t packet_size;
-        
-        /* 读取包头 */
-        if (read_byte(rb, &header, timeout_ms) != 0) {
-            /* 超时 */
-            if (state == 0) {
-                /* 还在等待开始，重发 'C' */
-                retry_count++;
-                if (retry_count >= MAX_RETRY) {
-                    YmodemPort_Log("[YMODEM] Timeout waiting for sender\r\n");
-                    if (cb->on_error) cb->on_error(YMODEM_ERR_TIMEOUT);
-                    return YMODEM_ERR_TIMEOUT;
-                }
+    if (ym->state == YMODEM_STATE_WAIT_START) {
+        /* 还在等待开始，重发 'C' / 'G' */
+        ym->retry_count++;
+        if (ym->retry_count >= MAX_RETRY) {
+            YmodemPort_Log("[YMODEM] Timeout waiting for sender\r\n");
+            if (cb->on_error) cb->on_error(YMODEM_ERR_TIMEOUT);
+            return finish(ym, YMODEM_ERR_TIMEOUT);
+        }
+        if (ym->streaming && ym->retry_count >= G_NEGOTIATE_RETRY) {
+            /* 发送方不支持 YMODEM-G，回退到经典 YMODEM */
+            YmodemPort_Log("[YMODEM] No response to 'G', falling back to 'C'\r\n");
+            ym->streaming = 0;
+            ym->start_ch = YMODEM_C;
+        }
+        send_char(ym->start_ch);
+        return YMODEM_BUSY;
+    }
+    
+    /* 数据传输中超时 */
+    YmodemPort_Log("[YMODEM] Timeout during transfer\r\n");
+    Ymodem_Cancel();
+    if (cb->on_error) cb->on_error(YMODEM_ERR_TIMEOUT);
+    return finish(ym, YMODEM_ERR_TIMEOUT);
+}
+
+/**
+ * @brief  处理单字节控制字符 (EOT / CAN / 未知字符)
+ * @retval YMODEM_BUSY=继续, <0=错误码
+ */
+static int handle_control(ymodem_t* ym, uint8_t header)
+{
+    switch (header) {
+        case YMODEM_EOT:
+            /* 传输结束 */
+            if (ym->streaming && ym->state != YMODEM_STATE_WAIT_START) {
+                /* YMODEM-G: EOT 直接 ACK，然后请求结束包 */
+                send_char(YMODEM_ACK);
+                send_char(ym->start_ch);
+                ym->state = YMODEM_STATE_WAIT_END;
+                ym->expected_seq = 0;
+            } else if (ym->state == YMODEM_STATE_RECEIVING) {
+                /* 第一个 EOT，发送 NAK */
+                send_char(YMODEM_NAK);
+                ym->state = YMODEM_STATE_WAIT_END;
+            } else if (ym->state == YMODEM_STATE_WAIT_END) {
+                /* 第二个 EOT，发送 ACK + C */
+                send_char(YMODEM_ACK);
                 send_char(YMODEM_C);
-                continue;
+                
+                /* 重置期望序列号，等待结束包 (packet 0，空文件名) */
+                ym->expected_seq = 0;
+            }
+            return YMODEM_BUSY;
+            
+        case YMODEM_CAN:
+            /* 发送方取消 */
+            YmodemPort_Log("[YMODEM] Transfer cancelled by sender\r\n");
+            if (ym->cb->on_error) ym->cb->on_error(YMODEM_ERR_CANCEL);
+            return finish(ym, YMODEM_ERR_CANCEL);
+            
+        default:
+            /* 未知字符，忽略 */
+            return YMODEM_BUSY;
+    }
+}
+
+/**
+ * @brief  处理一个已完整到达的数据包 (数据留在环形缓冲区中原地校验，不复制)
+ * @retval YMODEM_BUSY=继续, YMODEM_OK=传输完成, <0=错误码
+ */
+static int handle_packet(ymodem_t* ym, uint32_t packet_size)
+{
+    lwrb_t* rb = ym->rb;
+    const ymodem_cb_t* cb = ym->cb;
+    uint32_t total_len = 2 + packet_size + 2;  /* SeqNo + ~SeqNo + Data + CRC */
+    ymodem_vec_t pkt;
+    ymodem_vec_t data;
+    
+    rb_peek_vec(rb, total_len, &pkt);
+    vec_slice(&pkt, 2, packet_size, &data);
+    
+    uint8_t seq_no = vec_byte(&pkt, 0);
+    uint8_t seq_comp = vec_byte(&pkt, 1);
+    uint16_t recv_crc = ((uint16_t)vec_byte(&pkt, 2 + packet_size) << 8) |
+                         (uint16_t)vec_byte(&pkt, 2 + packet_size + 1);
+    
+    /* 验证序列号补码 */
+    if ((seq_no ^ seq_comp) != 0xFF) {
+        lwrb_skip(rb, total_len);
+        if (ym->streaming) return stream_abort(ym, YMODEM_ERR_SEQ);
+        send_char(YMODEM_NAK);
+        return YMODEM_BUSY;
+    }
+    
+    /* 验证 CRC */
+    uint16_t calc_crc = vec_crc16(&data);
+    if (calc_crc != recv_crc) {
+        lwrb_skip(rb, total_len);
+        if (ym->streaming) {
+            YmodemPort_Log("[YMODEM] CRC error in streaming mode\r\n");
+            return stream_abort(ym, YMODEM_ERR_CRC);
+        }
+        send_char(YMODEM_NAK);
+        return YMODEM_BUSY;
+    }
+    
+    /* 验证序列号 */
+    if (seq_no != ym->expected_seq) {
+        lwrb_skip(rb, total_len);
+        if (seq_no == 0 && ym->expected_seq == 1 && ym->received_bytes == ym->offset) {
+            /* 重发的 Packet 0 (发送方没收到应答，流式模式同样可能)：重新应答 */
+            if (ym->streaming) {
+                send_char(YMODEM_G);
             } else {
-                /* 数据传输中超时 */
-                YmodemPort_Log("[YMODEM] Timeout during transfer\r\n");
-                Ymodem_Cancel();
-                if (cb->on_error) cb->on_error(YMODEM_ERR_TIMEOUT);
-                return YMODEM_ERR_TIMEOUT;
+                send_char(YMODEM_ACK);
+                send_char(YMODEM_C);
             }
+            return YMODEM_BUSY;
         }
+        if (!ym->streaming && seq_no == (uint8_t)(ym->expected_seq - 1)) {
+            /* 重复包，发送 ACK 但不处理 */
+            send_char(YMODEM_ACK);
+            return YMODEM_BUSY;
+        }
+        YmodemPort_Log("[YMODEM] Sequence error (expect=%d, recv=%d)\r\n", ym->expected_seq, seq_no);
+        Ymodem_Cancel();
+        if (cb->on_error) cb->on_error(YMODEM_ERR_SEQ);
+        return finish(ym, YMODEM_ERR_SEQ);
+    }
+    
+    /* 处理数据包 */
+    if (ym->state == YMODEM_STATE_WAIT_START && seq_no == 0) {
+        /* Packet 0: 文件信息 */
+        read_file_info(&data, ym->filename, &ym->filesize, &ym->offset);
+        lwrb_skip(rb, total_len);
         
-        retry_count = 0;  /* 收到数据，重置重试计数 */
-        
-        /* 解析包头 */
-        switch (header) {
-            case YMODEM_SOH:
-                packet_size = YMODEM_PACKET_128;
-                break;
-                
-            case YMODEM_STX:
-                packet_size = YMODEM_PACKET_1K;
-                break;
-                
-            case YMODEM_EOT:
-                /* 传输结束 */
-                if (state == 1) {
-                    /* 第一个 EOT，发送 NAK */
-                    send_char(YMODEM_NAK);
-                    state = 2;
-                    continue;
-                } else if (state == 2) {
-                    /* 第二个 EOT，发送 ACK + C */
-                    send_char(YMODEM_ACK);
-                    send_char(YMODEM_C);
-                    
-                    /* 重置期望序列号，等待结束包 (packet 0，空文件名) */
-                    expected_seq = 0;
-                    continue;
-                }
-                break;
-                
-            case YMODEM_CAN:
-                /* 发送方取消 */
-                YmodemPort_Log("[YMODEM] Transfer cancelled by sender\r\n");
-                if (cb->on_error) cb->on_error(YMODEM_ERR_CANCEL);
-                return YMODEM_ERR_CANCEL;
-                
-            default:
-                /* 未知字符，忽略 */
-                continue;
+        if (ym->filename[0] == '\0') {
+            /* 空文件名 = 传输完全结束 */
+            YmodemPort_Log("[YMODEM] All transfers complete\r\n");
+            send_char(YMODEM_ACK);
+            return finish(ym, YMODEM_OK);
         }
         
-        /* 读取完整数据包 */
-        uint32_t total_len = 2 + packet_size + 2;  /* SeqNo + ~SeqNo + Data + CRC */
-        if (wait_for_bytes(rb, total_len, INTER_CHAR_TIMEOUT * 10) != 0) {
-            YmodemPort_Log("[YMODEM] Incomplete packet\r\n");
-            send_char(YMODEM_NAK);
-            continue;
+        YmodemPort_Log("[YMODEM] File: %s, Size: %lu bytes\r\n", ym->filename, (unsigned long)ym->filesize);
+        
+        /* 续传：发送方从 offset 处开始发送，必须由接收方确认 */
+        if (ym->offset > 0) {
+            YmodemPort_Log("[YMODEM] Resume at offset %lu\r\n", (unsigned long)ym->offset);
+            if (!cb->on_seek || cb->on_seek(ym->offset) != 0) {
+                YmodemPort_Log("[YMODEM] Resume offset rejected\r\n");
+                Ymodem_Cancel();
+                return finish(ym, YMODEM_ERR_CALLBACK);
+            }
         }
         
-        /* 读取数据包 */
-        packet_buf[0] = header;
-        lwrb_read(rb, &packet_buf[1], total_len);
+        /* 调用开始回调 */
+        if (cb->on_begin) {
+            if (cb->on_begin(ym->filename, ym->filesize) != 0) {
+                YmodemPort_Log("[YMODEM] Callback rejected transfer\r\n");
+                Ymodem_Cancel();
+                return finish(ym, YMODEM_ERR_CALLBACK);
+            }
+        }
         
-        uint8_t seq_no = packet_buf[1];
-        uint8_t seq_comp = packet_buf[2];
-        uint8_t* data = &packet_buf[3];
-        uint16_t recv_crc = (packet_buf[3 + packet_size] << 8) | packet_buf[3 + packet_size + 1];
+        ym->state = YMODEM_STATE_RECEIVING;
+        ym->expected_seq = 1;
+        ym->received_bytes = ym->offset;    /* 续传时从偏移处计数，用于裁剪最后一包 */
         
-        /* 验证序列号补码 */
-        if ((seq_no ^ seq_comp) != 0xFF) {
-            send_char(YMODEM_NAK);
-            continue;
+        if (ym->streaming) {
+            send_char(YMODEM_G);  /* YMODEM-G: 只发 'G'，之后发送方连续发送 */
+        } else {
+            send_char(YMODEM_ACK);
+            send_char(YMODEM_C);  /* 请求数据包 */
         }
+        return YMODEM_BUSY;
+    }
+    
+    if (ym->state == YMODEM_STATE_RECEIVING) {
+        /* 数据包 (序列号 255 之后回绕到 0，同样是数据包) */
+        uint32_t data_len = packet_size;
         
-        /* 验证 CRC */
-        uint16_t calc_crc = calc_crc16(data, packet_size);
-        if (calc_crc != recv_crc) {
-            send_char(YMODEM_NAK);
-            continue;
+        /* 如果知道文件大小，裁剪最后一个包 */
+        if (ym->filesize > 0 && ym->received_bytes + data_len > ym->filesize) {
+            data_len = ym->filesize - ym->received_bytes;
+            vec_slice(&pkt, 2, data_len, &data);
         }
         
-        /* 验证序列号 */
-        if (seq_no != expected_seq) {
-            if (seq_no == (uint8_t)(expected_seq - 1)) {
-                /* 重复包，发送 ACK 但不处理 */
-                send_char(YMODEM_ACK);
-                continue;
-            }
-            YmodemPort_Log("[YMODEM] Sequence error (expect=%d, recv=%d)\r\n", expected_seq, seq_no);
+        /* 调用数据回调 (直接传递环形缓冲区中的数据视图) */
+        if (deliver_data(cb, &data) != 0) {
+            YmodemPort_Log("[YMODEM] Data callback error\r\n");
             Ymodem_Cancel();
-            if (cb->on_error) cb->on_error(YMODEM_ERR_SEQ);
-            return YMODEM_ERR_SEQ;
+            return finish(ym, YMODEM_ERR_CALLBACK);
         }
+        lwrb_skip(rb, total_len);
         
-        /* 处理数据包 */
-        if (state == 0 && seq_no == 0) {
-            /* Packet 0: 文件信息 */
-            parse_file_info(data, packet_size, filename, &filesize);
-            
-            if (filename[0] == '\0') {
-                /* 空文件名 = 传输完全结束 */
-                YmodemPort_Log("[YMODEM] All transfers complete\r\n");
-                send_char(YMODEM_ACK);
-                return YMODEM_OK;
-            }
-            
-            YmodemPort_Log("[YMODEM] File: %s, Size: %lu bytes\r\n", filename, (unsigned long)filesize);
+        ym->received_bytes += data_len;
+        ym->expected_seq = (ym->expected_seq + 1) & 0xFF;
+        
+        /* 进度显示 */
+        if (ym->filesize > 0) {
+            YmodemPort_Log("\r[YMODEM] Progress: %lu/%lu (%lu%%)", 
+                   (unsigned long)ym->received_bytes, (unsigned long)ym->filesize,
+                   (unsigned long)(ym->received_bytes * 100 / ym->filesize));
+        }
+        
+        if (!ym->streaming) {
+            send_char(YMODEM_ACK);
+        }
+        return YMODEM_BUSY;
+    }
+    
+    if (ym->state == YMODEM_STATE_WAIT_END && seq_no == 0) {
+        /* 结束时的 packet 0 (空文件名) */
+        uint32_t end_offset;
+        read_file_info(&data, ym->filename, &ym->filesize, &end_offset);
+        lwrb_skip(rb, total_len);
+        
+        if (ym->filename[0] == '\0') {
+            /* 传输完成 */
+            YmodemPort_Log("\r\n[YMODEM] Transfer complete: %lu bytes\r\n", (unsigned long)ym->received_bytes);
             
-            /* 调用开始回调 */
-            if (cb->on_begin) {
-                if (cb->on_begin(filename, filesize) != 0) {
-                    YmodemPort_Log("[YMODEM] Callback rejected transfer\r\n");
-                    Ymodem_Cancel();
-                    return YMODEM_ERR_CALLBACK;
-                }
+            if (cb->on_end && cb->on_end() != 0) {
+                /* 例如延迟写入的数据在收尾时才发现失败 */
+                YmodemPort_Log("[YMODEM] End callback error\r\n");
+                Ymodem_Cancel();
+                return finish(ym, YMODEM_ERR_CALLBACK);
             }
             
-            state = 1;
-            expected_seq = 1;
-            received_bytes = 0;
-            
             send_char(YMODEM_ACK);
-            send_char(YMODEM_C);  /* 请求数据包 */
-            continue;
+            return finish(ym, YMODEM_OK);
         }
+    } else {
+        lwrb_skip(rb, total_len);
+    }
+    
+    /* 默认发送 ACK */
+    send_char(YMODEM_ACK);
+    return YMODEM_BUSY;
+}
+
+/*============================================================================
+ * 公共函数实现
+ *============================================================================*/
+
+void Ymodem_Cancel(void)
+{
+    /* 发送多个 CAN 取消传输 */
+    for (int i = 0; i < 5; i++) {
+        send_char(YMODEM_CAN);
+        YmodemPort_Delay(10);
+    }
+}
+
+void Ymodem_Init(ymodem_t* ym, lwrb_t* rb, const ymodem_cb_t* cb, uint32_t timeout_ms, int mode)
+{
+    memset(ym, 0, sizeof(*ym));
+    ym->rb = rb;
+    ym->cb = cb;
+    ym->timeout_ms = timeout_ms;
+    ym->streaming = (mode == YMODEM_MODE_G);
+    ym->start_ch = ym->streaming ? YMODEM_G : YMODEM_C;
+    ym->state = YMODEM_STATE_WAIT_START;
+    ym->result = YMODEM_BUSY;
+    ym->overflow_base = YmodemPort_GetRxOverflow();
+    
+    /*
+     * 调用前应丢弃升级命令后的残留数据 (lwrb_reset)，
+     * 如果 DMA→lwrb_write 是通过 old_pos 增量搬运的，还需要同步复位 old_pos
+     */
+    YmodemPort_Log("[YMODEM] Waiting for sender (send '%c')...\r\n", ym->start_ch);
+    
+    send_char(ym->start_ch);
+    ym->tick = YmodemPort_GetTick();
+}
+
+int Ymodem_Poll(ymodem_t* ym)
+{
+    if (ym->state == YMODEM_STATE_DONE || ym->state == YMODEM_STATE_ERROR) {
+        return ym->result;
+    }
+    
+    while (1) {
+        uint32_t now = YmodemPort_GetTick();
         
-        if (state >= 1 && seq_no != 0) {
-            /* 数据包 */
-            uint32_t data_len = packet_size;
-            
-            /* 如果知道文件大小，裁剪最后一个包 */
-            if (filesize > 0 && received_bytes + data_len > filesize) {
-                data_len = filesize - received_bytes;
-            }
+        if (ym->header == 0) {
+            uint8_t header;
             
-            /* 调用数据回调 */
-            if (cb->on_data) {
-                if (cb->on_data(data, data_len) != 0) {
-                    YmodemPort_Log("[YMODEM] Data callback error\r\n");
-                    Ymodem_Cancel();
-                    return YMODEM_ERR_CALLBACK;
+            /* 读取包头 */
+            if (lwrb_read(ym->rb, &header, 1) != 1) {
+                if ((now - ym->tick) > ym->timeout_ms) {
+                    int ret = handle_timeout(ym);
+                    ym->tick = now;
+                    return ret;
                 }
+                return YMODEM_BUSY;
             }
             
-            received_bytes += data_len;
-            expected_seq = (expected_seq + 1) & 0xFF;
+            ym->tick = now;
+            ym->retry_count = 0;  /* 收到数据，重置重试计数 */
             
-            /* 进度显示 */
-            if (filesize > 0) {
-                YmodemPort_Log("\r[YMODEM] Progress: %lu/%lu (%lu%%)", 
-                       (unsigned long)received_bytes, (unsigned long)filesize,
-                       (unsigned long)(received_bytes * 100 / filesize));
+            /* 流式模式下接收缓冲区溢出意味着数据已丢失，无法重传 */
+            if (ym->streaming && YmodemPort_GetRxOverflow() != ym->overflow_base) {
+                YmodemPort_Log("[YMODEM] RX buffer overflow in streaming mode\r\n");
+                return stream_abort(ym, YMODEM_ERR_OVERFLOW);
             }
             
-            send_char(YMODEM_ACK);
-            continue;
+            if (header != YMODEM_SOH && header != YMODEM_STX) {
+                int ret = handle_control(ym, header);
+                if (ret != YMODEM_BUSY) return ret;
+                continue;
+            }
+            ym->header = header;
         }
         
-        if (state == 2 && seq_no == 0) {
-            /* 结束时的 packet 0 (空文件名) */
-            parse_file_info(data, packet_size, filename, &filesize);
-            
-            if (filename[0] == '\0') {
-                /* 传输完成 */
-                YmodemPort_Log("\r\n[YMODEM] Transfer complete: %lu bytes\r\n", (unsigned long)received_bytes);
-                
-                if (cb->on_end) {
-                    cb->on_end();
-                }
-                
-                send_char(YMODEM_ACK);
-                return YMODEM_OK;
+        /* 等待完整数据包 */
+        uint32_t packet_size = (ym->header == YMODEM_STX) ? YMODEM_PACKET_1K : YMODEM_PACKET_128;
+        if (lwrb_get_full(ym->rb) < 2 + packet_size + 2) {
+            if ((now - ym->tick) > INTER_CHAR_TIMEOUT * 10) {
+                YmodemPort_Log("[YMODEM] Incomplete packet\r\n");
+                ym->header = 0;
+                ym->tick = now;
+                if (ym->streaming) return stream_abort(ym, YMODEM_ERR_TIMEOUT);
+                send_char(YMODEM_NAK);
+                continue;
             }
+            return YMODEM_BUSY;
         }
         
-        /* 默认发送 ACK */
-        send_char(YMODEM_ACK);
+        ym->header = 0;
+        int ret = handle_packet(ym, packet_size);
+        if (ret != YMODEM_BUSY) return ret;
+        ym->tick = YmodemPort_GetTick();
+    }
+}
+
+void Ymodem_Abort(ymodem_t* ym, int code)
+{
+    if (ym->state == YMODEM_STATE_DONE || ym->state == YMODEM_STATE_ERROR) {
+        return;
     }
+    
+    YmodemPort_Log("[YMODEM] Transfer aborted (%d)\r\n", code);
+    Ymodem_Cancel();
+    if (ym->cb->on_error) ym->cb->on_error(code);
+    finish(ym, code);
+}
+
+int Ymodem_Receive(lwrb_t* rb, const ymodem_cb_t* cb, uint32_t timeout_ms)
+{
+    return Ymodem_ReceiveEx(rb, cb, timeout_ms, YMODEM_MODE_CRC);
+}
+
+int Ymodem_ReceiveEx(lwrb_t* rb, const ymodem_cb_t* cb, uint32_t timeout_ms, int mode)
+{
+    ymodem_t ym;
+    int ret;
+    
+    Ymodem_Init(&ym, rb, cb, timeout_ms, mode);
+    
+    /* 阻塞封装：无数据时让出 CPU，等待 DMA/UART 中断或 SysTick 唤醒 */
+    while ((ret = Ymodem_Poll(&ym)) == YMODEM_BUSY) {
+        YmodemPort_Idle();
+    }
+    
+    return ret;
 }
@@ -0,0 +1,187 @@
+/**
+  ******************************************************************************
+  * @file           : ymodem_crc16.c
+  * @brief          : YMODEM CRC16-CCITT 计算引擎实现
+  * @description    : CRC16 对输入是线性的，T_k[n] (字节 n 后跟 k 个 0 字节的
+  *                   CRC) 等于 n 各置位 bit 对应常量的异或，因此所有查表
+  *                   均可由预处理器在编译期展开为 const 数组，无需运行时初始化
+  ******************************************************************************
+  */
+
+#include "ymodem_crc16.h"
+
+#if (YMODEM_CRC16_ENGINE == YMODEM_CRC16_HW)
+#include "ymodem_port.h"
+#endif
+
+/*============================================================================
+ * 编译期查表生成
+ *============================================================================*/
+
+/* T_k[1 << i], i = 0..7 (即 bit0..bit7 单独置位时的表项) */
+#define CRC16_K0  0x1021u, 0x2042u, 0x4084u, 0x8108u, 0x1231u, 0x2462u, 0x48C4u, 0x9188u
+#define CRC16_K1  0x3331u, 0x6662u, 0xCCC4u, 0x89A9u, 0x0373u, 0x06E6u, 0x0DCCu, 0x1B98u
+#define CRC16_K2  0x3730u, 0x6E60u, 0xDCC0u, 0xA9A1u, 0x4363u, 0x86C6u, 0x1DADu, 0x3B5Au
+#define CRC16_K3  0x76B4u, 0xED68u, 0xCAF1u, 0x85C3u, 0x1BA7u, 0x374Eu, 0x6E9Cu, 0xDD38u
+#define CRC16_K4  0xAA51u, 0x4483u, 0x8906u, 0x022Du, 0x045Au, 0x08B4u, 0x1168u, 0x22D0u
+#define CRC16_K5  0x45A0u, 0x8B40u, 0x06A1u, 0x0D42u, 0x1A84u, 0x3508u, 0x6A10u, 0xD420u
+#define CRC16_K6  0xB861u, 0x60E3u, 0xC1C6u, 0x93ADu, 0x377Bu, 0x6EF6u, 0xDDECu, 0xABF9u
+#define CRC16_K7  0x47D3u, 0x8FA6u, 0x0F6Du, 0x1EDAu, 0x3DB4u, 0x7B68u, 0xF6D0u, 0xFD81u
+
+#define CRC16_LIN(n, b0, b1, b2, b3, b4, b5, b6, b7)                        \
+    (uint16_t)((((n) & 0x01u) ? (b0) : 0u) ^ (((n) & 0x02u) ? (b1) : 0u) ^   \
+               (((n) & 0x04u) ? (b2) : 0u) ^ (((n) & 0x08u) ? (b3) : 0u) ^   \
+               (((n) & 0x10u) ? (b4) : 0u) ^ (((n) & 0x20u) ? (b5) : 0u) ^   \
+               (((n) & 0x40u) ? (b6) : 0u) ^ (((n) & 0x80u) ? (b7) : 0u))
+
+/* k 以记号传递，避免常量列表在宏嵌套中被提前展开 */
+#define CRC16_ENTRY_(n, K)  CRC16_LIN(n, K)
+#define CRC16_ENTRY(n, k)   CRC16_ENTRY_(n, CRC16_K##k)
+
+#define CRC16_R4(n, k)   CRC16_ENTRY((n) + 0u, k), CRC16_ENTRY((n) + 1u, k), \
+                         CRC16_ENTRY((n) + 2u, k), CRC16_ENTRY((n) + 3u, k)
+#define CRC16_R16(n, k)  CRC16_R4((n) + 0u, k),  CRC16_R4((n) + 4u, k),      \
+                         CRC16_R4((n) + 8u, k),  CRC16_R4((n) + 12u, k)
+#define CRC16_R64(n, k)  CRC16_R16((n) + 0u, k), CRC16_R16((n) + 16u, k),    \
+                         CRC16_R16((n) + 32u, k), CRC16_R16((n) + 48u, k)
+#define CRC16_ROW(k)   { CRC16_R64(0u, k), CRC16_R64(64u, k),                \
+                         CRC16_R64(128u, k), CRC16_R64(192u, k) }
+
+/* 根据所选引擎决定需要的表行数 */
+#if (YMODEM_CRC16_ENGINE == YMODEM_CRC16_SLICE8) || defined(YMODEM_CRC16_ALL_ENGINES)
+#define CRC16_TAB_ROWS  8
+#elif (YMODEM_CRC16_ENGINE == YMODEM_CRC16_SLICE4)
+#define CRC16_TAB_ROWS  4
+#elif (YMODEM_CRC16_ENGINE == YMODEM_CRC16_TABLE)
+#define CRC16_TAB_ROWS  1
+#else
+#define CRC16_TAB_ROWS  0
+#endif
+
+#if (CRC16_TAB_ROWS > 0)
+static const uint16_t s_crc16_tab[CRC16_TAB_ROWS][256] = {
+    CRC16_ROW(0),
+#if (CRC16_TAB_ROWS > 1)
+    CRC16_ROW(1), CRC16_ROW(2), CRC16_ROW(3),
+#endif
+#if (CRC16_TAB_ROWS > 4)
+    CRC16_ROW(4), CRC16_ROW(5), CRC16_ROW(6), CRC16_ROW(7),
+#endif
+};
+
+/* 单字节查表步进 */
+#define CRC16_STEP(crc, b) \
+    (uint16_t)(((crc) << 8) ^ s_crc16_tab[0][(uint8_t)(((crc) >> 8) ^ (b))])
+#endif
+
+/*============================================================================
+ * 公共函数实现
+ *============================================================================*/
+
+/**
+ * @brief  逐位计算 CRC16
+ */
+uint16_t Ymodem_Crc16_Bitwise(uint16_t crc, const uint8_t* data, uint32_t len)
+{
+    while (len--) {
+        crc ^= (uint16_t)(*data++) << 8;
+        for (int i = 0; i < 8; i++) {
+            if (crc & 0x8000) {
+                crc = (crc << 1) ^ 0x1021;
+            } else {
+                crc <<= 1;
+            }
+        }
+    }
+
+    return crc;
+}
+
+#if (YMODEM_CRC16_ENGINE == YMODEM_CRC16_TABLE) || defined(YMODEM_CRC16_ALL_ENGINES)
+/**
+ * @brief  256 项查表计算 CRC16
+ */
+uint16_t Ymodem_Crc16_Table(uint16_t crc, const uint8_t* data, uint32_t len)
+{
+    while (len--) {
+        crc = CRC16_STEP(crc, *data++);
+    }
+
+    return crc;
+}
+#endif
+
+#if (YMODEM_CRC16_ENGINE == YMODEM_CRC16_SLICE4) || defined(YMODEM_CRC16_ALL_ENGINES)
+/**
+ * @brief  slicing-by-4 计算 CRC16
+ * @note   4 字节为一组：前 2 字节与当前 CRC 异或后查 T3/T2，后 2 字节查 T1/T0
+ */
+uint16_t Ymodem_Crc16_Slice4(uint16_t crc, const uint8_t* data, uint32_t len)
+{
+    while (len >= 4) {
+        uint32_t hi = (crc >> 8) ^ data[0];
+        uint32_t lo = (crc & 0xFFu) ^ data[1];
+        crc = s_crc16_tab[3][hi] ^ s_crc16_tab[2][lo] ^
+              s_crc16_tab[1][data[2]] ^ s_crc16_tab[0][data[3]];
+        data += 4;
+        len  -= 4;
+    }
+
+    while (len--) {
+        crc = CRC16_STEP(crc, *data++);
+    }
+
+    return crc;
+}
+#endif
+
+#if (YMODEM_CRC16_ENGINE == YMODEM_CRC16_SLICE8) || defined(YMODEM_CRC16_ALL_ENGINES)
+/**
+ * @brief  slicing-by-8 计算 CRC16
+ */
+uint16_t Ymodem_Crc16_Slice8(uint16_t crc, const uint8_t* data, uint32_t len)
+{
+    while (len >= 8) {
+        uint32_t hi = (crc >> 8) ^ data[0];
+        uint32_t lo = (crc & 0xFFu) ^ data[1];
+        crc = s_crc16_tab[7][hi]      ^ s_crc16_tab[6][lo]      ^
+              s_crc16_tab[5][data[2]] ^ s_crc16_tab[4][data[3]] ^
+              s_crc16_tab[3][data[4]] ^ s_crc16_tab[2][data[5]] ^
+              s_crc16_tab[1][data[6]] ^ s_crc16_tab[0][data[7]];
+        data += 8;
+        len  -= 8;
+    }
+
+    while (len--) {
+        crc = CRC16_STEP(crc, *data++);
+    }
+
+    return crc;
+}
+#endif
+
+/**
+ * @brief  续算 CRC16-CCITT (按编译期选择分派)
+ */
+uint16_t Ymodem_Crc16Update(uint16_t crc, const uint8_t* data, uint32_t len)
+{
+#if (YMODEM_CRC16_ENGINE == YMODEM_CRC16_HW)
+    return YmodemPort_HwCrc16(crc, data, len);
+#elif (YMODEM_CRC16_ENGINE == YMODEM_CRC16_SLICE8)
+    return Ymodem_Crc16_Slice8(crc, data, len);
+#elif (YMODEM_CRC16_ENGINE == YMODEM_CRC16_SLICE4)
+    return Ymodem_Crc16_Slice4(crc, data, len);
+#elif (YMODEM_CRC16_ENGINE == YMODEM_CRC16_TABLE)
+    return Ymodem_Crc16_Table(crc, data, len);
+#else
+    return Ymodem_Crc16_Bitwise(crc, data, len);
+#endif
+}
+
+/**
+ * @brief  计算 CRC16-CCITT
+ */
+uint16_t Ymodem_Crc16(const uint8_t* data, uint32_t len)
+{
+    return Ymodem_Crc16Update(0, data, len);
+}
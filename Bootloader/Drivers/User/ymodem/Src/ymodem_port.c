@@ -7,11 +7,17 @@
   */
 
 #include "ymodem_port.h"
+#include "ymodem_crc16.h"
 #include "lwrb.h"
 #include "usart.h"
+#include "crc.h"
 #include <stdio.h>
 #include <stdarg.h>
 
+/* 外部引用 (定义在 main.c) */
+extern volatile uint32_t uart_rb_overflow;
+extern HAL_StatusTypeDef UartDmaRx_SetBaud(uint32_t baud);
+
 /*============================================================================
  * 平台接口实现
  *============================================================================*/
@@ -38,6 +44,34 @@ void YmodemPort_UpdateRxHead(void* rb)
 }
 
 
+void YmodemPort_Idle(void)
+{
+    /* 休眠到下一个中断 (UART 空闲/DMA 或 SysTick)，避免空转占满 CPU */
+    __WFI();
+}
+
+uint32_t YmodemPort_GetRxOverflow(void)
+{
+    /* 由 HAL_UARTEx_RxEventCallback 在 lwrb_write 写不下时累加 */
+    return uart_rb_overflow;
+}
+
+uint32_t YmodemPort_GetBaud(void)
+{
+    return huart1.Init.BaudRate;
+}
+
+uint32_t YmodemPort_GetUartClock(void)
+{
+    /* USART1 时钟源为 D2PCLK2 (见 HAL_UART_MspInit) */
+    return HAL_RCC_GetPCLK2Freq();
+}
+
+int YmodemPort_SetBaud(uint32_t baud)
+{
+    return (UartDmaRx_SetBaud(baud) == HAL_OK) ? 0 : -1;
+}
+
 void YmodemPort_InvalidateCache(void* buf, uint32_t size)
 {
     /* STM32H7 有 D-Cache，需要 Invalidate */
@@ -45,6 +79,40 @@ void YmodemPort_InvalidateCache(void* buf, uint32_t size)
                                   (size + 31) & ~31U);
 }
 
+#if (YMODEM_CRC16_ENGINE == YMODEM_CRC16_HW)
+/**
+ * @brief  复用 CRC 外设计算 CRC16
+ * @note   hcrc 默认配置为 CRC32 (Boot_CalcImageCRC 使用)，
+ *         此处临时切换为 poly 0x1021 / 16-bit / 字节输入，计算完成后恢复
+ */
+uint16_t YmodemPort_HwCrc16(uint16_t crc, const uint8_t* data, uint32_t len)
+{
+    static CRC_HandleTypeDef hcrc16;
+    uint32_t result;
+
+    hcrc16.Instance                     = CRC;
+    hcrc16.Init.DefaultPolynomialUse    = DEFAULT_POLYNOMIAL_DISABLE;
+    hcrc16.Init.GeneratingPolynomial    = 0x1021u;
+    hcrc16.Init.CRCLength               = CRC_POLYLENGTH_16B;
+    hcrc16.Init.DefaultInitValueUse     = DEFAULT_INIT_VALUE_DISABLE;
+    hcrc16.Init.InitValue               = crc;
+    hcrc16.Init.InputDataInversionMode  = CRC_INPUTDATA_INVERSION_NONE;
+    hcrc16.Init.OutputDataInversionMode = CRC_OUTPUTDATA_INVERSION_DISABLE;
+    hcrc16.InputDataFormat              = CRC_INPUTDATA_FORMAT_BYTES;
+
+    if (HAL_CRC_Init(&hcrc16) != HAL_OK) {
+        return Ymodem_Crc16_Bitwise(crc, data, len);
+    }
+
+    result = HAL_CRC_Calculate(&hcrc16, (uint32_t*)data, len);
+
+    /* 恢复 CRC32 默认配置 */
+    HAL_CRC_Init(&hcrc);
+
+    return (uint16_t)result;
+}
+#endif
+
 void YmodemPort_Log(const char* fmt, ...)
 {
     //va_list args;
@@ -0,0 +1,204 @@
+/**
+  ******************************************************************************
+  * @file           : crc16_bench.c
+  * @brief          : YMODEM CRC16 引擎对比测试 (主机)
+  * @description    : 以 YMODEM_CRC16_ALL_ENGINES 编译 ymodem_crc16.c，
+  *                   在随机种子生成的缓冲区上 (随机长度、起始对齐与续算初值)
+  *                   检查 BITWISE/TABLE/SLICE4/SLICE8 的结果一致，
+  *                   再按 YMODEM 包长测量每个引擎的 bytes/cycle
+  * @usage          : crc16_bench [--seed N] [--cases N] [--iter N]
+  * @note           : x86 上周期数来自 TSC，其他平台按 1 cycle = 1 ns 计
+  ******************************************************************************
+  */
+
+#include "ymodem_crc16.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/*============================================================================
+ * 配置
+ *============================================================================*/
+
+#define MAX_LEN         2048u       /* 随机测试的最大长度 */
+#define ALIGN_SLACK     8u          /* 起始地址在 0..7 字节偏移之间变化 */
+
+/*============================================================================
+ * 数据类型
+ *============================================================================*/
+
+typedef uint16_t (*crc16_fn_t)(uint16_t crc, const uint8_t* data, uint32_t len);
+
+typedef struct {
+    const char* name;
+    crc16_fn_t  fn;
+} engine_t;
+
+static const engine_t s_engines[] = {
+    { "BITWISE", Ymodem_Crc16_Bitwise },
+    { "TABLE",   Ymodem_Crc16_Table },
+    { "SLICE4",  Ymodem_Crc16_Slice4 },
+    { "SLICE8",  Ymodem_Crc16_Slice8 },
+};
+
+#define ENGINE_COUNT    (sizeof(s_engines) / sizeof(s_engines[0]))
+
+static uint8_t s_buf[MAX_LEN + ALIGN_SLACK];
+
+/*============================================================================
+ * 工具函数
+ *============================================================================*/
+
+static uint32_t s_rng;
+
+/* xorshift32：结果只取决于 --seed，失败用例可以复现 */
+static uint32_t rng(void)
+{
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 17;
+    s_rng ^= s_rng << 5;
+    return s_rng;
+}
+
+static uint64_t cycles_now(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static uint64_t ns_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/*============================================================================
+ * 测试
+ *============================================================================*/
+
+/**
+ * @brief  一致性检查：已知向量 + 随机用例 (整段与两段续算)
+ * @retval 不一致的用例数
+ */
+static uint32_t check_engines(uint32_t cases)
+{
+    static const uint8_t vec[] = "123456789";
+    uint32_t failures = 0;
+
+    /* CRC-16/XMODEM 标准校验值 */
+    for (uint32_t e = 0; e < ENGINE_COUNT; e++) {
+        uint16_t crc = s_engines[e].fn(0, vec, 9);
+        if (crc != 0x31C3u) {
+            fprintf(stderr, "crc16: %s(\"123456789\") = 0x%04X, expected 0x31C3\n", s_engines[e].name, crc);
+            failures++;
+        }
+    }
+
+    for (uint32_t c = 0; c < cases; c++) {
+        uint32_t len  = rng() % (MAX_LEN + 1u);
+        uint32_t off  = rng() % ALIGN_SLACK;
+        uint32_t cut  = len ? rng() % (len + 1u) : 0;
+        uint16_t init = (c & 1u) ? (uint16_t)rng() : 0;
+        const uint8_t* p = s_buf + off;
+
+        for (uint32_t i = 0; i < len; i++) {
+            s_buf[off + i] = (uint8_t)rng();
+        }
+
+        uint16_t ref = Ymodem_Crc16_Bitwise(init, p, len);
+        for (uint32_t e = 0; e < ENGINE_COUNT; e++) {
+            uint16_t whole = s_engines[e].fn(init, p, len);
+            uint16_t split = s_engines[e].fn(s_engines[e].fn(init, p, cut), p + cut, len - cut);
+
+            if (whole != ref || split != ref) {
+                if (failures++ < 10) {
+                    fprintf(stderr, "crc16: case %u (len %u, offset %u, cut %u, init 0x%04X): "
+                            "%s whole 0x%04X split 0x%04X, BITWISE 0x%04X\n",
+                            c, len, off, cut, init, s_engines[e].name, whole, split, ref);
+                }
+            }
+        }
+    }
+    return failures;
+}
+
+/**
+ * @brief  吞吐量：每个引擎对 len 字节的缓冲区重复计算 iter 次
+ */
+static void bench_len(uint32_t len, uint32_t iter)
+{
+    volatile uint16_t sink = 0;
+
+    for (uint32_t i = 0; i < len; i++) {
+        s_buf[i] = (uint8_t)rng();
+    }
+
+    fprintf(stdout, "  %4u bytes:", len);
+    for (uint32_t e = 0; e < ENGINE_COUNT; e++) {
+        uint32_t n = (e == 0) ? (iter / 8u + 1u) : iter;      /* BITWISE 慢一个数量级 */
+        uint16_t crc = 0;
+
+        uint64_t t0 = ns_now();
+        uint64_t c0 = cycles_now();
+        for (uint32_t i = 0; i < n; i++) {
+            crc = s_engines[e].fn(crc, s_buf, len);
+        }
+        uint64_t dc = cycles_now() - c0;
+        uint64_t dt = ns_now() - t0;
+        sink ^= crc;
+
+        double bytes = (double)len * n;
+        fprintf(stdout, "  %s %.3f B/cyc (%.0f MB/s)", s_engines[e].name,
+                dc ? bytes / (double)dc : 0.0, dt ? bytes * 1e3 / (double)dt : 0.0);
+    }
+    fprintf(stdout, "\n");
+    (void)sink;
+}
+
+static void usage(const char* prog)
+{
+    fprintf(stderr, "usage: %s [--seed N] [--cases N] [--iter N]\n", prog);
+    exit(2);
+}
+
+int main(int argc, char** argv)
+{
+    static const uint32_t lens[] = { 128, 1024 };     /* YMODEM 数据包长度 */
+    uint32_t seed  = 1;
+    uint32_t cases = 100000;
+    uint32_t iter  = 20000;
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if      (!strcmp(a, "--seed") && v)  { seed = strtoul(v, NULL, 0); i++; }
+        else if (!strcmp(a, "--cases") && v) { cases = strtoul(v, NULL, 0); i++; }
+        else if (!strcmp(a, "--iter") && v)  { iter = strtoul(v, NULL, 0); i++; }
+        else usage(argv[0]);
+    }
+
+    s_rng = seed ? seed : 1u;
+
+    uint32_t failures = check_engines(cases);
+    fprintf(stdout, "crc16: seed %u, %u random cases x %u engines, %u mismatches\n",
+            seed, cases, (unsigned)ENGINE_COUNT, failures);
+    if (failures) {
+        return 1;
+    }
+
+    for (uint32_t i = 0; i < sizeof(lens) / sizeof(lens[0]); i++) {
+        bench_len(lens[i], iter);
+    }
+    return 0;
+}
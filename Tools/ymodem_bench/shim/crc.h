@@ -0,0 +1,15 @@
+/**
+  ******************************************************************************
+  * @file           : crc.h (主机仿真)
+  * @brief          : 对应 CubeMX 生成的 crc.h
+  ******************************************************************************
+  */
+
+#ifndef __CRC_H__
+#define __CRC_H__
+
+#include "stm32h7xx_hal.h"
+
+extern CRC_HandleTypeDef hcrc;
+
+#endif /* __CRC_H__ */
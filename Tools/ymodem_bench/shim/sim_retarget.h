@@ -0,0 +1,19 @@
+/**
+  ******************************************************************************
+  * @file           : sim_retarget.h (主机仿真)
+  * @brief          : 把 Bootloader 模块中的 printf 重定向到仿真串口
+  * @note           : 通过 -include 强制包含，与目标板上 printf 重定向到 USART1 一致，
+  *                   发送方看到的横幅 (BAUD? / RESUME) 和日志与真实设备相同
+  ******************************************************************************
+  */
+
+#ifndef __SIM_RETARGET_H
+#define __SIM_RETARGET_H
+
+#include <stdio.h>
+
+int SimUart_Printf(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+
+#define printf SimUart_Printf
+
+#endif /* __SIM_RETARGET_H */
@@ -0,0 +1,13 @@
+/**
+  ******************************************************************************
+  * @file           : stm32h7xx.h (主机仿真)
+  * @brief          : 对应 CMSIS 设备头文件，boot_slots.h 只需要 Flash 地址常量
+  ******************************************************************************
+  */
+
+#ifndef __STM32H7XX_H
+#define __STM32H7XX_H
+
+#include "stm32h7xx_hal.h"
+
+#endif /* __STM32H7XX_H */
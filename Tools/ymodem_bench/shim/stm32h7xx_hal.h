@@ -0,0 +1,196 @@
+/**
+  ******************************************************************************
+  * @file           : stm32h7xx_hal.h (主机仿真)
+  * @brief          : 在 Linux 上编译 Bootloader 模块所需的最小 HAL 子集
+  * @description    : CRC 外设用软件实现 (默认配置：poly 0x04C11DB7，按字输入)；
+  *                   MDMA 只支持把数据写入 CRC->DR (在线程中遍历链表)；
+  *                   Flash 只保留地址常量，操作经 flash_port.h (见 sim_flash.c)
+  * @note           : 仅用于 ymodem_bench，实现见 sim_hal.c
+  ******************************************************************************
+  */
+
+#ifndef __STM32H7XX_HAL_H
+#define __STM32H7XX_HAL_H
+
+#include <sched.h>
+#include <stdint.h>
+
+/*============================================================================
+ * 状态码
+ *============================================================================*/
+
+typedef enum {
+    HAL_OK      = 0x00,
+    HAL_ERROR   = 0x01,
+    HAL_BUSY    = 0x02,
+    HAL_TIMEOUT = 0x03
+} HAL_StatusTypeDef;
+
+/*============================================================================
+ * Flash 地址 (与 STM32H743 相同；编程/擦除经 flash_port.h，由 sim_flash.c 实现)
+ *============================================================================*/
+
+#define FLASH_BANK1_BASE            0x08000000u
+#define FLASH_BANK2_BASE            0x08100000u
+#define FLASH_BANK_SIZE             0x00100000u
+
+/*============================================================================
+ * CRC
+ *============================================================================*/
+
+typedef struct {
+    volatile uint32_t DR;
+    volatile uint32_t INIT;
+} CRC_TypeDef;
+
+typedef struct {
+    CRC_TypeDef* Instance;
+} CRC_HandleTypeDef;
+
+/* 硬件复位 DR 时载入 INIT */
+#define __HAL_CRC_DR_RESET(h)   ((h)->Instance->DR = (h)->Instance->INIT)
+
+uint32_t HAL_CRC_Accumulate(CRC_HandleTypeDef* hcrc, uint32_t pBuffer[], uint32_t BufferLength);
+
+/*============================================================================
+ * 内核 (中断/Cache 无意义，DWT 周期计数器由单调时钟换算)
+ *============================================================================*/
+
+extern uint32_t SystemCoreClock;
+
+uint32_t HAL_GetTick(void);
+
+#define __disable_irq()                     ((void)0)
+#define __enable_irq()                      ((void)0)
+#define __WFI()                             sched_yield()
+#define SCB_InvalidateDCache_by_Addr(a, n)  ((void)(a), (void)(n))
+#define SCB_CleanDCache_by_Addr(a, n)       ((void)(a), (void)(n))
+#define HAL_NVIC_SetPriority(irq, p, s)     ((void)(irq), (void)(p), (void)(s))
+#define HAL_NVIC_EnableIRQ(irq)             ((void)(irq))
+
+typedef struct {
+    uint32_t DEMCR;
+} CoreDebug_Type;
+
+typedef struct {
+    uint32_t CTRL;
+    uint32_t CYCCNT;
+    uint32_t LAR;
+} DWT_Type;
+
+#define CoreDebug_DEMCR_TRCENA_Msk  (1u << 24)
+#define DWT_CTRL_CYCCNTENA_Msk      (1u << 0)
+
+/* 每次访问 DWT 时刷新 CYCCNT，读取即为当前周期数 */
+DWT_Type*       SimHal_Dwt(void);
+CoreDebug_Type* SimHal_CoreDebug(void);
+
+#define DWT         (SimHal_Dwt())
+#define CoreDebug   (SimHal_CoreDebug())
+
+/*============================================================================
+ * RTC 备份寄存器 (启动校验的定期复查计数；进程内保持，相当于备份域不掉电)
+ *============================================================================*/
+
+typedef struct {
+    volatile uint32_t BKP0R;
+    volatile uint32_t BKP1R;
+} RTC_TypeDef;
+
+RTC_TypeDef* SimHal_Rtc(void);
+
+#define RTC                             (SimHal_Rtc())
+#define __HAL_RCC_RTC_CLK_ENABLE()      ((void)0)
+#define HAL_PWR_EnableBkUpAccess()      ((void)0)
+
+/*============================================================================
+ * MDMA (启动镜像 CRC 校验；目的地址固定为 CRC->DR，按字累加)
+ *============================================================================*/
+
+typedef struct {
+    volatile uint32_t CCR;
+    volatile uint32_t CLAR;                 /* 第一个链表节点 */
+} MDMA_Channel_TypeDef;
+
+typedef struct {
+    uint32_t Request;
+    uint32_t TransferTriggerMode;
+    uint32_t Priority;
+    uint32_t Endianness;
+    uint32_t SourceInc;
+    uint32_t DestinationInc;
+    uint32_t SourceDataSize;
+    uint32_t DestDataSize;
+    uint32_t DataAlignment;
+    uint32_t BufferTransferLength;
+    uint32_t SourceBurst;
+    uint32_t DestBurst;
+    int32_t  SourceBlockAddressOffset;
+    int32_t  DestBlockAddressOffset;
+} MDMA_InitTypeDef;
+
+/* 与 HAL 相同的节点布局 (只使用 CBNDTR/CSAR/CDAR/CLAR) */
+typedef struct {
+    volatile uint32_t CTCR;
+    volatile uint32_t CBNDTR;
+    volatile uint32_t CSAR;
+    volatile uint32_t CDAR;
+    volatile uint32_t CBRUR;
+    volatile uint32_t CLAR;
+    volatile uint32_t CTBR;
+    volatile uint32_t Reserved;
+    volatile uint32_t CMAR;
+    volatile uint32_t CMDR;
+} MDMA_LinkNodeTypeDef;
+
+typedef struct {
+    MDMA_InitTypeDef Init;
+    uint32_t PostRequestMaskAddress;
+    uint32_t PostRequestMaskData;
+    uint32_t SrcAddress;
+    uint32_t DstAddress;
+    uint32_t BlockDataLength;
+    uint32_t BlockCount;
+} MDMA_LinkNodeConfTypeDef;
+
+typedef struct __MDMA_HandleTypeDef {
+    MDMA_Channel_TypeDef* Instance;
+    MDMA_InitTypeDef      Init;
+    void (*XferCpltCallback)(struct __MDMA_HandleTypeDef* hmdma);
+    void (*XferErrorCallback)(struct __MDMA_HandleTypeDef* hmdma);
+    MDMA_LinkNodeTypeDef* FirstLinkedListNodeAddress;
+    MDMA_LinkNodeTypeDef* LastLinkedListNodeAddress;
+    uint32_t              ErrorCode;
+} MDMA_HandleTypeDef;
+
+/* 配置常量在仿真中不起作用 */
+#define MDMA_REQUEST_SW                     0u
+#define MDMA_FULL_TRANSFER                  0u
+#define MDMA_PRIORITY_HIGH                  0u
+#define MDMA_LITTLE_ENDIANNESS_PRESERVE     0u
+#define MDMA_SRC_INC_WORD                   0u
+#define MDMA_DEST_INC_DISABLE               0u
+#define MDMA_SRC_DATASIZE_WORD              0u
+#define MDMA_DEST_DATASIZE_WORD             0u
+#define MDMA_DATAALIGN_PACKENABLE           0u
+#define MDMA_SOURCE_BURST_16BEATS           0u
+#define MDMA_DEST_BURST_SINGLE              0u
+#define MDMA_IRQn                           0
+#define __HAL_RCC_MDMA_CLK_ENABLE()         ((void)0)
+
+MDMA_Channel_TypeDef* SimHal_MdmaChannel(void);
+
+#define MDMA_Channel0                       (SimHal_MdmaChannel())
+
+HAL_StatusTypeDef HAL_MDMA_Init(MDMA_HandleTypeDef* hmdma);
+HAL_StatusTypeDef HAL_MDMA_DeInit(MDMA_HandleTypeDef* hmdma);
+HAL_StatusTypeDef HAL_MDMA_LinkedList_CreateNode(MDMA_LinkNodeTypeDef* pNode, MDMA_LinkNodeConfTypeDef* pNodeConfig);
+HAL_StatusTypeDef HAL_MDMA_LinkedList_AddNode(MDMA_HandleTypeDef* hmdma, MDMA_LinkNodeTypeDef* pNewNode,
+                                              const MDMA_LinkNodeTypeDef* pPrevNode);
+HAL_StatusTypeDef HAL_MDMA_Start_IT(MDMA_HandleTypeDef* hmdma, uint32_t SrcAddress, uint32_t DstAddress,
+                                    uint32_t BlockDataLength, uint32_t BlockCount);
+HAL_StatusTypeDef HAL_MDMA_Abort(MDMA_HandleTypeDef* hmdma);
+void              HAL_MDMA_IRQHandler(MDMA_HandleTypeDef* hmdma);
+uint32_t          HAL_MDMA_GetError(const MDMA_HandleTypeDef* hmdma);
+
+#endif /* __STM32H7XX_HAL_H */
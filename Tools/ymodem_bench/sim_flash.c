@@ -0,0 +1,359 @@
+/**
+  ******************************************************************************
+  * @file           : sim_flash.c
+  * @brief          : flash_port.h 的主机实现：内存模拟的双 Bank Flash
+  * @description    : 物理存储为 2MB (两个 1MB Bank) 加一页 Option Bytes，
+  *                   位于 memfd 或 --flash 后备文件中 (后者跨进程保留内容，
+  *                   用于测试续传与交换后的启动)。两个 Bank 按 SWAP_BANK
+  *                   共享映射到逻辑地址 0x08000000 / 0x08100000，
+  *                   FlashPort_SetSwap 重新映射，与 Option Bytes 重载后的
+  *                   地址别名一致。
+  *                   编程按 32B flash word 进行，目标不是擦除状态时报错；
+  *                   编程/擦除按配置的时间阻塞调用线程，串口线程照常接收，
+  *                   与目标板上 DMA 接收的行为一致。后台擦除由线程完成后
+  *                   调用回调 (相当于 FLASH 中断)，期间拒绝其他 Flash 操作。
+  *                   可对指定 flash word 注入一次编程故障 (数据位翻转或
+  *                   ECC 纠错)，用于验证读回校验与断点回退
+  ******************************************************************************
+  */
+
+#include "sim_flash.h"
+#include "sim_hal.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define SIM_BANK_SIZE       FLASH_BANK_SIZE
+#define SIM_FLASH_SIZE      (2u * SIM_BANK_SIZE)
+#define SIM_OB_SIZE         0x1000u              /* Option Bytes 页 (物理存储末尾) */
+#define SIM_STORE_SIZE      (SIM_FLASH_SIZE + SIM_OB_SIZE)
+#define SIM_OB_SWAP_ON      0x00000001u          /* 其他值 (含擦除态 0xFFFFFFFF) 视为不交换 */
+
+/* 每个逻辑 Bank 的 ECC 状态 (对应 FLASH_SR1/2 与 FLASH_ECC_FA1/2) */
+typedef struct {
+    int      flag;              /* FLASH_PORT_ECC_xxx */
+    uint32_t fail_addr;         /* 出错的 flash word 地址 */
+} sim_ecc_t;
+
+/*============================================================================
+ * 静态变量
+ *============================================================================*/
+
+static sim_flash_cfg_t       s_cfg;
+static sim_flash_stats_t     s_stats;
+static int                   s_fd = -1;
+static int                   s_swap;
+static volatile int          s_erase_busy;      /* 后台擦除进行中 */
+static sim_ecc_t             s_ecc[2];
+
+static uint32_t              s_erase_addr;
+static uint32_t              s_erase_t0;
+static volatile flash_port_erase_cb_t s_erase_cb;  /* NULL=已取消或无擦除 */
+
+/*============================================================================
+ * 内部函数
+ *============================================================================*/
+
+static int addr_valid(uint32_t addr, uint32_t len)
+{
+    return addr >= FLASH_BANK1_BASE && len <= SIM_FLASH_SIZE &&
+           addr - FLASH_BANK1_BASE <= SIM_FLASH_SIZE - len;
+}
+
+static sim_ecc_t* ecc_of(uint32_t addr)
+{
+    return &s_ecc[(addr >= FLASH_BANK2_BASE) ? 1 : 0];
+}
+
+/**
+ * @brief  按 SWAP_BANK 映射两个 Bank
+ * @param  fixed: MAP_FIXED_NOREPLACE (首次) 或 MAP_FIXED (替换现有映射)
+ */
+static int map_banks(int fixed)
+{
+    off_t off1 = s_swap ? SIM_BANK_SIZE : 0;
+    off_t off2 = s_swap ? 0 : SIM_BANK_SIZE;
+    void* p1 = mmap((void*)(uintptr_t)FLASH_BANK1_BASE, SIM_BANK_SIZE,
+                    PROT_READ | PROT_WRITE, MAP_SHARED | fixed, s_fd, off1);
+    void* p2 = mmap((void*)(uintptr_t)FLASH_BANK2_BASE, SIM_BANK_SIZE,
+                    PROT_READ | PROT_WRITE, MAP_SHARED | fixed, s_fd, off2);
+
+    if (p1 != (void*)(uintptr_t)FLASH_BANK1_BASE || p2 != (void*)(uintptr_t)FLASH_BANK2_BASE) {
+        fprintf(stderr, "sim: cannot map flash at 0x%08X\n", FLASH_BANK1_BASE);
+        return -1;
+    }
+    return 0;
+}
+
+static int ob_write_swap(int enable)
+{
+    uint32_t ob = enable ? SIM_OB_SWAP_ON : 0;
+    return (pwrite(s_fd, &ob, sizeof(ob), SIM_FLASH_SIZE) == (ssize_t)sizeof(ob)) ? 0 : -1;
+}
+
+/**
+ * @brief  擦除一个扇区 (阻塞指定时间)
+ */
+static void erase_one(uint32_t addr)
+{
+    uint64_t t0 = SimHal_GetTimeUs();
+    SimHal_BusyWaitUs(s_cfg.erase_ms * 1000u);
+    memset((void*)(uintptr_t)(addr & ~(FLASH_PORT_SECTOR_SIZE - 1u)), 0xFF, FLASH_PORT_SECTOR_SIZE);
+
+    s_stats.erases++;
+    s_stats.erase_us += SimHal_GetTimeUs() - t0;
+}
+
+static void* erase_thread(void* arg)
+{
+    flash_port_erase_cb_t cb;
+    (void)arg;
+
+    erase_one(s_erase_addr);
+
+    /* 与 HAL 实现相同：先解除忙状态，再在 "中断" 中记录统计并回调 (已取消时不回调) */
+    cb = s_erase_cb;
+    s_erase_cb = NULL;
+    s_erase_busy = 0;
+    if (cb) {
+        FlashPort_StatsRecord(FLASH_OP_ERASE, s_erase_addr, FLASH_PORT_SECTOR_SIZE,
+                              FlashPort_StatsNow() - s_erase_t0, 1);
+        cb(0, 0);
+    }
+    return NULL;
+}
+
+/*============================================================================
+ * 仿真控制
+ *============================================================================*/
+
+int SimFlash_Init(const sim_flash_cfg_t* cfg)
+{
+    uint32_t ob = 0xFFFFFFFFu;
+    off_t size = 0;
+
+    s_cfg = *cfg;
+    memset(&s_stats, 0, sizeof(s_stats));
+    memset(s_ecc, 0, sizeof(s_ecc));
+
+    if (cfg->flash_file) {
+        s_fd = open(cfg->flash_file, O_RDWR | O_CREAT, 0644);
+        if (s_fd >= 0) size = lseek(s_fd, 0, SEEK_END);
+    } else {
+        s_fd = memfd_create("sim_flash", 0);
+    }
+    if (s_fd < 0) {
+        perror(cfg->flash_file ? cfg->flash_file : "memfd_create");
+        return -1;
+    }
+
+    /* 新建的存储为全 0xFF (已擦除)；旧版本的 2MB 后备文件补上 Option Bytes 页 */
+    if (size < (off_t)SIM_STORE_SIZE) {
+        static uint8_t ff[SIM_OB_SIZE];
+        memset(ff, 0xFF, sizeof(ff));
+        for (off_t off = size; off < (off_t)SIM_STORE_SIZE; off += sizeof(ff)) {
+            if (pwrite(s_fd, ff, sizeof(ff), off) != (ssize_t)sizeof(ff)) {
+                perror("sim: flash store");
+                return -1;
+            }
+        }
+    }
+
+    /* 模拟上一次升级留下的镜像：Bootloader 扇区与 trailer 扇区保持擦除态 */
+    if (size == 0 && cfg->dirty) {
+        static uint8_t old[FLASH_PORT_SECTOR_SIZE];
+        memset(old, 0x5A, sizeof(old));
+        for (uint32_t bank = 0; bank < SIM_FLASH_SIZE; bank += SIM_BANK_SIZE) {
+            for (uint32_t off = FLASH_PORT_SECTOR_SIZE; off < SIM_BANK_SIZE - FLASH_PORT_SECTOR_SIZE;
+                 off += FLASH_PORT_SECTOR_SIZE) {
+                if (pwrite(s_fd, old, sizeof(old), bank + off) != (ssize_t)sizeof(old)) {
+                    perror("sim: flash store");
+                    return -1;
+                }
+            }
+        }
+    }
+
+    if (cfg->swap >= 0 && ob_write_swap(cfg->swap) != 0) {
+        perror("sim: option bytes");
+        return -1;
+    }
+    if (pread(s_fd, &ob, sizeof(ob), SIM_FLASH_SIZE) != (ssize_t)sizeof(ob)) {
+        perror("sim: option bytes");
+        return -1;
+    }
+    s_swap = (ob == SIM_OB_SWAP_ON);
+
+    return map_banks(MAP_FIXED_NOREPLACE);
+}
+
+const sim_flash_stats_t* SimFlash_GetStats(void)
+{
+    return &s_stats;
+}
+
+/*============================================================================
+ * flash_port.h 实现
+ *============================================================================*/
+
+/**
+ * @brief  编程连续的 flash word
+ * @note   目标必须已擦除：真实器件上重复编程会破坏 ECC，这里直接报错
+ */
+int FlashPort_Program(uint32_t addr, const void* data, uint32_t len, uint32_t flags)
+{
+    const uint8_t* src = (const uint8_t*)data;
+    (void)flags;
+
+    if (!data || (addr % FLASH_PORT_WORD_SIZE) != 0 || (len % FLASH_PORT_WORD_SIZE) != 0 ||
+        !addr_valid(addr, len)) {
+        return -1;
+    }
+    if (s_erase_busy) {
+        s_stats.busy_rejects++;
+        return -2;
+    }
+
+    uint32_t c0 = FlashPort_StatsNow();
+
+    for (uint32_t off = 0; off < len; off += FLASH_PORT_WORD_SIZE) {
+        uint32_t a = addr + off;
+        uint8_t* dst = (uint8_t*)(uintptr_t)a;
+
+        for (uint32_t i = 0; i < FLASH_PORT_WORD_SIZE; i++) {
+            if (dst[i] != 0xFF) {
+                s_stats.program_errors++;
+                FlashPort_StatsRecord(FLASH_OP_PROGRAM, addr, len, 0, 0);
+                return -2;
+            }
+        }
+
+        uint64_t t0 = SimHal_GetTimeUs();
+        SimHal_BusyWaitUs(s_cfg.program_us);
+        memcpy(dst, src + off, FLASH_PORT_WORD_SIZE);
+
+        /* 故障注入只触发一次，重新擦除后再编程即恢复正常 */
+        if (s_cfg.corrupt_addr == a) {
+            dst[FLASH_PORT_WORD_SIZE / 2] ^= 0x10u;
+            s_cfg.corrupt_addr = 0;
+            s_stats.injected_faults++;
+        }
+        if (s_cfg.ecc_addr == a) {
+            /* 真实器件在读回时置位；仿真无法拦截读访问，编程完成即置位 */
+            ecc_of(a)->flag = FLASH_PORT_ECC_SINGLE;
+            ecc_of(a)->fail_addr = a;
+            s_cfg.ecc_addr = 0;
+            s_stats.injected_faults++;
+        }
+
+        s_stats.programs++;
+        s_stats.program_us += SimHal_GetTimeUs() - t0;
+    }
+
+    FlashPort_StatsRecord(FLASH_OP_PROGRAM, addr, len, FlashPort_StatsNow() - c0, 1);
+    return 0;
+}
+
+int FlashPort_EraseSector(uint32_t addr)
+{
+    if (!addr_valid(addr, 1)) return -1;
+    if (s_erase_busy) {
+        s_stats.busy_rejects++;
+        return -1;
+    }
+
+    uint32_t c0 = FlashPort_StatsNow();
+    erase_one(addr);
+    FlashPort_StatsRecord(FLASH_OP_ERASE, addr, FLASH_PORT_SECTOR_SIZE, FlashPort_StatsNow() - c0, 1);
+    return 0;
+}
+
+/**
+ * @brief  后台擦除：线程按配置时间擦除，完成后调用回调
+ */
+int FlashPort_EraseStart(uint32_t addr, flash_port_erase_cb_t cb)
+{
+    pthread_t th;
+
+    if (!cb || !addr_valid(addr, 1)) return -1;
+    if (s_erase_busy) {
+        s_stats.busy_rejects++;
+        return -1;
+    }
+
+    s_erase_addr = addr;
+    s_erase_t0   = FlashPort_StatsNow();
+    s_erase_cb   = cb;
+    s_erase_busy = 1;
+    if (pthread_create(&th, NULL, erase_thread, NULL) != 0) {
+        s_erase_cb   = NULL;
+        s_erase_busy = 0;
+        return -1;
+    }
+    pthread_detach(th);
+    return 0;
+}
+
+/**
+ * @brief  放弃等待后台擦除：不再回调，等待擦除线程结束
+ */
+int FlashPort_EraseCancel(uint32_t timeout_ms)
+{
+    uint64_t end = SimHal_GetTimeUs() + (uint64_t)timeout_ms * 1000u;
+
+    s_erase_cb = NULL;
+    while (s_erase_busy) {
+        if (SimHal_GetTimeUs() > end) return -1;
+        SimHal_BusyWaitUs(1000);
+    }
+    FlashPort_StatsRecord(FLASH_OP_ERASE, s_erase_addr, FLASH_PORT_SECTOR_SIZE,
+                          FlashPort_StatsNow() - s_erase_t0, 0);
+    return 0;
+}
+
+void FlashPort_InvalidateCache(uint32_t addr, uint32_t len)
+{
+    (void)addr;
+    (void)len;
+}
+
+void FlashPort_EccClear(uint32_t addr)
+{
+    ecc_of(addr)->flag = FLASH_PORT_ECC_NONE;
+}
+
+int FlashPort_EccCheck(uint32_t addr, uint32_t* fail_addr)
+{
+    sim_ecc_t* e = ecc_of(addr);
+    int result = e->flag;
+
+    if (result != FLASH_PORT_ECC_NONE) {
+        *fail_addr = e->fail_addr;
+        e->flag = FLASH_PORT_ECC_NONE;
+    }
+    return result;
+}
+
+int FlashPort_GetSwap(void)
+{
+    return s_swap;
+}
+
+/**
+ * @brief  写入 SWAP_BANK 并立即重新映射 (目标板上此时会复位)
+ */
+int FlashPort_SetSwap(int enable)
+{
+    if (s_erase_busy) {
+        s_stats.busy_rejects++;
+        return -2;
+    }
+    if (ob_write_swap(enable) != 0) return -1;
+
+    s_swap = enable ? 1 : 0;
+    s_stats.swaps++;
+    return (map_banks(MAP_FIXED) == 0) ? 0 : -2;
+}
@@ -0,0 +1,44 @@
+/**
+  ******************************************************************************
+  * @file           : sim_flash.h
+  * @brief          : 主机仿真 Flash (flash_port.h 的主机实现) 的控制接口
+  ******************************************************************************
+  */
+
+#ifndef __SIM_FLASH_H
+#define __SIM_FLASH_H
+
+#include <stdint.h>
+#include "flash_port.h"
+
+typedef struct {
+    uint32_t    program_us;     /* 每个 flash word (32B) 的编程时间 */
+    uint32_t    erase_ms;       /* 每个扇区 (128KB) 的擦除时间 */
+    const char* flash_file;     /* Flash 后备文件 (NULL=不保留内容) */
+    uint32_t    corrupt_addr;   /* 首次编程该 flash word 时翻转一位 (0=不注入) */
+    uint32_t    ecc_addr;       /* 首次编程该 flash word 后置单位 ECC 纠错标志 (0=不注入) */
+    int         swap;           /* 启动时的 SWAP_BANK 选项 (-1=沿用后备文件中的值，默认不交换) */
+    int         dirty;          /* 新建存储时两个 Bank 的 App 扇区填入旧内容 (非擦除态)，使每个扇区都要真正擦除 */
+} sim_flash_cfg_t;
+
+typedef struct {
+    uint32_t programs;          /* 编程的 flash word 数 */
+    uint32_t program_errors;    /* 对未擦除区域编程的次数 */
+    uint64_t program_us;        /* 编程累计耗时 */
+    uint32_t erases;            /* 擦除的扇区数 */
+    uint64_t erase_us;          /* 擦除累计耗时 */
+    uint32_t busy_rejects;      /* 后台擦除期间被拒绝的 Flash 操作 (固件应先等待) */
+    uint32_t injected_faults;   /* 已注入的编程故障数 */
+    uint32_t swaps;             /* FlashPort_SetSwap 次数 */
+} sim_flash_stats_t;
+
+/**
+ * @brief  建立物理存储并按 SWAP_BANK 把两个 Bank 映射到 0x08000000 / 0x08100000
+ * @retval 0=成功, <0=失败 (地址已被占用或后备文件不可用)
+ * @note   需先调用 SimHal_Init (时间基准)
+ */
+int SimFlash_Init(const sim_flash_cfg_t* cfg);
+
+const sim_flash_stats_t* SimFlash_GetStats(void);
+
+#endif /* __SIM_FLASH_H */
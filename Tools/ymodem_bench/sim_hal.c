@@ -0,0 +1,248 @@
+/**
+  ******************************************************************************
+  * @file           : sim_hal.c
+  * @brief          : 主机仿真 HAL：CRC、时基、DWT、MDMA
+  * @description    : Flash 由 sim_flash.c (flash_port.h 的主机实现) 模拟；
+  *                   这里只保留固件直接使用的 HAL 子集
+  ******************************************************************************
+  */
+
+#include "sim_hal.h"
+#include <pthread.h>
+#include <time.h>
+
+/*============================================================================
+ * 全局变量
+ *============================================================================*/
+
+uint32_t SystemCoreClock = 480000000u;
+
+static uint64_t        s_t0_ns;
+static DWT_Type        s_dwt;
+static CoreDebug_Type  s_core_debug;
+static RTC_TypeDef     s_rtc;
+
+/* MDMA：每次传输在一个线程中完成，结束时直接调用完成回调 (相当于中断) */
+static MDMA_Channel_TypeDef s_mdma_ch;
+static pthread_t            s_mdma_tid;
+static int                  s_mdma_started;
+
+typedef struct {
+    MDMA_HandleTypeDef* hmdma;
+    uint32_t src, dst, len;
+} sim_mdma_job_t;
+
+static sim_mdma_job_t s_mdma_job;
+
+/*============================================================================
+ * 内部函数
+ *============================================================================*/
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t crc32_word(uint32_t crc, uint32_t word)
+{
+    crc ^= word;
+    for (int i = 0; i < 32; i++) {
+        crc = (crc & 0x80000000u) ? (crc << 1) ^ 0x04C11DB7u : (crc << 1);
+    }
+    return crc;
+}
+
+/*============================================================================
+ * 仿真控制
+ *============================================================================*/
+
+void SimHal_Init(void)
+{
+    s_t0_ns = now_ns();
+}
+
+uint64_t SimHal_GetTimeUs(void)
+{
+    return (now_ns() - s_t0_ns) / 1000u;
+}
+
+/**
+ * @brief  阻塞指定时间 (模拟 Flash 忙等待，期间不处理任何事件)
+ * @note   短于 2ms 时自旋等待，nanosleep 的唤醒延迟会明显拉长单字编程时间
+ */
+void SimHal_BusyWaitUs(uint32_t us)
+{
+    if (us == 0) return;
+
+    if (us >= 2000u) {
+        struct timespec ts = { us / 1000000u, (long)(us % 1000000u) * 1000 };
+        while (nanosleep(&ts, &ts) != 0) {
+        }
+        return;
+    }
+
+    uint64_t end = now_ns() + (uint64_t)us * 1000u;
+    while (now_ns() < end) {
+    }
+}
+
+/*============================================================================
+ * HAL 实现
+ *============================================================================*/
+
+uint32_t HAL_GetTick(void)
+{
+    return (uint32_t)((now_ns() - s_t0_ns) / 1000000u);
+}
+
+/**
+ * @brief  CRC32 累加 (按字输入，每字从 bit31 开始，与 fill_hdr_crc.py 一致)
+ */
+uint32_t HAL_CRC_Accumulate(CRC_HandleTypeDef* hcrc, uint32_t pBuffer[], uint32_t BufferLength)
+{
+    uint32_t crc = hcrc->Instance->DR;
+
+    for (uint32_t i = 0; i < BufferLength; i++) {
+        crc = crc32_word(crc, pBuffer[i]);
+    }
+    hcrc->Instance->DR = crc;
+    return crc;
+}
+
+DWT_Type* SimHal_Dwt(void)
+{
+    s_dwt.CYCCNT = (uint32_t)((now_ns() - s_t0_ns) * (SystemCoreClock / 1000000u) / 1000u);
+    return &s_dwt;
+}
+
+CoreDebug_Type* SimHal_CoreDebug(void)
+{
+    return &s_core_debug;
+}
+
+RTC_TypeDef* SimHal_Rtc(void)
+{
+    return &s_rtc;
+}
+
+MDMA_Channel_TypeDef* SimHal_MdmaChannel(void)
+{
+    return &s_mdma_ch;
+}
+
+/*============================================================================
+ * MDMA 仿真 (只支持 SW 请求 + 整个链表一次传完，目的地址固定为 CRC->DR)
+ *============================================================================*/
+
+static void mdma_feed_crc(uint32_t src, uint32_t dst, uint32_t len)
+{
+    volatile uint32_t* dr = (volatile uint32_t*)(uintptr_t)dst;
+    const uint32_t*    p  = (const uint32_t*)(uintptr_t)src;
+    uint32_t crc = *dr;
+
+    for (uint32_t i = 0; i < len / 4; i++) {
+        crc = crc32_word(crc, p[i]);
+    }
+    *dr = crc;
+}
+
+static void* mdma_thread(void* arg)
+{
+    sim_mdma_job_t* job = (sim_mdma_job_t*)arg;
+    const MDMA_LinkNodeTypeDef* node;
+
+    mdma_feed_crc(job->src, job->dst, job->len);
+    for (node = (const MDMA_LinkNodeTypeDef*)(uintptr_t)job->hmdma->Instance->CLAR; node;
+         node = (const MDMA_LinkNodeTypeDef*)(uintptr_t)node->CLAR) {
+        mdma_feed_crc(node->CSAR, node->CDAR, node->CBNDTR & 0x1FFFFu);
+    }
+
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (job->hmdma->XferCpltCallback) {
+        job->hmdma->XferCpltCallback(job->hmdma);
+    }
+    return NULL;
+}
+
+static void mdma_join(void)
+{
+    if (s_mdma_started) {
+        pthread_join(s_mdma_tid, NULL);
+        s_mdma_started = 0;
+    }
+}
+
+HAL_StatusTypeDef HAL_MDMA_Init(MDMA_HandleTypeDef* hmdma)
+{
+    hmdma->ErrorCode = 0;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_MDMA_DeInit(MDMA_HandleTypeDef* hmdma)
+{
+    mdma_join();
+    hmdma->Instance->CLAR = 0;
+    hmdma->FirstLinkedListNodeAddress = NULL;
+    hmdma->LastLinkedListNodeAddress  = NULL;
+    hmdma->XferCpltCallback  = NULL;
+    hmdma->XferErrorCallback = NULL;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_MDMA_LinkedList_CreateNode(MDMA_LinkNodeTypeDef* pNode, MDMA_LinkNodeConfTypeDef* pNodeConfig)
+{
+    if (pNodeConfig->BlockDataLength == 0 || pNodeConfig->BlockDataLength > 65536u) return HAL_ERROR;
+
+    pNode->CBNDTR = pNodeConfig->BlockDataLength;
+    pNode->CSAR   = pNodeConfig->SrcAddress;
+    pNode->CDAR   = pNodeConfig->DstAddress;
+    pNode->CLAR   = 0;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_MDMA_LinkedList_AddNode(MDMA_HandleTypeDef* hmdma, MDMA_LinkNodeTypeDef* pNewNode,
+                                              const MDMA_LinkNodeTypeDef* pPrevNode)
+{
+    if (pPrevNode != NULL) return HAL_ERROR;        /* 仿真只支持追加到末尾 */
+
+    pNewNode->CLAR = 0;
+    if (hmdma->FirstLinkedListNodeAddress == NULL) {
+        hmdma->Instance->CLAR = (uint32_t)(uintptr_t)pNewNode;
+        hmdma->FirstLinkedListNodeAddress = pNewNode;
+    } else {
+        hmdma->LastLinkedListNodeAddress->CLAR = (uint32_t)(uintptr_t)pNewNode;
+    }
+    hmdma->LastLinkedListNodeAddress = pNewNode;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_MDMA_Start_IT(MDMA_HandleTypeDef* hmdma, uint32_t SrcAddress, uint32_t DstAddress,
+                                    uint32_t BlockDataLength, uint32_t BlockCount)
+{
+    if (BlockDataLength == 0 || BlockDataLength > 65536u || BlockCount != 1) return HAL_ERROR;
+
+    mdma_join();
+    s_mdma_job = (sim_mdma_job_t){ hmdma, SrcAddress, DstAddress, BlockDataLength };
+    if (pthread_create(&s_mdma_tid, NULL, mdma_thread, &s_mdma_job) != 0) return HAL_ERROR;
+    s_mdma_started = 1;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_MDMA_Abort(MDMA_HandleTypeDef* hmdma)
+{
+    (void)hmdma;
+    mdma_join();
+    return HAL_OK;
+}
+
+void HAL_MDMA_IRQHandler(MDMA_HandleTypeDef* hmdma)
+{
+    (void)hmdma;
+}
+
+uint32_t HAL_MDMA_GetError(const MDMA_HandleTypeDef* hmdma)
+{
+    return hmdma->ErrorCode;
+}
@@ -0,0 +1,30 @@
+/**
+  ******************************************************************************
+  * @file           : sim_hal.h
+  * @brief          : 主机仿真 HAL 的控制接口 (时间基准)
+  * @note           : Flash 的配置与统计见 sim_flash.h
+  ******************************************************************************
+  */
+
+#ifndef __SIM_HAL_H
+#define __SIM_HAL_H
+
+#include <stdint.h>
+#include "stm32h7xx_hal.h"
+
+/**
+ * @brief  记录时间基准 (HAL_GetTick、DWT->CYCCNT 从此开始计数)
+ */
+void SimHal_Init(void);
+
+/**
+ * @brief  自 SimHal_Init 以来的时间 (微秒)
+ */
+uint64_t SimHal_GetTimeUs(void);
+
+/**
+ * @brief  阻塞指定时间 (模拟 Flash 编程/擦除的忙等待)
+ */
+void SimHal_BusyWaitUs(uint32_t us);
+
+#endif /* __SIM_HAL_H */
@@ -0,0 +1,836 @@
+/**
+  ******************************************************************************
+  * @file           : sim_target.c
+  * @brief          : 主机仿真升级目标 (Bootloader 升级路径的 Linux 构建)
+  * @description    : 在伪终端上运行 IAP_UpgradeViaYmodem，链接的是固件中的
+  *                   iap_upgrade.c / iap_write.c / trailer.c / ymodem.c / lwrb.c
+  *                   原文件，Flash 经 flash_port.h 由 sim_flash.c 模拟。
+  *                   串口线程模拟 USART1 + 循环 DMA：按波特率和单向延迟
+  *                   逐字节投递到 uart_rb，Flash 编程/擦除按配置时间阻塞主线程
+  * @usage          : sim_target [--baud N] [--latency-us N] [--prog-us N]
+  *                              [--erase-ms N] [--flash FILE] [--swap 0|1] [--once]
+  *                              [--sessions N] [-v]
+  *                              [--corrupt-addr A] [--ecc-addr A] [--trailer N]
+  *                              [--boot N] [--fill N] [--crc cpu|mdma] [--decide]
+  *                   启动后打印伪终端路径，收到任意字节即开始一次升级会话
+  *                   (--once / --sessions N 在 1 / N 次会话后退出)；
+  *                   --trailer N 不启动串口，在活动 Slot 的 trailer 扇区
+  *                   连续追加 N 条记录并报告耗时；--boot N 连续 N 次执行
+  *                   启动时的 Slot 检查；--fill N 在 trailer 写入不同数量的
+  *                   记录后各启动 N 次；--crc 选择镜像 CRC 引擎 (默认 mdma)；
+  *                   --decide 枚举两个 Slot 的状态组合，对照检查回滚决策
+  ******************************************************************************
+  */
+
+#include "sim_hal.h"
+#include "sim_flash.h"
+#include "crc.h"
+#include "iap_upgrade.h"
+#include "iap_write.h"
+#include "boot_crc.h"
+#include "boot_decide.h"
+#include "boot_image.h"
+#include "boot_slots.h"
+#include "boot_verify.h"
+#include "trailer.h"
+#include "ymodem_port.h"
+#include "lwrb.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+/*============================================================================
+ * 配置
+ *============================================================================*/
+
+#define SIM_UART_CLOCK      120000000u  /* PCLK2，与目标板一致 */
+#define SIM_RX_PEND_SIZE    2048u       /* 线路上 "正在传输" 的字节数上限 */
+#define SIM_TX_PEND_SIZE    8192u
+
+/*============================================================================
+ * 全局变量 (与 main.c 同名，供固件模块使用)
+ *============================================================================*/
+
+CRC_HandleTypeDef hcrc;
+static CRC_TypeDef s_crc_regs = { 0xFFFFFFFFu, 0xFFFFFFFFu };
+
+lwrb_t uart_rb;
+static uint8_t rb_buf[4096];
+volatile uint32_t uart_rb_overflow;
+
+/*============================================================================
+ * 仿真串口
+ *============================================================================*/
+
+typedef struct {
+    uint8_t  data[SIM_RX_PEND_SIZE > SIM_TX_PEND_SIZE ? SIM_RX_PEND_SIZE : SIM_TX_PEND_SIZE];
+    uint64_t due[SIM_RX_PEND_SIZE > SIM_TX_PEND_SIZE ? SIM_RX_PEND_SIZE : SIM_TX_PEND_SIZE];
+    uint32_t size;
+    uint32_t head;              /* 下一个投递位置 */
+    uint32_t count;
+    uint64_t last_due;          /* 最后一个字节的到达时刻 (线路串行化) */
+} wire_queue_t;
+
+static int              s_master = -1;
+static int              s_slave = -1;
+static pthread_mutex_t  s_lock = PTHREAD_MUTEX_INITIALIZER;
+static wire_queue_t     s_rx;   /* 主机 -> 目标 */
+static wire_queue_t     s_tx;   /* 目标 -> 主机 */
+static atomic_uint      s_baud;
+static uint64_t         s_latency_ns;
+static int              s_verbose;
+static int              s_no_wire;      /* 1=不经过仿真串口 (离线测试，日志只在 -v 时输出) */
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static void sleep_until_ns(uint64_t t)
+{
+    struct timespec ts = { (time_t)(t / 1000000000u), (long)(t % 1000000000u) };
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+    }
+}
+
+/* 8N1：每字节 10 位 */
+static uint64_t byte_ns(void)
+{
+    return 10000000000ull / atomic_load(&s_baud);
+}
+
+/**
+ * @brief  字节进入线路队列，按串行化和延迟计算到达时刻
+ * @note   调用者持有 s_lock
+ */
+static uint64_t wire_push(wire_queue_t* q, uint8_t ch, uint64_t now)
+{
+    uint64_t start = (q->last_due > now + s_latency_ns) ? q->last_due : now + s_latency_ns;
+    uint64_t due = start + byte_ns();
+    uint32_t pos = (q->head + q->count) % q->size;
+
+    q->data[pos] = ch;
+    q->due[pos] = due;
+    q->count++;
+    q->last_due = due;
+    return due;
+}
+
+static void wire_clear(wire_queue_t* q)
+{
+    q->head = 0;
+    q->count = 0;
+    q->last_due = 0;
+}
+
+/**
+ * @brief  串口线程：模拟 UART 收发与循环 DMA
+ */
+static void* wire_thread(void* arg)
+{
+    (void)arg;
+    uint8_t buf[256];
+
+    for (;;) {
+        uint64_t now = now_ns();
+        uint64_t next = now + 1000000u;     /* 最长 1ms 检查一次 */
+
+        pthread_mutex_lock(&s_lock);
+
+        /* 到达的字节写入环形缓冲区 (等价于 DMA 写入 rb_buf)，满则丢弃并计数 */
+        while (s_rx.count > 0 && s_rx.due[s_rx.head] <= now) {
+            if (lwrb_write(&uart_rb, &s_rx.data[s_rx.head], 1) != 1) {
+                uart_rb_overflow++;
+            }
+            s_rx.head = (s_rx.head + 1) % s_rx.size;
+            s_rx.count--;
+        }
+        if (s_rx.count > 0 && s_rx.due[s_rx.head] < next) next = s_rx.due[s_rx.head];
+
+        /* 发往主机 */
+        while (s_tx.count > 0 && s_tx.due[s_tx.head] <= now) {
+            if (write(s_master, &s_tx.data[s_tx.head], 1) != 1) break;
+            s_tx.head = (s_tx.head + 1) % s_tx.size;
+            s_tx.count--;
+        }
+        if (s_tx.count > 0 && s_tx.due[s_tx.head] < next) next = s_tx.due[s_tx.head];
+
+        /* 线路队列满时不读取，主机 write 被伪终端阻塞 (相当于物理线路限速) */
+        uint32_t room = s_rx.size - s_rx.count;
+
+        pthread_mutex_unlock(&s_lock);
+
+        struct pollfd pfd = { s_master, (short)(room >= sizeof(buf) ? POLLIN : 0), 0 };
+        uint64_t wait = (next > now) ? next - now : 0;
+        struct timespec ts = { (time_t)(wait / 1000000000u), (long)(wait % 1000000000u) };
+
+        if (ppoll(&pfd, 1, &ts, NULL) > 0 && (pfd.revents & POLLIN)) {
+            ssize_t n = read(s_master, buf, sizeof(buf));
+            if (n > 0) {
+                pthread_mutex_lock(&s_lock);
+                now = now_ns();
+                for (ssize_t i = 0; i < n; i++) {
+                    wire_push(&s_rx, buf[i], now);
+                }
+                pthread_mutex_unlock(&s_lock);
+            }
+        }
+    }
+    return NULL;
+}
+
+static int wire_open(void)
+{
+    struct termios tio;
+
+    s_master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (s_master < 0 || grantpt(s_master) != 0 || unlockpt(s_master) != 0) {
+        perror("posix_openpt");
+        return -1;
+    }
+
+    /* 自己保持从设备打开：主机关闭/重开串口时主设备不会出现 HUP */
+    s_slave = open(ptsname(s_master), O_RDWR | O_NOCTTY);
+    if (s_slave < 0 || tcgetattr(s_slave, &tio) != 0) {
+        perror("ptsname");
+        return -1;
+    }
+    cfmakeraw(&tio);
+    tcsetattr(s_slave, TCSANOW, &tio);
+
+    s_rx.size = SIM_RX_PEND_SIZE;
+    s_tx.size = SIM_TX_PEND_SIZE;
+    return 0;
+}
+
+/**
+ * @brief  等待发送队列清空 (对应 UART TC 标志)
+ */
+static void wire_drain_tx(void)
+{
+    for (;;) {
+        pthread_mutex_lock(&s_lock);
+        uint32_t count = s_tx.count;
+        uint64_t last = s_tx.last_due;
+        pthread_mutex_unlock(&s_lock);
+        if (count == 0) return;
+        sleep_until_ns(last);
+    }
+}
+
+int SimUart_Printf(const char* fmt, ...)
+{
+    char buf[512];
+    va_list ap;
+
+    va_start(ap, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+
+    if (n < 0) return n;
+    if (n >= (int)sizeof(buf)) n = sizeof(buf) - 1;
+
+    if (s_verbose) {
+        fwrite(buf, 1, (size_t)n, stderr);
+    }
+    if (s_no_wire) return n;
+    for (int i = 0; i < n; i++) {
+        YmodemPort_SendByte((uint8_t)buf[i]);
+    }
+    return n;
+}
+
+/*============================================================================
+ * YMODEM 平台接口
+ *============================================================================*/
+
+/**
+ * @brief  发送单个字节 (与 HAL_UART_Transmit 一样阻塞到发送寄存器空)
+ */
+void YmodemPort_SendByte(uint8_t ch)
+{
+    pthread_mutex_lock(&s_lock);
+    while (s_tx.count == s_tx.size) {
+        pthread_mutex_unlock(&s_lock);
+        usleep(100);
+        pthread_mutex_lock(&s_lock);
+    }
+    uint64_t due = wire_push(&s_tx, ch, now_ns());
+    pthread_mutex_unlock(&s_lock);
+
+    sleep_until_ns(due - s_latency_ns - byte_ns());
+}
+
+uint32_t YmodemPort_GetTick(void)
+{
+    return HAL_GetTick();
+}
+
+void YmodemPort_Delay(uint32_t ms)
+{
+    usleep(ms * 1000u);
+}
+
+void YmodemPort_UpdateRxHead(void* rb)
+{
+    (void)rb;
+}
+
+void YmodemPort_InvalidateCache(void* buf, uint32_t size)
+{
+    (void)buf;
+    (void)size;
+}
+
+/**
+ * @brief  空闲等待 (对应 WFI：最长睡眠一个 SysTick 周期)
+ */
+void YmodemPort_Idle(void)
+{
+    usleep(100);
+}
+
+uint32_t YmodemPort_GetRxOverflow(void)
+{
+    return uart_rb_overflow;
+}
+
+uint32_t YmodemPort_GetBaud(void)
+{
+    return atomic_load(&s_baud);
+}
+
+uint32_t YmodemPort_GetUartClock(void)
+{
+    return SIM_UART_CLOCK;
+}
+
+/**
+ * @brief  切换波特率 (与 UartDmaRx_SetBaud 相同：等待发送完成，丢弃已接收数据)
+ */
+int YmodemPort_SetBaud(uint32_t baud)
+{
+    if (baud == 0) return -1;
+
+    wire_drain_tx();
+
+    pthread_mutex_lock(&s_lock);
+    atomic_store(&s_baud, baud);
+    wire_clear(&s_rx);
+    lwrb_reset(&uart_rb);
+    pthread_mutex_unlock(&s_lock);
+
+    if (s_verbose) {
+        fprintf(stderr, "[sim] baud -> %u\n", baud);
+    }
+    return 0;
+}
+
+uint16_t YmodemPort_HwCrc16(uint16_t crc, const uint8_t* data, uint32_t len)
+{
+    (void)data;
+    (void)len;
+    return crc;
+}
+
+void YmodemPort_Log(const char* fmt, ...)
+{
+    if (!s_verbose) return;
+
+    va_list ap;
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+}
+
+/*============================================================================
+ * 主流程
+ *============================================================================*/
+
+static void print_session(int result, uint64_t t0_us)
+{
+    const iap_pipe_stats_t* ps = IAP_GetPipelineStats();
+    const sim_flash_stats_t* fs = SimFlash_GetStats();
+    const iap_prog_stats_t* gs = IAP_GetProgStats();
+    const flash_op_stats_t* pg = &FlashPort_GetStats()->op[FLASH_OP_PROGRAM];
+    const flash_op_stats_t* er = &FlashPort_GetStats()->op[FLASH_OP_ERASE];
+    uint64_t words = pg->bytes / FLASH_PORT_WORD_SIZE;
+    const image_hdr_t* hdr = (const image_hdr_t*)IAP_GetInactiveSlotBase();
+    double mhz = SystemCoreClock / 1e6;
+    int crc_ok = 0;
+
+    if (result == 0 && Boot_CheckMagic(hdr)) {
+        crc_ok = Boot_CheckCRC(IAP_GetInactiveSlotBase(), hdr);
+    }
+
+    fprintf(stdout,
+            "session: result=%d time=%.3f s image=%s\n"
+            "  pipeline: %s, %u pkts, wire %u ms, max depth %u, stalls %u\n"
+            "  flash: %u words programmed (%.3f s), %u sectors erased (%.3f s), %u program errors\n"
+            "  program: %u bytes in %u bursts, %llu cycles/KB, %u blank words skipped\n"
+            "  erase: %u sectors, %.3f s total, %.3f s blocking (off critical path %.0f%%), "
+            "%u blank sectors skipped, %u busy rejects\n"
+            "  verify: %u errors, %u faults injected\n"
+            "  latency: program %.1f/%.1f/%.1f us/word, erase %.1f/%.1f/%.1f ms (min/mean/max)\n"
+            "  uart: baud %u, rx overflow %u\n",
+            result, (double)(SimHal_GetTimeUs() - t0_us) / 1e6,
+            crc_ok ? "ready for swap" : "not valid",
+            ps->ram_staged ? "ram-staged" : ps->ram_spilled ? "ram-spilled" : "streamed", ps->packets, ps->wire_ms,
+            ps->max_depth, ps->stalls,
+            fs->programs, (double)fs->program_us / 1e6,
+            fs->erases, (double)fs->erase_us / 1e6, fs->program_errors,
+            gs->bytes, gs->bursts,
+            (unsigned long long)(gs->bytes ? gs->cycles * 1024u / gs->bytes : 0), gs->skipped_words,
+            gs->erases, (double)gs->erase_cycles / mhz / 1e6, (double)gs->erase_wait_cycles / mhz / 1e6,
+            gs->erase_cycles > gs->erase_wait_cycles ?
+                (double)(gs->erase_cycles - gs->erase_wait_cycles) * 100.0 / (double)gs->erase_cycles : 0.0,
+            gs->blank_sectors, fs->busy_rejects,
+            gs->verify_errors, fs->injected_faults,
+            pg->min_cycles / mhz, words ? (double)pg->cycles / words / mhz : 0.0, pg->max_cycles / mhz,
+            er->min_cycles / mhz / 1e3, er->count ? (double)er->cycles / er->count / mhz / 1e3 : 0.0,
+            er->max_cycles / mhz / 1e3,
+            YmodemPort_GetBaud(), uart_rb_overflow);
+    fflush(stdout);
+}
+
+/* 未交换时的两个 Slot (逻辑地址) */
+static const slot_info_t s_slots[2] = {
+    { FLASH_BANK1_BASE + BOOTLOADER_SIZE, FLASH_BANK1_BASE + BOOTLOADER_SIZE + SLOT_TOTAL_SIZE - TRAILER_SIZE },
+    { FLASH_BANK2_BASE + BOOTLOADER_SIZE, FLASH_BANK2_BASE + BOOTLOADER_SIZE + SLOT_TOTAL_SIZE - TRAILER_SIZE },
+};
+
+/**
+ * @brief  trailer 增长测试：连续追加状态记录 (写满时擦除)，每次追加后读取最后一条
+ * @note   handle: Boot 回滚流程的方式，trailer_t 句柄 trailer_write + trailer_last (缓存)；
+ *         scan  : 按基地址 trailer_is_full + trailer_next_seq + trailer_append + trailer_read_last，
+ *                 每一步都重新查找末尾 (在另一个 Slot 的 trailer 上运行)。
+ *         耗时为 DWT 周期数，含配置的编程/擦除时间
+ */
+static int trailer_bench(uint32_t count)
+{
+    static trailer_t t;
+    static tr_rec_t rec, last;
+    uint32_t base = s_slots[1].trailer_base;
+    uint64_t h_write = 0, h_read = 0, s_write = 0, s_read = 0;
+    uint32_t erases = 0;
+
+    if (trailer_erase(s_slots[0].trailer_base) != 0 || trailer_erase(base) != 0) return 1;
+    trailer_open(&t, s_slots[0].trailer_base);
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t attempt = 1u + i % MAX_ATTEMPTS;
+        uint32_t c0 = FlashPort_StatsNow();
+        int ret;
+
+        /* 句柄 */
+        erases += (uint32_t)trailer_full(&t);
+        ret = trailer_write(&t, TR_STATE_PENDING, attempt, 0x12345678u);
+        uint32_t c1 = FlashPort_StatsNow();
+        ret |= trailer_last(&t, &last);
+        uint32_t c2 = FlashPort_StatsNow();
+        h_write += c1 - c0;
+        h_read  += c2 - c1;
+
+        if (ret != 0 || trailer_read_last(s_slots[0].trailer_base, &rec) != 0 ||
+            memcmp(&rec, &last, sizeof(rec)) != 0 || last.attempt != attempt) {
+            fprintf(stderr, "trailer: handle record %u does not match flash\n", i);
+            return 1;
+        }
+
+        /* 按基地址扫描 */
+        c0 = FlashPort_StatsNow();
+        if (trailer_is_full(base) && trailer_erase(base) != 0) return 1;
+        memset(&rec, 0, sizeof(rec));
+        rec.magic     = TR_MAGIC;
+        rec.seq       = trailer_next_seq(base);
+        rec.state     = TR_STATE_PENDING;
+        rec.attempt   = attempt;
+        rec.img_crc32 = 0x87654321u;          /* 与句柄写入的记录区分 (Bank Swap 检查) */
+        ret = trailer_append(base, &rec);
+        c1 = FlashPort_StatsNow();
+        ret |= trailer_read_last(base, &rec);
+        c2 = FlashPort_StatsNow();
+        s_write += c1 - c0;
+        s_read  += c2 - c1;
+
+        if (ret != 0 || rec.seq != last.seq) {
+            fprintf(stderr, "trailer: append %u failed\n", i);
+            return 1;
+        }
+    }
+
+    /* Bank Swap 后同一逻辑地址是另一个 Bank 的 trailer，句柄必须重新扫描 */
+    if (FlashPort_SetSwap(!FlashPort_GetSwap()) != 0 || trailer_last(&t, &last) != 0 ||
+        trailer_read_last(s_slots[0].trailer_base, &rec) != 0 || memcmp(&rec, &last, sizeof(rec)) != 0 ||
+        FlashPort_SetSwap(!FlashPort_GetSwap()) != 0) {
+        fprintf(stderr, "trailer: handle not rescanned after bank swap\n");
+        return 1;
+    }
+
+    if (count) {
+        fprintf(stdout, "trailer: %u records, %u sector erases\n", count, erases);
+        fprintf(stdout, "  handle: write %llu cycles avg, last %llu cycles avg\n",
+                (unsigned long long)(h_write / count), (unsigned long long)(h_read / count));
+        fprintf(stdout, "  scan  : write %llu cycles avg, last %llu cycles avg\n",
+                (unsigned long long)(s_write / count), (unsigned long long)(s_read / count));
+    }
+    return 0;
+}
+
+/**
+ * @brief  按 Boot_RollbackDecision 的顺序检查两个 Slot (slot_prepare → Boot_VerifyStart
+ *         → Boot_VerifyFinish)：active 的完整 CRC 进行期间读取 inactive 的 trailer 与镜像头
+ * @retval 有效 Slot 数
+ * @note   固件只对影响决策的 Slot 求值，这里两个 Slot 都求值 (最坏情况)
+ */
+static uint32_t boot_inspect(int scrub)
+{
+    static trailer_t         tr[2];
+    static tr_rec_t          last[2];
+    static boot_verify_ctx_t v[2];
+
+    for (int i = 0; i < 2; i++) {
+        memset(&last[i], 0, sizeof(last[i]));
+        trailer_open(&tr[i], s_slots[i].trailer_base);
+        (void)trailer_last(&tr[i], &last[i]);
+        Boot_VerifyPrepare(&v[i], s_slots[i]);
+        if (i == 0) {
+            Boot_VerifyStart(&v[0], last[0].state, scrub);
+        }
+    }
+
+    uint32_t valid = Boot_VerifyFinish(&v[0]).valid;
+    Boot_VerifyStart(&v[1], last[1].state, scrub);
+    return valid + Boot_VerifyFinish(&v[1]).valid;
+}
+
+/**
+ * @brief  启动校验测试：连续 N 次启动，每次与 Boot_RollbackDecision 一样检查两个 Slot
+ * @note   第一次启动做完整 CRC 并写入校验记录，之后走缓存，每 BOOT_VERIFY_SCRUB_EVERY
+ *         次复查一次；耗时为 DWT 周期数 (含 trailer 扫描)
+ */
+static int boot_bench(uint32_t count)
+{
+    uint64_t first = 0, rest = 0, worst = 0;
+    uint32_t valid = 0;
+
+    s_no_wire = 1;
+    hcrc.Instance = &s_crc_regs;
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t t0 = FlashPort_StatsNow();
+
+        /* 与 Boot_RollbackDecision 相同：读取两个 trailer 并检查两个 Slot */
+        valid = boot_inspect(Boot_VerifyScrubDue());
+
+        uint32_t dt = FlashPort_StatsNow() - t0;
+        if (i == 0) {
+            first = dt;
+        } else {
+            rest += dt;
+            if (dt > worst) worst = dt;
+        }
+    }
+
+    uint64_t avg = (count > 1) ? rest / (count - 1) : 0;
+    fprintf(stdout,
+            "boot: %u boots, %u valid slots, first %llu cycles, then avg %llu / max %llu cycles "
+            "(%.1f%% of first)\n",
+            count, valid, (unsigned long long)first, (unsigned long long)avg,
+            (unsigned long long)worst, first ? (double)avg * 100.0 / (double)first : 0.0);
+    return 0;
+}
+
+/*============================================================================
+ * 决策表测试
+ *============================================================================*/
+
+/**
+ * @brief  先校验两个 Slot 再决策 (Boot_Decide 之前的 Boot_RollbackDecision 逻辑，
+ *         Flash 写入换成 BOOT_WR_xxx 标志)，作为 --decide 的参照
+ */
+static boot_plan_t decide_ref(const boot_slot_facts_t* a, const boot_slot_facts_t* b,
+                              int a_valid, int b_valid)
+{
+    boot_plan_t p = { ROLLBACK_NONE, 0, 0 };
+    int a_bind = a->has_tr && a_valid && a->tr_crc32 == a->img_crc32;
+    int b_bind = b->has_tr && b_valid && b->tr_crc32 == b->img_crc32;
+    int to_old = 0;
+
+    if (!a_valid) {
+        to_old = 1;
+    } else if (a_bind) {
+        if (a->tr_state == TR_STATE_PENDING) {
+            if (a->tr_attempt < MAX_ATTEMPTS) {
+                p.writes |= BOOT_WR_ACTIVE_ATTEMPT;
+                p.action = ROLLBACK_CONTINUE_PENDING;
+                return p;
+            }
+            p.writes |= BOOT_WR_ACTIVE_REJECTED;
+            to_old = 1;
+        } else if (a->tr_state == TR_STATE_REJECTED) {
+            to_old = 1;
+        }
+    } else {
+        /* 无 trailer 或 trailer 属于旧镜像 */
+        p.writes |= BOOT_WR_ACTIVE_PENDING;
+        p.action = ROLLBACK_CONTINUE_PENDING;
+        return p;
+    }
+
+    if (to_old) {
+        if (!b_valid || (b_bind && b->tr_state == TR_STATE_REJECTED)) {
+            p.action = ROLLBACK_DFU_MODE;
+            return p;
+        }
+        if (!b_bind) p.writes |= BOOT_WR_INACTIVE_PENDING;
+        p.action = ROLLBACK_SWAP_TO_OLD;
+        return p;
+    }
+
+    if (b_valid && Boot_SemverCompare(b->ver, a->ver) > 0 &&
+        !(b_bind && (b->tr_state == TR_STATE_REJECTED || b->tr_state == TR_STATE_CONFIRMED))) {
+        if (!(b_bind && b->tr_state == TR_STATE_PENDING)) p.writes |= BOOT_WR_INACTIVE_PENDING;
+        p.action = ROLLBACK_SWAP_TO_NEW;
+    }
+    return p;
+}
+
+static int s_decide_crc_ok[2];
+static uint32_t s_decide_calls[2];
+
+static int decide_check(int slot, void* arg)
+{
+    (void)arg;
+    s_decide_calls[slot]++;
+    return s_decide_crc_ok[slot];
+}
+
+/**
+ * @brief  把一个 0..DECIDE_SLOT_CASES-1 的编号展开成单个 Slot 的输入组合
+ */
+#define DECIDE_SLOT_CASES   (2 * 2 * 2 * 4 * 3 * 2)
+
+static void decide_slot(uint32_t n, uint32_t img_crc32, boot_slot_facts_t* f, int* crc_ok)
+{
+    static const uint32_t states[4]   = { TR_STATE_PENDING, TR_STATE_CONFIRMED, TR_STATE_REJECTED, 0x12345678u };
+    static const uint32_t attempts[3] = { 1, MAX_ATTEMPTS - 1, MAX_ATTEMPTS };
+
+    memset(f, 0, sizeof(*f));
+    f->hdr_ok     = (int)(n % 2);  n /= 2;
+    *crc_ok       = (int)(n % 2);  n /= 2;
+    f->has_tr     = (int)(n % 2);  n /= 2;
+    f->tr_state   = states[n % 4]; n /= 4;
+    f->tr_attempt = attempts[n % 3]; n /= 3;
+    f->img_crc32  = img_crc32;
+    f->tr_crc32   = (n % 2) ? img_crc32 : ~img_crc32;
+}
+
+/**
+ * @brief  决策表测试：枚举两个 Slot 的全部输入组合 (镜像头、CRC、trailer 状态/attempt/
+ *         绑定、inactive 版本低/同/高)，比较 Boot_Decide 与先校验再决策的结果，
+ *         并统计省下的完整 CRC 次数
+ */
+static int decide_test(void)
+{
+    static const semver_t vers[3] = { { 1, 1, 0 }, { 1, 2, 0 }, { 1, 3, 0 } };
+    boot_slot_facts_t a, b;
+    uint32_t cases = 0, mismatches = 0, eager = 0, lazy = 0;
+
+    s_no_wire = 1;
+
+    for (uint32_t i = 0; i < DECIDE_SLOT_CASES; i++) {
+        for (uint32_t j = 0; j < DECIDE_SLOT_CASES; j++) {
+            for (uint32_t v = 0; v < 3; v++) {
+                decide_slot(i, 0xA5A50001u, &a, &s_decide_crc_ok[0]);
+                decide_slot(j, 0x5A5A0002u, &b, &s_decide_crc_ok[1]);
+                a.ver = vers[1];
+                b.ver = vers[v];
+
+                boot_plan_t want = decide_ref(&a, &b, a.hdr_ok && s_decide_crc_ok[0],
+                                              b.hdr_ok && s_decide_crc_ok[1]);
+                s_decide_calls[0] = s_decide_calls[1] = 0;
+                boot_plan_t got = Boot_Decide(&a, &b, decide_check, NULL);
+
+                cases++;
+                eager += (uint32_t)(a.hdr_ok + b.hdr_ok);
+                lazy  += s_decide_calls[0] + s_decide_calls[1];
+
+                if (got.action != want.action || got.writes != want.writes ||
+                    s_decide_calls[0] > 1 || s_decide_calls[1] > 1) {
+                    if (mismatches++ < 10) {
+                        fprintf(stderr, "decide: case %u/%u/%u: action %d writes 0x%lX, expected %d 0x%lX\n",
+                                i, j, v, (int)got.action, (unsigned long)got.writes,
+                                (int)want.action, (unsigned long)want.writes);
+                    }
+                }
+            }
+        }
+    }
+
+    fprintf(stdout,
+            "decide: %u cases, %u mismatches, full CRCs %u -> %u (%.1f%% skipped)\n",
+            cases, mismatches, eager, lazy, eager ? (double)(eager - lazy) * 100.0 / (double)eager : 0.0);
+    return mismatches ? 1 : 0;
+}
+
+/**
+ * @brief  trailer 填充量测试：活动 Slot 的 trailer 先写入不同数量的状态记录，
+ *         再测量启动决策读取的部分 (两个 Slot 的 trailer 与校验缓存 + 下一条记录的序列号)
+ * @note   每个填充量先启动一次 (完整 CRC 并写入校验记录)，之后 count 次取平均；
+ *         不含定期复查。最大填充量留一条给校验记录，之后扇区正好写满
+ */
+static int fill_bench(uint32_t count)
+{
+    static const uint32_t levels[] = { 0, 64, 512, 1024, 2048, 3072, TR_REC_COUNT - 1 };
+    static tr_rec_t rec;
+    uint32_t base = s_slots[0].trailer_base;
+
+    s_no_wire = 1;
+    hcrc.Instance = &s_crc_regs;
+
+    fprintf(stdout, "fill: %u boots per level\n", count);
+    for (uint32_t l = 0; l < sizeof(levels) / sizeof(levels[0]); l++) {
+        uint64_t sum = 0, worst = 0;
+        uint32_t seq = 0;
+
+        if (trailer_erase(base) != 0) return 1;
+        for (uint32_t i = 0; i < levels[l]; i++) {
+            memset(&rec, 0xFF, sizeof(rec));
+            rec.magic     = TR_MAGIC;
+            rec.seq       = i + 1;
+            rec.state     = TR_STATE_CONFIRMED;
+            rec.attempt   = 1;
+            rec.img_crc32 = 0x12345678u;
+            if (trailer_append(base, &rec) != 0) {
+                fprintf(stderr, "fill: append %u failed\n", i);
+                return 1;
+            }
+        }
+
+        for (uint32_t i = 0; i <= count; i++) {
+            uint32_t t0 = FlashPort_StatsNow();
+
+            (void)boot_inspect(0);
+            seq = trailer_next_seq(base);
+            (void)trailer_is_full(base);
+
+            uint32_t dt = FlashPort_StatsNow() - t0;
+            if (i == 0) continue;           /* 第一次写入校验记录 */
+            sum += dt;
+            if (dt > worst) worst = dt;
+        }
+
+        if (seq != levels[l] + 1) {
+            fprintf(stderr, "fill: next seq %u, expected %u\n", seq, levels[l] + 1);
+            return 1;
+        }
+        fprintf(stdout, "  %4u records: avg %llu / max %llu cycles\n", levels[l],
+                (unsigned long long)(count ? sum / count : 0), (unsigned long long)worst);
+    }
+    return 0;
+}
+
+static void usage(const char* prog)
+{
+    fprintf(stderr,
+            "usage: %s [--baud N] [--latency-us N] [--prog-us N] [--erase-ms N]\n"
+            "          [--flash FILE] [--swap 0|1] [--dirty] [--timeout-ms N] [--once] [--sessions N] [-v]\n"
+            "          [--corrupt-addr A] [--ecc-addr A] [--trailer N] [--boot N] [--fill N] [--decide] [--ram]\n", prog);
+    exit(2);
+}
+
+int main(int argc, char** argv)
+{
+    sim_flash_cfg_t cfg = { .program_us = 100, .erase_ms = 1000, .flash_file = NULL, .swap = -1 };
+    uint32_t console_baud = 460800;
+    uint32_t trailer_count = 0;
+    uint32_t boot_count = 0;
+    uint32_t fill_count = 0;
+    int decide = 0;
+    uint32_t timeout_ms = 2000;
+    uint32_t sessions = 0;             /* 0=一直运行 */
+    int failed = 0;
+    pthread_t tid;
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if      (!strcmp(a, "--baud") && v)       { console_baud = strtoul(v, NULL, 0); i++; }
+        else if (!strcmp(a, "--latency-us") && v) { s_latency_ns = strtoull(v, NULL, 0) * 1000u; i++; }
+        else if (!strcmp(a, "--prog-us") && v)    { cfg.program_us = strtoul(v, NULL, 0); i++; }
+        else if (!strcmp(a, "--erase-ms") && v)   { cfg.erase_ms = strtoul(v, NULL, 0); i++; }
+        else if (!strcmp(a, "--flash") && v)      { cfg.flash_file = v; i++; }
+        else if (!strcmp(a, "--corrupt-addr") && v) { cfg.corrupt_addr = strtoul(v, NULL, 0); i++; }
+        else if (!strcmp(a, "--ecc-addr") && v)   { cfg.ecc_addr = strtoul(v, NULL, 0); i++; }
+        else if (!strcmp(a, "--swap") && v)       { cfg.swap = (int)strtol(v, NULL, 0); i++; }
+        else if (!strcmp(a, "--dirty"))           { cfg.dirty = 1; }
+        else if (!strcmp(a, "--trailer") && v)    { trailer_count = strtoul(v, NULL, 0); i++; }
+        else if (!strcmp(a, "--boot") && v)       { boot_count = strtoul(v, NULL, 0); i++; }
+        else if (!strcmp(a, "--timeout-ms") && v) { timeout_ms = strtoul(v, NULL, 0); i++; }
+        else if (!strcmp(a, "--fill") && v)       { fill_count = strtoul(v, NULL, 0); i++; }
+        else if (!strcmp(a, "--decide"))          { decide = 1; }
+        else if (!strcmp(a, "--once"))            { sessions = 1; }
+        else if (!strcmp(a, "--sessions") && v)   { sessions = strtoul(v, NULL, 0); i++; }
+        else if (!strcmp(a, "--ram"))             { IAP_SetInstallMode(IAP_INSTALL_RAM); }
+        else if (!strcmp(a, "--crc") && v)        { Boot_CRCSetEngine(strcmp(v, "cpu") ? BOOT_CRC_DMA : BOOT_CRC_CPU); i++; }
+        else if (!strcmp(a, "-v"))                { s_verbose = 1; }
+        else usage(argv[0]);
+    }
+    if (console_baud == 0) usage(argv[0]);
+
+    if (decide) return decide_test();
+
+    SimHal_Init();
+    if (SimFlash_Init(&cfg) != 0) return 1;
+
+    if (trailer_count) return trailer_bench(trailer_count);
+    if (boot_count) return boot_bench(boot_count);
+    if (fill_count) return fill_bench(fill_count);
+
+    hcrc.Instance = &s_crc_regs;
+    lwrb_init(&uart_rb, rb_buf, sizeof(rb_buf));
+    atomic_store(&s_baud, console_baud);
+
+    if (wire_open() != 0) return 1;
+    pthread_create(&tid, NULL, wire_thread, NULL);
+
+    fprintf(stdout, "PTY %s\n", ptsname(s_master));
+    fflush(stdout);
+
+    for (uint32_t n = 1; ; n++) {
+        uint8_t ch;
+
+        /* 对应按下 KEY0：任意字节触发一次升级会话 */
+        while (lwrb_read(&uart_rb, &ch, 1) != 1) {
+            YmodemPort_Idle();
+        }
+
+        uint64_t t0 = SimHal_GetTimeUs();
+
+        IAP_PrepareSlot();
+        int result = IAP_UpgradeViaYmodem(&uart_rb, timeout_ms);
+        wire_drain_tx();
+        print_session(result, t0);
+
+        failed |= (result != 0);
+        if (sessions && n >= sessions) return failed;
+
+        /* 丢弃会话残留 (如主机超时后重发的数据) */
+        usleep(200000);
+        pthread_mutex_lock(&s_lock);
+        lwrb_reset(&uart_rb);
+        pthread_mutex_unlock(&s_lock);
+    }
+}
@@ -0,0 +1,219 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+Scripted test of the session baud-rate negotiation over a pty.
+
+Runs the host side from ymodem_upload.py (negotiate_baud, Link) against
+the bootloader's baud_negotiate() in sim_target, one fresh sim_target per
+case:
+
+  accepted   - host proposes the fast rate and the probe echo is good:
+               both ends switch, classic YMODEM ('C') starts at the fast rate
+  stream     - host also requests YMODEM-G: the device grants it at no more
+               than the <gmax> it offered and starts with 'G'
+  mismatch   - bytes at the fast rate are garbled on the host side (wrong
+               divider, bad adapter): the device answers BAUD FAIL and both
+               ends fall back to the console rate and classic YMODEM
+  no-answer  - host ignores "BAUD?" (plain terminal): the device keeps the
+               console rate and starts classic YMODEM after its offer window
+  restore    - checked in every case: after the session ends (sender CAN)
+               the device is back at the console rate
+
+sim_target has no notion of the host's line rate, so a rate mismatch is
+modelled by the PtyPort below: while its baudrate is in `garble`, every
+byte it writes or reads is corrupted.
+
+Usage: python3 test_baud.py [--sim ./sim_target] [-v]
+Needs only the standard library (pyserial is stubbed if missing).
+"""
+
+import argparse
+import os
+import select
+import subprocess
+import sys
+import tempfile
+import termios
+import time
+import tty
+import types
+from pathlib import Path
+
+HERE = Path(__file__).resolve().parent
+sys.path.insert(0, str(HERE.parent))
+
+try:
+    import serial  # noqa: F401
+except ImportError:
+    sys.modules["serial"] = types.SimpleNamespace(Serial=None)  # only used by ymodem_upload.main()
+
+import ymodem_upload as yu  # noqa: E402
+
+CONSOLE = 460800
+FAST = 4000000
+
+
+class PtyPort:
+    """The subset of serial.Serial that ymodem_upload.Link/negotiate_baud use, on a pty."""
+
+    def __init__(self, path: str, baudrate: int, garble=()):
+        self.fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+        tty.setraw(self.fd)
+        self.baudrate = baudrate
+        self.garble = set(garble)
+        self.timeout = 0.05
+
+    def _line(self, data: bytes) -> bytes:
+        return bytes(b ^ 0x5A for b in data) if self.baudrate in self.garble else data
+
+    def write(self, data: bytes) -> None:
+        data = self._line(data)
+        while data:
+            data = data[os.write(self.fd, data):]
+
+    def read(self, n: int = 1) -> bytes:
+        ready, _, _ = select.select([self.fd], [], [], self.timeout)
+        return self._line(os.read(self.fd, n)) if ready else b""
+
+    def reset_input_buffer(self) -> None:
+        termios.tcflush(self.fd, termios.TCIFLUSH)
+
+    def close(self) -> None:
+        os.close(self.fd)
+
+
+class Target:
+    """One sim_target session (--once), device log captured from stderr (-v)."""
+
+    def __init__(self, sim: str):
+        self.out = tempfile.TemporaryFile(mode="w+")
+        self.err = tempfile.TemporaryFile(mode="w+")
+        self.proc = subprocess.Popen(
+            [sim, "--once", "-v", "--baud", str(CONSOLE), "--latency-us", "100",
+             "--prog-us", "0", "--erase-ms", "0", "--timeout-ms", "1000"],
+            stdout=self.out, stderr=self.err)
+        self.pty = None
+        deadline = time.monotonic() + 3.0
+        while self.pty is None and time.monotonic() < deadline:
+            self.out.seek(0)
+            for line in self.out:
+                if line.startswith("PTY "):
+                    self.pty = line.split()[1]
+            time.sleep(0.02)
+        if self.pty is None:
+            self.proc.kill()
+            raise SystemExit("sim_target did not report its pty")
+
+    def finish(self, timeout: float = 10.0):
+        try:
+            self.proc.wait(timeout)
+        except subprocess.TimeoutExpired:
+            self.proc.kill()
+            raise
+        self.out.seek(0)
+        self.err.seek(0)
+        return self.out.read(), self.err.read()
+
+
+def wait_line(link: yu.Link, prefix: bytes, timeout: float):
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        kind, val = link.read_event(deadline - time.monotonic())
+        if kind == "line" and val.startswith(prefix):
+            return val
+    return None
+
+
+def device_bauds(err: str):
+    """Rates the simulated UART was switched to, in order."""
+    return [int(l.split("->")[1]) for l in err.splitlines() if l.startswith("[sim] baud ->")]
+
+
+def run_case(sim: str, name: str, answer: bool, stream: bool, garble=(), verbose: bool = False) -> list:
+    """Returns a list of failure messages (empty = pass)."""
+    fails = []
+    t = Target(sim)
+    port = PtyPort(t.pty, CONSOLE, garble)
+    link = yu.Link(port, verbose)
+
+    port.write(b"U")
+    banner = wait_line(link, yu.BAUD_BANNER, 3.0)
+    if banner is None:
+        fails.append("no BAUD? banner")
+    t0 = time.monotonic()
+
+    rate, granted, gmax = CONSOLE, False, 0
+    if banner is not None and answer:
+        _, max_offer, gmax = banner.split()
+        gmax = int(gmax)
+        rate, granted = yu.negotiate_baud(link, int(max_offer), gmax, FAST, CONSOLE, stream)
+
+    start = link.wait_ctrl((yu.START_C, yu.START_G), 5.0)
+    dt = time.monotonic() - t0
+    if start is None:
+        fails.append("no start character")
+    elif (start == yu.START_G) != (name == "stream"):
+        fails.append(f"device started with {chr(start)!r}")
+    port.write(bytes([yu.CAN]))         # end the session here; negotiation is what is under test
+    out, err = t.finish()
+    port.close()
+
+    bauds = device_bauds(err)
+    if name == "accepted":
+        if rate != FAST:
+            fails.append(f"host settled on {rate}, expected {FAST}")
+        if "BAUD OK %d" % FAST not in err or bauds[:1] != [FAST]:
+            fails.append(f"device did not switch to {FAST} (switches {bauds})")
+    elif name == "stream":
+        want = max(min(FAST, gmax), CONSOLE)
+        if not granted or rate != want:
+            fails.append(f"host settled on {rate} granted={granted}, expected {want} with YMODEM-G")
+        if "BAUD OK %d G" % want not in err:
+            fails.append(f"device did not grant YMODEM-G at {want}")
+    elif name == "mismatch":
+        if rate != CONSOLE:
+            fails.append(f"host settled on {rate}, expected fallback to {CONSOLE}")
+        if "BAUD FAIL" not in err or bauds[:2] != [FAST, CONSOLE]:
+            fails.append(f"device did not fall back (switches {bauds})")
+    elif name == "no-answer":
+        if bauds:
+            fails.append(f"device changed rate without an offer (switches {bauds})")
+        # 300 ms offer window, timed here from the banner's arrival (which lags its start)
+        if dt < 0.25:
+            fails.append(f"start character after {dt:.3f} s, before the offer window closed")
+
+    # Session end: console rate restored on the device
+    if bauds and bauds[-1] != CONSOLE:
+        fails.append(f"device left at {bauds[-1]} after the session")
+    if f"uart: baud {CONSOLE}" not in out:
+        fails.append("session report does not show the console rate")
+
+    if verbose:
+        sys.stderr.write(err)
+    return fails
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("--sim", default=str(HERE / "sim_target"))
+    ap.add_argument("-v", "--verbose", action="store_true")
+    args = ap.parse_args()
+
+    cases = [
+        ("accepted", True, False, ()),
+        ("stream", True, True, ()),
+        ("mismatch", True, False, (FAST,)),
+        ("no-answer", False, False, ()),
+    ]
+    failed = 0
+    for name, answer, stream, garble in cases:
+        fails = run_case(args.sim, name, answer, stream, garble, args.verbose)
+        print(f"baud: {name:<10} {'ok' if not fails else 'FAIL'}")
+        for f in fails:
+            print(f"  {f}")
+        failed += bool(fails)
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,713 @@
+/**
+  ******************************************************************************
+  * @file           : ymodem_send.c
+  * @brief          : 主机端 YMODEM 发送与升级吞吐量基准
+  * @description    : 按 Ymodem_Receive() 期望的帧格式发送镜像，支持 YMODEM-G /
+  *                   经典 YMODEM、BAUD? 波特率/模式协商和 RESUME 续传握手
+  *                   (与 ymodem_upload.py 相同)。结束后报告吞吐量、每包往返时间、
+  *                   重传次数，以及到设备 ACK 结束包 (可执行 swap) 为止的总时间
+  * @usage          : ymodem_send <port> <image.bin> [--baud N] [--fast-baud N]
+  *                               [--trigger STR] [--stream | --compare] [--no-resume]
+  *                               [--rtt-log FILE] [-v]
+  *                   默认经典 YMODEM；--stream 在协商中请求 YMODEM-G (设备按
+  *                   速率决定是否允许)；--compare 在同一线路上先请求 YMODEM-G、
+  *                   再用经典 YMODEM 各上传一次，分别报告并对比吞吐量
+  ******************************************************************************
+  */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+/*============================================================================
+ * 常量定义
+ *============================================================================*/
+
+#define SOH     0x01
+#define STX     0x02
+#define EOT     0x04
+#define ACK     0x06
+#define NAK     0x15
+#define CAN     0x18
+#define START_C 'C'
+#define START_G 'G'
+
+#define BAUD_BANNER     "BAUD?"
+#define BAUD_PROBE      "SYNC\x55\xAA\x0F\xF0"
+#define RESUME_BANNER   "RESUME"
+
+#define HDR_SIZE        0x200u
+#define HDR_CRC_OFF     24u
+
+#define MAX_RETRY       10
+#define PKT_TIMEOUT_MS  10000u      /* 标准发送方的应答超时，文件信息包与结束包相同 (接收方的停顿不能超过它) */
+
+/*============================================================================
+ * 数据类型
+ *============================================================================*/
+
+/* 串口与行跟踪：只有位于行首的 'C'/'G' 才被当作发起字符 */
+typedef struct {
+    int      fd;
+    int      verbose;
+    char     line[256];
+    uint32_t line_len;
+} link_t;
+
+typedef enum {
+    EV_NONE = 0,    /* 超时 */
+    EV_CTRL,        /* 协议控制字节 */
+    EV_LINE         /* 一行文本 (不含换行) */
+} event_t;
+
+typedef struct {
+    uint32_t* rtt_us;           /* 每个数据包的往返时间 (仅经典模式) */
+    uint32_t  rtt_count;
+    uint32_t  retransmits;      /* 收到 NAK/超时后的重发次数 */
+    uint32_t  packets;
+    uint64_t  hdr_us;           /* 文件信息包 -> 接收方开始接收数据 (含 Slot 擦除) */
+    uint64_t  data_us;          /* 第一个数据包 -> EOT 被确认 */
+    uint64_t  end_us;           /* 结束包 -> ACK (含刷新与提交) */
+} send_stats_t;
+
+/*============================================================================
+ * 工具函数
+ *============================================================================*/
+
+static uint64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+static uint16_t crc16_ccitt(const uint8_t* data, uint32_t len)
+{
+    uint16_t crc = 0;
+    for (uint32_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 0x8000u) ? (uint16_t)((crc << 1) ^ 0x1021u) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/**
+ * @brief  组帧：包头 + 序号 + 反码 + 数据 (不足补 pad) + CRC16 (大端)
+ * @retval 帧长度
+ */
+static uint32_t make_packet(uint8_t* out, uint8_t seq, const uint8_t* data, uint32_t len,
+                            uint32_t size, uint8_t pad)
+{
+    out[0] = (size == 1024) ? STX : SOH;
+    out[1] = seq;
+    out[2] = (uint8_t)~seq;
+    memset(out + 3, pad, size);
+    memcpy(out + 3, data, len);
+
+    uint16_t crc = crc16_ccitt(out + 3, size);
+    out[3 + size] = (uint8_t)(crc >> 8);
+    out[4 + size] = (uint8_t)crc;
+    return size + 5;
+}
+
+static int cmp_u32(const void* a, const void* b)
+{
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+/*============================================================================
+ * 串口
+ *============================================================================*/
+
+static speed_t baud_to_speed(uint32_t baud)
+{
+    switch (baud) {
+    case 9600:    return B9600;
+    case 19200:   return B19200;
+    case 38400:   return B38400;
+    case 57600:   return B57600;
+    case 115200:  return B115200;
+    case 230400:  return B230400;
+    case 460800:  return B460800;
+    case 921600:  return B921600;
+    case 1000000: return B1000000;
+    case 1500000: return B1500000;
+    case 2000000: return B2000000;
+    case 3000000: return B3000000;
+    case 4000000: return B4000000;
+    default:      return 0;
+    }
+}
+
+static int port_set_baud(int fd, uint32_t baud)
+{
+    struct termios tio;
+    speed_t sp = baud_to_speed(baud);
+
+    if (sp == 0 || tcgetattr(fd, &tio) != 0) return -1;
+    cfsetispeed(&tio, sp);
+    cfsetospeed(&tio, sp);
+    return tcsetattr(fd, TCSADRAIN, &tio);
+}
+
+static int port_open(const char* path, uint32_t baud)
+{
+    struct termios tio;
+    int fd = open(path, O_RDWR | O_NOCTTY);
+
+    if (fd < 0 || tcgetattr(fd, &tio) != 0) {
+        perror(path);
+        return -1;
+    }
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+    tcsetattr(fd, TCSANOW, &tio);
+
+    if (port_set_baud(fd, baud) != 0) {
+        fprintf(stderr, "unsupported baud rate %u\n", baud);
+        close(fd);
+        return -1;
+    }
+    tcflush(fd, TCIOFLUSH);
+    return fd;
+}
+
+static void port_write(int fd, const void* buf, uint32_t len)
+{
+    const uint8_t* p = buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN) continue;
+            perror("write");
+            exit(1);
+        }
+        p += n;
+        len -= (uint32_t)n;
+    }
+}
+
+/**
+ * @brief  读取一个字节
+ * @retval 0-255=数据, -1=超时
+ */
+static int port_read_byte(int fd, uint32_t timeout_ms)
+{
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    uint8_t ch;
+
+    if (poll(&pfd, 1, (int)timeout_ms) <= 0) return -1;
+    if (read(fd, &ch, 1) != 1) return -1;
+    return ch;
+}
+
+static void port_discard_input(int fd, uint32_t quiet_ms)
+{
+    while (port_read_byte(fd, quiet_ms) >= 0) {
+    }
+}
+
+/**
+ * @brief  读取下一个事件：控制字节或一行文本
+ * @param  val: EV_CTRL 时为控制字节
+ */
+static event_t link_read_event(link_t* l, int* val, uint32_t timeout_ms)
+{
+    uint64_t deadline = now_us() + (uint64_t)timeout_ms * 1000u;
+
+    for (;;) {
+        uint64_t now = now_us();
+        if (now >= deadline) return EV_NONE;
+
+        int c = port_read_byte(l->fd, (uint32_t)((deadline - now + 999) / 1000));
+        if (c < 0) continue;
+
+        if (c == ACK || c == NAK || c == CAN || c == EOT ||
+            ((c == START_C || c == START_G) && l->line_len == 0)) {
+            *val = c;
+            return EV_CTRL;
+        }
+        if (c == '\n') {
+            while (l->line_len > 0 && l->line[l->line_len - 1] == '\r') l->line_len--;
+            l->line[l->line_len] = '\0';
+            l->line_len = 0;
+            if (l->verbose) fprintf(stderr, "< %s\n", l->line);
+            return EV_LINE;
+        }
+        if (l->line_len < sizeof(l->line) - 1) {
+            l->line[l->line_len++] = (char)c;
+        }
+    }
+}
+
+/**
+ * @brief  等待指定控制字节之一 (CAN 总是返回)
+ * @retval 控制字节, -1=超时
+ */
+static int link_wait_ctrl(link_t* l, const char* wanted, uint32_t timeout_ms)
+{
+    uint64_t deadline = now_us() + (uint64_t)timeout_ms * 1000u;
+    int val;
+
+    for (;;) {
+        uint64_t now = now_us();
+        if (now >= deadline) return -1;
+        if (link_read_event(l, &val, (uint32_t)((deadline - now + 999) / 1000)) == EV_CTRL &&
+            (val == CAN || strchr(wanted, val) != NULL)) {
+            return val;
+        }
+    }
+}
+
+/*============================================================================
+ * 会话握手
+ *============================================================================*/
+
+/**
+ * @brief  响应 "BAUD? <max> <gmax>"，返回之后使用的波特率
+ * @param  stream: 输入 1=请求 YMODEM-G；输出 1=设备允许 YMODEM-G
+ * @note   请求 YMODEM-G 时速率不超过 <gmax>，<gmax> 低于控制台速率则不请求
+ */
+static uint32_t negotiate_baud(link_t* l, uint32_t max_offer, uint32_t gmax, uint32_t want,
+                               uint32_t console, int* stream)
+{
+    static const char probe[] = BAUD_PROBE;
+    const uint32_t probe_len = sizeof(probe) - 1;
+    uint32_t rate = (want < max_offer) ? want : max_offer;
+    char msg[32];
+    int val;
+
+    if (*stream && gmax < console) *stream = 0;
+    if (*stream && rate > gmax) rate = gmax;
+    if (rate < console || baud_to_speed(rate) == 0) rate = console;
+    if (rate == console && !*stream) return console;
+
+    snprintf(msg, sizeof(msg), "BAUD %u%s\r\n", rate, *stream ? " G" : "");
+    port_write(l->fd, msg, (uint32_t)strlen(msg));
+
+    for (;;) {
+        event_t ev = link_read_event(l, &val, 1000);
+        if (ev == EV_NONE || (ev == EV_LINE && strncmp(l->line, "BAUD NO", 7) == 0)) {
+            *stream = 0;
+            return console;
+        }
+        if (ev == EV_LINE && strncmp(l->line, "BAUD OK", 7) == 0) break;
+    }
+    *stream = (strstr(l->line, " G") != NULL);
+    if (rate == console) return console;
+
+    /* 设备发完 "BAUD OK" 后切换，稍等再切换本端 */
+    usleep(20000);
+    port_set_baud(l->fd, rate);
+    tcflush(l->fd, TCIFLUSH);
+    l->line_len = 0;
+    port_write(l->fd, probe, probe_len);
+
+    /* 逐字节读取，不吞掉回显之后的发起字符 */
+    uint32_t matched = 0;
+    uint64_t deadline = now_us() + 500000u;
+    while (matched < probe_len && now_us() < deadline) {
+        int c = port_read_byte(l->fd, 10);
+        if (c < 0) continue;
+        matched = ((uint8_t)c == (uint8_t)probe[matched]) ? matched + 1
+                : ((uint8_t)c == (uint8_t)probe[0]) ? 1 : 0;
+    }
+    if (matched == probe_len) return rate;
+
+    /* 设备在自己的探测窗口结束后回退 (同时回到经典 YMODEM)，跟随回退 */
+    *stream = 0;
+    port_set_baud(l->fd, console);
+    usleep(600000);
+    tcflush(l->fd, TCIFLUSH);
+    return console;
+}
+
+/*============================================================================
+ * 发送
+ *============================================================================*/
+
+/**
+ * @brief  发送一个需要 ACK 的包，记录往返时间与重传
+ * @retval 0=已确认, -1=失败
+ */
+static int send_acked(link_t* l, const uint8_t* pkt, uint32_t len, send_stats_t* st, uint32_t* rtt,
+                      uint32_t timeout_ms)
+{
+    for (int retry = 0; retry < MAX_RETRY; retry++) {
+        uint64_t t0 = now_us();
+        port_write(l->fd, pkt, len);
+
+        int r = link_wait_ctrl(l, "\x06\x15", timeout_ms);
+        if (r == ACK) {
+            if (rtt) *rtt = (uint32_t)(now_us() - t0);
+            return 0;
+        }
+        if (r == CAN) return -1;
+        st->retransmits++;
+    }
+    return -1;
+}
+
+static int send_file(link_t* l, const char* name, const uint8_t* image, uint32_t total,
+                     uint32_t offset, int start, send_stats_t* st)
+{
+    int streaming = (start == START_G);
+    uint8_t pkt[1024 + 5];
+    uint8_t info[128];
+    uint32_t n, len;
+    int r = -1;
+
+    /* packet 0：文件名\0大小\0[+偏移\0] */
+    memset(info, 0, sizeof(info));
+    n = (uint32_t)snprintf((char*)info, sizeof(info), "%s", name) + 1;
+    n += (uint32_t)snprintf((char*)info + n, sizeof(info) - n, "%u", total) + 1;
+    if (offset > 0) {
+        snprintf((char*)info + n, sizeof(info) - n, "+%u", offset);
+    }
+    len = make_packet(pkt, 0, info, sizeof(info), 128, 0);
+
+    uint64_t t0 = now_us();
+    for (int retry = 0; retry < MAX_RETRY; retry++) {
+        port_write(l->fd, pkt, len);
+        if (streaming) {
+            r = link_wait_ctrl(l, "GC\x15", PKT_TIMEOUT_MS);
+            if (r == START_G) break;
+        } else {
+            r = link_wait_ctrl(l, "\x06\x15", PKT_TIMEOUT_MS);
+            if (r == ACK && (r = link_wait_ctrl(l, "C", PKT_TIMEOUT_MS)) == START_C) break;
+        }
+        if (r == CAN) {
+            fprintf(stderr, "receiver cancelled at file header\n");
+            return -1;
+        }
+        st->retransmits++;
+    }
+    if (r != START_G && r != START_C) {
+        fprintf(stderr, "no response to file header\n");
+        return -1;
+    }
+    st->hdr_us = now_us() - t0;
+
+    /* 数据包 */
+    uint8_t seq = 1;
+    uint64_t t_data = now_us();
+    for (uint32_t pos = offset; pos < total; pos += 1024, seq++) {
+        uint32_t chunk = (total - pos < 1024) ? total - pos : 1024;
+        len = make_packet(pkt, seq, image + pos, chunk, 1024, 0x1A);
+
+        if (streaming) {
+            port_write(l->fd, pkt, len);
+            /* 流式模式下接收方只会在出错时发送 CAN */
+            int c;
+            while ((c = port_read_byte(l->fd, 0)) >= 0) {
+                if (c == CAN) {
+                    fprintf(stderr, "\nreceiver cancelled at offset %u\n", pos);
+                    return -1;
+                }
+            }
+        } else if (send_acked(l, pkt, len, st, &st->rtt_us[st->rtt_count++], PKT_TIMEOUT_MS) != 0) {
+            fprintf(stderr, "\nfailed at offset %u\n", pos);
+            return -1;
+        }
+        st->packets++;
+
+        if (!l->verbose && (st->packets % 32) == 0) {
+            fprintf(stderr, "\r%u/%u", pos + chunk, total);
+        }
+    }
+
+    /* EOT：经典模式先 NAK 再 ACK；流式模式直接 ACK */
+    uint8_t eot = EOT;
+    for (int retry = 0; ; retry++) {
+        port_write(l->fd, &eot, 1);
+        r = link_wait_ctrl(l, "\x06\x15", PKT_TIMEOUT_MS);
+        if (r == ACK) break;
+        if (r == CAN || retry >= MAX_RETRY) {
+            fprintf(stderr, "\nEOT not acknowledged\n");
+            return -1;
+        }
+    }
+    st->data_us = now_us() - t_data;
+
+    if (link_wait_ctrl(l, "CG", PKT_TIMEOUT_MS) < 0) {
+        fprintf(stderr, "\nno request for end of batch\n");
+        return -1;
+    }
+
+    /* 结束包：设备在 ACK 之前刷新写入并提交 */
+    memset(info, 0, sizeof(info));
+    len = make_packet(pkt, 0, info, sizeof(info), 128, 0);
+    t0 = now_us();
+    if (send_acked(l, pkt, len, st, NULL, PKT_TIMEOUT_MS) != 0) {
+        fprintf(stderr, "\nno ACK for end of batch (write/commit failed?)\n");
+        return -1;
+    }
+    st->end_us = now_us() - t0;
+    fprintf(stderr, "\r%u/%u\n", total, total);
+    return 0;
+}
+
+/*============================================================================
+ * 报告
+ *============================================================================*/
+
+static void report(const send_stats_t* st, uint32_t bytes, uint32_t baud, int streaming,
+                   uint64_t total_us, uint64_t session_us)
+{
+    printf("mode            : %s @ %u baud\n", streaming ? "YMODEM-G" : "YMODEM (CRC)", baud);
+    printf("payload         : %u bytes in %u packets\n", bytes, st->packets);
+    printf("data phase      : %.3f s, %.0f B/s (line limit %.0f B/s)\n",
+           st->data_us / 1e6, bytes / (st->data_us / 1e6 + 1e-9), baud / 10.0);
+    printf("header -> start : %.3f s\n", st->hdr_us / 1e6);
+    printf("end -> ACK      : %.3f s\n", st->end_us / 1e6);
+    printf("retransmits     : %u\n", st->retransmits);
+
+    if (st->rtt_count > 0) {
+        uint32_t* s = malloc(st->rtt_count * sizeof(uint32_t));
+        uint64_t sum = 0;
+        memcpy(s, st->rtt_us, st->rtt_count * sizeof(uint32_t));
+        qsort(s, st->rtt_count, sizeof(uint32_t), cmp_u32);
+        for (uint32_t i = 0; i < st->rtt_count; i++) sum += s[i];
+        printf("packet RTT (us) : min %u  avg %llu  p50 %u  p99 %u  max %u\n",
+               s[0], (unsigned long long)(sum / st->rtt_count), s[st->rtt_count / 2],
+               s[(st->rtt_count * 99) / 100], s[st->rtt_count - 1]);
+        free(s);
+    } else {
+        printf("packet RTT (us) : n/a (streaming, no per-packet ACK)\n");
+    }
+
+    printf("session (start char -> ready) : %.3f s\n", session_us / 1e6);
+    printf("total (trigger -> ready)      : %.3f s, %.0f B/s\n",
+           total_us / 1e6, bytes / (total_us / 1e6 + 1e-9));
+}
+
+/*============================================================================
+ * 会话
+ *============================================================================*/
+
+/* 一次上传的输入 (对比模式下两次会话共用) */
+typedef struct {
+    const char*    name;
+    const uint8_t* image;
+    uint32_t       total;
+    uint32_t       img_crc;
+    const char*    trigger;
+    uint32_t       baud;
+    uint32_t       fast_baud;
+    int            no_resume;
+} job_t;
+
+/* 一次会话的结果 */
+typedef struct {
+    uint32_t baud;              /* 实际使用的会话波特率 */
+    int      streaming;
+    uint32_t bytes;             /* 实际发送的数据量 (续传时不含已提交部分) */
+    uint64_t total_us;          /* 触发 -> 设备 ACK 结束包 */
+    uint64_t session_us;        /* 发起字符 -> 设备 ACK 结束包 */
+    uint64_t data_us;           /* 第一个数据包 -> EOT 被确认 */
+} session_t;
+
+/**
+ * @brief  触发设备并完成一次上传
+ * @param  stream: 1=在协商中请求 YMODEM-G
+ * @retval 0=成功, -1=失败
+ */
+static int run_session(link_t* l, const job_t* j, int stream, send_stats_t* st, session_t* out)
+{
+    uint32_t offset = 0;
+    int start = -1, val, granted = 0;
+
+    out->baud = j->baud;
+
+    uint64_t t_start = now_us();
+    if (j->trigger) port_write(l->fd, j->trigger, (uint32_t)strlen(j->trigger));
+
+    /* 等待发起字符，期间处理 BAUD? / RESUME 横幅 */
+    uint64_t deadline = now_us() + 60000000u;
+
+    while (start < 0 && now_us() < deadline) {
+        event_t ev = link_read_event(l, &val, 1000);
+
+        if (ev == EV_LINE && strncmp(l->line, BAUD_BANNER, strlen(BAUD_BANNER)) == 0) {
+            char* p;
+            uint32_t max_offer = strtoul(l->line + strlen(BAUD_BANNER), &p, 10);
+            uint32_t gmax = strtoul(p, NULL, 10);
+            if (j->fast_baud || stream) {
+                granted = stream;
+                out->baud = negotiate_baud(l, max_offer, gmax, j->fast_baud ? j->fast_baud : j->baud,
+                                           j->baud, &granted);
+                fprintf(stderr, "session baud: %u%s\n", out->baud, granted ? " (YMODEM-G)" : "");
+            }
+        } else if (ev == EV_LINE && strncmp(l->line, RESUME_BANNER, strlen(RESUME_BANNER)) == 0) {
+            unsigned size, committed, crc;
+            if (!j->no_resume &&
+                sscanf(l->line + strlen(RESUME_BANNER), "%u %x %u", &size, &crc, &committed) == 3 &&
+                size == j->total && crc == j->img_crc) {
+                offset = committed;
+                fprintf(stderr, "resuming at %u/%u\n", offset, j->total);
+            }
+        } else if (ev == EV_CTRL && val == START_C) {
+            start = val;
+        } else if (ev == EV_CTRL && val == START_G && granted) {
+            start = val;
+        }
+    }
+    if (start < 0) {
+        fprintf(stderr, "receiver did not start\n");
+        return -1;
+    }
+
+    uint64_t t_session = now_us();
+    int ret = send_file(l, j->name, j->image, j->total, offset, start, st);
+    uint64_t t_ready = now_us();
+
+    /* 设备结束会话后恢复控制台波特率 */
+    if (out->baud != j->baud) {
+        port_set_baud(l->fd, j->baud);
+    }
+    port_discard_input(l->fd, 50);
+
+    out->streaming  = (start == START_G);
+    out->bytes      = j->total - offset;
+    out->total_us   = t_ready - t_start;
+    out->session_us = t_ready - t_session;
+    out->data_us    = st->data_us;
+    return ret;
+}
+
+static void write_rtt_log(const char* path, const send_stats_t* st)
+{
+    FILE* lf = fopen(path, "w");
+    if (!lf) return;
+
+    fprintf(lf, "packet,rtt_us\n");
+    for (uint32_t i = 0; i < st->rtt_count; i++) {
+        fprintf(lf, "%u,%u\n", i + 1, st->rtt_us[i]);
+    }
+    fclose(lf);
+}
+
+/*============================================================================
+ * 主流程
+ *============================================================================*/
+
+static void usage(const char* prog)
+{
+    fprintf(stderr,
+            "usage: %s <port> <image.bin> [--baud N] [--fast-baud N] [--trigger STR]\n"
+            "          [--stream | --compare] [--no-resume] [--rtt-log FILE] [-v]\n", prog);
+    exit(2);
+}
+
+int main(int argc, char** argv)
+{
+    const char* port = NULL;
+    const char* path = NULL;
+    const char* rtt_log = NULL;
+    int stream = 0, compare = 0;
+    link_t link = {0};
+    job_t job = { .baud = 460800 };
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if      (!strcmp(a, "--baud") && v)      { job.baud = strtoul(v, NULL, 0); i++; }
+        else if (!strcmp(a, "--fast-baud") && v) { job.fast_baud = strtoul(v, NULL, 0); i++; }
+        else if (!strcmp(a, "--trigger") && v)   { job.trigger = v; i++; }
+        else if (!strcmp(a, "--rtt-log") && v)   { rtt_log = v; i++; }
+        else if (!strcmp(a, "--stream"))         { stream = 1; }
+        else if (!strcmp(a, "--compare"))        { compare = 1; }
+        else if (!strcmp(a, "--no-resume"))      { job.no_resume = 1; }
+        else if (!strcmp(a, "-v"))               { link.verbose = 1; }
+        else if (a[0] == '-')                    { usage(argv[0]); }
+        else if (!port)                          { port = a; }
+        else if (!path)                          { path = a; }
+        else usage(argv[0]);
+    }
+    if (!port || !path || (stream && compare)) usage(argv[0]);
+
+    /* 读入镜像 */
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return 1;
+    }
+    fseek(f, 0, SEEK_END);
+    uint32_t total = (uint32_t)ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t* image = malloc(total ? total : 1);
+    if (fread(image, 1, total, f) != total) {
+        perror(path);
+        return 1;
+    }
+    fclose(f);
+
+    job.image = image;
+    job.total = total;
+    if (total >= HDR_SIZE) memcpy(&job.img_crc, image + HDR_CRC_OFF, 4);
+
+    const char* name = strrchr(path, '/');
+    job.name = name ? name + 1 : path;
+
+    /* 对比模式：同一线路上先请求 YMODEM-G 再经典 YMODEM，都从头上传 */
+    if (compare) job.no_resume = 1;
+
+    uint32_t* rtt_buf = calloc(total / 1024 + 2, sizeof(uint32_t));
+    session_t res[2];
+    int runs = compare ? 2 : 1;
+
+    link.fd = port_open(port, job.baud);
+    if (link.fd < 0) return 1;
+
+    for (int r = 0; r < runs; r++) {
+        int run_stream = compare ? (r == 0) : stream;
+        send_stats_t st = { .rtt_us = rtt_buf };
+
+        if (r > 0) {
+            usleep(500000);                 /* 等设备回到空闲 (丢弃会话残留后才响应触发) */
+        }
+        if (run_session(&link, &job, run_stream, &st, &res[r]) != 0) {
+            return 1;
+        }
+        if (compare) {
+            printf("--- %s ---\n", res[r].streaming ? "streaming" : "classic");
+        }
+        report(&st, res[r].bytes, res[r].baud, res[r].streaming, res[r].total_us, res[r].session_us);
+
+        if (rtt_log && st.rtt_count > 0) {
+            write_rtt_log(rtt_log, &st);
+        }
+    }
+
+    /* 两次会话的协商与续传握手时间不同，按发起字符之后的时间对比 */
+    if (compare) {
+        printf("--- compare (same link, start char -> ready) ---\n");
+        for (int r = 0; r < 2; r++) {
+            printf("%-13s: data %.0f B/s, session %.3f s @ %u baud\n",
+                   res[r].streaming ? "YMODEM-G" : "YMODEM (CRC)",
+                   res[r].bytes / (res[r].data_us / 1e6 + 1e-9), res[r].session_us / 1e6, res[r].baud);
+        }
+        printf("speedup      : data %.2fx, session %.2fx\n",
+               res[0].data_us ? (double)res[1].data_us / (double)res[0].data_us : 0.0,
+               res[0].session_us ? (double)res[1].session_us / (double)res[0].session_us : 0.0);
+    }
+
+    close(link.fd);
+    free(rtt_buf);
+    free(image);
+    return 0;
+}
@@ -0,0 +1,246 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+Upload a firmware image to the bootloader over USART1.
+
+Speaks the bootloader's session handshakes before plain YMODEM:
+  - baud-rate upshift ("BAUD?" offer, echo probe, automatic fallback)
+  - resume of an interrupted upload ("RESUME" banner, "+offset" in packet 0)
+and then sends the file with classic YMODEM (CRC16), or with YMODEM-G when
+--stream is given and the device grants it during the baud negotiation.
+
+Requires pyserial. The port argument may also be a pty path.
+"""
+
+import argparse
+import struct
+import sys
+import time
+from pathlib import Path
+
+import serial
+
+SOH, STX, EOT, ACK, NAK, CAN = 0x01, 0x02, 0x04, 0x06, 0x15, 0x18
+START_C, START_G = ord("C"), ord("G")
+
+BAUD_BANNER = b"BAUD?"
+BAUD_PROBE = b"SYNC\x55\xAA\x0F\xF0"
+RESUME_BANNER = b"RESUME"
+
+HDR_SIZE = 0x200
+HDR_CRC_OFF = 24
+
+
+def crc16_ccitt(data: bytes) -> int:
+    crc = 0
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def make_packet(seq: int, payload: bytes, size: int, pad: int = 0x1A) -> bytes:
+    data = payload.ljust(size, bytes([pad]))
+    hdr = bytes([STX if size == 1024 else SOH, seq & 0xFF, 0xFF - (seq & 0xFF)])
+    return hdr + data + struct.pack(">H", crc16_ccitt(data))
+
+
+class Link:
+    """Byte stream with line tracking, so that 'C'/'G' inside log text is ignored."""
+
+    def __init__(self, port: serial.Serial, verbose: bool = False):
+        self.port = port
+        self.verbose = verbose
+        self.line = bytearray()
+
+    def read_event(self, timeout: float):
+        """Return ('ctrl', byte) for protocol bytes or ('line', bytes) for a text line."""
+        deadline = time.monotonic() + timeout
+        while time.monotonic() < deadline:
+            b = self.port.read(1)
+            if not b:
+                continue
+            c = b[0]
+            if c in (ACK, NAK, CAN, EOT) or (c in (START_C, START_G) and not self.line):
+                return "ctrl", c
+            if c == ord("\n"):
+                text = bytes(self.line).rstrip(b"\r")
+                self.line.clear()
+                if self.verbose:
+                    print(f"< {text.decode(errors='replace')}")
+                return "line", text
+            self.line.append(c)
+        return None, None
+
+    def wait_ctrl(self, wanted, timeout: float):
+        deadline = time.monotonic() + timeout
+        while True:
+            left = deadline - time.monotonic()
+            if left <= 0:
+                return None
+            kind, val = self.read_event(left)
+            if kind == "ctrl" and (val in wanted or val == CAN):
+                return val
+
+
+def negotiate_baud(link: Link, max_offer: int, gmax: int, want: int, console: int,
+                   stream: bool = False, switch_delay: float = 0.02):
+    """Answer a 'BAUD? <max> <gmax>' offer.
+
+    With stream=True YMODEM-G is requested as well, at no more than <gmax>.
+    Returns (baud rate in use afterwards, True if the device granted YMODEM-G).
+    """
+    stream = stream and gmax >= console
+    rate = min(want, max_offer, gmax) if stream else min(want, max_offer)
+    rate = max(rate, console)
+    if rate == console and not stream:
+        return console, False
+    link.port.write(b"BAUD %d%s\r\n" % (rate, b" G" if stream else b""))
+
+    deadline = time.monotonic() + 1.0
+    while time.monotonic() < deadline:
+        kind, val = link.read_event(deadline - time.monotonic())
+        if kind != "line":
+            continue
+        if val.startswith(b"BAUD NO"):
+            return console, False
+        if val.startswith(b"BAUD OK"):
+            granted = val.split()[3:] == [b"G"]
+            break
+    else:
+        return console, False
+    if rate == console:
+        return console, granted
+
+    time.sleep(switch_delay)
+    link.port.baudrate = rate
+    link.port.reset_input_buffer()
+    link.line.clear()
+    link.port.write(BAUD_PROBE)
+
+    # Read byte-wise so nothing after the echo (e.g. the start character) is consumed.
+    echo = bytearray()
+    deadline = time.monotonic() + 0.5
+    while time.monotonic() < deadline and not echo.endswith(BAUD_PROBE):
+        echo += link.port.read(1)
+    if echo.endswith(BAUD_PROBE):
+        return rate, granted
+
+    # Device falls back (to classic YMODEM as well) after its own probe window; follow it.
+    link.port.baudrate = console
+    time.sleep(0.6)
+    link.port.reset_input_buffer()
+    return console, False
+
+
+def send_file(link: Link, name: str, image: bytes, offset: int, start: int) -> None:
+    streaming = start == START_G
+    port = link.port
+
+    info = name.encode() + b"\0" + str(len(image)).encode() + b"\0"
+    if offset:
+        info += b"+" + str(offset).encode() + b"\0"
+    pkt0 = make_packet(0, info, 128, pad=0)
+
+    for _ in range(10):
+        port.write(pkt0)
+        if streaming:
+            r = link.wait_ctrl((START_G, NAK), 10.0)
+            if r == START_G:
+                break
+        else:
+            r = link.wait_ctrl((ACK, NAK), 10.0)
+            if r == ACK and link.wait_ctrl((START_C,), 10.0) == START_C:
+                break
+        if r == CAN:
+            raise SystemExit("receiver cancelled at file header")
+    else:
+        raise SystemExit("no response to file header")
+
+    seq, pos, total = 1, offset, len(image)
+    t0 = time.monotonic()
+    while pos < total:
+        pkt = make_packet(seq, image[pos:pos + 1024], 1024)
+        if streaming:
+            port.write(pkt)
+            if port.in_waiting and CAN in port.read(port.in_waiting):
+                raise SystemExit(f"receiver cancelled at offset {pos}")
+        else:
+            for _ in range(10):
+                port.write(pkt)
+                r = link.wait_ctrl((ACK, NAK), 10.0)
+                if r == ACK:
+                    break
+                if r == CAN:
+                    raise SystemExit(f"receiver cancelled at offset {pos}")
+            else:
+                raise SystemExit(f"too many retries at offset {pos}")
+        pos += 1024
+        seq = (seq + 1) & 0xFF
+        sys.stdout.write(f"\r{min(pos, total)}/{total}")
+        sys.stdout.flush()
+    dt = time.monotonic() - t0
+    print(f"\nsent {total - offset} bytes in {dt:.2f}s ({(total - offset) / max(dt, 1e-6):.0f} B/s)")
+
+    port.write(bytes([EOT]))
+    if not streaming:
+        if link.wait_ctrl((NAK, ACK), 10.0) == NAK:
+            port.write(bytes([EOT]))
+            link.wait_ctrl((ACK,), 10.0)
+    else:
+        link.wait_ctrl((ACK,), 10.0)
+    link.wait_ctrl((START_C, START_G), 10.0)
+
+    port.write(make_packet(0, b"", 128, pad=0))
+    if link.wait_ctrl((ACK,), 10.0) != ACK:
+        raise SystemExit("no ACK for end of batch (verify/commit failed?)")
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("port", help="serial port or pty path")
+    ap.add_argument("bin", help="image .bin (header already filled by fill_hdr_crc.py)")
+    ap.add_argument("--baud", type=int, default=460800, help="console baud rate (default 460800)")
+    ap.add_argument("--fast-baud", type=int, default=4000000, help="session baud to propose, 0 = no upshift")
+    ap.add_argument("--stream", action="store_true",
+                    help="request YMODEM-G (no per-packet ACK, any error aborts the upload)")
+    ap.add_argument("--trigger", default=None, help="string sent first to enter upgrade mode (e.g. U)")
+    ap.add_argument("--no-resume", action="store_true", help="always upload from the start")
+    ap.add_argument("-v", "--verbose", action="store_true")
+    args = ap.parse_args()
+
+    image = Path(args.bin).read_bytes()
+    img_crc = struct.unpack_from("<I", image, HDR_CRC_OFF)[0] if len(image) >= HDR_SIZE else None
+
+    port = serial.Serial(args.port, args.baud, timeout=0.05)
+    link = Link(port, args.verbose)
+    if args.trigger:
+        port.write(args.trigger.encode())
+
+    offset = 0
+    streaming = False
+    deadline = time.monotonic() + 60.0
+    while time.monotonic() < deadline:
+        kind, val = link.read_event(deadline - time.monotonic())
+        if kind == "line" and val.startswith(BAUD_BANNER) and (args.fast_baud or args.stream):
+            _, max_offer, gmax = val.split()
+            rate, streaming = negotiate_baud(link, int(max_offer), int(gmax), args.fast_baud or args.baud,
+                                             args.baud, args.stream)
+            print(f"session baud: {rate}" + (" (YMODEM-G)" if streaming else ""))
+        elif kind == "line" and val.startswith(RESUME_BANNER) and not args.no_resume:
+            _, size, crc, committed = val.split()
+            if int(size) == len(image) and int(crc, 16) == img_crc:
+                offset = int(committed)
+                print(f"resuming at {offset}/{len(image)}")
+        elif kind == "ctrl" and (val == START_C or (val == START_G and streaming)):
+            send_file(link, Path(args.bin).name, image, offset, val)
+            port.baudrate = args.baud
+            print("upload complete")
+            return
+    raise SystemExit("receiver did not start")
+
+
+if __name__ == "__main__":
+    main()